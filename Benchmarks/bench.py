@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+"""Headless benchmark suite for the ns-3 and OMNeT++ scenarios.
+
+Every benchmark runs one topology without TAP devices and without a realtime
+scheduler, on a synthetic workload that draws the same random numbers on
+every run, so two runs execute the same events and only the speed differs:
+
+  manet-aodv-static       ns-3, 32-node AODV MANET, UDP echo across the network
+  tap-wifi-aodv           ns-3, 4 mobile AODV nodes, UDP echo
+  tap-csma-line           ns-3, 4 nodes on one CSMA channel, UDP echo
+  TictocExtended          OMNeT++, 1000-node middleman chain (Config BenchSuite)
+  VideoStreamingShowcase  OMNeT++/INET, UDP stream through the NAT router (Config Bench)
+
+For each one it collects events/sec, simulated seconds per wall second, peak
+RSS and heap allocations, writes them to a JSON file and compares them with a
+stored baseline. The exit status is 1 if a metric got worse by more than its
+threshold, or if a benchmark failed to run.
+
+  ./Benchmarks/bench.py                     # run everything, compare with baseline.json
+  ./Benchmarks/bench.py --save-baseline     # run and store the results as the new baseline
+  ./Benchmarks/bench.py tap-csma-line --repeat 5 --threshold events_per_sec=5
+
+ns-3 benchmarks run in the ns-3 container ($NS3_CONTAINER, default ns-3),
+OMNeT++ benchmarks on the host (opp_makemake and INET must be set up, see
+$INET_ROOT). Benchmarks whose environment is missing are skipped, not failed.
+"""
+
+import argparse
+import datetime
+import json
+import os
+import platform
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+REPO = os.path.dirname(HERE)
+PROJECTS = os.path.join(REPO, "Projects")
+
+NS3_CONTAINER = os.environ.get("NS3_CONTAINER", "ns-3")
+INET_ROOT = os.environ.get("INET_ROOT", os.path.join(PROJECTS, "inet-4.5.4"))
+
+# metric: (direction, default threshold in percent); +1 means higher is better
+METRICS = {
+    "events_per_sec": (+1, 10.0),
+    "sim_per_wall": (+1, 10.0),
+    "peak_rss_kb": (-1, 10.0),
+    "allocations": (-1, 2.0),
+}
+
+
+class Skip(Exception):
+    """The benchmark cannot run here (tool or container missing)"""
+
+
+class Failed(Exception):
+    """The benchmark ran and failed"""
+
+
+def run(cmd, cwd=None, timeout=None):
+    """Runs cmd, returns its combined output; raises Failed on a non-zero exit"""
+    try:
+        proc = subprocess.run(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              universal_newlines=True, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        raise Failed("timed out after %ss: %s" % (timeout, " ".join(cmd)))
+    if proc.returncode != 0:
+        tail = "\n".join(proc.stdout.splitlines()[-10:])
+        raise Failed("exit status %d: %s\n%s" % (proc.returncode, " ".join(cmd), tail))
+    return proc.stdout
+
+
+def search(pattern, output, what):
+    """Last match of pattern in output"""
+    matches = re.findall(pattern, output, re.MULTILINE)
+    if not matches:
+        raise Failed("no %s in the output" % what)
+    return matches[-1]
+
+
+# ns-3 ------------------------------------------------------------------------
+
+class Ns3Benchmark:
+    kind = "ns-3"
+
+    def __init__(self, name, args):
+        self.name = name
+        # The *-count-allocs.cc wrapper of the scenario, built with T4_COUNT_ALLOCS
+        self.program = "scratch/" + name + "-count-allocs"
+        self.args = args
+
+    def check(self, build):
+        if shutil.which("docker") is None:
+            raise Skip("docker not found")
+        try:
+            state = subprocess.run(["docker", "inspect", "-f", "{{.State.Running}}", NS3_CONTAINER],
+                                   stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, universal_newlines=True)
+        except OSError as e:
+            raise Skip(str(e))
+        if state.stdout.strip() != "true":
+            raise Skip("container %s is not running" % NS3_CONTAINER)
+
+    def build(self, timeout):
+        run(["docker", "exec", NS3_CONTAINER, "./ns3", "build", self.program], timeout=timeout)
+
+    def measure(self, timeout):
+        out = run(["docker", "exec", NS3_CONTAINER, "./ns3", "run", "--no-build",
+                   self.program + " " + self.args], timeout=timeout)
+        # RunStats::Print (run-stats.h)
+        events = int(search(r"^Events: (\d+) \(", out, "Events line"))
+        wall, ratio = search(r"^Wall time: (\S+) s \(sim/wall=(\S+)\)", out, "Wall time line")
+        rss = int(search(r"^RSS: current=\d+ kB peak=(\d+) kB", out, "RSS line"))
+        allocations = int(search(r"^Allocations: (-?\d+)", out, "Allocations line"))
+        if allocations < 0:
+            raise Failed("%s was built without -DT4_COUNT_ALLOCS" % self.program)
+        wall = float(wall)
+        return {
+            "events": events,
+            "wall_s": wall,
+            "sim_s": float(ratio) * wall,
+            "events_per_sec": events / wall if wall > 0 else 0.0,
+            "sim_per_wall": float(ratio),
+            "peak_rss_kb": rss,
+            "allocations": allocations,
+        }
+
+
+# OMNeT++ ---------------------------------------------------------------------
+
+def parse_bench_line(out):
+    """key=value fields of the last BENCH line (AppPacketPool, BenchStats)"""
+    line = search(r"^BENCH (.*)$", out, "BENCH line")
+    fields = dict(f.split("=", 1) for f in line.split() if "=" in f)
+    try:
+        events = int(fields["events"])
+        wall = float(fields["wall"])
+        sim_per_wall = float(fields["simsec/s"])
+        return {
+            "events": events,
+            "wall_s": wall,
+            "sim_s": sim_per_wall * wall,
+            "events_per_sec": events / wall if wall > 0 else 0.0,
+            "sim_per_wall": sim_per_wall,
+            "peak_rss_kb": int(fields["rss_kb"]),
+            "allocations": int(fields["allocs"]),
+        }
+    except (KeyError, ValueError) as e:
+        raise Failed("incomplete BENCH line (%s): %s" % (e, line))
+
+
+class TictocBenchmark:
+    kind = "OMNeT++"
+    name = "TictocExtended"
+    project = os.path.join(PROJECTS, "tutorial-tic-toc-extended")
+
+    def check(self, build):
+        if build and shutil.which("opp_makemake") is None:
+            raise Skip("opp_makemake not found (source the OMNeT++ setenv first)")
+        if not build and not os.path.exists(os.path.join(self.project, "tictoc")):
+            raise Skip("tictoc is not built")
+
+    def build(self, timeout):
+        # Same build as bench.sh: release, with the allocation counter
+        run(["opp_makemake", "-f", "-o", "tictoc", "-DTICTOC_COUNT_ALLOCS"], cwd=self.project, timeout=timeout)
+        run(["make", "MODE=release"], cwd=self.project, timeout=timeout)
+
+    def measure(self, timeout):
+        out = run(["./tictoc", "-u", "Cmdenv", "-c", "BenchSuite", "-r", "0"], cwd=self.project, timeout=timeout)
+        result = parse_bench_line(out)
+        if result["allocations"] < 0:
+            raise Failed("tictoc was built without -DTICTOC_COUNT_ALLOCS")
+        return result
+
+
+class VideoStreamingBenchmark:
+    kind = "OMNeT++"
+    name = "VideoStreamingShowcase"
+    project = os.path.join(PROJECTS, "TapAdhoc")
+
+    def check(self, build):
+        if not os.path.isdir(os.path.join(INET_ROOT, "src")):
+            raise Skip("INET not found at %s (set INET_ROOT)" % INET_ROOT)
+        if build and shutil.which("opp_configfilepath") is None:
+            raise Skip("OMNeT++ not found (source the OMNeT++ setenv first)")
+        if not build and not os.path.exists(os.path.join(self.project, "src", "TapAdhoc")):
+            raise Skip("TapAdhoc is not built")
+
+    def build(self, timeout):
+        run(["make", "MODE=release", "COUNT_ALLOCS=1", "INET_4_5_4_PROJ=" + INET_ROOT], cwd=self.project, timeout=timeout)
+
+    def measure(self, timeout):
+        simulations = os.path.join(self.project, "simulations")
+        ned_path = ".:../src:" + os.path.join(INET_ROOT, "src")
+        out = run(["../src/TapAdhoc", "-u", "Cmdenv", "-c", "Bench", "-n", ned_path, "-f", "omnetpp.ini"],
+                  cwd=simulations, timeout=timeout)
+        result = parse_bench_line(out)
+        if result["allocations"] < 0:
+            raise Failed("TapAdhoc was built without COUNT_ALLOCS=1")
+        return result
+
+
+BENCHMARKS = [
+    Ns3Benchmark("manet-aodv-static",
+                 "--tap=false --anim=false --pcap=false --eventLog= --metricsInterval=0 --nodes=32 --time=120"),
+    Ns3Benchmark("tap-wifi-aodv", "--tap=false --pcap=false --time=300 --echoInterval=0.1"),
+    Ns3Benchmark("tap-csma-line", "--tap=false --pcap=false --metricsInterval=0 --time=60 --echoInterval=0.001"),
+    TictocBenchmark(),
+    VideoStreamingBenchmark(),
+]
+
+
+# Results and comparison ------------------------------------------------------
+
+def machine():
+    cpu = platform.processor()
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    cpu = line.split(":", 1)[1].strip()
+                    break
+    except OSError:
+        pass
+    return {"host": platform.node(), "cpu": cpu, "cpus": os.cpu_count()}
+
+
+def git_revision():
+    try:
+        return subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=REPO, stdout=subprocess.PIPE,
+                              stderr=subprocess.DEVNULL, universal_newlines=True).stdout.strip()
+    except OSError:
+        return ""
+
+
+def median_of(runs):
+    """Per metric median over repeated runs"""
+    result = {}
+    for key in runs[0]:
+        value = statistics.median(r[key] for r in runs)
+        result[key] = int(value) if all(isinstance(r[key], int) for r in runs) else value
+    result["repeats"] = len(runs)
+    return result
+
+
+def compare(name, current, baseline, thresholds):
+    """Prints one row per metric; returns the names of regressed metrics"""
+    regressed = []
+    for metric, (direction, _) in METRICS.items():
+        old, new = baseline.get(metric), current.get(metric)
+        if old is None or new is None:
+            continue
+        if old <= 0:
+            change = 0.0
+        else:
+            change = (new - old) / old * 100
+        limit = thresholds[metric]
+        if direction * change < -limit:
+            status = "REGRESSION"
+            regressed.append(metric)
+        elif direction * change > limit:
+            status = "improved"
+        else:
+            status = "ok"
+        print("  %-16s %14.6g %14.6g %+8.1f%%  (limit %.0f%%)  %s" % (metric, old, new, change, limit, status))
+    if baseline.get("events") != current.get("events"):
+        print("  note: %s executed %s events, the baseline %s; the workload or the model changed, "
+              "so the rates are not strictly comparable" % (name, current.get("events"), baseline.get("events")))
+    return regressed
+
+
+def parse_thresholds(items):
+    thresholds = {metric: limit for metric, (_, limit) in METRICS.items()}
+    for item in items:
+        metric, _, value = item.partition("=")
+        if metric not in METRICS or not value:
+            raise SystemExit("--threshold expects one of %s=<percent>, got %r" % (", ".join(METRICS), item))
+        thresholds[metric] = float(value)
+    return thresholds
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0],
+                                     epilog="Benchmarks: " + ", ".join(b.name for b in BENCHMARKS))
+    parser.add_argument("names", nargs="*", help="benchmarks to run (default: all)")
+    parser.add_argument("--repeat", type=int, default=1, help="runs per benchmark; the median is kept")
+    parser.add_argument("--no-build", action="store_true", help="use the existing binaries")
+    parser.add_argument("--timeout", type=float, default=3600, help="seconds per build or run")
+    parser.add_argument("--out", default=os.path.join(HERE, "results.json"), help="results file")
+    parser.add_argument("--baseline", default=os.path.join(HERE, "baseline.json"), help="baseline file")
+    parser.add_argument("--save-baseline", action="store_true",
+                        help="store the results in the baseline file instead of comparing")
+    parser.add_argument("--threshold", action="append", default=[], metavar="METRIC=PERCENT",
+                        help="allowed change before a metric counts as regressed (repeatable)")
+    args = parser.parse_args()
+
+    thresholds = parse_thresholds(args.threshold)
+    known = {b.name: b for b in BENCHMARKS}
+    for name in args.names:
+        if name not in known:
+            parser.error("unknown benchmark %r" % name)
+    selected = [known[n] for n in args.names] if args.names else BENCHMARKS
+
+    results = {
+        "date": datetime.datetime.now().isoformat(timespec="seconds"),
+        "revision": git_revision(),
+        "machine": machine(),
+        "benchmarks": {},
+        "skipped": {},
+        "failed": {},
+    }
+    for bench in selected:
+        print("== %s (%s)" % (bench.name, bench.kind), flush=True)
+        try:
+            bench.check(not args.no_build)
+            if not args.no_build:
+                bench.build(args.timeout)
+            runs = []
+            for i in range(args.repeat):
+                runs.append(bench.measure(args.timeout))
+                r = runs[-1]
+                print("   run %d: %d events, %.0f events/s, sim/wall %.3g, peak RSS %d kB, %d allocations"
+                      % (i + 1, r["events"], r["events_per_sec"], r["sim_per_wall"], r["peak_rss_kb"],
+                         r["allocations"]), flush=True)
+            results["benchmarks"][bench.name] = median_of(runs)
+        except Skip as e:
+            print("   skipped: %s" % e)
+            results["skipped"][bench.name] = str(e)
+        except Failed as e:
+            print("   FAILED: %s" % e)
+            results["failed"][bench.name] = str(e)
+
+    with open(args.out, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+        f.write("\n")
+    print("\nResults: %s" % args.out)
+
+    if args.save_baseline:
+        baseline = {"benchmarks": {}}
+        if os.path.exists(args.baseline):
+            with open(args.baseline) as f:
+                baseline = json.load(f)
+        # Keep the entries of benchmarks that did not run this time
+        baseline["benchmarks"].update(results["benchmarks"])
+        baseline["date"] = results["date"]
+        baseline["revision"] = results["revision"]
+        baseline["machine"] = results["machine"]
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("Baseline updated: %s" % args.baseline)
+        return 1 if results["failed"] else 0
+
+    if not os.path.exists(args.baseline):
+        print("No baseline at %s; run with --save-baseline to create one" % args.baseline)
+        return 1 if results["failed"] else 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    if baseline.get("machine", {}).get("cpu") != results["machine"]["cpu"]:
+        print("Warning: the baseline was measured on %s, this is %s"
+              % (baseline.get("machine", {}).get("cpu"), results["machine"]["cpu"]))
+    print("\nComparison with %s (revision %s):" % (args.baseline, baseline.get("revision", "?")))
+    regressions = {}
+    for name, current in results["benchmarks"].items():
+        print("%s:" % name)
+        if name not in baseline["benchmarks"]:
+            print("  not in the baseline")
+            continue
+        regressed = compare(name, current, baseline["benchmarks"][name], thresholds)
+        if regressed:
+            regressions[name] = regressed
+
+    for name, metrics in regressions.items():
+        print("REGRESSION %s: %s" % (name, ", ".join(metrics)))
+    for name in results["failed"]:
+        print("FAILED %s" % name)
+    return 1 if regressions or results["failed"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,88 @@
+"""Offer UDP traffic at a fixed rate through the emulated network and
+report throughput, loss and one-way latency.
+
+Datagrams go to the router's NAT address 192.168.2.99 (like the video
+stream in run) and come back to the host on 192.168.3.20, so the same
+script measures the TAP setup (setup.sh, General config) and the ring
+setup (setup-ring.sh, Ring config). Start the simulation first.
+
+    python3 ratebench.py --rate 20000 --duration 10 --label ring
+"""
+
+import argparse
+import socket
+import struct
+import threading
+import time
+
+HEADER = struct.Struct("!QQ")   # sequence number, send time (ns)
+
+
+def receive(sock, results, stop):
+    while not stop.is_set():
+        try:
+            data = sock.recv(2048)
+        except socket.timeout:
+            continue
+        now = time.time_ns()
+        seq, sent = HEADER.unpack_from(data)
+        results.append((seq, now - sent, now))
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--rate", type=float, default=10000, help="datagrams per second")
+    parser.add_argument("--duration", type=float, default=5, help="seconds of traffic")
+    parser.add_argument("--size", type=int, default=64, help="UDP payload bytes")
+    parser.add_argument("--dst", default="192.168.2.99")
+    parser.add_argument("--listen", default="192.168.3.20")
+    parser.add_argument("--port", type=int, default=4004)
+    parser.add_argument("--label", default="", help="tag for the RESULT line, e.g. tap or ring")
+    args = parser.parse_args()
+
+    rx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    rx.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 8 << 20)
+    rx.bind((args.listen, args.port))
+    rx.settimeout(0.2)
+    tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    results = []
+    stop = threading.Event()
+    receiver = threading.Thread(target=receive, args=(rx, results, stop))
+    receiver.start()
+
+    padding = bytes(max(0, args.size - HEADER.size))
+    interval = 1e9 / args.rate
+    count = int(args.rate * args.duration)
+    start = time.perf_counter_ns()
+    for seq in range(count):
+        # pace against the schedule, not the previous send, so jitter does not accumulate
+        deadline = start + seq * interval
+        while time.perf_counter_ns() < deadline:
+            pass
+        tx.sendto(HEADER.pack(seq, time.time_ns()) + padding, (args.dst, args.port))
+    sendTime = (time.perf_counter_ns() - start) / 1e9
+
+    time.sleep(1.0)     # let the last datagrams drain through the simulation
+    stop.set()
+    receiver.join()
+
+    latencies = sorted(r[1] for r in results)
+    received = len({r[0] for r in results})
+    span = (results[-1][2] - results[0][2]) / 1e9 if len(results) > 1 else 0
+    print("RESULT label=%s sent=%d received=%d loss=%.2f%% tx_pps=%.0f rx_pps=%.0f "
+          "latency_p50_ms=%.3f latency_p99_ms=%.3f latency_max_ms=%.3f" % (
+              args.label or "-", count, received, 100.0 * (count - received) / max(count, 1),
+              count / sendTime if sendTime > 0 else 0, (len(results) - 1) / span if span > 0 else 0,
+              percentile(latencies, 50) / 1e6, percentile(latencies, 99) / 1e6,
+              (latencies[-1] if latencies else float("nan")) / 1e6))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,12 @@
+# create veth pairs: the simulation opens packet rings on ringa/ringb,
+# the host stack uses ringa-host/ringb-host (same addresses as tapa/tapb)
+sudo ip link add ringa type veth peer name ringa-host
+sudo ip link add ringb type veth peer name ringb-host
+# assign IP addresses to the host side
+sudo ip addr add 192.168.2.20/24 dev ringa-host
+sudo ip addr add 192.168.3.20/24 dev ringb-host
+# bring up all interfaces
+sudo ip link set dev ringa up
+sudo ip link set dev ringa-host up
+sudo ip link set dev ringb up
+sudo ip link set dev ringb-host up
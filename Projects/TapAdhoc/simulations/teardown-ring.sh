@@ -0,0 +1,3 @@
+# destroy veth pairs (removing one end removes its peer)
+sudo ip link del dev ringa
+sudo ip link del dev ringb
@@ -0,0 +1,72 @@
+//
+// Heap allocation counter for the benchmark configuration.
+//
+
+#include "AllocCounter.h"
+
+#ifdef TAPADHOC_COUNT_ALLOCS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<int64_t> allocations{0};
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace tapadhoc {
+
+int64_t allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace tapadhoc
+
+#else
+
+namespace tapadhoc {
+
+int64_t allocationCount()
+{
+    return -1;
+}
+
+} // namespace tapadhoc
+
+#endif
@@ -0,0 +1,22 @@
+//
+// Heap allocation counter for the benchmark configuration.
+//
+
+#ifndef __TAPADHOC_ALLOCCOUNTER_H
+#define __TAPADHOC_ALLOCCOUNTER_H
+
+#include <cstdint>
+
+namespace tapadhoc {
+
+/**
+ * Number of allocations through operator new since the program started,
+ * or -1 unless built with -DTAPADHOC_COUNT_ALLOCS (make COUNT_ALLOCS=1).
+ * The counter replaces the global operator new of the executable, so
+ * allocations inside INET and the simulation kernel are counted too.
+ */
+int64_t allocationCount();
+
+} // namespace tapadhoc
+
+#endif
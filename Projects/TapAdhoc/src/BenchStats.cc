@@ -0,0 +1,52 @@
+//
+// Run measurements for the headless benchmark configuration.
+//
+
+#include "BenchStats.h"
+
+#include <iostream>
+#include <sys/resource.h>
+
+#include "AllocCounter.h"
+
+namespace tapadhoc {
+
+Define_Module(BenchStats);
+
+void BenchStats::initialize(int stage)
+{
+    // Start measuring once the whole network is set up
+    if (stage == NUM_INIT_STAGES - 1) {
+        startWall = std::chrono::steady_clock::now();
+        startAllocations = allocationCount();
+    }
+}
+
+void BenchStats::finish()
+{
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - startWall).count();
+    eventnumber_t events = getSimulation()->getEventNumber();
+    double eventsPerSec = wall > 0 ? events / wall : 0;
+    double simsecPerSec = wall > 0 ? simTime().dbl() / wall : 0;
+    int64_t allocations = allocationCount();
+    if (allocations >= 0)
+        allocations -= startAllocations;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peakRss = usage.ru_maxrss;     // kB
+
+    recordScalar("events", events);
+    recordScalar("wallTime", wall, "s");
+    recordScalar("eventsPerSec", eventsPerSec);
+    recordScalar("simsecPerSec", simsecPerSec);
+    recordScalar("peakRss", peakRss, "kB");
+    if (allocations >= 0)
+        recordScalar("allocations", allocations);
+
+    std::cout << "BENCH network=" << getSimulation()->getSystemModule()->getComponentType()->getName()
+              << " events=" << events << " wall=" << wall << " events/s=" << (long)eventsPerSec
+              << " simsec/s=" << simsecPerSec << " rss_kb=" << peakRss << " allocs=" << allocations << std::endl;
+}
+
+} // namespace tapadhoc
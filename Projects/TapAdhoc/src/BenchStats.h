@@ -0,0 +1,37 @@
+//
+// Run measurements for the headless benchmark configuration.
+//
+
+#ifndef __TAPADHOC_BENCHSTATS_H
+#define __TAPADHOC_BENCHSTATS_H
+
+#include <chrono>
+
+#include "inet/common/INETDefs.h"
+
+namespace tapadhoc {
+
+using namespace inet;
+
+/**
+ * Measures the run it is part of: events per second, simulated seconds per
+ * wall-clock second, peak RSS and heap allocations (AllocCounter.h; -1
+ * unless built with the counter). The values are recorded as scalars and
+ * printed as one BENCH line, which also shows up in express mode.
+ */
+class BenchStats : public cSimpleModule
+{
+  protected:
+    std::chrono::steady_clock::time_point startWall;
+    int64_t startAllocations = 0;
+
+  protected:
+    virtual int numInitStages() const override { return NUM_INIT_STAGES; }
+    virtual void initialize(int stage) override;
+    virtual void handleMessage(cMessage *msg) override { throw cRuntimeError("This module does not handle messages"); }
+    virtual void finish() override;
+};
+
+} // namespace tapadhoc
+
+#endif
@@ -0,0 +1,218 @@
+//
+// External Ethernet device that exchanges frames with a host interface
+// through PACKET_MMAP rings instead of one read()/write() per frame.
+//
+
+#include "ExtRingEthernetDevice.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <vector>
+
+#include "inet/common/ModuleAccess.h"
+#include "inet/common/ProtocolTag_m.h"
+#include "inet/common/Simsignals.h"
+#include "inet/common/packet/chunk/BytesChunk.h"
+#include "inet/linklayer/ethernet/common/Ethernet.h"
+#include "inet/linklayer/ethernet/common/EthernetMacHeader_m.h"
+
+#include "FrameChecksum.h"
+
+namespace tapadhoc {
+
+Define_Module(ExtRingEthernetDevice);
+
+simsignal_t ExtRingEthernetDevice::rxLatencySignal = cComponent::registerSignal("rxLatency");
+
+namespace {
+
+int64_t realtimeNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+} // namespace
+
+ExtRingEthernetDevice::~ExtRingEthernetDevice()
+{
+    cancelAndDelete(flushTimer);
+    closeRing();
+}
+
+void ExtRingEthernetDevice::initialize(int stage)
+{
+    cSimpleModule::initialize(stage);
+    if (stage == INITSTAGE_LOCAL) {
+        device = par("device").stdstringValue();
+        fixChecksums = par("fixChecksums");
+        networkInterface = getContainingNicModule(this);
+        flushTimer = new cMessage("flush");
+        rtScheduler = check_and_cast<RealTimeScheduler *>(getSimulation()->getScheduler());
+        openRing();
+        WATCH(numSent);
+        WATCH(numReceived);
+        WATCH(numDropped);
+    }
+    else if (stage == INITSTAGE_NETWORK_INTERFACE_CONFIGURATION) {
+        // The simulated interface stands in for the host side of the link,
+        // so it takes that side's address (like copyFromExt for TAPs)
+        const char *macDevice = par("macDevice");
+        if (*macDevice) {
+            uint8_t bytes[MAC_ADDRESS_SIZE];
+            std::string error;
+            if (!PacketRing::getMacAddress(macDevice, bytes, error))
+                throw cRuntimeError("Cannot read MAC address of '%s': %s", macDevice, error.c_str());
+            MacAddress address;
+            address.setAddressBytes(bytes);
+            networkInterface->setMacAddress(address);
+        }
+    }
+}
+
+void ExtRingEthernetDevice::openRing()
+{
+    PacketRing::Options options;
+    options.rxBlockSize = par("rxBlockSize").intValue();
+    options.rxBlockCount = par("rxBlockCount").intValue();
+    options.rxBlockTimeoutMs = std::max<int64_t>(1, std::llround(par("rxBlockTimeout").doubleValue() * 1000));
+    options.txFrameSize = par("txFrameSize").intValue();
+    options.txFrameCount = par("txFrameCount").intValue();
+    options.qdiscBypass = par("qdiscBypass");
+
+    std::string error;
+    if (!ring.open(device, options, error))
+        throw cRuntimeError("Cannot open packet ring on '%s': %s (CAP_NET_RAW is required)", device.c_str(), error.c_str());
+    rtScheduler->addCallback(ring.getFd(), this);
+    EV_INFO << "Opened packet ring on " << device << ".\n";
+}
+
+void ExtRingEthernetDevice::closeRing()
+{
+    if (ring.isOpen()) {
+        ring.flush();
+        if (rtScheduler != nullptr)
+            rtScheduler->removeCallback(ring.getFd(), this);
+        ring.close();
+    }
+}
+
+void ExtRingEthernetDevice::handleMessage(cMessage *msg)
+{
+    if (msg == flushTimer) {
+        ring.flush();
+        return;
+    }
+
+    Packet *packet = check_and_cast<Packet *>(msg);
+    emit(packetReceivedFromLowerSignal, packet);
+    auto protocol = packet->getTag<PacketProtocolTag>()->getProtocol();
+    if (protocol != &Protocol::ethernetMac)
+        throw cRuntimeError("Accepts ethernet packets only");
+    sendToHost(packet);
+    delete packet;
+
+    // Everything sent at this simulation instant goes out with one send()
+    if (ring.getPending() > 0 && !flushTimer->isScheduled())
+        scheduleAt(simTime(), flushTimer);
+}
+
+void ExtRingEthernetDevice::sendToHost(Packet *packet)
+{
+    packet->popAtBack<EthernetFcs>(ETHER_FCS_BYTES);
+    size_t length = packet->getByteLength();
+    uint8_t *slot = ring.reserve(length);
+    if (slot == nullptr) {
+        EV_ERROR << "No free tx slot for " << length << " bytes, dropping " << packet->getName() << endl;
+        numDropped++;
+        return;
+    }
+    const auto& bytes = packet->peekDataAsBytes();
+    bytes->copyToBuffer(slot, length);
+    if (fixChecksums)
+        fixFrameChecksums(slot, length);
+    ring.commit(length);
+    emit(packetSentSignal, packet);
+    numSent++;
+}
+
+bool ExtRingEthernetDevice::notify(int fd)
+{
+    Enter_Method_Silent();
+    ASSERT(fd == ring.getFd());
+    int64_t nowNs = realtimeNs();
+    ring.receive([&] (PacketRing::Frame& frame) { receiveFromHost(frame, nowNs); });
+    return true;
+}
+
+void ExtRingEthernetDevice::receiveFromHost(PacketRing::Frame& frame, int64_t nowNs)
+{
+    // Frames the host stack left to checksum offload
+    if (frame.checksumNotReady && fixChecksums) {
+        fixFrameChecksums(frame.data, frame.length);
+        numChecksumsCompleted++;
+    }
+
+    // The wire would pad short frames, veth does not
+    size_t minLength = B(MIN_ETHERNET_FRAME_BYTES - ETHER_FCS_BYTES).get();
+    Ptr<BytesChunk> bytes;
+    if (frame.length >= minLength) {
+        bytes = makeShared<BytesChunk>(frame.data, frame.length);
+    }
+    else {
+        std::vector<uint8_t> padded(minLength, 0);
+        std::copy(frame.data, frame.data + frame.length, padded.begin());
+        bytes = makeShared<BytesChunk>(padded);
+    }
+    Packet *packet = new Packet(nullptr, bytes);
+
+    // Never checked against the bytes, so it is only declared
+    const auto& ethernetFcs = makeShared<EthernetFcs>();
+    ethernetFcs->setFcs(0xC00DC00DL);
+    ethernetFcs->setFcsMode(FCS_DECLARED_CORRECT);
+    packet->insertAtBack(ethernetFcs);
+    packet->addTag<PacketProtocolTag>()->setProtocol(&Protocol::ethernetMac);
+
+    if (numReceived == 0)
+        firstRxNs = frame.timestampNs;
+    lastRxNs = frame.timestampNs;
+    numReceived++;
+    emit(rxLatencySignal, (nowNs - frame.timestampNs) / 1e9);
+    emit(packetReceivedSignal, packet);
+    EV_INFO << "Received " << packet->getByteLength() << " bytes from " << device << ".\n";
+    emit(packetSentToLowerSignal, packet);
+    send(packet, "lowerLayerOut");
+}
+
+void ExtRingEthernetDevice::refreshDisplay() const
+{
+    char buf[120];
+    snprintf(buf, sizeof(buf), "device: %s\nrcv:%d snt:%d drop:%d", device.c_str(), numReceived, numSent, numDropped);
+    getDisplayString().setTagArg("t", 0, buf);
+}
+
+void ExtRingEthernetDevice::finish()
+{
+    closeRing();
+
+    const PacketRing::Stats& stats = ring.getStats();
+    double rxSpan = (lastRxNs - firstRxNs) / 1e9;
+    recordScalar("rxFrames", stats.rxFrames);
+    recordScalar("rxBytes", stats.rxBytes, "B");
+    if (rxSpan > 0)
+        recordScalar("rxRate", (numReceived - 1) / rxSpan, "pps");
+    if (stats.rxBlocks > 0)
+        recordScalar("rxFramesPerBlock", (double)stats.rxFrames / stats.rxBlocks);
+    recordScalar("rxChecksumsCompleted", numChecksumsCompleted);
+    recordScalar("txFrames", stats.txFrames);
+    recordScalar("txBytes", stats.txBytes, "B");
+    recordScalar("txFlushes", stats.txFlushes);
+    if (stats.txFlushes > 0)
+        recordScalar("txFramesPerFlush", (double)stats.txFrames / stats.txFlushes);
+    recordScalar("txRingFull", stats.txRingFull);
+    recordScalar("txTooLong", stats.txTooLong);
+}
+
+} // namespace tapadhoc
@@ -0,0 +1,71 @@
+//
+// External Ethernet device that exchanges frames with a host interface
+// through PACKET_MMAP rings instead of one read()/write() per frame.
+//
+
+#ifndef __TAPADHOC_EXTRINGETHERNETDEVICE_H
+#define __TAPADHOC_EXTRINGETHERNETDEVICE_H
+
+#include "inet/common/scheduler/RealTimeScheduler.h"
+#include "inet/networklayer/common/NetworkInterface.h"
+
+#include "PacketRing.h"
+
+namespace tapadhoc {
+
+using namespace inet;
+
+/**
+ * Counterpart of INET's ExtEthernetTapDevice on top of PacketRing.
+ *
+ * Frames from the host arrive in rx ring blocks; one scheduler callback
+ * turns every frame of every ready block into a packet. Frames from the
+ * simulation are copied into tx ring slots and flushed with a single
+ * send() at the end of the current simulation instant.
+ *
+ * Checksums are only computed at the boundary: the simulation can run with
+ * declared checksums and FCS, and this module fills in real IPv4/TCP/UDP/ICMP
+ * checksums on the way out and completes offloaded ones on the way in.
+ */
+class ExtRingEthernetDevice : public cSimpleModule, public RealTimeScheduler::ICallback
+{
+  protected:
+    std::string device;
+    bool fixChecksums = true;
+
+    NetworkInterface *networkInterface = nullptr;
+    RealTimeScheduler *rtScheduler = nullptr;
+    PacketRing ring;
+    cMessage *flushTimer = nullptr;
+
+    // statistics
+    int numSent = 0;
+    int numReceived = 0;
+    int numDropped = 0;
+    int numChecksumsCompleted = 0;
+    int64_t firstRxNs = 0;
+    int64_t lastRxNs = 0;
+
+    static simsignal_t rxLatencySignal;
+
+  protected:
+    virtual int numInitStages() const override { return NUM_INIT_STAGES; }
+    virtual void initialize(int stage) override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void refreshDisplay() const override;
+    virtual void finish() override;
+
+    virtual void openRing();
+    virtual void closeRing();
+    virtual void sendToHost(Packet *packet);
+    virtual void receiveFromHost(PacketRing::Frame& frame, int64_t nowNs);
+
+  public:
+    virtual ~ExtRingEthernetDevice();
+
+    virtual bool notify(int fd) override;
+};
+
+} // namespace tapadhoc
+
+#endif
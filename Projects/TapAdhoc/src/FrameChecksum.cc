@@ -0,0 +1,106 @@
+//
+// Internet checksums of a raw Ethernet frame, computed in place.
+//
+
+#include "FrameChecksum.h"
+
+#include <cstring>
+
+namespace tapadhoc {
+
+namespace {
+
+const uint16_t kEtherTypeIpv4 = 0x0800;
+const uint16_t kEtherTypeVlan = 0x8100;
+const uint8_t kProtocolIcmp = 1;
+const uint8_t kProtocolTcp = 6;
+const uint8_t kProtocolUdp = 17;
+
+inline uint16_t load16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+inline void store16(uint8_t *p, uint16_t value)
+{
+    p[0] = value >> 8;
+    p[1] = value & 0xff;
+}
+
+uint32_t sum(const uint8_t *data, size_t length, uint32_t acc)
+{
+    for (; length > 1; data += 2, length -= 2)
+        acc += load16(data);
+    if (length)
+        acc += data[0] << 8;
+    return acc;
+}
+
+uint16_t fold(uint32_t acc)
+{
+    while (acc >> 16)
+        acc = (acc & 0xffff) + (acc >> 16);
+    return ~acc & 0xffff;
+}
+
+} // namespace
+
+bool fixFrameChecksums(uint8_t *frame, size_t length)
+{
+    size_t offset = 12;
+    if (length < offset + 2)
+        return false;
+    uint16_t etherType = load16(frame + offset);
+    offset += 2;
+    if (etherType == kEtherTypeVlan) {
+        if (length < offset + 4)
+            return false;
+        etherType = load16(frame + offset + 2);
+        offset += 4;
+    }
+    if (etherType != kEtherTypeIpv4 || length < offset + 20)
+        return false;
+
+    uint8_t *ip = frame + offset;
+    size_t headerLength = (ip[0] & 0x0f) * 4;
+    size_t totalLength = load16(ip + 2);
+    if ((ip[0] >> 4) != 4 || headerLength < 20 || totalLength < headerLength || offset + totalLength > length)
+        return false;
+
+    store16(ip + 10, 0);
+    store16(ip + 10, fold(sum(ip, headerLength, 0)));
+
+    // Transport checksums need the whole datagram: skip fragments
+    uint16_t fragment = load16(ip + 6);
+    if ((fragment & 0x3fff) != 0)
+        return true;
+
+    uint8_t protocol = ip[9];
+    uint8_t *l4 = ip + headerLength;
+    size_t l4Length = totalLength - headerLength;
+    size_t checksumOffset;
+    switch (protocol) {
+        case kProtocolTcp: checksumOffset = 16; break;
+        case kProtocolUdp: checksumOffset = 6; break;
+        case kProtocolIcmp: checksumOffset = 2; break;
+        default: return true;
+    }
+    if (l4Length < checksumOffset + 2)
+        return true;
+
+    store16(l4 + checksumOffset, 0);
+    uint32_t acc = 0;
+    if (protocol != kProtocolIcmp) {
+        // pseudo header: addresses, protocol, transport length
+        acc = sum(ip + 12, 8, acc);
+        acc += protocol;
+        acc += l4Length;
+    }
+    uint16_t checksum = fold(sum(l4, l4Length, acc));
+    if (protocol == kProtocolUdp && checksum == 0)
+        checksum = 0xffff;
+    store16(l4 + checksumOffset, checksum);
+    return true;
+}
+
+} // namespace tapadhoc
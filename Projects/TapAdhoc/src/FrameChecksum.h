@@ -0,0 +1,23 @@
+//
+// Internet checksums of a raw Ethernet frame, computed in place.
+//
+
+#ifndef __TAPADHOC_FRAMECHECKSUM_H
+#define __TAPADHOC_FRAMECHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tapadhoc {
+
+/**
+ * Recomputes the IPv4 header checksum and, for unfragmented TCP, UDP and
+ * ICMP payloads, the transport checksum of an Ethernet frame (optionally
+ * 802.1Q tagged). Frames that are not IPv4, or are truncated, are left
+ * alone. Returns true if the frame was IPv4 and its checksums were written.
+ */
+bool fixFrameChecksums(uint8_t *frame, size_t length);
+
+} // namespace tapadhoc
+
+#endif
@@ -0,0 +1,203 @@
+//
+// PACKET_MMAP (TPACKET_V3) rx/tx rings on an AF_PACKET socket.
+//
+
+#include "PacketRing.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/if_ether.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING 23
+#endif
+
+namespace tapadhoc {
+
+namespace {
+
+bool fail(std::string& error, const std::string& what)
+{
+    error = what + ": " + strerror(errno);
+    return false;
+}
+
+} // namespace
+
+size_t PacketRing::txDataOffset()
+{
+    // TPACKET3_HDRLEN minus the sockaddr_ll, as tpacket_fill_skb() expects
+    return TPACKET_ALIGN(sizeof(tpacket3_hdr));
+}
+
+bool PacketRing::open(const std::string& device, const Options& opts, std::string& error)
+{
+    close();
+    options = opts;
+    long page = sysconf(_SC_PAGESIZE);
+    if (options.rxBlockSize % page != 0 || options.rxBlockCount == 0 || options.txFrameCount == 0
+            || options.txFrameSize < TPACKET_ALIGNMENT || (options.txFrameSize & (options.txFrameSize - 1)) != 0)
+    {
+        error = "invalid ring geometry";
+        return false;
+    }
+
+    ifindex = if_nametoindex(device.c_str());
+    if (ifindex == 0) {
+        ifindex = -1;
+        return fail(error, "if_nametoindex(" + device + ")");
+    }
+
+    // Protocol 0 until the rings exist, so nothing is queued outside them
+    fd = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return fail(error, "socket(AF_PACKET)");
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        close();
+        return fail(error, "PACKET_VERSION");
+    }
+
+    // Frames we transmit would otherwise show up in our own rx ring
+    int one = 1;
+    setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+    if (options.qdiscBypass)
+        setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    tpacket_req3 rx = {};
+    rx.tp_block_size = options.rxBlockSize;
+    rx.tp_block_nr = options.rxBlockCount;
+    rx.tp_frame_size = TPACKET_ALIGNMENT << 7;
+    rx.tp_frame_nr = (rx.tp_block_size / rx.tp_frame_size) * rx.tp_block_nr;
+    rx.tp_retire_blk_tov = options.rxBlockTimeoutMs;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &rx, sizeof(rx)) < 0) {
+        close();
+        return fail(error, "PACKET_RX_RING");
+    }
+
+    // tx blocks only group frames for the mapping; each slot holds one frame
+    size_t txBlockSize = std::max<size_t>(page, options.txFrameSize);
+    size_t framesPerBlock = txBlockSize / options.txFrameSize;
+    size_t txBlocks = (options.txFrameCount + framesPerBlock - 1) / framesPerBlock;
+    options.txFrameCount = txBlocks * framesPerBlock;
+    tpacket_req3 tx = {};
+    tx.tp_block_size = txBlockSize;
+    tx.tp_block_nr = txBlocks;
+    tx.tp_frame_size = options.txFrameSize;
+    tx.tp_frame_nr = options.txFrameCount;
+    if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &tx, sizeof(tx)) < 0) {
+        close();
+        return fail(error, "PACKET_TX_RING");
+    }
+
+    rxSize = options.rxBlockSize * options.rxBlockCount;
+    mapSize = rxSize + txBlockSize * txBlocks;
+    void *mem = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd, 0);
+    if (mem == MAP_FAILED)
+        mem = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        close();
+        return fail(error, "mmap");
+    }
+    map = static_cast<uint8_t *>(mem);
+
+    sockaddr_ll addr = {};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        close();
+        return fail(error, "bind(" + device + ")");
+    }
+
+    rxNext = txNext = pending = 0;
+    stats = Stats();
+    return true;
+}
+
+void PacketRing::close()
+{
+    if (map != nullptr)
+        munmap(map, mapSize);
+    map = nullptr;
+    mapSize = rxSize = 0;
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    ifindex = -1;
+}
+
+uint8_t *PacketRing::reserve(size_t length)
+{
+    if (length + txDataOffset() > options.txFrameSize) {
+        stats.txTooLong++;
+        return nullptr;
+    }
+    tpacket3_hdr *hdr = txHeader((txNext + pending) % options.txFrameCount);
+    uint32_t status = __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE);
+    if (pending >= options.txFrameCount || (status != TP_STATUS_AVAILABLE && !(status & TP_STATUS_WRONG_FORMAT))) {
+        // the kernel has not sent this slot yet: push out what we have
+        if (pending > 0)
+            flush();
+        status = __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE);
+        if (status != TP_STATUS_AVAILABLE && !(status & TP_STATUS_WRONG_FORMAT)) {
+            stats.txRingFull++;
+            return nullptr;
+        }
+    }
+    return reinterpret_cast<uint8_t *>(hdr) + txDataOffset();
+}
+
+void PacketRing::commit(size_t length)
+{
+    tpacket3_hdr *hdr = txHeader((txNext + pending) % options.txFrameCount);
+    hdr->tp_len = length;
+    hdr->tp_snaplen = length;
+    hdr->tp_next_offset = 0;
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+    pending++;
+    stats.txFrames++;
+    stats.txBytes += length;
+}
+
+bool PacketRing::flush()
+{
+    if (pending == 0)
+        return true;
+    txNext = (txNext + pending) % options.txFrameCount;
+    pending = 0;
+    stats.txFlushes++;
+    // Non-blocking: the kernel sends every slot marked SEND_REQUEST
+    while (send(fd, nullptr, 0, MSG_DONTWAIT) < 0) {
+        if (errno == EINTR)
+            continue;
+        return errno == EAGAIN || errno == ENOBUFS;
+    }
+    return true;
+}
+
+bool PacketRing::getMacAddress(const std::string& device, uint8_t mac[6], std::string& error)
+{
+    int s = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (s < 0)
+        return fail(error, "socket");
+    ifreq ifr = {};
+    strncpy(ifr.ifr_name, device.c_str(), IFNAMSIZ - 1);
+    bool ok = ioctl(s, SIOCGIFHWADDR, &ifr) == 0;
+    if (ok)
+        memcpy(mac, ifr.ifr_hwaddr.sa_data, 6);
+    else
+        fail(error, "SIOCGIFHWADDR(" + device + ")");
+    ::close(s);
+    return ok;
+}
+
+} // namespace tapadhoc
@@ -0,0 +1,157 @@
+//
+// PACKET_MMAP (TPACKET_V3) rx/tx rings on an AF_PACKET socket.
+//
+// The kernel fills whole rx blocks and hands them over at once; receive()
+// walks every frame of every ready block and returns each block with one
+// store. Frames to send are copied into tx ring slots and go out with a
+// single send() per flush(), however many are queued.
+//
+// No OMNeT++/INET dependency, so it can be benchmarked on its own.
+//
+
+#ifndef __TAPADHOC_PACKETRING_H
+#define __TAPADHOC_PACKETRING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <linux/if_packet.h>
+
+namespace tapadhoc {
+
+class PacketRing
+{
+  public:
+    struct Options
+    {
+        size_t rxBlockSize = 1 << 20;   // bytes, multiple of the page size
+        size_t rxBlockCount = 16;
+        unsigned rxBlockTimeoutMs = 1;  // kernel retires a partly filled block after this
+        size_t txFrameSize = 2048;      // one frame per slot, power of two
+        size_t txFrameCount = 1024;
+        bool qdiscBypass = true;        // PACKET_QDISC_BYPASS for tx
+    };
+
+    struct Stats
+    {
+        uint64_t rxFrames = 0;
+        uint64_t rxBytes = 0;
+        uint64_t rxBlocks = 0;
+        uint64_t rxSkipped = 0;         // our own outgoing frames, filtered out
+        uint64_t txFrames = 0;
+        uint64_t txBytes = 0;
+        uint64_t txFlushes = 0;         // send() calls
+        uint64_t txRingFull = 0;        // frames dropped because no slot was free
+        uint64_t txTooLong = 0;
+    };
+
+    /** A received frame; data points into the ring and is valid only during the callback */
+    struct Frame
+    {
+        uint8_t *data;
+        size_t length;
+        int64_t timestampNs;            // kernel rx timestamp, CLOCK_REALTIME
+        bool checksumNotReady;          // TP_STATUS_CSUMNOTREADY: L4 checksum left to offload
+    };
+
+    PacketRing() {}
+    ~PacketRing() { close(); }
+    PacketRing(const PacketRing&) = delete;
+    PacketRing& operator=(const PacketRing&) = delete;
+
+    bool open(const std::string& device, const Options& options, std::string& error);
+    void close();
+    bool isOpen() const { return fd >= 0; }
+    int getFd() const { return fd; }
+    int getIfIndex() const { return ifindex; }
+    const Stats& getStats() const { return stats; }
+
+    /**
+     * Calls fn(Frame&) for every frame in every block the kernel has
+     * released, then hands the blocks back. Returns the number of frames.
+     */
+    template <typename F>
+    size_t receive(F fn);
+
+    /**
+     * Returns a tx slot for a frame of up to length bytes, or nullptr if
+     * the ring is full (or the frame too long). Fill it, then commit().
+     */
+    uint8_t *reserve(size_t length);
+    void commit(size_t length);
+
+    /** Number of committed frames not yet handed to the kernel */
+    size_t getPending() const { return pending; }
+
+    /** One send() for everything committed since the last flush */
+    bool flush();
+
+    /** Copies a device's MAC address into mac[6] */
+    static bool getMacAddress(const std::string& device, uint8_t mac[6], std::string& error);
+
+  private:
+    tpacket_block_desc *rxBlock(size_t index) const
+    {
+        return reinterpret_cast<tpacket_block_desc *>(map + index * options.rxBlockSize);
+    }
+    tpacket3_hdr *txHeader(size_t index) const
+    {
+        return reinterpret_cast<tpacket3_hdr *>(map + rxSize + index * options.txFrameSize);
+    }
+    static size_t txDataOffset();
+
+    Options options;
+    int fd = -1;
+    int ifindex = -1;
+    uint8_t *map = nullptr;
+    size_t mapSize = 0;
+    size_t rxSize = 0;
+    size_t rxNext = 0;          // next rx block to look at
+    size_t txNext = 0;          // next tx slot to fill
+    size_t pending = 0;
+    Stats stats;
+};
+
+template <typename F>
+size_t PacketRing::receive(F fn)
+{
+    size_t frames = 0;
+    for (;;) {
+        tpacket_block_desc *block = rxBlock(rxNext);
+        if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+            break;
+
+        uint8_t *base = reinterpret_cast<uint8_t *>(block);
+        uint32_t count = block->hdr.bh1.num_pkts;
+        auto *hdr = reinterpret_cast<tpacket3_hdr *>(base + block->hdr.bh1.offset_to_first_pkt);
+        for (uint32_t i = 0; i < count; i++) {
+            auto *sll = reinterpret_cast<sockaddr_ll *>(reinterpret_cast<uint8_t *>(hdr) + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+            if (sll->sll_pkttype == PACKET_OUTGOING) {
+                // older kernels without PACKET_IGNORE_OUTGOING
+                stats.rxSkipped++;
+            }
+            else {
+                Frame frame;
+                frame.data = reinterpret_cast<uint8_t *>(hdr) + hdr->tp_mac;
+                frame.length = hdr->tp_snaplen;
+                frame.timestampNs = (int64_t)hdr->tp_sec * 1000000000 + hdr->tp_nsec;
+                frame.checksumNotReady = (hdr->tp_status & TP_STATUS_CSUMNOTREADY) != 0;
+                stats.rxFrames++;
+                stats.rxBytes += frame.length;
+                frames++;
+                fn(frame);
+            }
+            hdr = reinterpret_cast<tpacket3_hdr *>(reinterpret_cast<uint8_t *>(hdr) + hdr->tp_next_offset);
+        }
+
+        stats.rxBlocks++;
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        rxNext = (rxNext + 1) % options.rxBlockCount;
+    }
+    return frames;
+}
+
+} // namespace tapadhoc
+
+#endif
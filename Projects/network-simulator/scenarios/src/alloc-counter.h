@@ -0,0 +1,72 @@
+/*
+ * Heap allocation counter for the benchmarks.
+ *
+ * Replaces the program's global operator new/delete, so every allocation
+ * made through new is counted: ns-3 objects, packets, scheduled events and
+ * STL containers, including those inside the ns-3 libraries. The cost is
+ * one relaxed atomic increment per allocation, so like the counters of the
+ * OMNeT++ projects it is off unless T4_COUNT_ALLOCS is defined, and
+ * HeapAllocations() returns -1. Scratch programs share one ns-3
+ * configuration, so the define comes from the *-count-allocs.cc wrappers:
+ * each defines it and includes its scenario, and Benchmarks/bench.py runs
+ * those.
+ *
+ * The replacement operators are defined here, so only one translation unit
+ * per program may include this header. Each scenario is a single .cc that
+ * gets it through run-stats.h.
+ */
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdint>
+
+#ifdef T4_COUNT_ALLOCS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> g_heapAllocations{0};
+
+/** Allocations through operator new since the program started */
+inline int64_t HeapAllocations() {
+    return static_cast<int64_t>(g_heapAllocations.load(std::memory_order_relaxed));
+}
+
+void *operator new(std::size_t size) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+#else
+
+/** -1: built without T4_COUNT_ALLOCS */
+inline int64_t HeapAllocations() { return -1; }
+
+#endif /* T4_COUNT_ALLOCS */
+
+#endif /* ALLOC_COUNTER_H */
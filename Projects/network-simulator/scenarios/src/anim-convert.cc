@@ -0,0 +1,314 @@
+/*
+ * Convert a binary animation trace (binary-anim.h) to NetAnim XML
+ *
+ * Reads the trace one chunk at a time, so memory stays bounded by the block
+ * size, the string table and one entry per packet uid. Every transmission
+ * gets its own NetAnim uId, as AnimationInterface does; receptions refer to
+ * the latest transmission of the same packet.
+ *
+ * Usage: anim-convert <trace.bin> <trace.xml>
+ */
+
+#include "binary-anim-format.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** Seconds with up to 9 decimals, trailing zeros dropped (0.021034) */
+static const char *Seconds(uint64_t ns, char *buf) {
+    int len = std::sprintf(buf, "%" PRIu64 ".%09" PRIu64, ns / 1000000000, ns % 1000000000);
+    while (buf[len - 1] == '0') {
+        buf[--len] = '\0';
+    }
+    if (buf[len - 1] == '.') {
+        buf[len - 1] = '\0';
+    }
+    return buf;
+}
+
+/** Centimetres as metres (50, 12.5) */
+static const char *Metres(int64_t cm, char *buf) {
+    std::sprintf(buf, "%.2f", cm / 100.0);
+    char *end = buf + std::strlen(buf);
+    while (end[-1] == '0') {
+        *--end = '\0';
+    }
+    if (end[-1] == '.') {
+        end[-1] = '\0';
+    }
+    return buf;
+}
+
+static std::string XmlEscape(const std::string &s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        default: out += c; break;
+        }
+    }
+    return out;
+}
+
+class Converter {
+public:
+    explicit Converter(std::FILE *out) : m_out(out) {}
+
+    bool Chunk(uint8_t kind, const uint8_t *data, size_t size) {
+        AnimReader r(data, data + size);
+        char b0[32], b1[32];
+        switch (kind) {
+        case ANIM_STRING:
+            m_strings.push_back(r.Rest());
+            return true;
+        case ANIM_NODE: {
+            uint64_t node = r.Varint();
+            int64_t x = r.Signed(), y = r.Signed();
+            if (node >= m_x.size()) {
+                m_x.resize(node + 1);
+                m_y.resize(node + 1);
+            }
+            m_x[node] = x;
+            m_y[node] = y;
+            std::fprintf(m_out, "<node id=\"%" PRIu64 "\" sysId=\"0\" locX=\"%s\" locY=\"%s\" />\n", node,
+                         Metres(x, b0), Metres(y, b1));
+            break;
+        }
+        case ANIM_DESCR: {
+            uint64_t node = r.Varint();
+            std::string descr = XmlEscape(String(r.Varint()));
+            std::fprintf(m_out, "<nu p=\"d\" t=\"0\" id=\"%" PRIu64 "\" descr=\"%s\" />\n", node, descr.c_str());
+            break;
+        }
+        case ANIM_COLOR: {
+            uint64_t node = r.Varint();
+            uint64_t red = r.Varint(), green = r.Varint(), blue = r.Varint();
+            std::fprintf(m_out, "<nu p=\"c\" t=\"0\" id=\"%" PRIu64 "\" r=\"%" PRIu64 "\" g=\"%" PRIu64
+                         "\" b=\"%" PRIu64 "\" />\n", node, red, green, blue);
+            break;
+        }
+        case ANIM_SIZE: {
+            uint64_t node = r.Varint();
+            int64_t w = static_cast<int64_t>(r.Varint()), h = static_cast<int64_t>(r.Varint());
+            std::fprintf(m_out, "<nu p=\"s\" t=\"0\" id=\"%" PRIu64 "\" w=\"%s\" h=\"%s\" />\n", node,
+                         Metres(w, b0), Metres(h, b1));
+            break;
+        }
+        case ANIM_IP: {
+            uint64_t node = r.Varint();
+            std::string addr = String(r.Varint());
+            std::fprintf(m_out, "<ip n=\"%" PRIu64 "\" >\n<address >%s</address>\n</ip>\n", node, addr.c_str());
+            break;
+        }
+        case ANIM_BLOCK:
+            Block(r);
+            break;
+        default:
+            // Unknown chunk kinds are skipped, so the format can grow
+            return true;
+        }
+        return !r.Error();
+    }
+
+private:
+    struct Tx {
+        uint64_t uid, node, time, metaCount;
+    };
+    struct Rx {
+        uint64_t uid, node, time;
+    };
+    struct Pos {
+        uint64_t node, time;
+        int64_t x, y;
+    };
+
+    const std::string &String(uint64_t id) const {
+        static const std::string empty;
+        return id >= 1 && id <= m_strings.size() ? m_strings[id - 1] : empty;
+    }
+
+    void Block(AnimReader &r) {
+        uint64_t base = r.Varint();
+        uint64_t nTx = r.Varint(), nRx = r.Varint(), nPos = r.Varint();
+        if (r.Error() || nTx + nRx + nPos > (1u << 24)) {
+            return;
+        }
+        m_tx.assign(nTx, Tx());
+        m_rx.assign(nRx, Rx());
+        m_pos.assign(nPos, Pos());
+
+        uint64_t uid = 0, time = base, metaTotal = 0;
+        for (Tx &e : m_tx) { e.uid = uid += r.Signed(); }
+        for (Tx &e : m_tx) { e.node = r.Varint(); }
+        for (Tx &e : m_tx) { e.time = time += r.Varint(); }
+        for (Tx &e : m_tx) { metaTotal += e.metaCount = r.Varint(); }
+        m_meta.resize(std::min<uint64_t>(metaTotal, 1u << 26));
+        uint64_t numbers = 0;
+        for (uint32_t &id : m_meta) {
+            id = static_cast<uint32_t>(r.Varint());
+            const std::string &header = String(id);
+            numbers += std::count(header.begin(), header.end(), kAnimNumber);
+        }
+        m_values.resize(std::min<uint64_t>(numbers, 1u << 26));
+        for (uint64_t &v : m_values) { v = r.Varint(); }
+
+        uid = 0;
+        time = base;
+        for (Rx &e : m_rx) { e.uid = uid += r.Signed(); }
+        for (Rx &e : m_rx) { e.node = r.Varint(); }
+        for (Rx &e : m_rx) { e.time = time += r.Varint(); }
+
+        time = base;
+        for (Pos &e : m_pos) { e.node = r.Varint(); }
+        for (Pos &e : m_pos) { e.time = time += r.Varint(); }
+        for (Pos &e : m_pos) { e.x = r.Signed(); }
+        for (Pos &e : m_pos) { e.y = r.Signed(); }
+        if (r.Error()) {
+            return;
+        }
+
+        // Merge the three columns back into time order (tx before rx on ties)
+        size_t t = 0, x = 0, p = 0, meta = 0, value = 0;
+        while (t < m_tx.size() || x < m_rx.size() || p < m_pos.size()) {
+            uint64_t tt = t < m_tx.size() ? m_tx[t].time : UINT64_MAX;
+            uint64_t xt = x < m_rx.size() ? m_rx[x].time : UINT64_MAX;
+            uint64_t pt = p < m_pos.size() ? m_pos[p].time : UINT64_MAX;
+            if (tt <= xt && tt <= pt) {
+                WriteTx(m_tx[t++], meta, value);
+            } else if (xt <= pt) {
+                WriteRx(m_rx[x++]);
+            } else {
+                WritePos(m_pos[p++]);
+            }
+        }
+    }
+
+    void WriteTx(const Tx &e, size_t &meta, size_t &value) {
+        char buf[32];
+        uint64_t animUid = ++m_nextAnimUid;
+        m_animUid[e.uid] = animUid;
+        std::fprintf(m_out, "<pr uId=\"%" PRIu64 "\" fId=\"%" PRIu64 "\" fbTx=\"%s\"", animUid, e.node,
+                     Seconds(e.time, buf));
+        if (e.metaCount > 0) {
+            std::string info;
+            for (uint64_t i = 0; i < e.metaCount && meta < m_meta.size(); i++) {
+                info += i ? " " : "";
+                for (char c : String(m_meta[meta++])) {
+                    if (c != kAnimNumber) {
+                        info += c;
+                    } else if (value < m_values.size()) {
+                        info += std::to_string(m_values[value++]);
+                    }
+                }
+            }
+            std::fprintf(m_out, " meta-info=\"%s\"", XmlEscape(info).c_str());
+        }
+        std::fprintf(m_out, " />\n");
+    }
+
+    void WriteRx(const Rx &e) {
+        char buf[32];
+        auto it = m_animUid.find(e.uid);
+        if (it == m_animUid.end()) {
+            return;
+        }
+        std::fprintf(m_out, "<wpr uId=\"%" PRIu64 "\" tId=\"%" PRIu64 "\" fbRx=\"%s\" lbRx=\"0\" />\n", it->second,
+                     e.node, Seconds(e.time, buf));
+    }
+
+    void WritePos(const Pos &e) {
+        char b0[32], b1[32], b2[32];
+        if (e.node >= m_x.size()) {
+            m_x.resize(e.node + 1);
+            m_y.resize(e.node + 1);
+        }
+        m_x[e.node] += e.x;
+        m_y[e.node] += e.y;
+        std::fprintf(m_out, "<nu p=\"p\" t=\"%s\" id=\"%" PRIu64 "\" x=\"%s\" y=\"%s\" />\n", Seconds(e.time, b0),
+                     e.node, Metres(m_x[e.node], b1), Metres(m_y[e.node], b2));
+    }
+
+    std::FILE *m_out;
+    std::vector<std::string> m_strings;
+    std::vector<int64_t> m_x, m_y;
+    std::unordered_map<uint64_t, uint64_t> m_animUid;
+    uint64_t m_nextAnimUid = 0;
+    std::vector<Tx> m_tx;
+    std::vector<Rx> m_rx;
+    std::vector<Pos> m_pos;
+    std::vector<uint32_t> m_meta;
+    std::vector<uint64_t> m_values;
+};
+
+static bool ReadVarint(std::FILE *f, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = std::fgetc(f);
+        if (c == EOF) {
+            return false;
+        }
+        v |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: %s <trace.bin> <trace.xml>\n", argv[0]);
+        return 2;
+    }
+    std::FILE *in = std::fopen(argv[1], "rb");
+    if (!in) {
+        std::perror(argv[1]);
+        return 1;
+    }
+    char magic[sizeof(kAnimMagic)];
+    if (std::fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        std::memcmp(magic, kAnimMagic, sizeof(magic)) != 0) {
+        std::fprintf(stderr, "%s: not a binary animation trace\n", argv[1]);
+        return 1;
+    }
+    std::FILE *out = std::fopen(argv[2], "w");
+    if (!out) {
+        std::perror(argv[2]);
+        return 1;
+    }
+
+    std::fprintf(out, "<anim ver=\"netanim-3.108\" filetype=\"animation\" >\n");
+    Converter converter(out);
+    std::vector<uint8_t> payload;
+    uint64_t chunks = 0;
+    int kind;
+    while ((kind = std::fgetc(in)) != EOF) {
+        uint64_t size;
+        if (!ReadVarint(in, size) || size > (1u << 30)) {
+            std::fprintf(stderr, "%s: truncated after %" PRIu64 " chunks\n", argv[1], chunks);
+            break;
+        }
+        payload.resize(size);
+        if (size > 0 && std::fread(payload.data(), 1, size, in) != size) {
+            std::fprintf(stderr, "%s: truncated after %" PRIu64 " chunks\n", argv[1], chunks);
+            break;
+        }
+        if (!converter.Chunk(static_cast<uint8_t>(kind), payload.data(), size)) {
+            std::fprintf(stderr, "%s: malformed chunk %" PRIu64 "\n", argv[1], chunks);
+        }
+        chunks++;
+    }
+    std::fprintf(out, "</anim>\n");
+    std::fclose(out);
+    std::fclose(in);
+    return 0;
+}
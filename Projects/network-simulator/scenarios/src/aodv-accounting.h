@@ -0,0 +1,377 @@
+/*
+ * AODV control-plane accounting
+ *
+ * Counts the AODV messages every node sends and receives, per type, from
+ * the Ipv4L3Protocol Tx/Rx traces (the packet still carries its IPv4
+ * header there). Classification copies the first bytes of the packet and
+ * looks at the protocol and UDP destination port (654) first; only AODV
+ * packets get their message type read, everything else costs one
+ * CopyData(). HELLOs are RREPs with dst == origin and are counted apart.
+ *
+ * Route discovery latency: ns-3's AODV sends a locally originated packet
+ * without a route to the loopback interface and queues it until a route
+ * is found, then sends the queue out as soon as the route is installed.
+ * So a discovery starts at the first data packet a node sends on the
+ * loopback interface to a remote destination, and ends at the first data
+ * packet from that node to that destination on a WiFi interface. A node
+ * still waiting after kDiscoveryTimeout (AODV's MaxQueueTime) has failed.
+ *
+ * Airtime: every PSDU a PHY starts sending is charged its duration
+ * (WifiPhy::CalculateTxDuration) as routing (AODV), data, or control
+ * (ACKs and other frames without an IP payload).
+ *
+ * Written on the simulator thread only; counters are relaxed atomics so
+ * the metrics thread may read them.
+ */
+
+#ifndef AODV_ACCOUNTING_H
+#define AODV_ACCOUNTING_H
+
+#include "latency-histogram.h"
+#include "metrics-exporter.h"
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+enum AodvMessage : uint32_t { AODV_RREQ, AODV_RREP, AODV_HELLO, AODV_RERR, AODV_RREP_ACK, AODV_MESSAGE_COUNT };
+
+static const char *const kAodvMessageNames[AODV_MESSAGE_COUNT] = {"rreq", "rrep", "hello", "rerr", "rrep_ack"};
+
+enum AirtimeKind : uint32_t { AIRTIME_ROUTING, AIRTIME_DATA, AIRTIME_CONTROL, AIRTIME_KIND_COUNT };
+
+static const char *const kAirtimeKindNames[AIRTIME_KIND_COUNT] = {"routing", "data", "control"};
+
+class AodvAccounting {
+public:
+    static const uint16_t kAodvPort = 654;
+
+    /** A discovery not finished after this long has failed (AODV MaxQueueTime) */
+    static constexpr int64_t kDiscoveryTimeoutNs = 30000000000LL;
+
+    /** Messages and bytes (IP packet size) of one node, per type */
+    struct alignas(64) NodeRow {
+        std::atomic<uint64_t> txPkts[AODV_MESSAGE_COUNT];
+        std::atomic<uint64_t> txBytes[AODV_MESSAGE_COUNT];
+        std::atomic<uint64_t> rxPkts[AODV_MESSAGE_COUNT];
+        std::atomic<uint64_t> rxBytes[AODV_MESSAGE_COUNT];
+
+        NodeRow() {
+            for (uint32_t t = 0; t < AODV_MESSAGE_COUNT; t++) {
+                txPkts[t] = txBytes[t] = rxPkts[t] = rxBytes[t] = 0;
+            }
+        }
+    };
+
+    /** Connect to the IP traces of nodes and the PHYs of devices (WiFi devices only) */
+    void Attach(NodeContainer &nodes, NetDeviceContainer &devices) {
+        uint32_t maxId = 0;
+        for (uint32_t i = 0; i < nodes.GetN(); i++) {
+            maxId = std::max(maxId, nodes.Get(i)->GetId());
+        }
+        m_rows.reset(new NodeRow[maxId + 1]);
+        m_n = maxId + 1;
+        m_pending.resize(m_n);
+        for (uint32_t i = 0; i < nodes.GetN(); i++) {
+            Ptr<Ipv4> ipv4 = nodes.Get(i)->GetObject<Ipv4>();
+            uint32_t id = nodes.Get(i)->GetId();
+            ipv4->TraceConnectWithoutContext("Tx", MakeBoundCallback(&AodvAccounting::IpTx, this, id));
+            ipv4->TraceConnectWithoutContext("Rx", MakeBoundCallback(&AodvAccounting::IpRx, this, id));
+        }
+        for (uint32_t i = 0; i < devices.GetN(); i++) {
+            Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice>(devices.Get(i));
+            if (!dev) {
+                continue;
+            }
+            Ptr<WifiPhy> phy = dev->GetPhy();
+            phy->TraceConnectWithoutContext(
+                "PhyTxPsduBegin", MakeBoundCallback(&AodvAccounting::PhyTxPsduBegin, this, PeekPointer(phy)));
+        }
+    }
+
+    uint32_t GetN() const { return m_n; }
+    const NodeRow &operator[](uint32_t node) const { return m_rows[node]; }
+
+    uint64_t TotalTx(AodvMessage type) const { return Total(&NodeRow::txPkts, type); }
+    uint64_t TotalRx(AodvMessage type) const { return Total(&NodeRow::rxPkts, type); }
+    uint64_t TotalTxBytes(AodvMessage type) const { return Total(&NodeRow::txBytes, type); }
+
+    uint64_t TotalTxBytes() const {
+        uint64_t n = 0;
+        for (uint32_t t = 0; t < AODV_MESSAGE_COUNT; t++) {
+            n += TotalTxBytes(static_cast<AodvMessage>(t));
+        }
+        return n;
+    }
+
+    /** First queued data packet to route installed, ns */
+    const LatencyHistogram &GetDiscoveryLatency() const { return m_discovery; }
+    uint64_t GetDiscoveries() const { return Load(m_discoveries); }
+    uint64_t GetFailedDiscoveries() const { return Load(m_failed); }
+
+    /** Discoveries still waiting for a route */
+    uint64_t GetPendingDiscoveries() const { return Load(m_pendingCount); }
+
+    uint64_t GetAirtimeNs(AirtimeKind kind) const { return Load(m_airtimeNs[kind]); }
+
+    /** Share of the airtime used by AODV, cumulative */
+    double GetRoutingAirtimeShare() const {
+        uint64_t total = 0;
+        for (uint32_t k = 0; k < AIRTIME_KIND_COUNT; k++) {
+            total += GetAirtimeNs(static_cast<AirtimeKind>(k));
+        }
+        return total ? static_cast<double>(GetAirtimeNs(AIRTIME_ROUTING)) / total : 0.0;
+    }
+
+    /**
+     * Share of the airtime used by AODV since the previous call, for the
+     * periodic report (one caller)
+     */
+    double TakeRoutingAirtimeShare() {
+        uint64_t now[AIRTIME_KIND_COUNT];
+        uint64_t total = 0;
+        for (uint32_t k = 0; k < AIRTIME_KIND_COUNT; k++) {
+            now[k] = GetAirtimeNs(static_cast<AirtimeKind>(k));
+            total += now[k] - m_lastAirtimeNs[k];
+        }
+        double share = total ? static_cast<double>(now[AIRTIME_ROUTING] - m_lastAirtimeNs[AIRTIME_ROUTING]) / total
+                             : 0.0;
+        std::copy(now, now + AIRTIME_KIND_COUNT, m_lastAirtimeNs);
+        return share;
+    }
+
+    /** Totals, discovery latency and routing airtime, for the periodic report */
+    void PrintSummary(std::ostream &os) {
+        LatencyHistogram::Snapshot s = m_discovery.Read();
+        os << "  AODV: RREQ=" << TotalTx(AODV_RREQ) << " RREP=" << TotalTx(AODV_RREP)
+           << " HELLO=" << TotalTx(AODV_HELLO) << " RERR=" << TotalTx(AODV_RERR)
+           << " ACK=" << TotalTx(AODV_RREP_ACK) << " sent (" << TotalTxBytes() << "B) | discovery p50="
+           << Ms(s.Percentile(0.5)) << "ms p99=" << Ms(s.Percentile(0.99)) << "ms (" << GetDiscoveries()
+           << " done, " << GetFailedDiscoveries() << " failed, " << GetPendingDiscoveries()
+           << " pending) | routing airtime " << std::fixed << std::setprecision(1)
+           << TakeRoutingAirtimeShare() * 100 << "% (total " << GetRoutingAirtimeShare() * 100 << "%)\n"
+           << std::defaultfloat << std::setprecision(6);
+    }
+
+    /** Per-node table and totals, for the final statistics */
+    void Print(std::ostream &os, uint32_t maxNodes) const {
+        os << "AODV Routing (packets sent/received, bytes sent):\n";
+        for (uint32_t i = 0; i < m_n && i < maxNodes; i++) {
+            const NodeRow &r = m_rows[i];
+            os << "  Node " << i << ":";
+            for (uint32_t t = 0; t < AODV_MESSAGE_COUNT; t++) {
+                os << " " << kAodvMessageNames[t] << "=" << Load(r.txPkts[t]) << "/" << Load(r.rxPkts[t]) << "/"
+                   << Load(r.txBytes[t]) << "B";
+            }
+            os << "\n";
+        }
+        for (uint32_t t = 0; t < AODV_MESSAGE_COUNT; t++) {
+            AodvMessage type = static_cast<AodvMessage>(t);
+            os << "  " << std::left << std::setw(9) << kAodvMessageNames[t] << std::right
+               << "TX=" << TotalTx(type) << " RX=" << TotalRx(type) << " TX bytes=" << TotalTxBytes(type) << "\n";
+        }
+        LatencyHistogram::Snapshot s = m_discovery.Read();
+        os << "  Route discovery: " << GetDiscoveries() << " done, " << GetFailedDiscoveries() << " failed, "
+           << GetPendingDiscoveries() << " pending; latency p50=" << Ms(s.Percentile(0.5))
+           << "ms p90=" << Ms(s.Percentile(0.9)) << "ms p99=" << Ms(s.Percentile(0.99)) << "ms max=" << Ms(s.max)
+           << "ms\n";
+        os << "  Airtime: routing=" << Ms(GetAirtimeNs(AIRTIME_ROUTING)) << "ms data=" << Ms(GetAirtimeNs(AIRTIME_DATA))
+           << "ms control=" << Ms(GetAirtimeNs(AIRTIME_CONTROL)) << "ms, routing share "
+           << GetRoutingAirtimeShare() * 100 << "%\n";
+    }
+
+    /**
+     * Export t4_aodv_tx_pkts{node,type}, t4_aodv_rx_pkts, t4_aodv_tx_bytes,
+     * t4_aodv_discovery_ns{quantile}, t4_aodv_discoveries{result} and
+     * t4_airtime_ns{kind}
+     */
+    void AddCollector(MetricsExporter &metrics) const {
+        metrics.AddCollector([this](std::vector<MetricsExporter::Sample> &out) {
+            struct Column {
+                const char *name;
+                std::atomic<uint64_t> (NodeRow::*field)[AODV_MESSAGE_COUNT];
+            };
+            const Column columns[] = {{"t4_aodv_tx_pkts", &NodeRow::txPkts},
+                                      {"t4_aodv_rx_pkts", &NodeRow::rxPkts},
+                                      {"t4_aodv_tx_bytes", &NodeRow::txBytes}};
+            for (const Column &c : columns) {
+                for (uint32_t i = 0; i < m_n; i++) {
+                    for (uint32_t t = 0; t < AODV_MESSAGE_COUNT; t++) {
+                        out.push_back({c.name, {{"node", std::to_string(i)}, {"type", kAodvMessageNames[t]}},
+                                       static_cast<double>(Load((m_rows[i].*c.field)[t]))});
+                    }
+                }
+            }
+            LatencyHistogram::Snapshot s = m_discovery.Read();
+            for (const char *q : {"0.5", "0.9", "0.99"}) {
+                out.push_back({"t4_aodv_discovery_ns", {{"quantile", q}},
+                               static_cast<double>(s.Percentile(std::atof(q)))});
+            }
+            out.push_back({"t4_aodv_discoveries", {{"result", "done"}}, static_cast<double>(GetDiscoveries())});
+            out.push_back({"t4_aodv_discoveries", {{"result", "failed"}}, static_cast<double>(GetFailedDiscoveries())});
+            out.push_back({"t4_aodv_discoveries", {{"result", "pending"}}, static_cast<double>(GetPendingDiscoveries())});
+            for (uint32_t k = 0; k < AIRTIME_KIND_COUNT; k++) {
+                out.push_back({"t4_airtime_ns", {{"kind", kAirtimeKindNames[k]}},
+                               static_cast<double>(GetAirtimeNs(static_cast<AirtimeKind>(k)))});
+            }
+        });
+    }
+
+    static double Ms(uint64_t ns) { return ns / 1e6; }
+
+private:
+    // IPv4 header (no options) + UDP header + the AODV fields we look at
+    static const uint32_t kPeekBytes = 20 + 8 + 16;
+
+    static void Bump(std::atomic<uint64_t> &a, uint64_t n = 1) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static uint64_t Load(const std::atomic<uint64_t> &a) { return a.load(std::memory_order_relaxed); }
+
+    static uint32_t ReadU32(const uint8_t *p) {
+        return static_cast<uint32_t>(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    }
+
+    uint64_t Total(std::atomic<uint64_t> (NodeRow::*field)[AODV_MESSAGE_COUNT], AodvMessage type) const {
+        uint64_t n = 0;
+        for (uint32_t i = 0; i < m_n; i++) {
+            n += Load((m_rows[i].*field)[type]);
+        }
+        return n;
+    }
+
+    /**
+     * AODV message type of the IPv4 packet in buf (length bytes copied), or
+     * AODV_MESSAGE_COUNT if it is not AODV. Port first, then the type.
+     */
+    static AodvMessage Classify(const uint8_t *buf, uint32_t length) {
+        if (length < 20 || (buf[0] >> 4) != 4 || buf[9] != 17) {
+            return AODV_MESSAGE_COUNT;
+        }
+        uint32_t udp = (buf[0] & 0x0f) * 4u;
+        if (length < udp + 9 || (buf[udp + 2] << 8 | buf[udp + 3]) != kAodvPort) {
+            return AODV_MESSAGE_COUNT;
+        }
+        const uint8_t *aodv = buf + udp + 8;
+        switch (aodv[0]) {
+        case 1:
+            return AODV_RREQ;
+        case 2:
+            // RREP: flags, prefix, hop count, dst, dst seqno, origin
+            return length >= udp + 8 + 16 && ReadU32(aodv + 4) == ReadU32(aodv + 12) ? AODV_HELLO : AODV_RREP;
+        case 3:
+            return AODV_RERR;
+        case 4:
+            return AODV_RREP_ACK;
+        default:
+            return AODV_MESSAGE_COUNT;
+        }
+    }
+
+    static void IpTx(AodvAccounting *self, uint32_t node, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface) {
+        uint8_t buf[kPeekBytes];
+        uint32_t length = p->CopyData(buf, sizeof(buf));
+        AodvMessage type = Classify(buf, length);
+        if (type != AODV_MESSAGE_COUNT) {
+            Bump(self->m_rows[node].txPkts[type]);
+            Bump(self->m_rows[node].txBytes[type], p->GetSize());
+            return;
+        }
+        if (length >= 20) {
+            self->TrackDiscovery(node, ReadU32(buf + 12), ReadU32(buf + 16), ipv4, interface);
+        }
+    }
+
+    static void IpRx(AodvAccounting *self, uint32_t node, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface) {
+        uint8_t buf[kPeekBytes];
+        AodvMessage type = Classify(buf, p->CopyData(buf, sizeof(buf)));
+        if (type != AODV_MESSAGE_COUNT) {
+            Bump(self->m_rows[node].rxPkts[type]);
+            Bump(self->m_rows[node].rxBytes[type], p->GetSize());
+        }
+    }
+
+    /** A data packet leaves node: on the loopback it waits for a route, elsewhere it has one */
+    void TrackDiscovery(uint32_t node, uint32_t src, uint32_t dst, Ptr<Ipv4> ipv4, uint32_t interface) {
+        std::unordered_map<uint32_t, int64_t> &pending = m_pending[node];
+        Ipv4Address to(dst);
+        if (interface == 0) {
+            if (to.IsBroadcast() || to.IsMulticast() || to.IsLocalhost() || ipv4->GetInterfaceForAddress(to) >= 0) {
+                return;
+            }
+            int64_t now = Simulator::Now().GetNanoSeconds();
+            auto it = pending.find(dst);
+            if (it == pending.end()) {
+                pending.emplace(dst, now);
+                Bump(m_pendingCount);
+            } else if (now - it->second > kDiscoveryTimeoutNs) {
+                // The queued packets were dropped; this one starts a new discovery
+                Bump(m_failed);
+                it->second = now;
+            }
+            return;
+        }
+        if (pending.empty()) {
+            return;
+        }
+        auto it = pending.find(dst);
+        if (it == pending.end() || ipv4->GetInterfaceForAddress(Ipv4Address(src)) < 0) {
+            return;
+        }
+        int64_t elapsed = Simulator::Now().GetNanoSeconds() - it->second;
+        if (elapsed > kDiscoveryTimeoutNs) {
+            Bump(m_failed);
+        } else {
+            m_discovery.Record(static_cast<uint64_t>(elapsed));
+            Bump(m_discoveries);
+        }
+        pending.erase(it);
+        m_pendingCount.store(Load(m_pendingCount) - 1, std::memory_order_relaxed);
+    }
+
+    static void PhyTxPsduBegin(AodvAccounting *self, WifiPhy *phy, WifiConstPsduMap psdus, WifiTxVector txVector,
+                               double txPowerW) {
+        Time duration = WifiPhy::CalculateTxDuration(psdus, txVector, phy->GetPhyBand());
+        AirtimeKind kind = AIRTIME_CONTROL;
+        Ptr<const WifiPsdu> psdu = psdus.begin()->second;
+        if (psdu->GetNMpdus() > 0 && psdu->GetHeader(0).IsData()) {
+            // LLC/SNAP (8 bytes, EtherType last) then the IPv4 packet
+            uint8_t buf[8 + kPeekBytes];
+            Ptr<const Packet> payload = psdu->GetPayload(0);
+            uint32_t length = payload->CopyData(buf, sizeof(buf));
+            bool ipv4 = length > 8 && buf[6] == 0x08 && buf[7] == 0x00;
+            kind = ipv4 && Classify(buf + 8, length - 8) != AODV_MESSAGE_COUNT ? AIRTIME_ROUTING : AIRTIME_DATA;
+        }
+        Bump(self->m_airtimeNs[kind], duration.GetNanoSeconds());
+    }
+
+    std::unique_ptr<NodeRow[]> m_rows;
+    uint32_t m_n = 0;
+
+    // Discovery start per destination, per node (simulator thread only)
+    std::vector<std::unordered_map<uint32_t, int64_t>> m_pending;
+    std::atomic<uint64_t> m_pendingCount{0};
+    std::atomic<uint64_t> m_discoveries{0};
+    std::atomic<uint64_t> m_failed{0};
+    LatencyHistogram m_discovery;
+
+    std::atomic<uint64_t> m_airtimeNs[AIRTIME_KIND_COUNT] = {};
+    uint64_t m_lastAirtimeNs[AIRTIME_KIND_COUNT] = {};
+};
+
+} // namespace ns3
+
+#endif /* AODV_ACCOUNTING_H */
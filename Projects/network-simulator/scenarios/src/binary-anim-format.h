@@ -0,0 +1,106 @@
+/*
+ * Compact binary animation trace: file format shared by the writer
+ * (binary-anim.h) and the converter to NetAnim XML (anim-convert.cc).
+ *
+ * The file is "T4ANIM01" followed by chunks: u8 kind | varint length | payload.
+ * All integers are LEB128 varints; signed values are zigzag encoded; times
+ * are nanoseconds and positions centimetres.
+ *
+ *   ANIM_STRING   bytes                      defines the next string id (1, 2, ...)
+ *   ANIM_NODE     node | x | y               initial position
+ *   ANIM_DESCR    node | string id           <nu p="d">
+ *   ANIM_COLOR    node | r | g | b           <nu p="c">
+ *   ANIM_SIZE     node | w | h (cm)          <nu p="s">
+ *   ANIM_IP       node | string id           <ip>
+ *   ANIM_BLOCK    events, stored by column:
+ *       baseTime | nTx | nRx | nPos
+ *       tx:  uid (delta) | node | time (delta) | header count | header
+ *            string ids | numbers (one per kAnimNumber in those headers)
+ *       rx:  uid (delta) | node | time (delta)
+ *       pos: node | time (delta) | x (delta per node) | y (delta per node)
+ *
+ * Header strings are Packet::Print() output with every standalone decimal
+ * number replaced by kAnimNumber, so most of them repeat verbatim.
+ *
+ * Column deltas restart at every block, so blocks decode independently
+ * except for the string table and the per-node positions.
+ */
+
+#ifndef BINARY_ANIM_FORMAT_H
+#define BINARY_ANIM_FORMAT_H
+
+#include <cstdint>
+#include <string>
+
+static const char kAnimMagic[8] = {'T', '4', 'A', 'N', 'I', 'M', '0', '1'};
+
+// Placeholder for a number in a header string
+static const char kAnimNumber = '\x01';
+
+enum AnimChunk : uint8_t {
+    ANIM_STRING = 1,
+    ANIM_NODE,
+    ANIM_DESCR,
+    ANIM_COLOR,
+    ANIM_SIZE,
+    ANIM_IP,
+    ANIM_BLOCK,
+};
+
+inline void AnimPutVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline void AnimPutSigned(std::string &out, int64_t v) {
+    AnimPutVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+/**
+ * Bounds-checked reader over one chunk payload. Reading past the end sets
+ * the error flag and returns zeros.
+ */
+class AnimReader {
+public:
+    AnimReader(const uint8_t *begin, const uint8_t *end) : m_p(begin), m_end(end) {}
+
+    uint64_t Varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_p == m_end) {
+                m_error = true;
+                return 0;
+            }
+            uint8_t b = *m_p++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                return v;
+            }
+        }
+        m_error = true;
+        return v;
+    }
+
+    int64_t Signed() {
+        uint64_t v = Varint();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    std::string Rest() {
+        std::string s(reinterpret_cast<const char *>(m_p), m_end - m_p);
+        m_p = m_end;
+        return s;
+    }
+
+    bool Error() const { return m_error; }
+
+private:
+    const uint8_t *m_p;
+    const uint8_t *m_end;
+    bool m_error = false;
+};
+
+#endif /* BINARY_ANIM_FORMAT_H */
@@ -0,0 +1,413 @@
+/*
+ * Binary animation sink, an alternative to ns3::AnimationInterface.
+ *
+ * AnimationInterface writes one verbose XML element per transmission and per
+ * reception, each carrying the full Packet::Print() output. This sink
+ * records the same information (packet tx at PhyTxBegin, rx at PhyRxBegin,
+ * node positions, descriptions, colors and sizes) into the compact format
+ * of binary-anim-format.h:
+ *   - events are buffered in columns and written as varint/delta blocks,
+ *   - metadata is split per header, the numbers are taken out of each
+ *     header and every distinct remaining skeleton is written once and
+ *     referenced by id afterwards,
+ *   - positions are polled like NetAnim does but only written when a node
+ *     actually moved (and not polled at all if no node can move).
+ * anim-convert.cc turns the file back into NetAnim XML.
+ *
+ * Like AnimationInterface, create it after all devices are installed and
+ * keep it alive until the simulation has finished. With SetFilter only
+ * the transmissions and receptions a TraceFilter keeps are recorded.
+ */
+
+#ifndef BINARY_ANIM_H
+#define BINARY_ANIM_H
+
+#include "binary-anim-format.h"
+#include "trace-filter.h"
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class BinaryAnimationInterface {
+public:
+    BinaryAnimationInterface(const std::string &filename, bool metadata = true,
+                             Time pollInterval = MilliSeconds(250))
+        : m_metadata(metadata), m_pollInterval(pollInterval) {
+        m_file = std::fopen(filename.c_str(), "wb");
+        if (!m_file) {
+            NS_FATAL_ERROR("Cannot open animation trace " << filename);
+        }
+        std::fwrite(kAnimMagic, 1, sizeof(kAnimMagic), m_file);
+        if (m_metadata) {
+            PacketMetadata::Enable();
+        }
+
+        bool mobile = false;
+        for (uint32_t i = 0; i < NodeList::GetNNodes(); i++) {
+            Ptr<Node> node = NodeList::GetNode(i);
+            const uint32_t nodeId = node->GetId();
+            Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
+            if (mobility && !DynamicCast<ConstantPositionMobilityModel>(mobility)) {
+                mobile = true;
+            }
+            Vector pos = mobility ? mobility->GetPosition() : Vector();
+            m_lastX.push_back(Centimetres(pos.x));
+            m_lastY.push_back(Centimetres(pos.y));
+            m_polledX.push_back(m_lastX.back());
+            m_polledY.push_back(m_lastY.back());
+
+            std::string payload;
+            AnimPutVarint(payload, nodeId);
+            AnimPutSigned(payload, m_lastX.back());
+            AnimPutSigned(payload, m_lastY.back());
+            WriteChunk(ANIM_NODE, payload);
+
+            Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+            for (uint32_t j = 1; ipv4 && j < ipv4->GetNInterfaces(); j++) {
+                std::ostringstream addr;
+                addr << ipv4->GetAddress(j, 0).GetLocal();
+                payload.clear();
+                AnimPutVarint(payload, nodeId);
+                AnimPutVarint(payload, Intern(addr.str()));
+                WriteChunk(ANIM_IP, payload);
+            }
+
+            for (uint32_t d = 0; d < node->GetNDevices(); d++) {
+                Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice>(node->GetDevice(d));
+                if (!dev) {
+                    continue;
+                }
+                Ptr<WifiPhy> phy = dev->GetPhy();
+                phy->TraceConnectWithoutContext("PhyTxBegin", MakeBoundCallback(&TxTrace, this, nodeId));
+                phy->TraceConnectWithoutContext("PhyRxBegin", MakeBoundCallback(&RxTrace, this, nodeId));
+            }
+        }
+
+        if (mobile) {
+            Simulator::Schedule(m_pollInterval, &BinaryAnimationInterface::PollPositions, this);
+        }
+    }
+
+    ~BinaryAnimationInterface() {
+        FlushBlock();
+        FlushFile();
+        std::fclose(m_file);
+    }
+
+    BinaryAnimationInterface(const BinaryAnimationInterface &) = delete;
+    BinaryAnimationInterface &operator=(const BinaryAnimationInterface &) = delete;
+
+    void UpdateNodeDescription(Ptr<Node> node, const std::string &descr) {
+        std::string payload;
+        AnimPutVarint(payload, node->GetId());
+        AnimPutVarint(payload, Intern(descr));
+        WriteChunk(ANIM_DESCR, payload);
+    }
+
+    void UpdateNodeColor(Ptr<Node> node, uint8_t r, uint8_t g, uint8_t b) {
+        std::string payload;
+        AnimPutVarint(payload, node->GetId());
+        AnimPutVarint(payload, r);
+        AnimPutVarint(payload, g);
+        AnimPutVarint(payload, b);
+        WriteChunk(ANIM_COLOR, payload);
+    }
+
+    void UpdateNodeSize(uint32_t nodeId, double width, double height) {
+        std::string payload;
+        AnimPutVarint(payload, nodeId);
+        AnimPutVarint(payload, static_cast<uint64_t>(Centimetres(width)));
+        AnimPutVarint(payload, static_cast<uint64_t>(Centimetres(height)));
+        WriteChunk(ANIM_SIZE, payload);
+    }
+
+    /** Only record packets filter keeps; filter must outlive the interface */
+    void SetFilter(const TraceFilter *filter) { m_filter = filter; }
+
+    /** Bytes written so far (including the buffered part) */
+    uint64_t GetBytes() const { return m_written + m_out.size(); }
+
+private:
+    // Events per block and bytes buffered before writing to the file
+    static const size_t kBlockEvents = 4096;
+    static const size_t kFileBuffer = 1 << 20;
+    // Distinct header strings remembered for interning
+    static const size_t kMaxInterned = 1 << 18;
+
+    struct TxEvent {
+        uint64_t uid;
+        uint32_t node;
+        uint64_t time;
+        uint32_t metaCount;
+    };
+    struct RxEvent {
+        uint64_t uid;
+        uint32_t node;
+        uint64_t time;
+    };
+    struct PosEvent {
+        uint32_t node;
+        uint64_t time;
+        int64_t x;
+        int64_t y;
+    };
+
+    static int64_t Centimetres(double m) { return static_cast<int64_t>(std::llround(m * 100.0)); }
+
+    static void TxTrace(BinaryAnimationInterface *anim, uint32_t nodeId, Ptr<const Packet> p, double txPowerW) {
+        if (anim->m_filter && !anim->m_filter->Accept(nodeId, p, TRACE_WIFI)) {
+            return;
+        }
+        anim->RecordTx(nodeId, p);
+    }
+
+    static void RxTrace(BinaryAnimationInterface *anim, uint32_t nodeId, Ptr<const Packet> p,
+                        RxPowerWattPerChannelBand rxPowersW) {
+        if (anim->m_filter && !anim->m_filter->Accept(nodeId, p, TRACE_WIFI)) {
+            return;
+        }
+        anim->m_rx.push_back({p->GetUid(), nodeId, Now()});
+        anim->EventAdded();
+    }
+
+    static uint64_t Now() { return static_cast<uint64_t>(Simulator::Now().GetNanoSeconds()); }
+
+    void RecordTx(uint32_t nodeId, Ptr<const Packet> p) {
+        TxEvent ev{p->GetUid(), nodeId, Now(), 0};
+        if (m_metadata) {
+            m_print.str("");
+            p->Print(m_print);
+            ev.metaCount = InternHeaders(m_print.str());
+        }
+        m_tx.push_back(ev);
+        EventAdded();
+    }
+
+    /**
+     * Split Packet::Print() output into one string per header, e.g.
+     * "ns3::UdpHeader (length: 28 654 > 654)", and intern each of them
+     * as a skeleton with its numeric fields stored separately
+     */
+    uint32_t InternHeaders(const std::string &meta) {
+        uint32_t count = 0;
+        size_t start = 0;
+        int depth = 0;
+        for (size_t i = 0; i <= meta.size(); i++) {
+            char c = i < meta.size() ? meta[i] : ' ';
+            if (c == '(' || c == '[') {
+                depth++;
+            } else if ((c == ')' || c == ']') && depth > 0) {
+                depth--;
+            } else if (c == ' ' && depth == 0 &&
+                       (i == meta.size() || meta.compare(i + 1, 5, "ns3::") == 0 ||
+                        meta.compare(i + 1, 7, "Payload") == 0)) {
+                if (i > start) {
+                    m_txMeta.push_back(Intern(Skeleton(meta, start, i)));
+                    count++;
+                }
+                start = i + 1;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Replace every standalone decimal number in meta[begin, end) by
+     * kAnimNumber and queue its value ("ttl 64" -> "ttl \x01", 64). Numbers
+     * with leading zeros or glued to letters (MAC addresses, 0x800) stay in
+     * the text so the conversion back is exact.
+     */
+    std::string Skeleton(const std::string &meta, size_t begin, size_t end) {
+        std::string &out = m_skeleton;
+        out.clear();
+        size_t i = begin;
+        while (i < end) {
+            size_t j = i;
+            while (j < end && std::isdigit(static_cast<unsigned char>(meta[j]))) {
+                j++;
+            }
+            bool standalone = j > i && (i == begin || !std::isalnum(static_cast<unsigned char>(meta[i - 1]))) &&
+                              (j == end || !std::isalnum(static_cast<unsigned char>(meta[j])));
+            if (standalone && (meta[i] != '0' || j - i == 1) && j - i <= 18) {
+                m_txValues.push_back(std::stoull(meta.substr(i, j - i)));
+                out.push_back(kAnimNumber);
+                i = j;
+            } else if (j > i) {
+                out.append(meta, i, j - i);
+                i = j;
+            } else {
+                out.push_back(meta[i++]);
+            }
+        }
+        return out;
+    }
+
+    uint32_t Intern(const std::string &s) {
+        auto it = m_strings.find(s);
+        if (it != m_strings.end()) {
+            return it->second;
+        }
+        uint32_t id = ++m_nextString;
+        if (m_strings.size() < kMaxInterned) {
+            m_strings.emplace(s, id);
+        }
+        WriteChunk(ANIM_STRING, s);
+        return id;
+    }
+
+    void PollPositions() {
+        for (uint32_t i = 0; i < NodeList::GetNNodes() && i < m_lastX.size(); i++) {
+            Ptr<MobilityModel> mobility = NodeList::GetNode(i)->GetObject<MobilityModel>();
+            if (!mobility) {
+                continue;
+            }
+            Vector pos = mobility->GetPosition();
+            int64_t x = Centimetres(pos.x);
+            int64_t y = Centimetres(pos.y);
+            if (x != m_polledX[i] || y != m_polledY[i]) {
+                m_polledX[i] = x;
+                m_polledY[i] = y;
+                m_pos.push_back({i, Now(), x, y});
+                EventAdded();
+            }
+        }
+        Simulator::Schedule(m_pollInterval, &BinaryAnimationInterface::PollPositions, this);
+    }
+
+    void EventAdded() {
+        if (m_tx.size() + m_rx.size() + m_pos.size() >= kBlockEvents) {
+            FlushBlock();
+        }
+    }
+
+    /** Encode the buffered events column by column */
+    void FlushBlock() {
+        if (m_tx.empty() && m_rx.empty() && m_pos.empty()) {
+            return;
+        }
+        uint64_t base = UINT64_MAX;
+        base = m_tx.empty() ? base : std::min(base, m_tx.front().time);
+        base = m_rx.empty() ? base : std::min(base, m_rx.front().time);
+        base = m_pos.empty() ? base : std::min(base, m_pos.front().time);
+
+        std::string &b = m_block;
+        b.clear();
+        AnimPutVarint(b, base);
+        AnimPutVarint(b, m_tx.size());
+        AnimPutVarint(b, m_rx.size());
+        AnimPutVarint(b, m_pos.size());
+
+        uint64_t prevUid = 0, prevTime = base;
+        for (const TxEvent &e : m_tx) {
+            AnimPutSigned(b, static_cast<int64_t>(e.uid - prevUid));
+            prevUid = e.uid;
+        }
+        for (const TxEvent &e : m_tx) {
+            AnimPutVarint(b, e.node);
+        }
+        for (const TxEvent &e : m_tx) {
+            AnimPutVarint(b, e.time - prevTime);
+            prevTime = e.time;
+        }
+        for (const TxEvent &e : m_tx) {
+            AnimPutVarint(b, e.metaCount);
+        }
+        for (uint32_t id : m_txMeta) {
+            AnimPutVarint(b, id);
+        }
+        for (uint64_t v : m_txValues) {
+            AnimPutVarint(b, v);
+        }
+
+        prevUid = 0;
+        prevTime = base;
+        for (const RxEvent &e : m_rx) {
+            AnimPutSigned(b, static_cast<int64_t>(e.uid - prevUid));
+            prevUid = e.uid;
+        }
+        for (const RxEvent &e : m_rx) {
+            AnimPutVarint(b, e.node);
+        }
+        for (const RxEvent &e : m_rx) {
+            AnimPutVarint(b, e.time - prevTime);
+            prevTime = e.time;
+        }
+
+        prevTime = base;
+        for (const PosEvent &e : m_pos) {
+            AnimPutVarint(b, e.node);
+        }
+        for (const PosEvent &e : m_pos) {
+            AnimPutVarint(b, e.time - prevTime);
+            prevTime = e.time;
+        }
+        for (const PosEvent &e : m_pos) {
+            AnimPutSigned(b, e.x - m_lastX[e.node]);
+            m_lastX[e.node] = e.x;
+        }
+        for (const PosEvent &e : m_pos) {
+            AnimPutSigned(b, e.y - m_lastY[e.node]);
+            m_lastY[e.node] = e.y;
+        }
+
+        WriteChunk(ANIM_BLOCK, b);
+        m_tx.clear();
+        m_rx.clear();
+        m_pos.clear();
+        m_txMeta.clear();
+        m_txValues.clear();
+    }
+
+    void WriteChunk(AnimChunk kind, const std::string &payload) {
+        m_out.push_back(static_cast<char>(kind));
+        AnimPutVarint(m_out, payload.size());
+        m_out.append(payload);
+        if (m_out.size() >= kFileBuffer) {
+            FlushFile();
+        }
+    }
+
+    void FlushFile() {
+        std::fwrite(m_out.data(), 1, m_out.size(), m_file);
+        m_written += m_out.size();
+        m_out.clear();
+    }
+
+    bool m_metadata;
+    Time m_pollInterval;
+    const TraceFilter *m_filter = nullptr;
+    std::FILE *m_file = nullptr;
+    std::string m_out;
+    std::string m_block;
+    uint64_t m_written = 0;
+    std::ostringstream m_print;
+    std::unordered_map<std::string, uint32_t> m_strings;
+    uint32_t m_nextString = 0;
+    std::vector<int64_t> m_lastX, m_lastY;     // last written, for the position deltas
+    std::vector<int64_t> m_polledX, m_polledY; // last polled
+    std::vector<TxEvent> m_tx;
+    std::vector<RxEvent> m_rx;
+    std::vector<PosEvent> m_pos;
+    std::vector<uint32_t> m_txMeta;
+    std::vector<uint64_t> m_txValues;
+    std::string m_skeleton;
+};
+
+} // namespace ns3
+
+#endif /* BINARY_ANIM_H */
@@ -0,0 +1,63 @@
+/*
+ * Synthetic UDP echo traffic for headless runs.
+ *
+ * Every node runs a UdpEchoServer, and node i sends echo requests to node
+ * (i + n/2) % n, half-way across the network, so routes span several hops
+ * as n grows. Clients start 10 ms apart so the first requests do not
+ * collide. The workload draws no random numbers, so runs with the same
+ * seed execute the same events, which is what the benchmarks compare.
+ */
+
+#ifndef ECHO_TRAFFIC_H
+#define ECHO_TRAFFIC_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <cstdint>
+
+namespace ns3 {
+
+/** Requests sent and replies received by all echo clients */
+struct EchoTrafficStats {
+    uint64_t tx = 0;
+    uint64_t rx = 0;
+
+    double DeliveryRatio() const { return tx ? static_cast<double>(rx) / tx : 0.0; }
+};
+
+inline void EchoTrafficTx(EchoTrafficStats *stats, Ptr<const Packet>) { stats->tx++; }
+inline void EchoTrafficRx(EchoTrafficStats *stats, Ptr<const Packet>) { stats->rx++; }
+
+/**
+ * Installs the servers (from 0.5 s) and clients (from 1 s) on all nodes;
+ * everything stops at stop. interfaces holds one address per node.
+ */
+inline void InstallEchoTraffic(NodeContainer &nodes, Ipv4InterfaceContainer &interfaces, Time interval,
+                               uint32_t packetSize, Time stop, EchoTrafficStats &stats) {
+    const uint32_t n = nodes.GetN();
+    const uint16_t port = 9;
+
+    UdpEchoServerHelper server(port);
+    ApplicationContainer servers = server.Install(nodes);
+    servers.Start(Seconds(0.5));
+    servers.Stop(stop);
+
+    for (uint32_t i = 0; i < n; i++) {
+        UdpEchoClientHelper client(interfaces.GetAddress((i + n / 2) % n), port);
+        client.SetAttribute("MaxPackets", UintegerValue(0));
+        client.SetAttribute("Interval", TimeValue(interval));
+        client.SetAttribute("PacketSize", UintegerValue(packetSize));
+        ApplicationContainer app = client.Install(nodes.Get(i));
+        app.Get(0)->TraceConnectWithoutContext("Tx", MakeBoundCallback(&EchoTrafficTx, &stats));
+        app.Get(0)->TraceConnectWithoutContext("Rx", MakeBoundCallback(&EchoTrafficRx, &stats));
+        app.Start(Seconds(1.0 + 0.01 * i));
+        app.Stop(stop);
+    }
+}
+
+} // namespace ns3
+
+#endif /* ECHO_TRAFFIC_H */
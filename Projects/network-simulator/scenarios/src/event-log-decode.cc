@@ -0,0 +1,149 @@
+/*
+ * Decoder for the binary event log written by event-log.h
+ *
+ * Prints one line per record:
+ *     12.345678901s node 3 WARN PHY_RX_DROP reason=PREAMBLE_DETECT_FAILURE size=120 uid=4711
+ * --summary prints counts per type and code instead.
+ *
+ * Usage: event-log-decode [--summary] <file>
+ */
+
+#include "event-log.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+
+struct TypeInfo {
+    std::string name, code, arg0, arg1;
+    bool arg0IsIpv4 = false;
+};
+
+static bool ReadString(std::FILE *f, std::string &out) {
+    uint16_t len;
+    if (std::fread(&len, sizeof(len), 1, f) != 1) {
+        return false;
+    }
+    out.resize(len);
+    return len == 0 || std::fread(&out[0], 1, len, f) == len;
+}
+
+static std::string Ipv4String(uint32_t a) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u", a >> 24, (a >> 16) & 0xff, (a >> 8) & 0xff, a & 0xff);
+    return buf;
+}
+
+int main(int argc, char *argv[]) {
+    bool summary = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--summary") == 0) {
+            summary = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        std::fprintf(stderr, "Usage: %s [--summary] <event log>\n", argv[0]);
+        return 2;
+    }
+
+    std::FILE *f = std::fopen(path, "rb");
+    if (!f) {
+        std::perror(path);
+        return 1;
+    }
+
+    // Header: magic, record size, type and name tables
+    char magic[8];
+    uint32_t recordSize, typeCount, nameCount;
+    if (std::fread(magic, 1, 8, f) != 8 || std::memcmp(magic, "T4EVLOG1", 8) != 0 ||
+        std::fread(&recordSize, sizeof(recordSize), 1, f) != 1 || recordSize != sizeof(EventRecord) ||
+        std::fread(&typeCount, sizeof(typeCount), 1, f) != 1) {
+        std::fprintf(stderr, "%s: not an event log (or a different record version)\n", path);
+        return 1;
+    }
+    std::map<uint16_t, TypeInfo> types;
+    for (uint32_t i = 0; i < typeCount; i++) {
+        uint16_t type;
+        uint8_t isIpv4;
+        TypeInfo info;
+        if (std::fread(&type, sizeof(type), 1, f) != 1 || std::fread(&isIpv4, 1, 1, f) != 1 ||
+            !ReadString(f, info.name) || !ReadString(f, info.code) || !ReadString(f, info.arg0) ||
+            !ReadString(f, info.arg1)) {
+            std::fprintf(stderr, "%s: truncated type table\n", path);
+            return 1;
+        }
+        info.arg0IsIpv4 = isIpv4;
+        types[type] = info;
+    }
+    std::map<std::pair<uint16_t, uint32_t>, std::string> names;
+    if (std::fread(&nameCount, sizeof(nameCount), 1, f) != 1) {
+        std::fprintf(stderr, "%s: truncated name table\n", path);
+        return 1;
+    }
+    for (uint32_t i = 0; i < nameCount; i++) {
+        uint16_t type;
+        uint32_t code;
+        std::string name;
+        if (std::fread(&type, sizeof(type), 1, f) != 1 || std::fread(&code, sizeof(code), 1, f) != 1 ||
+            !ReadString(f, name)) {
+            std::fprintf(stderr, "%s: truncated name table\n", path);
+            return 1;
+        }
+        names[{type, code}] = name;
+    }
+
+    // Records
+    std::map<std::pair<uint16_t, uint32_t>, uint64_t> counts;
+    uint64_t total = 0;
+    EventRecord buf[1024];
+    size_t n;
+    while ((n = std::fread(buf, sizeof(EventRecord), 1024, f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const EventRecord &r = buf[i];
+            total++;
+            if (summary) {
+                counts[{r.type, r.code}]++;
+                continue;
+            }
+            auto t = types.find(r.type);
+            std::string typeName = t != types.end() ? t->second.name : "TYPE_" + std::to_string(r.type);
+            auto name = names.find({r.type, r.code});
+            std::string code = name != names.end() ? name->second : std::to_string(r.code);
+            const char *level = r.level < 4 ? kEventLogLevelNames[r.level] : "?";
+
+            std::printf("%" PRIu64 ".%09" PRIu64 "s node %u %s %s", r.timeNs / 1000000000,
+                        r.timeNs % 1000000000, r.node, level, typeName.c_str());
+            if (t != types.end()) {
+                const TypeInfo &info = t->second;
+                std::string arg0 = info.arg0IsIpv4 ? Ipv4String(r.arg0) : std::to_string(r.arg0);
+                if (!info.code.empty()) {
+                    std::printf(" %s=%s", info.code.c_str(), code.c_str());
+                }
+                std::printf(" %s=%s %s=%" PRIu64, info.arg0.c_str(), arg0.c_str(), info.arg1.c_str(), r.arg1);
+            } else {
+                std::printf(" code=%s arg0=%u arg1=%" PRIu64, code.c_str(), r.arg0, r.arg1);
+            }
+            std::printf("\n");
+        }
+    }
+    std::fclose(f);
+
+    if (summary) {
+        for (const auto &c : counts) {
+            auto t = types.find(c.first.first);
+            auto name = names.find(c.first);
+            std::printf("%-14s %-34s %" PRIu64 "\n",
+                        t != types.end() ? t->second.name.c_str() : std::to_string(c.first.first).c_str(),
+                        name != names.end() ? name->second.c_str() : std::to_string(c.first.second).c_str(),
+                        c.second);
+        }
+        std::printf("%" PRIu64 " records\n", total);
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+/*
+ * Asynchronous binary event log.
+ *
+ * Trace callbacks used to format drop reasons straight into std::cout on
+ * the simulator thread. Instead they now push fixed-size EventRecords into a
+ * per-thread single-producer/single-consumer ring. A background writer
+ * drains all rings into a binary file; event-log-decode.cc prints it back as
+ * text. A full ring drops the record (and counts it) rather than blocking
+ * the realtime loop.
+ *
+ * Levels are filtered at compile time: EVLOG sites below EVLOG_MIN_LEVEL
+ * are discarded by `if constexpr`, so their arguments are never evaluated.
+ * Build with -DEVLOG_MIN_LEVEL=EVLOG_LEVEL_INFO to keep the per-packet
+ * INFO sites.
+ *
+ * File layout (host byte order):
+ *   "T4EVLOG1" | u32 recordSize | u32 typeCount
+ *   typeCount x { u16 type | u8 arg0IsIpv4 | 4 strings (name, code, arg0, arg1) }
+ *   u32 nameCount
+ *   nameCount x { u16 type | u32 code | string }
+ *   EventRecord...
+ * where string = u16 length + bytes.
+ */
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define EVLOG_LEVEL_DEBUG 0
+#define EVLOG_LEVEL_INFO 1
+#define EVLOG_LEVEL_WARN 2
+#define EVLOG_LEVEL_ERROR 3
+
+#ifndef EVLOG_MIN_LEVEL
+#define EVLOG_MIN_LEVEL EVLOG_LEVEL_WARN
+#endif
+
+static const char *const kEventLogLevelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+/**
+ * One log entry. Fixed 32 bytes; the meaning of code/arg0/arg1 is given by
+ * the type definition stored in the file header.
+ */
+struct EventRecord {
+    uint64_t timeNs;
+    uint32_t node;
+    uint16_t type;
+    uint8_t level;
+    uint8_t reserved;
+    uint32_t code;
+    uint32_t arg0;
+    uint64_t arg1;
+};
+static_assert(sizeof(EventRecord) == 32, "EventRecord must stay 32 bytes");
+
+/**
+ * Lock-free single-producer/single-consumer ring of EventRecords
+ */
+class EventRing {
+public:
+    explicit EventRing(uint32_t capacity) : m_mask(capacity - 1), m_records(new EventRecord[capacity]) {}
+
+    bool Push(const EventRecord &record) {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tailCache > m_mask) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tailCache > m_mask) {
+                m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        m_records[head & m_mask] = record;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer side: append everything queued to out */
+    size_t Drain(std::vector<EventRecord> &out) {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i != head; i++) {
+            out.push_back(m_records[i & m_mask]);
+        }
+        m_tail.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    uint64_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    const uint64_t m_mask;
+    std::unique_ptr<EventRecord[]> m_records;
+    alignas(64) std::atomic<uint64_t> m_head{0};
+    uint64_t m_tailCache = 0;
+    std::atomic<uint64_t> m_dropped{0};
+    alignas(64) std::atomic<uint64_t> m_tail{0};
+};
+
+class EventLog {
+public:
+    using Clock = uint64_t (*)();
+
+    static EventLog &Get() {
+        static EventLog log;
+        return log;
+    }
+
+    /** Describe an event type: the labels of its code (empty: unused), arg0 and arg1 fields */
+    void DefineType(uint16_t type, const std::string &name, const std::string &code, const std::string &arg0,
+                    const std::string &arg1, bool arg0IsIpv4 = false) {
+        m_types.push_back({type, arg0IsIpv4, name, code, arg0, arg1});
+    }
+
+    /** Symbolic name of a code value of a type, e.g. a drop reason */
+    void DefineName(uint16_t type, uint32_t code, const std::string &name) {
+        m_names.push_back({type, code, name});
+    }
+
+    /** Time source for records (e.g. simulator time in ns) */
+    void SetClock(Clock clock) { m_clock = clock; }
+
+    /** Open the output file and start the writer thread. Define types first. */
+    bool Open(const std::string &path, uint32_t ringCapacity = 1 << 14) {
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file) {
+            return false;
+        }
+        m_ringCapacity = ringCapacity;
+        WriteHeader();
+        m_running.store(true, std::memory_order_release);
+        m_thread = std::thread(&EventLog::Run, this);
+        m_enabled.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /** Stop the writer after draining every ring */
+    void Close() {
+        if (!m_enabled.exchange(false)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running.store(false, std::memory_order_release);
+        }
+        m_wake.notify_one();
+        m_thread.join();
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+
+    void Push(uint8_t level, uint16_t type, uint32_t node, uint32_t code, uint32_t arg0, uint64_t arg1) {
+        if (!m_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        EventRecord record{m_clock ? m_clock() : 0, node, type, level, 0, code, arg0, arg1};
+        LocalRing()->Push(record);
+    }
+
+    uint64_t GetWritten() const { return m_written; }
+
+    uint64_t GetDropped() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t dropped = 0;
+        for (const auto &ring : m_rings) {
+            dropped += ring->GetDropped();
+        }
+        return dropped;
+    }
+
+private:
+    struct TypeDef {
+        uint16_t type;
+        bool arg0IsIpv4;
+        std::string name, code, arg0, arg1;
+    };
+    struct NameDef {
+        uint16_t type;
+        uint32_t code;
+        std::string name;
+    };
+
+    EventLog() = default;
+    ~EventLog() { Close(); }
+
+    EventRing *LocalRing() {
+        thread_local EventRing *ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_rings.emplace_back(new EventRing(m_ringCapacity));
+            ring = m_rings.back().get();
+        }
+        return ring;
+    }
+
+    void WriteString(const std::string &s) {
+        uint16_t len = static_cast<uint16_t>(s.size());
+        std::fwrite(&len, sizeof(len), 1, m_file);
+        std::fwrite(s.data(), 1, len, m_file);
+    }
+
+    void WriteHeader() {
+        uint32_t recordSize = sizeof(EventRecord);
+        uint32_t typeCount = static_cast<uint32_t>(m_types.size());
+        std::fwrite("T4EVLOG1", 1, 8, m_file);
+        std::fwrite(&recordSize, sizeof(recordSize), 1, m_file);
+        std::fwrite(&typeCount, sizeof(typeCount), 1, m_file);
+        for (const TypeDef &t : m_types) {
+            uint8_t isIpv4 = t.arg0IsIpv4;
+            std::fwrite(&t.type, sizeof(t.type), 1, m_file);
+            std::fwrite(&isIpv4, sizeof(isIpv4), 1, m_file);
+            WriteString(t.name);
+            WriteString(t.code);
+            WriteString(t.arg0);
+            WriteString(t.arg1);
+        }
+        uint32_t nameCount = static_cast<uint32_t>(m_names.size());
+        std::fwrite(&nameCount, sizeof(nameCount), 1, m_file);
+        for (const NameDef &n : m_names) {
+            std::fwrite(&n.type, sizeof(n.type), 1, m_file);
+            std::fwrite(&n.code, sizeof(n.code), 1, m_file);
+            WriteString(n.name);
+        }
+    }
+
+    void Run() {
+        std::vector<EventRecord> batch;
+        batch.reserve(m_ringCapacity);
+        while (true) {
+            bool running;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait_for(lock, std::chrono::milliseconds(20),
+                                [this] { return !m_running.load(std::memory_order_acquire); });
+                running = m_running.load(std::memory_order_acquire);
+                for (const auto &ring : m_rings) {
+                    ring->Drain(batch);
+                }
+            }
+            if (!batch.empty()) {
+                std::fwrite(batch.data(), sizeof(EventRecord), batch.size(), m_file);
+                m_written += batch.size();
+                batch.clear();
+            }
+            if (!running) {
+                std::fflush(m_file);
+                return;
+            }
+        }
+    }
+
+    std::vector<TypeDef> m_types;
+    std::vector<NameDef> m_names;
+    std::vector<std::unique_ptr<EventRing>> m_rings;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_enabled{false};
+    std::FILE *m_file = nullptr;
+    Clock m_clock = nullptr;
+    uint32_t m_ringCapacity = 1 << 14;
+    uint64_t m_written = 0;
+};
+
+// Compile-time filtered logging; disabled sites do not evaluate their arguments
+#define EVLOG(level, type, node, code, arg0, arg1)                                                         \
+    do {                                                                                                   \
+        if constexpr ((level) >= EVLOG_MIN_LEVEL) {                                                        \
+            EventLog::Get().Push((level), (type), (node), (code), (arg0), (arg1));                          \
+        }                                                                                                  \
+    } while (0)
+
+#define EVLOG_DEBUG(type, node, code, arg0, arg1) EVLOG(EVLOG_LEVEL_DEBUG, type, node, code, arg0, arg1)
+#define EVLOG_INFO(type, node, code, arg0, arg1) EVLOG(EVLOG_LEVEL_INFO, type, node, code, arg0, arg1)
+#define EVLOG_WARN(type, node, code, arg0, arg1) EVLOG(EVLOG_LEVEL_WARN, type, node, code, arg0, arg1)
+#define EVLOG_ERROR(type, node, code, arg0, arg1) EVLOG(EVLOG_LEVEL_ERROR, type, node, code, arg0, arg1)
+
+#endif /* EVENT_LOG_H */
@@ -0,0 +1,383 @@
+/*
+ * End-to-end latency of container traffic, per flow
+ *
+ * Every IPv4 frame a container sends into the simulation (TapIngress of
+ * its TapPortDevice, see tap-replay.h) is looked up by 5-tuple in a flat,
+ * open-addressing hash table and gets a FlowLatencyTag with its flow and
+ * arrival time. When a tagged frame leaves the simulation towards a
+ * container (TapEgress, unicast to that port), the time since ingress goes
+ * into the flow's histogram (latency-histogram.h). Egress only reads the
+ * tag, so the hash lookup is paid once per packet.
+ *
+ * Loss per flow is 1 - received / sent; frames still in flight when the
+ * run stops count as lost. Flows past MaxFlows are counted but not
+ * tracked. A flow's histogram is only allocated when it is first seen.
+ *
+ * The table is written on the simulator thread; the flow list is
+ * append-only and published with a release store, so the metrics thread
+ * can read flows and histograms at any time.
+ */
+
+#ifndef FLOW_LATENCY_H
+#define FLOW_LATENCY_H
+
+#include "latency-histogram.h"
+#include "metrics-exporter.h"
+#include "tap-replay.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/** Flow and ingress time of a container frame */
+class FlowLatencyTag : public Tag {
+public:
+    static TypeId GetTypeId() {
+        static TypeId tid =
+            TypeId("ns3::FlowLatencyTag").SetParent<Tag>().SetGroupName("TapBridge").AddConstructor<FlowLatencyTag>();
+        return tid;
+    }
+
+    FlowLatencyTag() = default;
+    FlowLatencyTag(uint32_t flow, int64_t timeNs) : m_flow(flow), m_timeNs(timeNs) {}
+
+    TypeId GetInstanceTypeId() const override { return GetTypeId(); }
+    uint32_t GetSerializedSize() const override { return 12; }
+    void Serialize(TagBuffer i) const override {
+        i.WriteU32(m_flow);
+        i.WriteU64(static_cast<uint64_t>(m_timeNs));
+    }
+    void Deserialize(TagBuffer i) override {
+        m_flow = i.ReadU32();
+        m_timeNs = static_cast<int64_t>(i.ReadU64());
+    }
+    void Print(std::ostream &os) const override { os << "flow=" << m_flow << " t=" << m_timeNs; }
+
+    uint32_t GetFlow() const { return m_flow; }
+    int64_t GetTimeNs() const { return m_timeNs; }
+
+private:
+    uint32_t m_flow = 0;
+    int64_t m_timeNs = 0;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(FlowLatencyTag);
+
+/** IPv4 5-tuple; ports are 0 for protocols without them and for non-first fragments */
+struct FlowKey {
+    uint32_t src = 0;
+    uint32_t dst = 0;
+    uint16_t srcPort = 0;
+    uint16_t dstPort = 0;
+    uint8_t protocol = 0;
+
+    bool operator==(const FlowKey &o) const {
+        return src == o.src && dst == o.dst && srcPort == o.srcPort && dstPort == o.dstPort &&
+               protocol == o.protocol;
+    }
+
+    uint64_t Hash() const {
+        uint64_t h = (static_cast<uint64_t>(src) << 32 | dst) * 0x9E3779B97F4A7C15ull;
+        h ^= (static_cast<uint64_t>(srcPort) << 24 | static_cast<uint64_t>(dstPort) << 8 | protocol) +
+             0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+        return h ^ (h >> 29);
+    }
+
+    std::string ToString() const {
+        std::ostringstream os;
+        const char *name = protocol == 6 ? "tcp" : protocol == 17 ? "udp" : protocol == 1 ? "icmp" : nullptr;
+        os << Ipv4Address(src) << ":" << srcPort << ">" << Ipv4Address(dst) << ":" << dstPort << "/";
+        if (name) {
+            os << name;
+        } else {
+            os << static_cast<uint32_t>(protocol);
+        }
+        return os.str();
+    }
+};
+
+/**
+ * Open-addressing (linear probing) map from FlowKey to flow index, kept
+ * at most half full; simulator thread only
+ */
+class FlowTable {
+public:
+    static const uint32_t kEmpty = UINT32_MAX;
+
+    FlowTable() { Rehash(1024); }
+
+    /** Index of key, or kEmpty */
+    uint32_t Find(const FlowKey &key) const {
+        for (uint64_t i = key.Hash() & m_mask;; i = (i + 1) & m_mask) {
+            const Slot &s = m_slots[i];
+            if (s.value == kEmpty || s.key == key) {
+                return s.value;
+            }
+        }
+    }
+
+    void Insert(const FlowKey &key, uint32_t value) {
+        if ((m_size + 1) * 2 > m_slots.size()) {
+            Rehash(m_slots.size() * 2);
+        }
+        Place(key, value);
+        m_size++;
+    }
+
+    uint32_t GetSize() const { return m_size; }
+
+private:
+    struct Slot {
+        FlowKey key;
+        uint32_t value = kEmpty;
+    };
+
+    void Place(const FlowKey &key, uint32_t value) {
+        uint64_t i = key.Hash() & m_mask;
+        while (m_slots[i].value != kEmpty) {
+            i = (i + 1) & m_mask;
+        }
+        m_slots[i].key = key;
+        m_slots[i].value = value;
+    }
+
+    void Rehash(size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(m_slots);
+        m_slots.resize(capacity);
+        m_mask = capacity - 1;
+        for (const Slot &s : old) {
+            if (s.value != kEmpty) {
+                Place(s.key, s.value);
+            }
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    uint64_t m_mask = 0;
+    uint32_t m_size = 0;
+};
+
+class FlowLatencyMonitor {
+public:
+    struct Flow {
+        FlowKey key;
+        std::string name;
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> received{0};
+        LatencyHistogram latency;
+
+        uint64_t GetSent() const { return sent.load(std::memory_order_relaxed); }
+        uint64_t GetReceived() const { return received.load(std::memory_order_relaxed); }
+        double Loss() const {
+            uint64_t s = GetSent();
+            uint64_t r = GetReceived();
+            return s && r < s ? static_cast<double>(s - r) / s : 0.0;
+        }
+    };
+
+    explicit FlowLatencyMonitor(uint32_t maxFlows = 4096) : m_maxFlows(maxFlows) {
+        m_flows.reset(new std::unique_ptr<Flow>[maxFlows]);
+    }
+
+    /** Measure the frames that enter and leave the simulation through port */
+    void Attach(Ptr<TapPortDevice> port) {
+        port->TraceConnectWithoutContext("TapIngress", MakeBoundCallback(&FlowLatencyMonitor::Ingress, this));
+        port->TraceConnectWithoutContext("TapEgress",
+                                         MakeBoundCallback(&FlowLatencyMonitor::Egress, this, PeekPointer(port)));
+    }
+
+    uint32_t GetFlowCount() const { return m_count.load(std::memory_order_acquire); }
+    const Flow &GetFlow(uint32_t i) const { return *m_flows[i]; }
+    uint64_t GetUntracked() const { return m_untracked.load(std::memory_order_relaxed); }
+
+    /** All flows together */
+    LatencyHistogram::Snapshot ReadAll(uint64_t *sent = nullptr, uint64_t *received = nullptr) const {
+        LatencyHistogram::Snapshot all;
+        uint64_t s = 0, r = 0;
+        for (uint32_t i = 0; i < GetFlowCount(); i++) {
+            all.Merge(m_flows[i]->latency.Read());
+            s += m_flows[i]->GetSent();
+            r += m_flows[i]->GetReceived();
+        }
+        if (sent) {
+            *sent = s;
+        }
+        if (received) {
+            *received = r;
+        }
+        return all;
+    }
+
+    /** One line over all flows, for the periodic report */
+    void PrintSummary(std::ostream &os) const {
+        if (GetFlowCount() == 0) {
+            return;
+        }
+        uint64_t sent, received;
+        LatencyHistogram::Snapshot all = ReadAll(&sent, &received);
+        os << "  TAP flows: " << GetFlowCount() << " flows, " << received << "/" << sent
+           << " frames out, latency p50=" << Ms(all.Percentile(0.5)) << "ms p99=" << Ms(all.Percentile(0.99))
+           << "ms p99.9=" << Ms(all.Percentile(0.999)) << "ms\n";
+    }
+
+    /** The top flows by frames sent, for the final statistics */
+    void Print(std::ostream &os, uint32_t top = 20) const {
+        uint32_t n = GetFlowCount();
+        if (n == 0) {
+            return;
+        }
+        std::vector<const Flow *> flows;
+        for (uint32_t i = 0; i < n; i++) {
+            flows.push_back(m_flows[i].get());
+        }
+        std::sort(flows.begin(), flows.end(),
+                  [](const Flow *a, const Flow *b) { return a->GetSent() > b->GetSent(); });
+        os << "TAP flow latency (" << n << " flows";
+        if (GetUntracked()) {
+            os << ", " << GetUntracked() << " frames of untracked flows";
+        }
+        os << "; in-flight frames count as lost):\n";
+        for (uint32_t i = 0; i < flows.size() && i < top; i++) {
+            const Flow &f = *flows[i];
+            LatencyHistogram::Snapshot s = f.latency.Read();
+            os << "  " << std::left << std::setw(44) << f.name << std::right << " sent=" << f.GetSent()
+               << " recv=" << f.GetReceived() << " loss=" << std::fixed << std::setprecision(1) << f.Loss() * 100
+               << "%" << std::defaultfloat << std::setprecision(6) << " p50=" << Ms(s.Percentile(0.5))
+               << "ms p99=" << Ms(s.Percentile(0.99)) << "ms p99.9=" << Ms(s.Percentile(0.999)) << "ms\n";
+        }
+        if (flows.size() > top) {
+            os << "  ... " << flows.size() - top << " more flows\n";
+        }
+    }
+
+    /**
+     * Export t4_flow_latency_ns{flow,quantile}, t4_flow_sent{flow} and
+     * t4_flow_received{flow}; flow="all" aggregates every flow
+     */
+    void AddCollector(MetricsExporter &metrics) const {
+        metrics.AddCollector([this](std::vector<MetricsExporter::Sample> &out) {
+            uint32_t n = GetFlowCount();
+            if (n == 0) {
+                return;
+            }
+            static const char *const quantiles[] = {"0.5", "0.99", "0.999"};
+            uint64_t sent, received;
+            LatencyHistogram::Snapshot all = ReadAll(&sent, &received);
+            for (const char *q : quantiles) {
+                out.push_back({"t4_flow_latency_ns", {{"flow", "all"}, {"quantile", q}},
+                               static_cast<double>(all.Percentile(std::atof(q)))});
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                const Flow &f = *m_flows[i];
+                LatencyHistogram::Snapshot s = f.latency.Read();
+                for (const char *q : quantiles) {
+                    out.push_back({"t4_flow_latency_ns", {{"flow", f.name}, {"quantile", q}},
+                                   static_cast<double>(s.Percentile(std::atof(q)))});
+                }
+            }
+            out.push_back({"t4_flow_sent", {{"flow", "all"}}, static_cast<double>(sent)});
+            for (uint32_t i = 0; i < n; i++) {
+                out.push_back({"t4_flow_sent", {{"flow", m_flows[i]->name}}, static_cast<double>(m_flows[i]->GetSent())});
+            }
+            out.push_back({"t4_flow_received", {{"flow", "all"}}, static_cast<double>(received)});
+            for (uint32_t i = 0; i < n; i++) {
+                out.push_back({"t4_flow_received", {{"flow", m_flows[i]->name}},
+                               static_cast<double>(m_flows[i]->GetReceived())});
+            }
+        });
+    }
+
+    static double Ms(uint64_t ns) { return ns / 1e6; }
+
+private:
+    static const uint16_t kIpv4 = 0x0800;
+
+    static void Bump(std::atomic<uint64_t> &a, uint64_t n = 1) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /** 5-tuple of the IPv4 packet (no Ethernet header); false if too short */
+    static bool Parse(Ptr<const Packet> packet, FlowKey &key) {
+        uint8_t b[24];
+        uint32_t length = packet->CopyData(b, sizeof(b));
+        if (length < 20 || (b[0] >> 4) != 4) {
+            return false;
+        }
+        key.protocol = b[9];
+        key.src = static_cast<uint32_t>(b[12]) << 24 | b[13] << 16 | b[14] << 8 | b[15];
+        key.dst = static_cast<uint32_t>(b[16]) << 24 | b[17] << 16 | b[18] << 8 | b[19];
+        uint32_t ihl = (b[0] & 0x0f) * 4u;
+        bool first = ((b[6] & 0x1f) | b[7]) == 0;
+        if (first && (key.protocol == 6 || key.protocol == 17) && ihl == 20 && length >= 24) {
+            key.srcPort = static_cast<uint16_t>(b[20] << 8 | b[21]);
+            key.dstPort = static_cast<uint16_t>(b[22] << 8 | b[23]);
+        }
+        return true;
+    }
+
+    static void Ingress(FlowLatencyMonitor *self, Ptr<const Packet> packet, const Address &dst, const Address &src,
+                        uint16_t protocol) {
+        FlowKey key;
+        if (protocol != kIpv4 || Mac48Address::ConvertFrom(dst).IsGroup() || !Parse(packet, key)) {
+            return;
+        }
+        uint32_t flow = self->m_table.Find(key);
+        if (flow == FlowTable::kEmpty) {
+            flow = self->AddFlow(key);
+            if (flow == FlowTable::kEmpty) {
+                Bump(self->m_untracked);
+                return;
+            }
+        }
+        Bump(self->m_flows[flow]->sent);
+        packet->AddPacketTag(FlowLatencyTag(flow, Simulator::Now().GetNanoSeconds()));
+    }
+
+    static void Egress(FlowLatencyMonitor *self, TapPortDevice *port, Ptr<const Packet> packet, const Address &dst,
+                       const Address &src, uint16_t protocol) {
+        FlowLatencyTag tag;
+        if (protocol != kIpv4 || !packet->PeekPacketTag(tag) || tag.GetFlow() >= self->GetFlowCount() ||
+            Mac48Address::ConvertFrom(dst) != Mac48Address::ConvertFrom(port->GetAddress())) {
+            return;
+        }
+        Flow &flow = *self->m_flows[tag.GetFlow()];
+        flow.latency.Record(static_cast<uint64_t>(Simulator::Now().GetNanoSeconds() - tag.GetTimeNs()));
+        Bump(flow.received);
+    }
+
+    uint32_t AddFlow(const FlowKey &key) {
+        uint32_t n = m_count.load(std::memory_order_relaxed);
+        if (n >= m_maxFlows) {
+            return FlowTable::kEmpty;
+        }
+        m_flows[n].reset(new Flow);
+        m_flows[n]->key = key;
+        m_flows[n]->name = key.ToString();
+        m_table.Insert(key, n);
+        m_count.store(n + 1, std::memory_order_release);
+        return n;
+    }
+
+    uint32_t m_maxFlows;
+    std::unique_ptr<std::unique_ptr<Flow>[]> m_flows;
+    std::atomic<uint32_t> m_count{0};
+    std::atomic<uint64_t> m_untracked{0};
+    FlowTable m_table;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_LATENCY_H */
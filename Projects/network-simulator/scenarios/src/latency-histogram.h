@@ -0,0 +1,126 @@
+/*
+ * HDR-style latency histogram.
+ *
+ * Log-linear buckets: values below 2^kSubBits are exact, above that every
+ * power of two is split into 2^(kSubBits-1) linear sub-buckets, so any
+ * recorded value is within 1 / 2^(kSubBits-1) (~3%) of its bucket bounds
+ * over the full uint64_t range, in a fixed 7.8 kB table.
+ *
+ * One thread records (the simulator thread); any thread may read. Counts
+ * are relaxed atomics updated with load + store instead of fetch_add, so
+ * recording is a few plain instructions; readers see every bucket at some
+ * recent value, which is all a periodic report needs.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class LatencyHistogram {
+public:
+    static constexpr uint32_t kSubBits = 5;
+    static constexpr uint32_t kHalf = 1u << (kSubBits - 1);
+    static constexpr uint32_t kBuckets = (64 - kSubBits + 1) * kHalf + kHalf;
+
+    /** Bucket holding value v */
+    static uint32_t Index(uint64_t v) {
+        if (v < (1u << kSubBits)) {
+            return static_cast<uint32_t>(v);
+        }
+        uint32_t shift = 63 - __builtin_clzll(v) - kSubBits + 1;
+        return shift * kHalf + static_cast<uint32_t>(v >> shift);
+    }
+
+    /** Lowest value stored in bucket i */
+    static uint64_t Low(uint32_t i) {
+        if (i < (1u << kSubBits)) {
+            return i;
+        }
+        uint32_t shift = i / kHalf - 1;
+        return static_cast<uint64_t>(i - shift * kHalf) << shift;
+    }
+
+    /** Highest value stored in bucket i */
+    static uint64_t High(uint32_t i) { return i + 1 < kBuckets ? Low(i + 1) - 1 : UINT64_MAX; }
+
+    /** Writer thread only */
+    void Record(uint64_t v) {
+        Bump(m_counts[Index(v)], 1);
+        Bump(m_count, 1);
+        Bump(m_sum, v);
+        if (v > m_max.load(std::memory_order_relaxed)) {
+            m_max.store(v, std::memory_order_relaxed);
+        }
+    }
+
+    /** Point-in-time copy, safe from any thread */
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        double Mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+
+        /** Upper bound of the bucket holding quantile q (0..1), capped at max */
+        uint64_t Percentile(double q) const {
+            uint64_t total = 0;
+            for (uint64_t c : counts) {
+                total += c;
+            }
+            if (total == 0) {
+                return 0;
+            }
+            uint64_t rank = static_cast<uint64_t>(q * total);
+            rank = rank < 1 ? 1 : rank > total ? total : rank;
+            uint64_t seen = 0;
+            for (uint32_t i = 0; i < counts.size(); i++) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    return High(i) < max ? High(i) : max;
+                }
+            }
+            return max;
+        }
+
+        /** Add another snapshot, e.g. to aggregate per-flow histograms */
+        void Merge(const Snapshot &other) {
+            counts.resize(kBuckets);
+            for (uint32_t i = 0; i < other.counts.size(); i++) {
+                counts[i] += other.counts[i];
+            }
+            count += other.count;
+            sum += other.sum;
+            max = other.max > max ? other.max : max;
+        }
+    };
+
+    Snapshot Read() const {
+        Snapshot s;
+        s.counts.resize(kBuckets);
+        for (uint32_t i = 0; i < kBuckets; i++) {
+            s.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+        }
+        s.count = m_count.load(std::memory_order_relaxed);
+        s.sum = m_sum.load(std::memory_order_relaxed);
+        s.max = m_max.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    uint64_t GetCount() const { return m_count.load(std::memory_order_relaxed); }
+
+private:
+    static void Bump(std::atomic<uint64_t> &a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> m_counts[kBuckets] = {};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+#endif /* LATENCY_HISTOGRAM_H */
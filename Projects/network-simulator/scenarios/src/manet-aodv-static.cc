@@ -1,9 +1,18 @@
 /*
- * TAP-AODV-NETANIM - 4 Node MANET with TAP Bridges
+ * TAP-AODV-NETANIM - N Node MANET with TAP Bridges
  * Combines: TAP interface → WiFi Ad-hoc → AODV Routing → NetAnim Visualization
  *
  * Traffic from Docker containers flows through TAP devices into the ns-3
  * simulation, gets routed via AODV, and is visualized in NetAnim.
+ *
+ * --nodes=N scales the MANET; the first --taps nodes are bridged to
+ * tap-0..tap-(taps-1). --tap=false runs headless (default simulator, no TAP,
+ * synthetic UDP echo traffic) for benchmarking, see scripts/bench-manet-nodes.sh;
+ * with --traffic=peers it runs the pynode workload instead (peer-traffic.h).
+ * --tapRecord=<file> records what the containers send; --tapReplay=<file>
+ * re-injects it headless, deterministic and faster than realtime.
+ * --trace=<spec> samples and filters what the per-packet trace sinks see
+ * (trace-filter.h).
  */
 
 #include "ns3/core-module.h"
@@ -14,153 +23,285 @@
 #include "ns3/aodv-module.h"
 #include "ns3/tap-bridge-module.h"
 #include "ns3/netanim-module.h"
+#include "ns3/applications-module.h"
+#include "aodv-accounting.h"
+#include "binary-anim.h"
+#include "echo-traffic.h"
+#include "event-log.h"
+#include "flow-latency.h"
+#include "metrics-exporter.h"
+#include "mq-tap-bridge.h"
+#include "node-counters.h"
+#include "pcapng-capture.h"
+#include "peer-traffic.h"
+#include "realtime-lag-monitor.h"
+#include "run-stats.h"
+#include "shm-bridge.h"
+#include "spatial-wifi-channel.h"
+#include "tap-replay.h"
+#include "trace-filter.h"
+#include "trajectory-mobility.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <sys/stat.h>
+#include <vector>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TapAodvNetanim");
 
-// Traffic counters
-static uint64_t g_macRxBytes[4] = {0}, g_macRxPkts[4] = {0};
-static uint64_t g_macTxBytes[4] = {0}, g_macTxPkts[4] = {0};
-static uint64_t g_ipRxBytes[4] = {0}, g_ipRxPkts[4] = {0};
-static uint64_t g_ipTxBytes[4] = {0}, g_ipTxPkts[4] = {0};
-static uint64_t g_ipDropPkts = 0;
-static uint64_t g_phyTxBegin = 0, g_phyTxEnd = 0, g_phyTxDrop = 0;
-static uint64_t g_phyRxBegin = 0, g_phyRxEnd = 0, g_phyRxDrop = 0;
+// Traffic counters, one row per node
+static NodeCounterTable g_counters;
+
+// --trace: which packets the counters, event log, pcap and animation see
+static TraceFilter g_trace;
+
+// Per-node rows are only printed periodically up to this many nodes
+static const uint32_t kMaxPrintedNodes = 16;
+
+// AODV messages per node and type, route discovery latency, routing airtime
+static AodvAccounting g_aodv;
 
-// AODV verification counters
-static uint64_t g_aodvRreqTx = 0, g_aodvRrepTx = 0;
-static uint64_t g_aodvRreqRx = 0, g_aodvRrepRx = 0;
+// Synthetic (headless) echo traffic: requests sent, replies received
+static EchoTrafficStats g_echo;
+
+// Synthetic (headless) pynode-style peer traffic, --traffic=peers
+static PeerTrafficStats g_peerStats;
+
+// Event log record types (see event-log.h, decoded by event-log-decode.cc)
+enum ManetEvent : uint16_t {
+    EV_IP_DROP = 1,
+    EV_PHY_TX_DROP,
+    EV_PHY_RX_DROP,
+    EV_MAC_RX,
+    EV_MAC_TX,
+    EV_IP_RX,
+    EV_IP_TX,
+};
 
 // Trace callbacks
-static void IpDropCallback(const Ipv4Header &header, Ptr<const Packet> p,
+static void IpDropCallback(uint32_t nodeId, const Ipv4Header &header, Ptr<const Packet> p,
                            Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-    g_ipDropPkts++;
-    std::cout << "[DROP] IP packet to " << header.GetDestination()
-              << " reason=" << reason << " iface=" << interface << "\n";
+    if (!g_trace.Accept(nodeId, p, header)) {
+        return;
+    }
+    g_counters[nodeId].Add(IP_DROP_PKTS);
+    EVLOG_WARN(EV_IP_DROP, nodeId, reason, header.GetDestination().Get(), interface);
+}
+
+static void PhyTxBeginCallback(uint32_t nodeId, Ptr<const Packet> p, double txPowerW) {
+    if (g_trace.Accept(nodeId, p, TRACE_WIFI)) {
+        g_counters[nodeId].Add(PHY_TX_BEGIN);
+    }
+}
+
+static void PhyTxEndCallback(uint32_t nodeId, Ptr<const Packet> p) {
+    if (g_trace.Accept(nodeId, p, TRACE_WIFI)) {
+        g_counters[nodeId].Add(PHY_TX_END);
+    }
 }
 
-static void PhyTxBeginCallback(Ptr<const Packet> p, double txPowerW) { g_phyTxBegin++; }
-static void PhyTxEndCallback(Ptr<const Packet> p) { g_phyTxEnd++; }
-static void PhyTxDropCallback(Ptr<const Packet> p) { g_phyTxDrop++; std::cout << "[DROP] PHY TX\n"; }
-static void PhyRxBeginCallback(Ptr<const Packet> p, RxPowerWattPerChannelBand rxPowersW) { g_phyRxBegin++; }
-static void PhyRxEndCallback(Ptr<const Packet> p) { g_phyRxEnd++; }
-
-static void PhyRxDropCallback(Ptr<const Packet> p, WifiPhyRxfailureReason reason) {
-    g_phyRxDrop++;
-    std::cout << "[DROP] PHY RX reason=" << reason << " (";
-    switch(reason) {
-        case UNSUPPORTED_SETTINGS: std::cout << "UNSUPPORTED_SETTINGS"; break;
-        case CHANNEL_SWITCHING: std::cout << "CHANNEL_SWITCHING"; break;
-        case RXING: std::cout << "RXING"; break;
-        case TXING: std::cout << "TXING"; break;
-        case SLEEPING: std::cout << "SLEEPING"; break;
-        case POWERED_OFF: std::cout << "POWERED_OFF"; break;
-        case TRUNCATED_TX: std::cout << "TRUNCATED_TX"; break;
-        case BUSY_DECODING_PREAMBLE: std::cout << "BUSY_DECODING_PREAMBLE"; break;
-        case PREAMBLE_DETECT_FAILURE: std::cout << "PREAMBLE_DETECT_FAILURE"; break;
-        case RECEPTION_ABORTED_BY_TX: std::cout << "RECEPTION_ABORTED_BY_TX"; break;
-        case L_SIG_FAILURE: std::cout << "L_SIG_FAILURE"; break;
-        case HT_SIG_FAILURE: std::cout << "HT_SIG_FAILURE"; break;
-        case SIG_A_FAILURE: std::cout << "SIG_A_FAILURE"; break;
-        case SIG_B_FAILURE: std::cout << "SIG_B_FAILURE"; break;
-        case PREAMBLE_DETECTION_PACKET_SWITCH: std::cout << "PREAMBLE_DETECTION_PACKET_SWITCH"; break;
-        case FRAME_CAPTURE_PACKET_SWITCH: std::cout << "FRAME_CAPTURE_PACKET_SWITCH"; break;
-        case OBSS_PD_CCA_RESET: std::cout << "OBSS_PD_CCA_RESET"; break;
-        case FILTERED: std::cout << "FILTERED"; break;
-        default: std::cout << "UNKNOWN"; break;
-    }
-    std::cout << ")\n";
+static void PhyRxBeginCallback(uint32_t nodeId, Ptr<const Packet> p, RxPowerWattPerChannelBand rxPowersW) {
+    if (g_trace.Accept(nodeId, p, TRACE_WIFI)) {
+        g_counters[nodeId].Add(PHY_RX_BEGIN);
+    }
 }
 
-static void MacRxCallback(uint32_t idx, Ptr<const Packet> p) {
-    g_macRxBytes[idx] += p->GetSize();
-    g_macRxPkts[idx]++;
-    NS_LOG_INFO("MAC RX Node " << idx << ": " << p->GetSize() << " bytes");
+static void PhyRxEndCallback(uint32_t nodeId, Ptr<const Packet> p) {
+    if (g_trace.Accept(nodeId, p, TRACE_WIFI)) {
+        g_counters[nodeId].Add(PHY_RX_END);
+    }
 }
 
-static void MacTxCallback(uint32_t idx, Ptr<const Packet> p) {
-    g_macTxBytes[idx] += p->GetSize();
-    g_macTxPkts[idx]++;
-    NS_LOG_INFO("MAC TX Node " << idx << ": " << p->GetSize() << " bytes");
+static void PhyTxDropCallback(uint32_t nodeId, Ptr<const Packet> p) {
+    if (!g_trace.Accept(nodeId, p, TRACE_WIFI)) {
+        return;
+    }
+    g_counters[nodeId].Add(PHY_TX_DROP);
+    EVLOG_WARN(EV_PHY_TX_DROP, nodeId, 0, p->GetSize(), p->GetUid());
 }
 
-static void IpRxCallback(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface) {
-    uint32_t nodeId = ipv4->GetObject<Node>()->GetId();
-    if (nodeId < 4) {
-        g_ipRxBytes[nodeId] += p->GetSize();
-        g_ipRxPkts[nodeId]++;
-        NS_LOG_INFO("IP RX Node " << nodeId << " iface " << interface << ": " << p->GetSize() << " bytes");
+static void PhyRxDropCallback(uint32_t nodeId, Ptr<const Packet> p, WifiPhyRxfailureReason reason) {
+    if (!g_trace.Accept(nodeId, p, TRACE_WIFI)) {
+        return;
     }
+    g_counters[nodeId].Add(PHY_RX_DROP);
+    EVLOG_WARN(EV_PHY_RX_DROP, nodeId, reason, p->GetSize(), p->GetUid());
 }
 
-static void IpTxCallback(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface) {
-    uint32_t nodeId = ipv4->GetObject<Node>()->GetId();
-    if (nodeId < 4) {
-        g_ipTxBytes[nodeId] += p->GetSize();
-        g_ipTxPkts[nodeId]++;
-        NS_LOG_INFO("IP TX Node " << nodeId << " iface " << interface << ": " << p->GetSize() << " bytes");
+static void MacRxCallback(uint32_t nodeId, Ptr<const Packet> p) {
+    if (!g_trace.Accept(nodeId, p, TRACE_LLC)) {
+        return;
     }
+    g_counters[nodeId].AddPacket(MAC_RX_PKTS, MAC_RX_BYTES, p->GetSize());
+    EVLOG_INFO(EV_MAC_RX, nodeId, 0, p->GetSize(), p->GetUid());
 }
 
-// Individual MAC callbacks (required for TraceConnectWithoutContext)
-static void MacRx0(Ptr<const Packet> p) { MacRxCallback(0, p); }
-static void MacRx1(Ptr<const Packet> p) { MacRxCallback(1, p); }
-static void MacRx2(Ptr<const Packet> p) { MacRxCallback(2, p); }
-static void MacRx3(Ptr<const Packet> p) { MacRxCallback(3, p); }
-static void MacTx0(Ptr<const Packet> p) { MacTxCallback(0, p); }
-static void MacTx1(Ptr<const Packet> p) { MacTxCallback(1, p); }
-static void MacTx2(Ptr<const Packet> p) { MacTxCallback(2, p); }
-static void MacTx3(Ptr<const Packet> p) { MacTxCallback(3, p); }
+static void MacTxCallback(uint32_t nodeId, Ptr<const Packet> p) {
+    if (!g_trace.Accept(nodeId, p, TRACE_LLC)) {
+        return;
+    }
+    g_counters[nodeId].AddPacket(MAC_TX_PKTS, MAC_TX_BYTES, p->GetSize());
+    EVLOG_INFO(EV_MAC_TX, nodeId, 0, p->GetSize(), p->GetUid());
+}
+
+static void IpRxCallback(uint32_t nodeId, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface) {
+    if (!g_trace.Accept(nodeId, p, TRACE_IPV4)) {
+        return;
+    }
+    g_counters[nodeId].AddPacket(IP_RX_PKTS, IP_RX_BYTES, p->GetSize());
+    EVLOG_INFO(EV_IP_RX, nodeId, interface, p->GetSize(), p->GetUid());
+}
+
+static void IpTxCallback(uint32_t nodeId, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface) {
+    if (!g_trace.Accept(nodeId, p, TRACE_IPV4)) {
+        return;
+    }
+    g_counters[nodeId].AddPacket(IP_TX_PKTS, IP_TX_BYTES, p->GetSize());
+    EVLOG_INFO(EV_IP_TX, nodeId, interface, p->GetSize(), p->GetUid());
+}
+
+static uint64_t EventLogClock() { return Simulator::Now().GetNanoSeconds(); }
+
+/**
+ * Describe the record types in the log header, so the decoder can print
+ * reason names without knowing ns-3's enums
+ */
+static void SetupEventLog() {
+    EventLog &log = EventLog::Get();
+    log.SetClock(&EventLogClock);
+    log.DefineType(EV_IP_DROP, "IP_DROP", "reason", "dst", "iface", true);
+    log.DefineType(EV_PHY_TX_DROP, "PHY_TX_DROP", "reason", "size", "uid");
+    log.DefineType(EV_PHY_RX_DROP, "PHY_RX_DROP", "reason", "size", "uid");
+    log.DefineType(EV_MAC_RX, "MAC_RX", "", "size", "uid");
+    log.DefineType(EV_MAC_TX, "MAC_TX", "", "size", "uid");
+    log.DefineType(EV_IP_RX, "IP_RX", "iface", "size", "uid");
+    log.DefineType(EV_IP_TX, "IP_TX", "iface", "size", "uid");
+
+    log.DefineName(EV_IP_DROP, Ipv4L3Protocol::DROP_TTL_EXPIRED, "TTL_EXPIRED");
+    log.DefineName(EV_IP_DROP, Ipv4L3Protocol::DROP_NO_ROUTE, "NO_ROUTE");
+    log.DefineName(EV_IP_DROP, Ipv4L3Protocol::DROP_BAD_CHECKSUM, "BAD_CHECKSUM");
+    log.DefineName(EV_IP_DROP, Ipv4L3Protocol::DROP_INTERFACE_DOWN, "INTERFACE_DOWN");
+    log.DefineName(EV_IP_DROP, Ipv4L3Protocol::DROP_ROUTE_ERROR, "ROUTE_ERROR");
+    log.DefineName(EV_IP_DROP, Ipv4L3Protocol::DROP_FRAGMENT_TIMEOUT, "FRAGMENT_TIMEOUT");
+
+    const std::pair<WifiPhyRxfailureReason, const char *> rxReasons[] = {
+        {UNSUPPORTED_SETTINGS, "UNSUPPORTED_SETTINGS"},
+        {CHANNEL_SWITCHING, "CHANNEL_SWITCHING"},
+        {RXING, "RXING"},
+        {TXING, "TXING"},
+        {SLEEPING, "SLEEPING"},
+        {POWERED_OFF, "POWERED_OFF"},
+        {TRUNCATED_TX, "TRUNCATED_TX"},
+        {BUSY_DECODING_PREAMBLE, "BUSY_DECODING_PREAMBLE"},
+        {PREAMBLE_DETECT_FAILURE, "PREAMBLE_DETECT_FAILURE"},
+        {RECEPTION_ABORTED_BY_TX, "RECEPTION_ABORTED_BY_TX"},
+        {L_SIG_FAILURE, "L_SIG_FAILURE"},
+        {HT_SIG_FAILURE, "HT_SIG_FAILURE"},
+        {SIG_A_FAILURE, "SIG_A_FAILURE"},
+        {SIG_B_FAILURE, "SIG_B_FAILURE"},
+        {PREAMBLE_DETECTION_PACKET_SWITCH, "PREAMBLE_DETECTION_PACKET_SWITCH"},
+        {FRAME_CAPTURE_PACKET_SWITCH, "FRAME_CAPTURE_PACKET_SWITCH"},
+        {OBSS_PD_CCA_RESET, "OBSS_PD_CCA_RESET"},
+        {FILTERED, "FILTERED"},
+    };
+    for (const auto &r : rxReasons) {
+        log.DefineName(EV_PHY_RX_DROP, r.first, r.second);
+    }
+}
 
 // Statistics functions
-static void PrintStats() {
-    std::cout << "\n[" << Simulator::Now().GetSeconds() << "s] Traffic Statistics:\n";
-    std::cout << "  MAC Layer (WiFi):\n";
-    uint64_t totalMacTx = 0, totalMacRx = 0;
-    for (int i = 0; i < 4; i++) {
-        std::cout << "    Node" << i << ": TX=" << g_macTxPkts[i] << "pkts/" << g_macTxBytes[i] << "B"
-                  << " RX=" << g_macRxPkts[i] << "pkts/" << g_macRxBytes[i] << "B\n";
-        totalMacTx += g_macTxPkts[i];
-        totalMacRx += g_macRxPkts[i];
-    }
-    std::cout << "  IP Layer (includes TAP traffic):\n";
-    uint64_t totalIpTx = 0, totalIpRx = 0;
-    for (int i = 0; i < 4; i++) {
-        std::cout << "    Node" << i << ": TX=" << g_ipTxPkts[i] << "pkts/" << g_ipTxBytes[i] << "B"
-                  << " RX=" << g_ipRxPkts[i] << "pkts/" << g_ipRxBytes[i] << "B\n";
-        totalIpTx += g_ipTxPkts[i];
-        totalIpRx += g_ipRxPkts[i];
-    }
-    std::cout << "  Totals: MAC TX=" << totalMacTx << " RX=" << totalMacRx
-              << " | IP TX=" << totalIpTx << " RX=" << totalIpRx << "\n";
-    std::cout << "  PHY: TxBegin=" << g_phyTxBegin << " TxEnd=" << g_phyTxEnd << " TxDrop=" << g_phyTxDrop
-              << " | RxBegin=" << g_phyRxBegin << " RxEnd=" << g_phyRxEnd << " RxDrop=" << g_phyRxDrop << "\n";
-    std::cout << "  Drops: IP=" << g_ipDropPkts << "\n";
-    Simulator::Schedule(Seconds(10.0), &PrintStats);
+
+/**
+ * Periodic report. Runs on the metrics exporter thread, so it only reads
+ * seqlock snapshots and never touches the simulator.
+ */
+static void PrintStats(std::ostream &os, double elapsed) {
+    const uint32_t n = g_counters.GetN();
+    NodeCounterSnapshot total;
+    std::vector<NodeCounterSnapshot> rows(n);
+    for (uint32_t i = 0; i < n; i++) {
+        rows[i] = g_counters[i].Snapshot();
+        for (uint32_t c = 0; c < NODE_COUNTER_COUNT; c++) {
+            total.value[c] += rows[i].value[c];
+        }
+    }
+
+    os << "\n[" << elapsed << "s wall] Traffic Statistics:\n";
+    if (n <= kMaxPrintedNodes) {
+        os << "  MAC Layer (WiFi):\n";
+        for (uint32_t i = 0; i < n; i++) {
+            os << "    Node" << i << ": TX=" << rows[i].Get(MAC_TX_PKTS) << "pkts/" << rows[i].Get(MAC_TX_BYTES) << "B"
+               << " RX=" << rows[i].Get(MAC_RX_PKTS) << "pkts/" << rows[i].Get(MAC_RX_BYTES) << "B\n";
+        }
+        os << "  IP Layer (includes TAP traffic):\n";
+        for (uint32_t i = 0; i < n; i++) {
+            os << "    Node" << i << ": TX=" << rows[i].Get(IP_TX_PKTS) << "pkts/" << rows[i].Get(IP_TX_BYTES) << "B"
+               << " RX=" << rows[i].Get(IP_RX_PKTS) << "pkts/" << rows[i].Get(IP_RX_BYTES) << "B\n";
+        }
+    }
+    os << "  Totals (" << n << " nodes): MAC TX=" << total.Get(MAC_TX_PKTS) << " RX=" << total.Get(MAC_RX_PKTS)
+       << " | IP TX=" << total.Get(IP_TX_PKTS) << " RX=" << total.Get(IP_RX_PKTS) << "\n";
+    os << "  PHY: TxBegin=" << total.Get(PHY_TX_BEGIN) << " TxEnd=" << total.Get(PHY_TX_END)
+       << " TxDrop=" << total.Get(PHY_TX_DROP)
+       << " | RxBegin=" << total.Get(PHY_RX_BEGIN) << " RxEnd=" << total.Get(PHY_RX_END)
+       << " RxDrop=" << total.Get(PHY_RX_DROP) << "\n";
+    os << "  Drops: IP=" << total.Get(IP_DROP_PKTS) << "\n";
 }
 
 static void PrintFinalStats() {
+    const uint32_t n = g_counters.GetN();
     std::cout << "\n=== FINAL STATISTICS ===\n";
     std::cout << "MAC Layer (WiFi):\n";
-    for (int i = 0; i < 4; i++) {
-        std::cout << "  Node " << i << ": TX=" << g_macTxPkts[i] << " pkts/" << g_macTxBytes[i] << " bytes"
-                  << ", RX=" << g_macRxPkts[i] << " pkts/" << g_macRxBytes[i] << " bytes\n";
+    for (uint32_t i = 0; i < n; i++) {
+        const NodeCounters &c = g_counters[i];
+        std::cout << "  Node " << i << ": TX=" << c.Get(MAC_TX_PKTS) << " pkts/" << c.Get(MAC_TX_BYTES) << " bytes"
+                  << ", RX=" << c.Get(MAC_RX_PKTS) << " pkts/" << c.Get(MAC_RX_BYTES) << " bytes\n";
     }
     std::cout << "IP Layer (includes TAP traffic):\n";
-    for (int i = 0; i < 4; i++) {
-        std::cout << "  Node " << i << ": TX=" << g_ipTxPkts[i] << " pkts/" << g_ipTxBytes[i] << " bytes"
-                  << ", RX=" << g_ipRxPkts[i] << " pkts/" << g_ipRxBytes[i] << " bytes\n";
+    for (uint32_t i = 0; i < n; i++) {
+        const NodeCounters &c = g_counters[i];
+        std::cout << "  Node " << i << ": TX=" << c.Get(IP_TX_PKTS) << " pkts/" << c.Get(IP_TX_BYTES) << " bytes"
+                  << ", RX=" << c.Get(IP_RX_PKTS) << " pkts/" << c.Get(IP_RX_BYTES) << " bytes\n";
     }
     std::cout << "PHY Layer:\n";
-    std::cout << "  TX: Begin=" << g_phyTxBegin << " End=" << g_phyTxEnd << " Drop=" << g_phyTxDrop << "\n";
-    std::cout << "  RX: Begin=" << g_phyRxBegin << " End=" << g_phyRxEnd << " Drop=" << g_phyRxDrop << "\n";
-    std::cout << "AODV Routing:\n";
-    std::cout << "  RREQ: TX=" << g_aodvRreqTx << " RX=" << g_aodvRreqRx << "\n";
-    std::cout << "  RREP: TX=" << g_aodvRrepTx << " RX=" << g_aodvRrepRx << "\n";
-    std::cout << "Drops: IP=" << g_ipDropPkts << "\n";
+    std::cout << "  TX: Begin=" << g_counters.Total(PHY_TX_BEGIN) << " End=" << g_counters.Total(PHY_TX_END)
+              << " Drop=" << g_counters.Total(PHY_TX_DROP) << "\n";
+    std::cout << "  RX: Begin=" << g_counters.Total(PHY_RX_BEGIN) << " End=" << g_counters.Total(PHY_RX_END)
+              << " Drop=" << g_counters.Total(PHY_RX_DROP) << "\n";
+    g_aodv.Print(std::cout, n);
+    std::cout << "Drops: IP=" << g_counters.Total(IP_DROP_PKTS) << "\n";
+}
+
+/**
+ * One machine-readable line with the run's parameters and results, as
+ * key=value pairs; collected by manet-sweep
+ */
+static void PrintResultLine(uint32_t numNodes, const std::string &mobility, double speed, double pause,
+                            double time, const RunStats &runStats) {
+    std::cout << "RESULT nodes=" << numNodes << " mobility=" << mobility << " speed=" << speed
+              << " pause=" << pause << " time=" << time << " run=" << RngSeedManager::GetRun()
+              << " mac_tx=" << g_counters.Total(MAC_TX_PKTS) << " mac_rx=" << g_counters.Total(MAC_RX_PKTS)
+              << " ip_tx=" << g_counters.Total(IP_TX_PKTS) << " ip_rx=" << g_counters.Total(IP_RX_PKTS)
+              << " ip_drop=" << g_counters.Total(IP_DROP_PKTS) << " phy_rx_drop=" << g_counters.Total(PHY_RX_DROP)
+              << " rreq_tx=" << g_aodv.TotalTx(AODV_RREQ) << " rrep_tx=" << g_aodv.TotalTx(AODV_RREP)
+              << " rerr_tx=" << g_aodv.TotalTx(AODV_RERR) << " hello_tx=" << g_aodv.TotalTx(AODV_HELLO)
+              << " aodv_tx_bytes=" << g_aodv.TotalTxBytes()
+              << " disc_done=" << g_aodv.GetDiscoveries() << " disc_failed=" << g_aodv.GetFailedDiscoveries()
+              << " disc_p50_ms=" << AodvAccounting::Ms(g_aodv.GetDiscoveryLatency().Read().Percentile(0.5))
+              << " disc_p99_ms=" << AodvAccounting::Ms(g_aodv.GetDiscoveryLatency().Read().Percentile(0.99))
+              << " routing_airtime=" << g_aodv.GetRoutingAirtimeShare() << " echo_tx=" << g_echo.tx
+              << " echo_rx=" << g_echo.rx << " pdr=" << g_echo.DeliveryRatio()
+              << " peer_attempts=" << PeerTrafficStats::Load(g_peerStats.attempts)
+              << " peer_delivered=" << PeerTrafficStats::Load(g_peerStats.delivered)
+              << " peer_success=" << g_peerStats.SuccessRate()
+              << " peer_lat_p50_ms=" << PeerTrafficStats::Ms(g_peerStats.latency.Read().Percentile(0.5))
+              << " peer_lat_p99_ms=" << PeerTrafficStats::Ms(g_peerStats.latency.Read().Percentile(0.99))
+              << " events=" << runStats.GetEvents() << " wall_s=" << runStats.GetWallSeconds()
+              << " peak_rss_kb=" << RunStats::PeakRssKb() << "\n";
 }
 
 // Setup functions
@@ -168,7 +309,8 @@ static void PrintFinalStats() {
 /**
  * Configure WiFi ad-hoc network
  */
-static NetDeviceContainer SetupWifi(NodeContainer &nodes, YansWifiPhyHelper &wifiPhy) {
+static NetDeviceContainer SetupWifi(NodeContainer &nodes, YansWifiPhyHelper &wifiPhy,
+                                    Ptr<YansWifiChannel> &channel, bool spatial) {
     WifiHelper wifi;
     wifi.SetStandard(WIFI_STANDARD_80211a);
     wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
@@ -178,10 +320,9 @@ static NetDeviceContainer SetupWifi(NodeContainer &nodes, YansWifiPhyHelper &wif
     wifiPhy.Set("TxPowerStart", DoubleValue(20.0));
     wifiPhy.Set("TxPowerEnd", DoubleValue(20.0));
 
-    YansWifiChannelHelper wifiChannel;
-    wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-    wifiChannel.AddPropagationLoss("ns3::RangePropagationLossModel", "MaxRange", DoubleValue(50.0));
-    wifiPhy.SetChannel(wifiChannel.Create());
+    // 50 m hard range; the spatial channel only visits receivers near the sender
+    channel = CreateRangeWifiChannel(50.0, spatial);
+    wifiPhy.SetChannel(channel);
 
     WifiMacHelper wifiMac;
     wifiMac.SetType("ns3::AdhocWifiMac");
@@ -193,16 +334,31 @@ static NetDeviceContainer SetupWifi(NodeContainer &nodes, YansWifiPhyHelper &wif
  * Configure node mobility model
  */
 static void SetupMobility(NodeContainer &nodes, const std::string &mobility_model,
-                          double speed, double pause) {
+                          double speed, double pause, double spacing) {
     MobilityHelper mobility;
+    const uint32_t n = nodes.GetN();
+    const uint32_t gridWidth = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+    const double side = std::max(100.0, spacing * gridWidth);
+
+    if (n == 4) {
+        // Initial positions (2x2 grid, the original 4-node layout)
+        Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator>();
+        positionAlloc->Add(Vector(0.0, 0.0, 0.0));
+        positionAlloc->Add(Vector(50.0, 0.0, 0.0));
+        positionAlloc->Add(Vector(0.0, 50.0, 0.0));
+        positionAlloc->Add(Vector(60.0, 60.0, 0.0));
+        mobility.SetPositionAllocator(positionAlloc);
+    } else {
+        // Initial positions (square grid, neighbours within radio range)
+        mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+            "MinX", DoubleValue(0.0), "MinY", DoubleValue(0.0),
+            "DeltaX", DoubleValue(spacing), "DeltaY", DoubleValue(spacing),
+            "GridWidth", UintegerValue(gridWidth),
+            "LayoutType", StringValue("RowFirst"));
+    }
 
-    // Initial positions (2x2 grid)
-    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator>();
-    positionAlloc->Add(Vector(0.0, 0.0, 0.0));
-    positionAlloc->Add(Vector(50.0, 0.0, 0.0));
-    positionAlloc->Add(Vector(0.0, 50.0, 0.0));
-    positionAlloc->Add(Vector(60.0, 60.0, 0.0));
-    mobility.SetPositionAllocator(positionAlloc);
+    std::ostringstream area;
+    area << "ns3::UniformRandomVariable[Min=0|Max=" << side << "]";
 
     if (mobility_model == "random-waypoint") {
         std::ostringstream speedStr, pauseStr;
@@ -212,11 +368,11 @@ static void SetupMobility(NodeContainer &nodes, const std::string &mobility_mode
             "Speed", StringValue(speedStr.str()),
             "Pause", StringValue(pauseStr.str()),
             "PositionAllocator", PointerValue(CreateObjectWithAttributes<RandomRectanglePositionAllocator>(
-                "X", StringValue("ns3::UniformRandomVariable[Min=0|Max=100]"),
-                "Y", StringValue("ns3::UniformRandomVariable[Min=0|Max=100]"))));
+                "X", StringValue(area.str()),
+                "Y", StringValue(area.str()))));
     } else if (mobility_model == "random-walk") {
         mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
-            "Bounds", RectangleValue(Rectangle(0, 100, 0, 100)),
+            "Bounds", RectangleValue(Rectangle(0, side, 0, side)),
             "Speed", StringValue("ns3::UniformRandomVariable[Min=1|Max=" + std::to_string(speed) + "]"));
     } else {
         mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
@@ -233,56 +389,113 @@ static Ipv4InterfaceContainer SetupNetwork(NodeContainer &nodes, NetDeviceContai
     stack.SetRoutingHelper(aodv);
     stack.Install(nodes);
 
+    // Keep the /24 the containers are configured with unless it is too small
     Ipv4AddressHelper address;
-    address.SetBase("10.0.0.0", "255.255.255.0");
+    address.SetBase("10.0.0.0", nodes.GetN() < 254 ? "255.255.255.0" : "255.255.0.0");
     return address.Assign(devices);
 }
 
 /**
- * Setup all trace connections for monitoring
+ * Setup all trace connections for monitoring. Every hook is bound to the
+ * node id of its device, so one callback serves all nodes.
  */
-static void SetupTracing(NodeContainer &nodes) {
-    // MAC layer traces
-    Config::ConnectWithoutContext("/NodeList/0/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx", MakeCallback(&MacRx0));
-    Config::ConnectWithoutContext("/NodeList/1/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx", MakeCallback(&MacRx1));
-    Config::ConnectWithoutContext("/NodeList/2/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx", MakeCallback(&MacRx2));
-    Config::ConnectWithoutContext("/NodeList/3/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx", MakeCallback(&MacRx3));
-    Config::ConnectWithoutContext("/NodeList/0/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx", MakeCallback(&MacTx0));
-    Config::ConnectWithoutContext("/NodeList/1/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx", MakeCallback(&MacTx1));
-    Config::ConnectWithoutContext("/NodeList/2/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx", MakeCallback(&MacTx2));
-    Config::ConnectWithoutContext("/NodeList/3/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx", MakeCallback(&MacTx3));
+static void SetupTracing(NodeContainer &nodes, NetDeviceContainer &devices) {
+    g_counters.Resize(nodes.GetN());
+
+    for (uint32_t i = 0; i < devices.GetN(); i++) {
+        Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice>(devices.Get(i));
+        uint32_t nodeId = dev->GetNode()->GetId();
+
+        // MAC layer traces
+        dev->GetMac()->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&MacRxCallback, nodeId));
+        dev->GetMac()->TraceConnectWithoutContext("MacTx", MakeBoundCallback(&MacTxCallback, nodeId));
+
+        // PHY layer traces
+        Ptr<WifiPhy> phy = dev->GetPhy();
+        phy->TraceConnectWithoutContext("PhyTxBegin", MakeBoundCallback(&PhyTxBeginCallback, nodeId));
+        phy->TraceConnectWithoutContext("PhyTxEnd", MakeBoundCallback(&PhyTxEndCallback, nodeId));
+        phy->TraceConnectWithoutContext("PhyTxDrop", MakeBoundCallback(&PhyTxDropCallback, nodeId));
+        phy->TraceConnectWithoutContext("PhyRxBegin", MakeBoundCallback(&PhyRxBeginCallback, nodeId));
+        phy->TraceConnectWithoutContext("PhyRxEnd", MakeBoundCallback(&PhyRxEndCallback, nodeId));
+        phy->TraceConnectWithoutContext("PhyRxDrop", MakeBoundCallback(&PhyRxDropCallback, nodeId));
+    }
 
     // IP layer traces
-    for (uint32_t i = 0; i < 4; i++) {
+    for (uint32_t i = 0; i < nodes.GetN(); i++) {
         Ptr<Ipv4> ipv4 = nodes.Get(i)->GetObject<Ipv4>();
-        ipv4->TraceConnectWithoutContext("Tx", MakeCallback(&IpTxCallback));
-        ipv4->TraceConnectWithoutContext("Rx", MakeCallback(&IpRxCallback));
-        ipv4->TraceConnectWithoutContext("Drop", MakeCallback(&IpDropCallback));
+        uint32_t nodeId = nodes.Get(i)->GetId();
+        ipv4->TraceConnectWithoutContext("Tx", MakeBoundCallback(&IpTxCallback, nodeId));
+        ipv4->TraceConnectWithoutContext("Rx", MakeBoundCallback(&IpRxCallback, nodeId));
+        ipv4->TraceConnectWithoutContext("Drop", MakeBoundCallback(&IpDropCallback, nodeId));
     }
 
-    // PHY layer traces
-    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyTxBegin", MakeCallback(&PhyTxBeginCallback));
-    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyTxEnd", MakeCallback(&PhyTxEndCallback));
-    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyTxDrop", MakeCallback(&PhyTxDropCallback));
-    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyRxBegin", MakeCallback(&PhyRxBeginCallback));
-    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyRxEnd", MakeCallback(&PhyRxEndCallback));
-    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyRxDrop", MakeCallback(&PhyRxDropCallback));
-
-    std::cout << "Tracing enabled: MAC, IP, PHY layers\n";
+    std::cout << "Tracing enabled: MAC, IP, PHY layers (" << nodes.GetN() << " nodes)\n";
 }
 
+/** Bridge type and the bridges created for the containers, kept alive until the run ends */
+struct ContainerBridges {
+    std::string type = "tap";
+    std::string shmDir = "/dev/shm/t4";
+    std::vector<Ptr<ShmBridge>> shm;
+    std::vector<Ptr<MqTapBridge>> mq;
+    FlowLatencyMonitor *flows = nullptr;
+};
+
 /**
- * Setup TAP bridges for Docker container connectivity
+ * Setup TAP bridges for Docker container connectivity (tap-0 .. tap-<taps-1>).
+ * With a recorder or flow latency, each bridge goes through a TapPortDevice
+ * that records the frames read from the TAP and timestamps them for the
+ * per-flow latency (flow-latency.h). bridges.type selects the bridge device:
+ * tap (TapBridge), mq (MqTapBridge on the same, multi_queue, TAP devices)
+ * or shm (ShmBridge to the container's shm-shim through shmDir/node-<i>).
  */
-static void SetupTapBridges(NodeContainer &nodes, NetDeviceContainer &devices) {
+static void SetupTapBridges(NodeContainer &nodes, NetDeviceContainer &devices, uint32_t taps,
+                            TapIngressRecorder *recorder, ContainerBridges &bridges) {
     TapBridgeHelper tapBridge;
     tapBridge.SetAttribute("Mode", StringValue("UseLocal"));
-    const char *taps[] = {"tap-0", "tap-1", "tap-2", "tap-3"};
 
-    for (uint32_t i = 0; i < 4; i++) {
-        tapBridge.SetAttribute("DeviceName", StringValue(taps[i]));
-        tapBridge.Install(nodes.Get(i), devices.Get(i));
-        std::cout << "TAP: " << taps[i] << " -> Node " << i << "\n";
+    for (uint32_t i = 0; i < taps; i++) {
+        std::string tap = "tap-" + std::to_string(i);
+        tapBridge.SetAttribute("DeviceName", StringValue(tap));
+        Ptr<NetDevice> bridged = devices.Get(i);
+        if (recorder || bridges.flows) {
+            Ptr<TapPortDevice> port = TapPortDevice::Install(bridged);
+            if (recorder) {
+                recorder->Attach(port);
+            }
+            if (bridges.flows) {
+                bridges.flows->Attach(port);
+            }
+            bridged = port;
+        }
+        if (bridges.type == "shm") {
+            std::string region = bridges.shmDir + "/node-" + std::to_string(i);
+            bridges.shm.push_back(InstallShmBridge(nodes.Get(i), bridged, region));
+            std::cout << "SHM: " << region << " -> Node " << i << "\n";
+            continue;
+        }
+        if (bridges.type == "mq") {
+            bridges.mq.push_back(InstallMqTapBridge(nodes.Get(i), bridged, tap, "UseLocal"));
+            std::cout << "TAP (multi-queue): " << tap << " -> Node " << i << "\n";
+            continue;
+        }
+        tapBridge.Install(nodes.Get(i), bridged);
+        std::cout << "TAP: " << tap << " -> Node " << i << "\n";
+    }
+}
+
+/**
+ * Node labels for either animation sink (AnimationInterface or
+ * BinaryAnimationInterface)
+ */
+template <typename Anim>
+static void DescribeNodes(Anim &anim, NodeContainer &nodes, Ipv4InterfaceContainer &interfaces) {
+    for (uint32_t i = 0; i < nodes.GetN(); i++) {
+        std::ostringstream oss;
+        oss << "Node" << i << " (" << interfaces.GetAddress(i) << ")";
+        anim.UpdateNodeDescription(nodes.Get(i), oss.str());
+        anim.UpdateNodeColor(nodes.Get(i), 0, 128, 255);
+        anim.UpdateNodeSize(nodes.Get(i)->GetId(), 5, 5);
     }
 }
 
@@ -295,18 +508,29 @@ static void SetupNetAnim(AnimationInterface &anim, NodeContainer &nodes,
     anim.SetMaxPktsPerTraceFile(1000000);
     anim.EnablePacketMetadata(true);
     anim.EnableIpv4L3ProtocolCounters(Seconds(0), Seconds(time));
-
-    for (uint32_t i = 0; i < nodes.GetN(); i++) {
-        std::ostringstream oss;
-        oss << "Node" << i << " (" << interfaces.GetAddress(i) << ")";
-        anim.UpdateNodeDescription(nodes.Get(i), oss.str());
-        anim.UpdateNodeColor(nodes.Get(i), 0, 128, 255);
-        anim.UpdateNodeSize(nodes.Get(i)->GetId(), 5, 5);
+    DescribeNodes(anim, nodes, interfaces);
+
+    // AnimationInterface connects its own traces: of --trace, only the time span applies
+    if (g_trace.IsActive()) {
+        anim.SetStartTime(Seconds(g_trace.GetStart()));
+        if (g_trace.GetStop() > 0) {
+            anim.SetStopTime(Seconds(std::min(g_trace.GetStop(), time)));
+        }
+        std::cout << "NetAnim XML: only the --trace windows apply, use --animFormat=binary to sample/filter\n";
     }
 
     std::cout << "\nNetAnim output: " << animFile << "\n";
-    std::cout << "PCAP files: /tmp/aodv-tap-*.pcap\n";
-    std::cout << "Waiting for TAP traffic...\n\n";
+}
+
+/**
+ * Setup the compact binary animation trace (convert with anim-convert)
+ */
+static void SetupBinaryAnim(BinaryAnimationInterface &anim, NodeContainer &nodes,
+                            Ipv4InterfaceContainer &interfaces, const std::string &animFile) {
+    anim.SetFilter(&g_trace);
+    DescribeNodes(anim, nodes, interfaces);
+
+    std::cout << "\nBinary animation output: " << animFile << " (anim-convert " << animFile << " out.xml)\n";
 }
 
 // Main function
@@ -314,21 +538,110 @@ int main(int argc, char *argv[]) {
     // Configuration parameters
     double time = 60.0;
     bool verbose = false;
-    std::string animFile = "manet-aodv-tap.xml";
+    std::string animFile;
+    std::string animFormat = "xml";
     std::string mobility_model = "static";
+    std::string trajectory;
     double speed = 5.0;
     double pause = 2.0;
+    uint32_t numNodes = 4;
+    uint32_t taps = 4;
+    double spacing = 40.0;
+    bool tap = true;
+    bool anim = true;
+    bool pcap = true;
+    PcapngOptions pcapOptions;
+    bool spatialChannel = true;
+    double metricsInterval = 10.0;
+    std::string metricsSocket;
+    std::string metricsFormat = "prometheus";
+    std::string eventLog = "/tmp/aodv-tap-events.bin";
+    bool lagMonitor = true;
+    std::string tapRecord;
+    std::string tapReplay;
+    ContainerBridges bridges;
+    uint32_t shmSpinUs = 50;
+    uint32_t tapQueues = 4;
+    bool flowLatency = true;
+    uint32_t maxFlows = 4096;
+    std::string traffic = "echo";
+    PeerTrafficOptions peerOptions;
+    std::string traceSpec;
 
     // Parse command line
     CommandLine cmd(__FILE__);
     cmd.AddValue("time", "Simulation time in seconds", time);
     cmd.AddValue("verbose", "Enable logging", verbose);
-    cmd.AddValue("animFile", "NetAnim output XML file", animFile);
+    cmd.AddValue("animFile", "Animation output file (default manet-aodv-tap.xml or .anim)", animFile);
+    cmd.AddValue("animFormat", "Animation trace format: xml (NetAnim) or binary (see anim-convert)", animFormat);
     cmd.AddValue("mobility", "Mobility model: static, random-waypoint, random-walk", mobility_model);
     cmd.AddValue("speed", "Max speed in m/s (for mobile models)", speed);
     cmd.AddValue("pause", "Pause time in seconds (for random-waypoint)", pause);
+    cmd.AddValue("nodes", "Number of MANET nodes", numNodes);
+    cmd.AddValue("taps", "Number of nodes bridged to tap-0..tap-<taps-1>", taps);
+    cmd.AddValue("trajectory", "Precomputed trajectory file from trajectory-gen (overrides --mobility)", trajectory);
+    cmd.AddValue("spacing", "Grid spacing in m for the initial layout (N != 4)", spacing);
+    cmd.AddValue("tap", "Bridge to TAP devices in realtime; false runs headless with synthetic traffic", tap);
+    cmd.AddValue("traffic", "Headless traffic: echo (UDP echo across the network) or peers (pynode-style TCP)",
+                 traffic);
+    peerOptions.AddValues(cmd);
+    cmd.AddValue("anim", "Write the NetAnim trace", anim);
+    cmd.AddValue("pcap", "Write the merged pcapng capture /tmp/aodv-tap-*.pcapng", pcap);
+    pcapOptions.AddValues(cmd);
+    cmd.AddValue("spatialChannel", "Use the spatially indexed WiFi channel (false: stock YansWifiChannel)", spatialChannel);
+    cmd.AddValue("metricsInterval", "Seconds between statistics reports (0 disables)", metricsInterval);
+    cmd.AddValue("metricsSocket", "Unix socket serving metric snapshots (empty disables)", metricsSocket);
+    cmd.AddValue("metricsFormat", "Metrics socket format: text, json, prometheus", metricsFormat);
+    cmd.AddValue("trace",
+                 "Packets seen by the counters, event log, pcap and animation, e.g. "
+                 "\"sample=10;nodes=0-3;flows=udp/*>10.0.0.3:5000;window=10-20\" (see trace-filter.h)",
+                 traceSpec);
+    cmd.AddValue("eventLog", "Binary event log file, read with event-log-decode (empty disables)", eventLog);
+    cmd.AddValue("lagMonitor", "Measure realtime scheduling lag per event (realtime only)", lagMonitor);
+    cmd.AddValue("tapRecord", "Record the frames read from the TAP devices to this file", tapRecord);
+    cmd.AddValue("tapReplay", "Replay a --tapRecord file headless instead of bridging TAP devices", tapReplay);
+    cmd.AddValue("bridge",
+                 "Container bridge: tap (TapBridge), mq (multi-queue TAP ingress) or shm (shared-memory rings to "
+                 "shm-shim)",
+                 bridges.type);
+    cmd.AddValue("tapQueues", "TAP queues read in parallel with --bridge=mq", tapQueues);
+    cmd.AddValue("shmDir", "Directory of the shared-memory regions, shared with the containers", bridges.shmDir);
+    cmd.AddValue("shmSpinUs", "Microseconds the shm bridge polls its ring before sleeping (0 on few cores)",
+                 shmSpinUs);
+    cmd.AddValue("flowLatency", "Per-flow latency and loss of the container traffic (TAP ingress to egress)",
+                 flowLatency);
+    cmd.AddValue("maxFlows", "Flows tracked by --flowLatency; later flows are only counted", maxFlows);
     cmd.Parse(argc, argv);
 
+    if (numNodes < 2) {
+        NS_FATAL_ERROR("--nodes must be at least 2");
+    }
+    std::string traceError;
+    if (!g_trace.Parse(traceSpec, traceError)) {
+        NS_FATAL_ERROR("--trace: " << traceError);
+    }
+    if (!tapReplay.empty()) {
+        tap = false;
+    }
+    taps = tap ? std::min(taps, numNodes) : 0;
+    if (bridges.type != "tap" && bridges.type != "mq" && bridges.type != "shm") {
+        NS_FATAL_ERROR("--bridge must be tap, mq or shm");
+    }
+    Config::SetDefault("ns3::MqTapBridge::Queues", UintegerValue(tapQueues));
+    if (bridges.type == "shm") {
+        mkdir(bridges.shmDir.c_str(), 0777);
+        Config::SetDefault("ns3::ShmBridge::SpinTime", TimeValue(MicroSeconds(shmSpinUs)));
+    }
+    if (traffic != "echo" && traffic != "peers") {
+        NS_FATAL_ERROR("--traffic must be echo or peers");
+    }
+    if (animFormat != "xml" && animFormat != "binary") {
+        NS_FATAL_ERROR("--animFormat must be xml or binary");
+    }
+    if (animFile.empty()) {
+        animFile = animFormat == "binary" ? "manet-aodv-tap.anim" : "manet-aodv-tap.xml";
+    }
+
     // Enable logging if verbose
     if (verbose) {
         LogComponentEnable("TapAodvNetanim", LOG_LEVEL_INFO);
@@ -337,44 +650,186 @@ int main(int argc, char *argv[]) {
     }
 
     // Real-time simulation required for TAP bridges
-    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    if (tap) {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    }
     GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
 
-    std::cout << "\n=== TAP-AODV-NETANIM: 4-Node MANET ===\n";
-    std::cout << "Mobility: " << mobility_model << " (speed=" << speed << "m/s, pause=" << pause << "s)\n";
+    // Measure how far the realtime event loop falls behind the wall clock
+    if (tap && lagMonitor) {
+        RealtimeLagMonitor::Get().Enable();
+    }
+
+    std::cout << "\n=== TAP-AODV-NETANIM: " << numNodes << "-Node MANET"
+              << (tap ? "" : tapReplay.empty() ? " (headless)" : " (replay)") << " ===\n";
+    if (!trajectory.empty()) {
+        mobility_model = "trajectory";
+        std::cout << "Mobility: trajectory file " << trajectory << "\n";
+    } else {
+        std::cout << "Mobility: " << mobility_model << " (speed=" << speed << "m/s, pause=" << pause << "s)\n";
+    }
 
     // Create and configure network
     NodeContainer nodes;
-    nodes.Create(4);
+    nodes.Create(numNodes);
 
-    YansWifiPhyHelper wifiPhy;
-    NetDeviceContainer devices = SetupWifi(nodes, wifiPhy);
-    SetupMobility(nodes, mobility_model, speed, pause);
+    SpatialYansWifiPhyHelper wifiPhy;
+    Ptr<YansWifiChannel> channel;
+    NetDeviceContainer devices = SetupWifi(nodes, wifiPhy, channel, spatialChannel);
+    if (trajectory.empty()) {
+        SetupMobility(nodes, mobility_model, speed, pause, spacing);
+    } else {
+        std::string error;
+        if (!InstallTrajectories(nodes, trajectory, error)) {
+            NS_FATAL_ERROR(error);
+        }
+    }
     Ipv4InterfaceContainer interfaces = SetupNetwork(nodes, devices);
 
     // Print node addresses
-    for (uint32_t i = 0; i < 4; i++) {
+    for (uint32_t i = 0; i < std::min(numNodes, kMaxPrintedNodes); i++) {
         std::cout << "Node " << i << ": " << interfaces.GetAddress(i) << "\n";
     }
 
-    // Enable PCAP tracing
-    wifiPhy.EnablePcapAll("/tmp/aodv-tap");
+    // One merged capture for all nodes, written by a background thread
+    PcapngCapture capture;
+    if (pcap) {
+        if (!capture.Start("/tmp/aodv-tap", pcapOptions)) {
+            NS_FATAL_ERROR("Cannot start the pcapng capture");
+        }
+        capture.SetFilter(&g_trace);
+        capture.Attach(devices);
+    }
+
+    // Drop events go to the binary event log, written off the event loop
+    if (!eventLog.empty()) {
+        SetupEventLog();
+        if (!EventLog::Get().Open(eventLog)) {
+            NS_FATAL_ERROR("Cannot open event log " << eventLog);
+        }
+        std::cout << "Event log: " << eventLog << "\n";
+    }
 
     // Setup all tracing and TAP bridges
-    SetupTracing(nodes);
-    SetupTapBridges(nodes, devices);
+    SetupTracing(nodes, devices);
+    g_trace.Print(std::cout);
+    g_aodv.Attach(nodes, devices);
+    TapIngressRecorder recorder;
+    TapIngressReplay replay;
+    FlowLatencyMonitor flows(maxFlows);
+    if (tap && flowLatency) {
+        bridges.flows = &flows;
+    }
+    if (tap) {
+        if (!tapRecord.empty() && !recorder.Open(tapRecord, numNodes)) {
+            NS_FATAL_ERROR("Cannot open TAP record file " << tapRecord);
+        }
+        SetupTapBridges(nodes, devices, taps, tapRecord.empty() ? nullptr : &recorder, bridges);
+    } else if (!tapReplay.empty()) {
+        if (!replay.Start(tapReplay, devices)) {
+            NS_FATAL_ERROR("Cannot read TAP record file " << tapReplay);
+        }
+        if (replay.GetRecordedNodes() != numNodes) {
+            std::cout << "Warning: " << tapReplay << " was recorded with --nodes=" << replay.GetRecordedNodes()
+                      << "\n";
+        }
+        std::cout << "Replaying TAP ingress from " << tapReplay << "\n";
+    } else if (traffic == "peers") {
+        // Fixed RNG streams from 1000 on, clear of anything else the scenario assigns
+        InstallPeerTraffic(nodes, interfaces, peerOptions, g_peerStats, Seconds(1.0), Seconds(time), 1000);
+        std::cout << "Peer traffic: " << numNodes * std::max<uint32_t>(1, peerOptions.perNode)
+                  << " virtual peers, one connection every " << peerOptions.interval << "s each\n";
+    } else {
+        InstallEchoTraffic(nodes, interfaces, Seconds(1.0), 64, Seconds(time), g_echo);
+    }
 
     // NetAnim must be created here (in main) to stay alive during simulation
-    AnimationInterface anim(animFile);
-    SetupNetAnim(anim, nodes, interfaces, time, animFile);
+    std::unique_ptr<AnimationInterface> animation;
+    std::unique_ptr<BinaryAnimationInterface> binaryAnimation;
+    if (anim && animFormat == "binary") {
+        binaryAnimation = std::make_unique<BinaryAnimationInterface>(animFile);
+        SetupBinaryAnim(*binaryAnimation, nodes, interfaces, animFile);
+    } else if (anim) {
+        animation = std::make_unique<AnimationInterface>(animFile);
+        SetupNetAnim(*animation, nodes, interfaces, time, animFile);
+    }
+    if (pcap) {
+        std::cout << "PCAPNG capture: /tmp/aodv-tap-*.pcapng\n";
+    }
+    if (tap) {
+        std::cout << "Waiting for TAP traffic...\n\n";
+    }
+
+    // Statistics are reported from the exporter thread, off the event loop
+    MetricsExporter metrics;
+    metrics.AddNodeCounterTable(&g_counters);
+    metrics.SetTextReport([&bridges, &flows](std::ostream &os, double elapsed) {
+        PrintStats(os, elapsed);
+        RealtimeLagMonitor::Get().PrintSummary(os);
+        g_peerStats.PrintSummary(os);
+        g_aodv.PrintSummary(os);
+        flows.PrintSummary(os);
+        for (const Ptr<MqTapBridge> &mq : bridges.mq) {
+            mq->PrintSummary(os);
+        }
+    });
+    RealtimeLagMonitor::Get().AddCollector(metrics);
+    g_peerStats.AddCollector(metrics);
+    g_aodv.AddCollector(metrics);
+    flows.AddCollector(metrics);
+    for (const Ptr<MqTapBridge> &mq : bridges.mq) {
+        mq->AddCollector(metrics);
+    }
 
     // Run simulation
-    Simulator::Schedule(Seconds(10.0), &PrintStats);
+    RunStats runStats;
     Simulator::Stop(Seconds(time));
+    metrics.Start(metricsInterval, metricsSocket, MetricsExporter::ParseFormat(metricsFormat));
+    runStats.Start();
     Simulator::Run();
+    runStats.Stop();
+    metrics.Stop();
+    EventLog::Get().Close();
+    capture.Stop();
+    recorder.Close();
 
     // Print final statistics
     PrintFinalStats();
+    PrintSpatialChannelStats(channel);
+    RealtimeLagMonitor::Get().Print(std::cout);
+    g_peerStats.PrintSummary(std::cout);
+    if (!eventLog.empty()) {
+        std::cout << "Event log: " << EventLog::Get().GetWritten() << " records, "
+                  << EventLog::Get().GetDropped() << " dropped (ring full)\n";
+    }
+    if (pcap) {
+        capture.Print(std::cout);
+    }
+    if (!bridges.shm.empty()) {
+        std::cout << "Shared-memory bridges:\n";
+        for (const Ptr<ShmBridge> &shm : bridges.shm) {
+            shm->Print(std::cout);
+        }
+    }
+    if (!bridges.mq.empty()) {
+        std::cout << "Multi-queue TAP bridges:\n";
+        for (const Ptr<MqTapBridge> &mq : bridges.mq) {
+            mq->Print(std::cout);
+        }
+    }
+    flows.Print(std::cout);
+    if (!tapRecord.empty() && tap) {
+        std::cout << "TAP record: " << recorder.GetFrames() << " frames in " << tapRecord << "\n";
+    }
+    if (!tapReplay.empty()) {
+        std::cout << "TAP replay: " << replay.GetFrames() << " frames injected, " << replay.GetSkipped()
+                  << " for missing nodes\n";
+    }
+    if (binaryAnimation) {
+        std::cout << "Animation trace: " << binaryAnimation->GetBytes() << " bytes\n";
+    }
+    runStats.Print();
+    PrintResultLine(numNodes, mobility_model, speed, pause, time, runStats);
 
     Simulator::Destroy();
     return 0;
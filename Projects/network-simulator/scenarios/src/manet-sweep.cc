@@ -0,0 +1,460 @@
+/*
+ * Parameter sweep for manet-aodv-static
+ *
+ * Expands a grid of --mobility x --speed x --pause x --nodes x RNG run
+ * numbers into jobs and runs them headless (--tap=false: default simulator,
+ * synthetic traffic, no TAP, no traces) on a pool of worker threads, one
+ * per core, each pinned to its core. A job inherits the core of the worker
+ * that forks it.
+ *
+ * Every finished job appends one row to a CSV file: the job parameters
+ * followed by the values of the scenario's RESULT line. The file is flushed
+ * after each row, so an interrupted sweep resumes by running it again with
+ * the same arguments: jobs that already have a row are skipped. Failed jobs
+ * get no row and are retried on the next run.
+ *
+ * Usage (from the ns-3 directory, after ./ns3 build scratch/manet-aodv-static):
+ *   manet-sweep --mobility=static,random-waypoint --speed=1,5,10 --pause=0,5
+ *               --nodes=16,64 --runs=1-10 --time=300 --out=sweep.csv
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Parameter columns, in CSV order; they identify a job
+static const char *const kParams[] = {"mobility", "speed", "pause", "nodes", "time", "run"};
+static const size_t kParamCount = sizeof(kParams) / sizeof(kParams[0]);
+
+struct Options {
+    std::vector<std::string> mobility = {"static"};
+    std::vector<std::string> speed = {"5"};
+    std::vector<std::string> pause = {"2"};
+    std::vector<std::string> nodes = {"4"};
+    std::string time = "60";
+    uint32_t runFirst = 1;
+    uint32_t runLast = 1;
+    std::string binary = "build/scratch/ns3.37-manet-aodv-static-default";
+    std::string out = "manet-sweep.csv";
+    std::string extra;
+    uint32_t jobs = 0;
+    double timeout = 0;
+};
+
+struct Job {
+    std::vector<std::string> params; // kParams order
+};
+
+static std::vector<std::string> Split(const std::string &s, char sep) {
+    std::vector<std::string> out;
+    std::string item;
+    std::istringstream is(s);
+    while (std::getline(is, item, sep)) {
+        if (!item.empty()) {
+            out.push_back(item);
+        }
+    }
+    return out;
+}
+
+static std::string JobKey(const std::vector<std::string> &params) {
+    std::string key;
+    for (const std::string &p : params) {
+        key += p;
+        key += ',';
+    }
+    return key;
+}
+
+static void Usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  --mobility=a,b      mobility models (static, random-waypoint, random-walk)\n"
+              << "  --speed=1,5         max speeds in m/s\n"
+              << "  --pause=0,5         pause times in s\n"
+              << "  --nodes=4,32        node counts\n"
+              << "  --time=60           simulated seconds per job\n"
+              << "  --runs=1-10         RNG run numbers (--RngRun)\n"
+              << "  --jobs=N            concurrent jobs (default: cores available)\n"
+              << "  --timeout=S         kill a job after S wall seconds (0: never)\n"
+              << "  --binary=PATH       scenario executable\n"
+              << "  --extra=\"--a=1 ..\"  more scenario arguments\n"
+              << "  --out=FILE          results CSV, resumed if it exists\n";
+}
+
+static bool ParseArg(const std::string &arg, Options &o) {
+    std::string::size_type eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+        return false;
+    }
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    try {
+        if (name == "mobility") {
+            o.mobility = Split(value, ',');
+        } else if (name == "speed") {
+            o.speed = Split(value, ',');
+        } else if (name == "pause") {
+            o.pause = Split(value, ',');
+        } else if (name == "nodes") {
+            o.nodes = Split(value, ',');
+        } else if (name == "time") {
+            o.time = value;
+        } else if (name == "runs") {
+            std::string::size_type dash = value.find('-');
+            o.runFirst = std::stoul(value.substr(0, dash));
+            o.runLast = dash == std::string::npos ? o.runFirst : std::stoul(value.substr(dash + 1));
+        } else if (name == "jobs") {
+            o.jobs = std::stoul(value);
+        } else if (name == "timeout") {
+            o.timeout = std::stod(value);
+        } else if (name == "binary") {
+            o.binary = value;
+        } else if (name == "extra") {
+            o.extra = value;
+        } else if (name == "out") {
+            o.out = value;
+        } else {
+            return false;
+        }
+    } catch (const std::logic_error &) {
+        // std::invalid_argument or std::out_of_range from the number parsers
+        std::cerr << "Bad value for --" << name << ": " << value << "\n";
+        return false;
+    }
+    return true;
+}
+
+static bool ParseArgs(int argc, char *argv[], Options &o) {
+    for (int i = 1; i < argc; i++) {
+        if (!ParseArg(argv[i], o)) {
+            return false;
+        }
+    }
+    return o.runFirst <= o.runLast;
+}
+
+/**
+ * Results file: a header line, then one row per finished job. Rows are
+ * appended and flushed as jobs finish, from any worker.
+ */
+class ResultsFile {
+public:
+    /** Load the jobs already done from an existing file */
+    bool Open(const std::string &path) {
+        std::ifstream in(path);
+        std::string line;
+        if (in && std::getline(in, line) && !line.empty()) {
+            m_columns = Split(line, ',');
+            if (m_columns.size() < kParamCount ||
+                !std::equal(kParams, kParams + kParamCount, m_columns.begin())) {
+                std::cerr << path << ": not a manet-sweep results file\n";
+                return false;
+            }
+            // A row cut short by an interrupted run has too few fields and is redone
+            while (std::getline(in, line)) {
+                size_t fields = std::count(line.begin(), line.end(), ',') + 1;
+                std::vector<std::string> row = Split(line, ',');
+                if (fields == m_columns.size() && row.size() >= kParamCount) {
+                    row.resize(kParamCount);
+                    m_done.insert(JobKey(row));
+                }
+            }
+        }
+        m_file = std::fopen(path.c_str(), "a+");
+        if (!m_file) {
+            std::perror(path.c_str());
+            return false;
+        }
+        // Terminate a row cut short by an interrupted run; output after
+        // input needs a seek in between
+        bool terminated = std::fseek(m_file, -1, SEEK_END) != 0 || std::fgetc(m_file) == '\n';
+        std::fseek(m_file, 0, SEEK_END);
+        if (!terminated) {
+            std::fputc('\n', m_file);
+        }
+        return true;
+    }
+
+    ~ResultsFile() {
+        if (m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    bool IsDone(const Job &job) const { return m_done.count(JobKey(job.params)) > 0; }
+
+    /** Append a row; the first row of a new file fixes the result columns */
+    void Append(const Job &job, const std::vector<std::pair<std::string, std::string>> &result) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_columns.empty()) {
+            m_columns.assign(kParams, kParams + kParamCount);
+            for (const auto &kv : result) {
+                if (std::find(kParams, kParams + kParamCount, kv.first) == kParams + kParamCount) {
+                    m_columns.push_back(kv.first);
+                }
+            }
+            std::string header;
+            for (const std::string &c : m_columns) {
+                header += (header.empty() ? "" : ",") + c;
+            }
+            std::fprintf(m_file, "%s\n", header.c_str());
+        }
+        std::string row;
+        for (size_t c = 0; c < m_columns.size(); c++) {
+            std::string value;
+            if (c < kParamCount) {
+                value = job.params[c];
+            } else {
+                for (const auto &kv : result) {
+                    if (kv.first == m_columns[c]) {
+                        value = kv.second;
+                        break;
+                    }
+                }
+            }
+            row += (c ? "," : "") + value;
+        }
+        std::fprintf(m_file, "%s\n", row.c_str());
+        std::fflush(m_file);
+    }
+
+private:
+    std::FILE *m_file = nullptr;
+    std::vector<std::string> m_columns;
+    std::set<std::string> m_done;
+    std::mutex m_mutex;
+};
+
+/** Pin the calling thread (and the processes it forks) to one CPU */
+static void PinToCpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/**
+ * Run one job to completion and collect its stdout. False on exec errors,
+ * non-zero exit, signals and timeouts.
+ */
+static bool RunJob(const Options &o, const Job &job, std::string &output) {
+    std::vector<std::string> args = {o.binary,
+                                     "--tap=false",
+                                     "--anim=false",
+                                     "--pcap=false",
+                                     "--eventLog=",
+                                     "--metricsInterval=0",
+                                     "--mobility=" + job.params[0],
+                                     "--speed=" + job.params[1],
+                                     "--pause=" + job.params[2],
+                                     "--nodes=" + job.params[3],
+                                     "--time=" + job.params[4],
+                                     "--RngRun=" + job.params[5]};
+    for (const std::string &a : Split(o.extra, ' ')) {
+        args.push_back(a);
+    }
+    std::vector<char *> argv;
+    for (std::string &a : args) {
+        argv.push_back(&a[0]);
+    }
+    argv.push_back(nullptr);
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDERR_FILENO);
+        }
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    close(fds[1]);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(o.timeout);
+    bool timedOut = false;
+    char buf[4096];
+    while (true) {
+        int wait = -1;
+        if (o.timeout > 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) {
+                kill(pid, SIGKILL);
+                timedOut = true;
+                break;
+            }
+            wait = static_cast<int>(left.count());
+        }
+        pollfd pfd = {fds[0], POLLIN, 0};
+        int ready = poll(&pfd, 1, wait);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        ssize_t n = read(fds[0], buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        output.append(buf, n);
+    }
+    close(fds[0]);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return !timedOut && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/** key=value pairs of the RESULT line, in order */
+static bool ParseResult(const std::string &output, std::vector<std::pair<std::string, std::string>> &result) {
+    std::string::size_type at = output.rfind("\nRESULT ");
+    if (at == std::string::npos) {
+        return false;
+    }
+    std::string line = output.substr(at + 8, output.find('\n', at + 1) - at - 8);
+    for (const std::string &field : Split(line, ' ')) {
+        std::string::size_type eq = field.find('=');
+        if (eq != std::string::npos) {
+            result.emplace_back(field.substr(0, eq), field.substr(eq + 1));
+        }
+    }
+    return !result.empty();
+}
+
+int main(int argc, char *argv[]) {
+    Options o;
+    if (!ParseArgs(argc, argv, o)) {
+        Usage(argv[0]);
+        return 2;
+    }
+    if (access(o.binary.c_str(), X_OK) != 0) {
+        std::cerr << o.binary << ": not executable (./ns3 build scratch/manet-aodv-static first)\n";
+        return 1;
+    }
+
+    ResultsFile results;
+    if (!results.Open(o.out)) {
+        return 1;
+    }
+
+    // Grid x runs, minus what the results file already has
+    std::vector<Job> jobs;
+    size_t total = 0;
+    for (const std::string &mobility : o.mobility) {
+        for (const std::string &speed : o.speed) {
+            for (const std::string &pause : o.pause) {
+                for (const std::string &nodes : o.nodes) {
+                    for (uint32_t run = o.runFirst; run <= o.runLast; run++) {
+                        Job job{{mobility, speed, pause, nodes, o.time, std::to_string(run)}};
+                        total++;
+                        if (!results.IsDone(job)) {
+                            jobs.push_back(job);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // One worker per CPU this process may use
+    cpu_set_t allowed;
+    std::vector<int> cpus;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        cpus.push_back(0);
+    }
+    uint32_t workers = o.jobs ? o.jobs : static_cast<uint32_t>(cpus.size());
+    workers = std::max<uint32_t>(1, std::min<uint32_t>(workers, static_cast<uint32_t>(jobs.size())));
+
+    std::cout << "Sweep: " << total << " jobs, " << total - jobs.size() << " already in " << o.out << ", running "
+              << jobs.size() << " on " << workers << " workers\n";
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+    std::mutex failedMutex;
+    std::vector<std::string> failed;
+    std::mutex printMutex;
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&](uint32_t index) {
+        PinToCpu(cpus[index % cpus.size()]);
+        size_t i;
+        while ((i = next.fetch_add(1)) < jobs.size()) {
+            const Job &job = jobs[i];
+            auto jobStart = std::chrono::steady_clock::now();
+            std::string output;
+            std::vector<std::pair<std::string, std::string>> result;
+            bool ok = RunJob(o, job, output) && ParseResult(output, result);
+            if (ok) {
+                results.Append(job, result);
+            } else {
+                std::lock_guard<std::mutex> lock(failedMutex);
+                failed.push_back(JobKey(job.params));
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - jobStart).count();
+            size_t done = ++finished;
+            std::lock_guard<std::mutex> lock(printMutex);
+            std::cout << "[" << done << "/" << jobs.size() << "] ";
+            for (size_t p = 0; p < kParamCount; p++) {
+                std::cout << kParams[p] << "=" << job.params[p] << " ";
+            }
+            std::cout << (ok ? "ok " : "FAILED ") << seconds << " s\n" << std::flush;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (uint32_t w = 0; w < workers; w++) {
+        pool.emplace_back(worker, w);
+    }
+    for (std::thread &t : pool) {
+        t.join();
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Done: " << jobs.size() - failed.size() << " jobs in " << wall << " s, results in " << o.out
+              << "\n";
+    if (!failed.empty()) {
+        std::cout << failed.size() << " failed (rerun to retry):\n";
+        for (const std::string &key : failed) {
+            std::cout << "  " << key << "\n";
+        }
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,287 @@
+/*
+ * Metrics exporter thread.
+ *
+ * Periodic statistics used to be printed by an event on the simulator
+ * thread, which in RealtimeSimulatorImpl shows up as jitter on TAP traffic.
+ * The exporter runs on its own thread and never touches the event loop: it
+ * only reads counters that are safe to read concurrently (relaxed atomics,
+ * seqlock rows from node-counters.h) and
+ *   - prints a text report to stdout every Interval seconds, and
+ *   - serves a snapshot on a local Unix socket (text, JSON or Prometheus
+ *     exposition format), one snapshot per connection:
+ *         socat - UNIX-CONNECT:/tmp/t4-metrics.sock
+ *
+ * Collectors and the text report are called on the exporter thread.
+ */
+
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include "node-counters.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+class MetricsExporter {
+public:
+    enum Format { TEXT, JSON, PROMETHEUS };
+
+    struct Sample {
+        std::string name;
+        std::vector<std::pair<std::string, std::string>> labels;
+        double value;
+    };
+
+    using Collector = std::function<void(std::vector<Sample> &)>;
+    using TextReport = std::function<void(std::ostream &, double elapsed)>;
+
+    ~MetricsExporter() { Stop(); }
+
+    static Format ParseFormat(const std::string &name) {
+        if (name == "json") {
+            return JSON;
+        }
+        if (name == "text") {
+            return TEXT;
+        }
+        return PROMETHEUS;
+    }
+
+    /** Register a source of samples for the socket */
+    void AddCollector(Collector collector) { m_collectors.push_back(std::move(collector)); }
+
+    /** Export every counter of every node as t4_<counter>{node="<id>"} */
+    void AddNodeCounterTable(const NodeCounterTable *table) {
+        AddCollector([table](std::vector<Sample> &out) {
+            std::vector<NodeCounterSnapshot> rows(table->GetN());
+            for (uint32_t i = 0; i < table->GetN(); i++) {
+                rows[i] = (*table)[i].Snapshot();
+            }
+            // Grouped by metric name, as the exposition format expects
+            for (uint32_t c = 0; c < NODE_COUNTER_COUNT; c++) {
+                for (uint32_t i = 0; i < rows.size(); i++) {
+                    out.push_back({std::string("t4_") + kNodeCounterNames[c],
+                                   {{"node", std::to_string(i)}}, static_cast<double>(rows[i].value[c])});
+                }
+            }
+        });
+    }
+
+    /** Console report printed every interval (replaces the in-simulator PrintStats) */
+    void SetTextReport(TextReport report) { m_report = std::move(report); }
+
+    /**
+     * Start the exporter thread. interval <= 0 disables the periodic report,
+     * an empty socketPath disables the socket.
+     */
+    void Start(double interval, const std::string &socketPath, Format format) {
+        m_interval = interval;
+        m_socketPath = socketPath;
+        m_format = format;
+        m_start = std::chrono::steady_clock::now();
+        m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (!m_socketPath.empty()) {
+            OpenSocket();
+        }
+        if (m_interval <= 0 && m_listenFd < 0) {
+            return;
+        }
+        m_thread = std::thread(&MetricsExporter::Run, this);
+    }
+
+    void Stop() {
+        if (m_thread.joinable()) {
+            uint64_t one = 1;
+            ssize_t ignored = write(m_wakeFd, &one, sizeof(one));
+            (void)ignored;
+            m_thread.join();
+        }
+        if (m_listenFd >= 0) {
+            close(m_listenFd);
+            unlink(m_socketPath.c_str());
+            m_listenFd = -1;
+        }
+        if (m_wakeFd >= 0) {
+            close(m_wakeFd);
+            m_wakeFd = -1;
+        }
+    }
+
+    double Elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    /** Render all collectors in the given format */
+    std::string Render(Format format) const {
+        std::vector<Sample> samples;
+        for (const Collector &collector : m_collectors) {
+            collector(samples);
+        }
+        std::ostringstream os;
+        switch (format) {
+        case JSON:
+            RenderJson(os, samples);
+            break;
+        case TEXT:
+            for (const Sample &s : samples) {
+                os << s.name << LabelString(s) << " " << FormatValue(s.value) << "\n";
+            }
+            break;
+        case PROMETHEUS:
+            RenderPrometheus(os, samples);
+            break;
+        }
+        return os.str();
+    }
+
+private:
+    /** Integers print exactly, everything else with full precision */
+    static std::string FormatValue(double v) {
+        if (std::fabs(v) < 9e15 && v == static_cast<double>(static_cast<int64_t>(v))) {
+            return std::to_string(static_cast<int64_t>(v));
+        }
+        std::ostringstream os;
+        os.precision(12);
+        os << v;
+        return os.str();
+    }
+
+    static std::string LabelString(const Sample &s) {
+        if (s.labels.empty()) {
+            return "";
+        }
+        std::string out = "{";
+        for (size_t i = 0; i < s.labels.size(); i++) {
+            out += (i ? "," : "") + s.labels[i].first + "=\"" + s.labels[i].second + "\"";
+        }
+        return out + "}";
+    }
+
+    void RenderPrometheus(std::ostream &os, const std::vector<Sample> &samples) const {
+        std::string last;
+        for (const Sample &s : samples) {
+            if (s.name != last) {
+                os << "# TYPE " << s.name << " untyped\n";
+                last = s.name;
+            }
+            os << s.name << LabelString(s) << " " << FormatValue(s.value) << "\n";
+        }
+        os << "t4_exporter_uptime_seconds " << Elapsed() << "\n";
+    }
+
+    void RenderJson(std::ostream &os, const std::vector<Sample> &samples) const {
+        os << "{\"elapsed\":" << Elapsed() << ",\"metrics\":[";
+        for (size_t i = 0; i < samples.size(); i++) {
+            const Sample &s = samples[i];
+            os << (i ? "," : "") << "{\"name\":\"" << s.name << "\",\"labels\":{";
+            for (size_t l = 0; l < s.labels.size(); l++) {
+                os << (l ? "," : "") << "\"" << s.labels[l].first << "\":\"" << s.labels[l].second << "\"";
+            }
+            os << "},\"value\":" << FormatValue(s.value) << "}";
+        }
+        os << "]}\n";
+    }
+
+    void OpenSocket() {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (m_socketPath.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Metrics socket path too long: " << m_socketPath << "\n";
+            return;
+        }
+        std::strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(m_socketPath.c_str());
+
+        m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+            listen(m_listenFd, 8) < 0) {
+            std::cerr << "Metrics socket " << m_socketPath << ": " << std::strerror(errno) << "\n";
+            if (m_listenFd >= 0) {
+                close(m_listenFd);
+            }
+            m_listenFd = -1;
+            return;
+        }
+        std::cout << "Metrics: " << m_socketPath << "\n";
+    }
+
+    void Serve() {
+        int client;
+        while ((client = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+            std::string body = Render(m_format);
+            const char *p = body.data();
+            size_t left = body.size();
+            while (left > 0) {
+                ssize_t n = send(client, p, left, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    break;
+                }
+                p += n;
+                left -= n;
+            }
+            close(client);
+        }
+    }
+
+    void Run() {
+        using Clock = std::chrono::steady_clock;
+        auto next = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_interval));
+        pollfd fds[2] = {{m_wakeFd, POLLIN, 0}, {m_listenFd, POLLIN, 0}};
+        nfds_t nfds = m_listenFd >= 0 ? 2 : 1;
+
+        while (true) {
+            int timeout = -1;
+            if (m_interval > 0) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count();
+                timeout = left > 0 ? static_cast<int>(left) : 0;
+            }
+            int ready = poll(fds, nfds, timeout);
+            if (ready < 0 && errno != EINTR) {
+                return;
+            }
+            if (fds[0].revents & POLLIN) {
+                return;
+            }
+            if (nfds == 2 && (fds[1].revents & POLLIN)) {
+                Serve();
+            }
+            if (m_interval > 0 && Clock::now() >= next) {
+                if (m_report) {
+                    std::ostringstream os;
+                    m_report(os, Elapsed());
+                    std::cout << os.str() << std::flush;
+                }
+                next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_interval));
+            }
+        }
+    }
+
+    std::vector<Collector> m_collectors;
+    TextReport m_report;
+    double m_interval = 0.0;
+    std::string m_socketPath;
+    Format m_format = PROMETHEUS;
+    std::chrono::steady_clock::time_point m_start;
+    int m_listenFd = -1;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+};
+
+#endif /* METRICS_EXPORTER_H */
@@ -0,0 +1,276 @@
+/*
+ * TapBridge with multi-queue, batched ingress
+ *
+ * TapBridge reads one frame per read() on a single fd and schedules one
+ * simulator event per frame; a burst from a container overflows the TAP's
+ * queue while the simulator thread works through it. MqTapBridge attaches
+ * to a multi_queue TAP with MqTapReader (mq-tap-reader.h): pinned reader
+ * threads drain every queue into an MPSC queue, and a single event on the
+ * node sends up to BatchSize frames on the bridged device before it
+ * reschedules itself. The readers schedule an event only when the previous
+ * one found the queue empty.
+ *
+ * Modes as TapBridge:
+ *   UseLocal   the bridged device keeps its MAC and sends with Send(); the
+ *              container's MAC is learned and frames for the device are
+ *              rewritten to it (manet-aodv-static.cc)
+ *   UseBridge  frames are sent with SendFrom() with the container's source
+ *              MAC, and everything the device receives goes to the TAP
+ *              (tap-csma-line.cc)
+ */
+
+#ifndef MQ_TAP_BRIDGE_H
+#define MQ_TAP_BRIDGE_H
+
+#include "metrics-exporter.h"
+#include "mq-tap-reader.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <iostream>
+#include <string>
+
+namespace ns3 {
+
+class MqTapBridge : public NetDevice {
+public:
+    enum Mode { USE_LOCAL, USE_BRIDGE };
+
+    static TypeId GetTypeId() {
+        static TypeId tid =
+            TypeId("ns3::MqTapBridge")
+                .SetParent<NetDevice>()
+                .SetGroupName("TapBridge")
+                .AddConstructor<MqTapBridge>()
+                .AddAttribute("DeviceName", "Multi-queue TAP device to attach to", StringValue(""),
+                              MakeStringAccessor(&MqTapBridge::m_deviceName), MakeStringChecker())
+                .AddAttribute("Mode", "UseLocal or UseBridge, as TapBridge", EnumValue(USE_LOCAL),
+                              MakeEnumAccessor(&MqTapBridge::m_mode),
+                              MakeEnumChecker(USE_LOCAL, "UseLocal", USE_BRIDGE, "UseBridge"))
+                .AddAttribute("Queues", "TAP queues, one reader thread each", UintegerValue(4),
+                              MakeUintegerAccessor(&MqTapBridge::m_queues), MakeUintegerChecker<uint32_t>(1, 256))
+                .AddAttribute("QueueSize", "Frames buffered between the readers and the simulator",
+                              UintegerValue(4096), MakeUintegerAccessor(&MqTapBridge::m_queueSize),
+                              MakeUintegerChecker<uint32_t>(64))
+                .AddAttribute("BatchSize", "Most frames sent on the bridged device per event", UintegerValue(64),
+                              MakeUintegerAccessor(&MqTapBridge::m_batchSize), MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("Cpus", "Reader CPUs: auto, none or a list such as 2,3", StringValue("auto"),
+                              MakeStringAccessor(&MqTapBridge::m_cpus), MakeStringChecker());
+        return tid;
+    }
+
+    ~MqTapBridge() override { m_reader.Stop(); }
+
+    /** Take over device: the TAP's frames are sent on it, its frames are written to the TAP */
+    void SetBridgedNetDevice(Ptr<NetDevice> device) {
+        if (m_mode == USE_BRIDGE && !device->SupportsSendFrom()) {
+            NS_FATAL_ERROR("MqTapBridge: UseBridge needs a device that supports SendFrom()");
+        }
+        m_device = device;
+        m_node->RegisterProtocolHandler(MakeCallback(&MqTapBridge::ReceiveFromBridgedDevice, this), 0, device,
+                                        true);
+        // As TapBridge: the node's own stack no longer sees the bridged device
+        device->SetReceiveCallback(MakeCallback(&MqTapBridge::DiscardFromBridgedDevice, this));
+    }
+
+    Ptr<NetDevice> GetBridgedNetDevice() const { return m_device; }
+
+    const MqTapReader &GetReader() const { return m_reader; }
+
+    /** Report line with the ingress rate since the previous report (exporter thread) */
+    void PrintSummary(std::ostream &os) {
+        double rate = m_reader.TakeRate();
+        os << "  TAP ingress node " << m_nodeId << " " << static_cast<uint64_t>(rate) << " pps, ";
+        m_reader.Print(os);
+    }
+
+    /** Final statistics */
+    void Print(std::ostream &os) const {
+        os << "  node " << m_nodeId << " events=" << m_events << " ";
+        m_reader.Print(os);
+    }
+
+    /**
+     * Export t4_tap_ingress_frames{node,queue}, t4_tap_ingress_drops{node,queue},
+     * t4_tap_ingress_pps{node}, t4_tap_queue_depth{node} and t4_tap_queue_depth_max{node}
+     */
+    void AddCollector(MetricsExporter &metrics) const {
+        metrics.AddCollector([this](std::vector<MetricsExporter::Sample> &out) {
+            std::string node = std::to_string(m_nodeId);
+            for (uint32_t q = 0; q < m_reader.GetQueues(); q++) {
+                out.push_back({"t4_tap_ingress_frames", {{"node", node}, {"queue", std::to_string(q)}},
+                               static_cast<double>(m_reader.GetFrames(q))});
+            }
+            for (uint32_t q = 0; q < m_reader.GetQueues(); q++) {
+                out.push_back({"t4_tap_ingress_drops", {{"node", node}, {"queue", std::to_string(q)}},
+                               static_cast<double>(m_reader.GetDrops(q))});
+            }
+            out.push_back({"t4_tap_ingress_pps", {{"node", node}}, m_reader.GetRate()});
+            out.push_back({"t4_tap_queue_depth", {{"node", node}}, static_cast<double>(m_reader.GetDepth())});
+            out.push_back(
+                {"t4_tap_queue_depth_max", {{"node", node}}, static_cast<double>(m_reader.GetMaxDepth())});
+        });
+    }
+
+    // NetDevice: the bridge itself carries no traffic of the node
+
+    void SetIfIndex(const uint32_t index) override { m_ifIndex = index; }
+    uint32_t GetIfIndex() const override { return m_ifIndex; }
+    Ptr<Channel> GetChannel() const override { return nullptr; }
+    void SetAddress(Address address) override { m_address = Mac48Address::ConvertFrom(address); }
+    Address GetAddress() const override { return m_address; }
+    bool SetMtu(const uint16_t mtu) override {
+        m_mtu = mtu;
+        return true;
+    }
+    uint16_t GetMtu() const override { return m_mtu; }
+    bool IsLinkUp() const override { return true; }
+    void AddLinkChangeCallback(Callback<void> callback) override {}
+    bool IsBroadcast() const override { return true; }
+    Address GetBroadcast() const override { return Mac48Address::GetBroadcast(); }
+    bool IsMulticast() const override { return true; }
+    Address GetMulticast(Ipv4Address group) const override { return Mac48Address::GetMulticast(group); }
+    Address GetMulticast(Ipv6Address group) const override { return Mac48Address::GetMulticast(group); }
+    bool IsBridge() const override { return true; }
+    bool IsPointToPoint() const override { return false; }
+    bool Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber) override { return false; }
+    bool SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest,
+                  uint16_t protocolNumber) override {
+        return false;
+    }
+    Ptr<Node> GetNode() const override { return m_node; }
+    void SetNode(Ptr<Node> node) override {
+        m_node = node;
+        m_nodeId = node->GetId();
+    }
+    bool NeedsArp() const override { return true; }
+    void SetReceiveCallback(ReceiveCallback cb) override {}
+    void SetPromiscReceiveCallback(PromiscReceiveCallback cb) override {}
+    bool SupportsSendFrom() const override { return false; }
+
+protected:
+    void DoInitialize() override {
+        MqTapOptions options;
+        options.device = m_deviceName;
+        options.queues = m_queues;
+        options.queueSize = m_queueSize;
+        options.cpus = m_cpus;
+        if (!m_reader.Open(options)) {
+            NS_FATAL_ERROR("MqTapBridge: " << m_reader.GetError());
+        }
+        uint32_t context = m_nodeId;
+        m_reader.Start([this, context] {
+            Simulator::ScheduleWithContext(context, Seconds(0), &MqTapBridge::DrainToSim, this);
+        });
+        NetDevice::DoInitialize();
+    }
+
+    void DoDispose() override {
+        m_reader.Stop();
+        m_device = nullptr;
+        m_node = nullptr;
+        NetDevice::DoDispose();
+    }
+
+private:
+    static const uint32_t kEthernetHeader = 14;
+
+    /** Simulator thread: send a batch of TAP frames on the bridged device */
+    void DrainToSim() {
+        m_events++;
+        uint32_t n = m_reader.Drain(
+            [this](const uint8_t *frame, uint32_t length, uint32_t queue) {
+                if (length < kEthernetHeader) {
+                    return;
+                }
+                Mac48Address dst, src;
+                dst.CopyFrom(frame);
+                src.CopyFrom(frame + 6);
+                uint16_t protocol = static_cast<uint16_t>(frame[12] << 8 | frame[13]);
+                if (protocol < 0x600) {
+                    return; // 802.3 length field: not Ethernet II, TapBridge drops these too
+                }
+                Ptr<Packet> packet = Create<Packet>(frame + kEthernetHeader, length - kEthernetHeader);
+                if (m_mode == USE_BRIDGE) {
+                    m_device->SendFrom(packet, src, dst, protocol);
+                    return;
+                }
+                if (!m_learned) {
+                    m_containerMac = src;
+                    m_learned = true;
+                }
+                m_device->Send(packet, dst, protocol);
+            },
+            m_batchSize);
+        // A full batch, or frames claimed while we were draining: keep going
+        if (n == m_batchSize || !m_reader.Disarm()) {
+            Simulator::ScheduleWithContext(m_nodeId, Seconds(0), &MqTapBridge::DrainToSim, this);
+        }
+    }
+
+    bool ReceiveFromBridgedDevice(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                  const Address &src, const Address &dst, PacketType packetType) {
+        if (m_mode == USE_LOCAL && (packetType == PACKET_OTHERHOST || !m_learned)) {
+            return true;
+        }
+        uint32_t size = packet->GetSize();
+        if (size + kEthernetHeader > sizeof(m_frame)) {
+            return true;
+        }
+        Mac48Address to = m_mode == USE_LOCAL && packetType == PACKET_HOST ? m_containerMac
+                                                                             : Mac48Address::ConvertFrom(dst);
+        to.CopyTo(m_frame);
+        Mac48Address::ConvertFrom(src).CopyTo(m_frame + 6);
+        m_frame[12] = static_cast<uint8_t>(protocol >> 8);
+        m_frame[13] = static_cast<uint8_t>(protocol);
+        packet->CopyData(m_frame + kEthernetHeader, size);
+        m_reader.Write(m_frame, size + kEthernetHeader);
+        return true;
+    }
+
+    bool DiscardFromBridgedDevice(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                  const Address &src) {
+        return true;
+    }
+
+    std::string m_deviceName;
+    Mode m_mode = USE_LOCAL;
+    uint32_t m_queues = 4;
+    uint32_t m_queueSize = 4096;
+    uint32_t m_batchSize = 64;
+    std::string m_cpus;
+
+    Ptr<NetDevice> m_device;
+    Ptr<Node> m_node;
+    uint32_t m_nodeId = 0;
+    uint32_t m_ifIndex = 0;
+    Mac48Address m_address;
+    uint16_t m_mtu = 1500;
+
+    MqTapReader m_reader;
+    bool m_learned = false;
+    Mac48Address m_containerMac;
+    uint8_t m_frame[65536];
+    uint64_t m_events = 0;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(MqTapBridge);
+
+/**
+ * Bridge device to the multi-queue TAP deviceName, as
+ * TapBridgeHelper::Install(node, device) does with a single-queue one
+ */
+inline Ptr<MqTapBridge> InstallMqTapBridge(Ptr<Node> node, Ptr<NetDevice> device, const std::string &deviceName,
+                                           const std::string &mode) {
+    Ptr<MqTapBridge> bridge = CreateObject<MqTapBridge>();
+    bridge->SetAttribute("DeviceName", StringValue(deviceName));
+    bridge->SetAttribute("Mode", StringValue(mode));
+    node->AddDevice(bridge);
+    bridge->SetBridgedNetDevice(device);
+    return bridge;
+}
+
+} // namespace ns3
+
+#endif /* MQ_TAP_BRIDGE_H */
@@ -0,0 +1,398 @@
+/*
+ * Multi-queue TAP ingress, independent of ns-3
+ *
+ * A TAP device created with multi_queue (ip tuntap add tap-0 mode tap
+ * multi_queue) can be opened once per queue; the kernel spreads the frames
+ * written to it over the queues by flow hash. MqTapReader opens Queues fds
+ * on the device and drains each one on its own reader thread, pinned to a
+ * CPU. A reader sleeps in poll() and, when woken, reads up to ReadBatch
+ * frames with non-blocking read()s straight into cells of a bounded
+ * multi-producer / single-consumer queue (MpscFrameQueue, after Vyukov):
+ * a producer claims a cell with one CAS and publishes it with one release
+ * store, the consumer takes cells in order without atomic RMW.
+ *
+ * The consumer is woken by a callback, at most once per idle period: a
+ * reader only calls it after publishing frames while the consumer is
+ * disarmed, and the consumer disarms (Disarm()) only when it found the
+ * queue empty.
+ *
+ * Counters are relaxed atomics with a single writer each, so the metrics
+ * thread can read them at any time.
+ */
+
+#ifndef MQ_TAP_READER_H
+#define MQ_TAP_READER_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/if_tun.h>
+#include <net/if.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+/**
+ * Bounded MPSC queue of frames, each copied into a fixed-size cell
+ */
+class MpscFrameQueue {
+public:
+    static const uint32_t kFrameBytes = 1536 - 16;
+
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> seq;
+        uint32_t length;
+        uint32_t queue;
+        uint8_t data[kFrameBytes];
+    };
+
+    /** cells is rounded up to a power of two */
+    explicit MpscFrameQueue(uint32_t cells = 4096) {
+        uint32_t n = 1;
+        while (n < cells) {
+            n <<= 1;
+        }
+        m_mask = n - 1;
+        m_cells.reset(new Cell[n]);
+        for (uint32_t i = 0; i < n; i++) {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /** Producer: claim the next free cell, or nullptr when the queue is full */
+    Cell *Claim() {
+        uint64_t pos = m_enqueue.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell *cell = &m_cells[pos & m_mask];
+            uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return cell;
+                }
+            } else if (seq < pos) {
+                return nullptr;
+            } else {
+                pos = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Producer: hand a claimed cell to the consumer; length 0 is skipped */
+    void Publish(Cell *cell, uint32_t length, uint32_t queue) {
+        cell->length = length;
+        cell->queue = queue;
+        uint64_t pos = cell->seq.load(std::memory_order_relaxed);
+        cell->seq.store(pos + 1, std::memory_order_release);
+    }
+
+    /** Consumer: call fn(data, length, queue) for up to max published frames, in order */
+    template <typename F> uint32_t Drain(F fn, uint32_t max) {
+        uint32_t n = 0;
+        uint64_t pos = m_dequeue.load(std::memory_order_relaxed);
+        uint64_t depth = m_enqueue.load(std::memory_order_relaxed) - pos;
+        if (depth > m_maxDepth.load(std::memory_order_relaxed)) {
+            m_maxDepth.store(depth, std::memory_order_relaxed);
+        }
+        while (n < max) {
+            Cell *cell = &m_cells[pos & m_mask];
+            if (cell->seq.load(std::memory_order_acquire) != pos + 1) {
+                break;
+            }
+            if (cell->length) {
+                fn(cell->data, cell->length, cell->queue);
+                n++;
+            }
+            cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+            pos++;
+            m_dequeue.store(pos, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    /** Frames claimed but not yet consumed */
+    uint64_t GetDepth() const {
+        return m_enqueue.load(std::memory_order_seq_cst) - m_dequeue.load(std::memory_order_relaxed);
+    }
+
+    /** Deepest the queue was seen by the consumer */
+    uint64_t GetMaxDepth() const { return m_maxDepth.load(std::memory_order_relaxed); }
+
+    uint32_t GetCapacity() const { return m_mask + 1; }
+
+private:
+    std::unique_ptr<Cell[]> m_cells;
+    uint32_t m_mask = 0;
+    alignas(64) std::atomic<uint64_t> m_enqueue{0};
+    alignas(64) std::atomic<uint64_t> m_dequeue{0};
+    std::atomic<uint64_t> m_maxDepth{0};
+};
+
+struct MqTapOptions {
+    std::string device;
+    uint32_t queues = 4;
+    uint32_t queueSize = 4096;
+    uint32_t readBatch = 64;
+    /** auto (queue q on CPU (q + 1) % ncpu, leaving CPU 0 to the simulator), none, or a list "2,3" */
+    std::string cpus = "auto";
+};
+
+class MqTapReader {
+public:
+    using Notify = std::function<void()>;
+
+    MqTapReader() = default;
+    MqTapReader(const MqTapReader &) = delete;
+    MqTapReader &operator=(const MqTapReader &) = delete;
+
+    ~MqTapReader() {
+        Stop();
+        for (int fd : m_fds) {
+            close(fd);
+        }
+    }
+
+    /** Attach one fd per queue to the (multi_queue) TAP device */
+    bool Open(const MqTapOptions &options) {
+        m_options = options;
+        m_queue.reset(new MpscFrameQueue(options.queueSize));
+        m_stats.reset(new QueueStats[options.queues]);
+        for (uint32_t q = 0; q < options.queues; q++) {
+            int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+            if (fd < 0) {
+                m_error = std::string("/dev/net/tun: ") + std::strerror(errno);
+                return false;
+            }
+            ifreq ifr = {};
+            ifr.ifr_flags = IFF_TAP | IFF_NO_PI | IFF_MULTI_QUEUE;
+            std::strncpy(ifr.ifr_name, options.device.c_str(), IFNAMSIZ - 1);
+            if (ioctl(fd, TUNSETIFF, &ifr) != 0) {
+                m_error = options.device + ": " + std::strerror(errno) +
+                          (errno == EINVAL ? " (create it with: ip tuntap add " + options.device +
+                                                 " mode tap multi_queue)"
+                                           : "");
+                close(fd);
+                return false;
+            }
+            m_fds.push_back(fd);
+        }
+        return true;
+    }
+
+    /** Start the reader threads; notify is called on them when the consumer should drain */
+    void Start(Notify notify) {
+        m_notify = std::move(notify);
+        m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        std::vector<int> cpus = Cpus();
+        for (uint32_t q = 0; q < m_fds.size(); q++) {
+            m_threads.emplace_back(&MqTapReader::ReadLoop, this, q);
+            if (!cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpus[q % cpus.size()], &set);
+                pthread_setaffinity_np(m_threads.back().native_handle(), sizeof(set), &set);
+            }
+        }
+        m_lastReport = std::chrono::steady_clock::now();
+    }
+
+    void Stop() {
+        if (m_threads.empty()) {
+            return;
+        }
+        m_stop.store(true, std::memory_order_relaxed);
+        uint64_t one = 1;
+        (void)!write(m_wakeFd, &one, sizeof(one));
+        for (std::thread &t : m_threads) {
+            t.join();
+        }
+        m_threads.clear();
+        close(m_wakeFd);
+    }
+
+    /** Consumer: up to max frames, fn(data, length, queue) */
+    template <typename F> uint32_t Drain(F fn, uint32_t max) {
+        uint32_t n = m_queue->Drain(fn, max);
+        Bump(m_delivered, n);
+        return n;
+    }
+
+    /**
+     * Consumer found the queue empty: re-enable the notification. False if
+     * frames were claimed meanwhile and the consumer must drain again itself.
+     */
+    bool Disarm() {
+        m_armed.store(false, std::memory_order_seq_cst);
+        return m_queue->GetDepth() == 0 || m_armed.exchange(true, std::memory_order_seq_cst);
+    }
+
+    /** Consumer: one frame back to the device (on queue 0); false if the TAP queue is full */
+    bool Write(const uint8_t *frame, uint32_t length) {
+        if (write(m_fds[0], frame, length) == static_cast<ssize_t>(length)) {
+            Bump(m_written, 1);
+            return true;
+        }
+        Bump(m_writeDrops, 1);
+        return false;
+    }
+
+    uint32_t GetQueues() const { return static_cast<uint32_t>(m_fds.size()); }
+    uint64_t GetDepth() const { return m_queue->GetDepth(); }
+    uint64_t GetMaxDepth() const { return m_queue->GetMaxDepth(); }
+    uint64_t GetDelivered() const { return m_delivered.load(std::memory_order_relaxed); }
+    uint64_t GetWritten() const { return m_written.load(std::memory_order_relaxed); }
+    uint64_t GetWriteDrops() const { return m_writeDrops.load(std::memory_order_relaxed); }
+    uint64_t GetFrames(uint32_t q) const { return m_stats[q].frames.load(std::memory_order_relaxed); }
+    uint64_t GetBytes(uint32_t q) const { return m_stats[q].bytes.load(std::memory_order_relaxed); }
+    uint64_t GetDrops(uint32_t q) const { return m_stats[q].drops.load(std::memory_order_relaxed); }
+    uint64_t GetWakeups(uint32_t q) const { return m_stats[q].wakeups.load(std::memory_order_relaxed); }
+    const std::string &GetError() const { return m_error; }
+
+    uint64_t GetFrames() const {
+        uint64_t n = 0;
+        for (uint32_t q = 0; q < GetQueues(); q++) {
+            n += GetFrames(q);
+        }
+        return n;
+    }
+
+    uint64_t GetDrops() const {
+        uint64_t n = 0;
+        for (uint32_t q = 0; q < GetQueues(); q++) {
+            n += GetDrops(q);
+        }
+        return n;
+    }
+
+    /**
+     * Ingress frames/s since the previous call (since Start on the first).
+     * Meant for the periodic report, on one thread.
+     */
+    double TakeRate() {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - m_lastReport).count();
+        uint64_t frames = GetFrames();
+        double rate = seconds > 0 ? (frames - m_lastFrames) / seconds : 0.0;
+        m_lastReport = now;
+        m_lastFrames = frames;
+        m_rate.store(rate, std::memory_order_relaxed);
+        return rate;
+    }
+
+    /** Rate computed by the last TakeRate() */
+    double GetRate() const { return m_rate.load(std::memory_order_relaxed); }
+
+    /** One line: frames and drops per queue, queue depth */
+    void Print(std::ostream &os) const {
+        std::ostringstream line;
+        line << m_options.device << ": in=" << GetFrames() << " to-sim=" << GetDelivered()
+             << " depth=" << GetDepth() << "/" << m_queue->GetCapacity() << " (max " << GetMaxDepth()
+             << ") drops=" << GetDrops() << " out=" << GetWritten() << " out-drops=" << GetWriteDrops() << " |";
+        for (uint32_t q = 0; q < GetQueues(); q++) {
+            line << " q" << q << "=" << GetFrames(q);
+        }
+        os << line.str() << "\n";
+    }
+
+private:
+    struct alignas(64) QueueStats {
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> drops{0};
+        std::atomic<uint64_t> wakeups{0};
+    };
+
+    static void Bump(std::atomic<uint64_t> &a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::vector<int> Cpus() const {
+        std::vector<int> cpus;
+        if (m_options.cpus == "none") {
+            return cpus;
+        }
+        if (m_options.cpus == "auto") {
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            n = n > 0 ? n : 1;
+            for (uint32_t q = 0; q < m_fds.size(); q++) {
+                cpus.push_back(static_cast<int>((q + 1) % n));
+            }
+            return cpus;
+        }
+        std::istringstream list(m_options.cpus);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            cpus.push_back(std::atoi(item.c_str()));
+        }
+        return cpus;
+    }
+
+    void ReadLoop(uint32_t q) {
+        std::vector<uint8_t> scratch(65536); // frames dropped because the queue is full
+        QueueStats &stats = m_stats[q];
+        pollfd fds[2] = {{m_fds[q], POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            if (poll(fds, 2, -1) < 0 || fds[1].revents) {
+                continue;
+            }
+            Bump(stats.wakeups, 1);
+            uint32_t published = 0;
+            for (uint32_t i = 0; i < m_options.readBatch; i++) {
+                MpscFrameQueue::Cell *cell = m_queue->Claim();
+                ssize_t n = read(m_fds[q], cell ? cell->data : scratch.data(), cell ? sizeof(cell->data) : scratch.size());
+                if (cell) {
+                    // A claimed cell must be published, even empty
+                    m_queue->Publish(cell, n > 0 ? static_cast<uint32_t>(n) : 0, q);
+                }
+                if (n <= 0) {
+                    break;
+                }
+                if (!cell) {
+                    Bump(stats.drops, 1);
+                    continue;
+                }
+                Bump(stats.frames, 1);
+                Bump(stats.bytes, static_cast<uint64_t>(n));
+                published++;
+            }
+            if (published && !m_armed.exchange(true, std::memory_order_seq_cst)) {
+                m_notify();
+            }
+        }
+    }
+
+    MqTapOptions m_options;
+    std::vector<int> m_fds;
+    int m_wakeFd = -1;
+    std::unique_ptr<MpscFrameQueue> m_queue;
+    std::unique_ptr<QueueStats[]> m_stats;
+    std::vector<std::thread> m_threads;
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_armed{false};
+    Notify m_notify;
+    std::string m_error;
+
+    std::atomic<uint64_t> m_delivered{0};
+    std::atomic<uint64_t> m_written{0};
+    std::atomic<uint64_t> m_writeDrops{0};
+
+    std::chrono::steady_clock::time_point m_lastReport;
+    uint64_t m_lastFrames = 0;
+    std::atomic<double> m_rate{0.0};
+};
+
+#endif /* MQ_TAP_READER_H */
@@ -0,0 +1,435 @@
+/*
+ * Streaming analyzer for NetAnim XML traces (the Demo traces, --animFormat=xml)
+ *
+ * The trace is memory-mapped and scanned once. <pr> (transmission) and
+ * <wpr> (wireless reception) elements are tokenized in place, without
+ * copying or allocating. Memory is constant: transmissions wait for their
+ * receptions in a direct-mapped table indexed by uId, and a newer
+ * transmission simply evicts an older one in the same slot.
+ *
+ * Reports
+ *   - per directed link: unicast frames delivered / addressed to the
+ *     receiver (by MAC DA), broadcast frames received / sent by the sender,
+ *   - per-hop latency (fbRx - fbTx): distribution over all receptions and
+ *     mean/max per link,
+ *   - AODV control vs data bytes (IPv4 length, or the payload fragment size
+ *     when there is no IPv4 header).
+ * A reception is a PHY reception start, as NetAnim records it; frames
+ * that fail to decode afterwards still count as delivered.
+ *
+ * Usage: netanim-analyze [--slots=N] [--maxNodes=N] <trace.xml>
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Non-owning view of a byte range in the mapped file */
+struct Span {
+    const char *p = nullptr;
+    size_t n = 0;
+
+    bool Empty() const { return n == 0; }
+
+    bool Contains(const char *needle) const {
+        return p && memmem(p, n, needle, std::strlen(needle)) != nullptr;
+    }
+
+    /** Position right after needle, or nullptr */
+    const char *After(const char *needle) const {
+        size_t len = std::strlen(needle);
+        const char *hit = p ? static_cast<const char *>(memmem(p, n, needle, len)) : nullptr;
+        return hit ? hit + len : nullptr;
+    }
+};
+
+static uint64_t ParseUint(const char *p, const char *end) {
+    uint64_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+    }
+    return v;
+}
+
+static uint64_t ParseUint(Span s) { return ParseUint(s.p, s.p + s.n); }
+
+/** "12.0035" seconds -> nanoseconds */
+static uint64_t ParseNs(Span s) {
+    const char *p = s.p, *end = s.p + s.n;
+    uint64_t sec = 0, frac = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        sec = sec * 10 + (*p++ - '0');
+    }
+    int digits = 0;
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9' && digits < 9) {
+            frac = frac * 10 + (*p++ - '0');
+            digits++;
+        }
+    }
+    for (; digits < 9; digits++) {
+        frac *= 10;
+    }
+    return sec * 1000000000ull + frac;
+}
+
+/** Parse "aa:bb:cc:dd:ee:ff" at p into 48 bits */
+static bool ParseMac(const char *p, const char *end, uint64_t &mac) {
+    if (end - p < 17) {
+        return false;
+    }
+    mac = 0;
+    for (int i = 0; i < 6; i++) {
+        char hex[3] = {p[i * 3], p[i * 3 + 1], 0};
+        char *stop;
+        mac = (mac << 8) | std::strtoul(hex, &stop, 16);
+        if (stop != hex + 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Attributes of one element. Attr() scans the element for name="..."; the
+ * element bodies are short, so this beats building an index.
+ */
+struct Element {
+    const char *p;
+    const char *end;
+
+    Span Attr(const char *name) const {
+        const size_t len = std::strlen(name);
+        for (const char *q = p; q + len + 2 <= end; q++) {
+            q = static_cast<const char *>(std::memchr(q, name[0], end - q));
+            if (!q || q + len + 2 > end) {
+                break;
+            }
+            if (q[-1] == ' ' && std::memcmp(q, name, len) == 0 && q[len] == '=' && q[len + 1] == '"') {
+                const char *v = q + len + 2;
+                const char *close = static_cast<const char *>(std::memchr(v, '"', end - v));
+                return close ? Span{v, static_cast<size_t>(close - v)} : Span{};
+            }
+        }
+        return Span{};
+    }
+};
+
+/**
+ * Log-linear histogram of nanosecond values: 16 sub-buckets per power of
+ * two, so quantiles are within ~6%
+ */
+class Histogram {
+public:
+    void Add(uint64_t v) {
+        m_counts[Bucket(v)]++;
+        m_total++;
+        m_max = std::max(m_max, v);
+    }
+
+    uint64_t Quantile(double q) const {
+        uint64_t rank = static_cast<uint64_t>(q * (m_total - 1)), seen = 0;
+        for (int b = 0; b < kBuckets; b++) {
+            seen += m_counts[b];
+            if (seen > rank) {
+                return std::min(Upper(b), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    uint64_t GetTotal() const { return m_total; }
+    uint64_t GetMax() const { return m_max; }
+
+private:
+    static const int kSub = 16;
+    static const int kBuckets = 64 * kSub;
+
+    static int Bucket(uint64_t v) {
+        if (v < kSub) {
+            return static_cast<int>(v);
+        }
+        int exp = 63 - __builtin_clzll(v);
+        int sub = static_cast<int>((v >> (exp - 4)) & (kSub - 1));
+        return (exp - 3) * kSub + sub;
+    }
+
+    static uint64_t Upper(int b) {
+        if (b < kSub) {
+            return b;
+        }
+        int exp = b / kSub + 3;
+        uint64_t sub = b % kSub;
+        return ((kSub + sub + 1) << (exp - 4)) - 1;
+    }
+
+    uint64_t m_counts[kBuckets] = {};
+    uint64_t m_total = 0;
+    uint64_t m_max = 0;
+};
+
+struct LinkStats {
+    uint64_t unicastTx = 0;
+    uint64_t unicastRx = 0;
+    uint64_t broadcastRx = 0;
+    uint64_t latencySum = 0;
+    uint64_t latencyMax = 0;
+};
+
+struct NodeStats {
+    uint64_t broadcastTx = 0;
+    uint64_t mac = 0;
+};
+
+/** Transmission waiting for its receptions */
+struct PendingTx {
+    uint64_t uid = 0;
+    uint64_t fbTx = 0;
+    uint32_t from = 0;
+    int32_t to = -1; // unicast destination node, -1 for broadcast/unknown
+};
+
+enum Traffic { AODV, DATA, OTHER, TRAFFIC_COUNT };
+static const char *const kTrafficNames[TRAFFIC_COUNT] = {"AODV control", "Data", "Other"};
+
+class Analyzer {
+public:
+    Analyzer(uint32_t slots, uint32_t maxNodes)
+        : m_slotMask(slots - 1), m_maxNodes(maxNodes), m_pending(new PendingTx[slots]),
+          m_links(new LinkStats[maxNodes * maxNodes]), m_nodes(new NodeStats[maxNodes]) {}
+
+    void Scan(const char *data, size_t size) {
+        const char *p = data, *end = data + size;
+        while ((p = static_cast<const char *>(std::memchr(p, '<', end - p)))) {
+            const char *close = static_cast<const char *>(std::memchr(p, '>', end - p));
+            if (!close) {
+                break;
+            }
+            if (close - p > 4 && std::memcmp(p, "<pr ", 4) == 0) {
+                Tx(Element{p + 3, close});
+            } else if (close - p > 5 && std::memcmp(p, "<wpr ", 5) == 0) {
+                Rx(Element{p + 4, close});
+            }
+            p = close + 1;
+        }
+    }
+
+    void Report(double seconds, size_t bytes) const {
+        std::printf("Trace: %.1f MB in %.3f s (%.0f MB/s)\n", bytes / 1e6, seconds, bytes / 1e6 / seconds);
+        std::printf("Records: %" PRIu64 " tx, %" PRIu64 " rx (%" PRIu64 " rx without a pending tx, %" PRIu64
+                    " tx evicted from the pending table)\n\n",
+                    m_txCount, m_rxCount, m_rxUnmatched, m_evicted);
+
+        std::printf("%-10s %10s %10s %8s %10s %8s %10s %10s\n", "Link", "Ucast tx", "Ucast rx", "Ratio",
+                    "Bcast rx", "Ratio", "Lat mean", "Lat max");
+        for (uint32_t from = 0; from < m_nodeCount; from++) {
+            for (uint32_t to = 0; to < m_nodeCount; to++) {
+                const LinkStats &l = m_links[from * m_maxNodes + to];
+                uint64_t rx = l.unicastRx + l.broadcastRx;
+                if (l.unicastTx == 0 && rx == 0) {
+                    continue;
+                }
+                char link[24];
+                std::snprintf(link, sizeof(link), "%u->%u", from, to);
+                uint64_t bcast = m_nodes[from].broadcastTx;
+                std::printf("%-10s %10" PRIu64 " %10" PRIu64 " %8s %10" PRIu64 " %8s %8.2fus %8.2fus\n", link,
+                            l.unicastTx, l.unicastRx, Ratio(l.unicastRx, l.unicastTx).c_str(), l.broadcastRx,
+                            Ratio(l.broadcastRx, bcast).c_str(), rx ? l.latencySum / 1e3 / rx : 0.0,
+                            l.latencyMax / 1e3);
+            }
+        }
+
+        std::printf("\nPer-hop latency (fbRx - fbTx), %" PRIu64 " receptions:\n", m_latency.GetTotal());
+        if (m_latency.GetTotal() > 0) {
+            std::printf("  p50=%.3fus p90=%.3fus p99=%.3fus p99.9=%.3fus max=%.3fus\n",
+                        m_latency.Quantile(0.5) / 1e3, m_latency.Quantile(0.9) / 1e3,
+                        m_latency.Quantile(0.99) / 1e3, m_latency.Quantile(0.999) / 1e3,
+                        m_latency.GetMax() / 1e3);
+        }
+
+        uint64_t totalBytes = 0;
+        for (int t = 0; t < TRAFFIC_COUNT; t++) {
+            totalBytes += m_trafficBytes[t];
+        }
+        std::printf("\nTransmitted bytes by traffic class:\n");
+        for (int t = 0; t < TRAFFIC_COUNT; t++) {
+            std::printf("  %-13s %8" PRIu64 " frames %12" PRIu64 " bytes %6.2f%%\n", kTrafficNames[t],
+                        m_trafficFrames[t], m_trafficBytes[t],
+                        totalBytes ? 100.0 * m_trafficBytes[t] / totalBytes : 0.0);
+        }
+        if (m_noMeta > 0) {
+            std::printf("  (%" PRIu64 " frames without meta-info, enable packet metadata to classify them)\n",
+                        m_noMeta);
+        }
+    }
+
+private:
+    static std::string Ratio(uint64_t num, uint64_t den) {
+        if (den == 0) {
+            return "-";
+        }
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(num) / den);
+        return buf;
+    }
+
+    void Tx(const Element &e) {
+        const uint64_t uid = ParseUint(e.Attr("uId"));
+        const uint64_t from = ParseUint(e.Attr("fId"));
+        const Span meta = e.Attr("meta-info");
+        m_txCount++;
+        if (from >= m_maxNodes) {
+            return;
+        }
+        m_nodeCount = std::max<uint32_t>(m_nodeCount, from + 1);
+
+        PendingTx &slot = m_pending[uid & m_slotMask];
+        if (slot.uid != 0 && slot.uid != uid) {
+            m_evicted++;
+        }
+        slot.uid = uid;
+        slot.from = static_cast<uint32_t>(from);
+        slot.fbTx = ParseNs(e.Attr("fbTx"));
+        slot.to = -1;
+
+        if (meta.Empty()) {
+            m_noMeta++;
+            m_nodes[from].broadcastTx++;
+            return;
+        }
+        Classify(meta);
+
+        // Learn the sender's MAC and resolve the destination MAC to a node
+        uint64_t sa, da;
+        const char *end = meta.p + meta.n;
+        const char *saText = meta.After("SA=");
+        if (saText && ParseMac(saText, end, sa)) {
+            m_nodes[from].mac = sa;
+        }
+        const char *daText = meta.After("DA=");
+        if (daText && ParseMac(daText, end, da) && !(da >> 40 & 1)) {
+            for (uint32_t n = 0; n < m_nodeCount; n++) {
+                if (m_nodes[n].mac == da) {
+                    slot.to = static_cast<int32_t>(n);
+                    m_links[from * m_maxNodes + n].unicastTx++;
+                    return;
+                }
+            }
+        }
+        m_nodes[from].broadcastTx++;
+    }
+
+    void Rx(const Element &e) {
+        const uint64_t uid = ParseUint(e.Attr("uId"));
+        const uint64_t to = ParseUint(e.Attr("tId"));
+        m_rxCount++;
+        const PendingTx &slot = m_pending[uid & m_slotMask];
+        if (slot.uid != uid || to >= m_maxNodes) {
+            m_rxUnmatched++;
+            return;
+        }
+        m_nodeCount = std::max<uint32_t>(m_nodeCount, to + 1);
+
+        const uint64_t fbRx = ParseNs(e.Attr("fbRx"));
+        const uint64_t latency = fbRx > slot.fbTx ? fbRx - slot.fbTx : 0;
+        LinkStats &l = m_links[slot.from * m_maxNodes + to];
+        if (slot.to < 0) {
+            l.broadcastRx++;
+        } else if (static_cast<uint64_t>(slot.to) == to) {
+            l.unicastRx++;
+        } else {
+            // Overheard unicast: latency only
+        }
+        l.latencySum += latency;
+        l.latencyMax = std::max(l.latencyMax, latency);
+        m_latency.Add(latency);
+    }
+
+    /** Bytes and traffic class of one transmission from its meta-info */
+    void Classify(const Span &meta) {
+        uint64_t bytes = 0;
+        const char *end = meta.p + meta.n;
+        const char *ipv4 = meta.After("ns3::Ipv4Header (");
+        const char *length = ipv4 ? Span{ipv4, static_cast<size_t>(end - ipv4)}.After("length: ") : nullptr;
+        if (length) {
+            bytes = ParseUint(length, end);
+        } else if (const char *frag = meta.After("Payload Fragment [")) {
+            uint64_t start = ParseUint(frag, end);
+            const char *colon = static_cast<const char *>(std::memchr(frag, ':', end - frag));
+            uint64_t stop = colon ? ParseUint(colon + 1, end) : start;
+            bytes = stop > start ? stop - start : 0;
+        }
+        Traffic t = meta.Contains("ns3::aodv::TypeHeader") ? AODV : ipv4 ? DATA : OTHER;
+        m_trafficFrames[t]++;
+        m_trafficBytes[t] += bytes;
+    }
+
+    const uint64_t m_slotMask;
+    const uint32_t m_maxNodes;
+    std::unique_ptr<PendingTx[]> m_pending;
+    std::unique_ptr<LinkStats[]> m_links;
+    std::unique_ptr<NodeStats[]> m_nodes;
+    uint32_t m_nodeCount = 0;
+    Histogram m_latency;
+    uint64_t m_txCount = 0, m_rxCount = 0, m_rxUnmatched = 0, m_evicted = 0, m_noMeta = 0;
+    uint64_t m_trafficFrames[TRAFFIC_COUNT] = {};
+    uint64_t m_trafficBytes[TRAFFIC_COUNT] = {};
+};
+
+int main(int argc, char *argv[]) {
+    uint32_t slots = 1 << 16;
+    uint32_t maxNodes = 256;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--slots=", 8) == 0) {
+            slots = static_cast<uint32_t>(std::strtoul(argv[i] + 8, nullptr, 10));
+        } else if (std::strncmp(argv[i], "--maxNodes=", 11) == 0) {
+            maxNodes = static_cast<uint32_t>(std::strtoul(argv[i] + 11, nullptr, 10));
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path || slots == 0 || (slots & (slots - 1)) != 0 || maxNodes == 0 || maxNodes > 4096) {
+        std::fprintf(stderr, "Usage: %s [--slots=<power of two>] [--maxNodes=N<=4096] <trace.xml>\n", argv[0]);
+        return 2;
+    }
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        std::perror(path);
+        return 1;
+    }
+    if (st.st_size == 0) {
+        std::fprintf(stderr, "%s: empty trace\n", path);
+        return 1;
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        std::perror("mmap");
+        return 1;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    Analyzer analyzer(slots, maxNodes);
+    auto start = std::chrono::steady_clock::now();
+    analyzer.Scan(static_cast<const char *>(map), st.st_size);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    analyzer.Report(seconds, st.st_size);
+
+    munmap(map, st.st_size);
+    close(fd);
+    return 0;
+}
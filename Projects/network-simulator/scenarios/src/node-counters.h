@@ -0,0 +1,146 @@
+/*
+ * Per-node traffic counters shared by the scenarios in this folder.
+ *
+ * All counters live in one contiguous table with one cache-line-aligned row
+ * per node, indexed by node id. Trace callbacks are bound to their node id
+ * (MakeBoundCallback), so a callback only ever touches its own row.
+ *
+ * Rows are written by the simulator thread only and may be read from other
+ * threads (metrics-exporter.h). Each row is a seqlock: the writer bumps the
+ * sequence to odd, updates the counters with relaxed stores and bumps it
+ * back to even; Snapshot() retries until it read a stable row. On the
+ * writer side this is a handful of plain stores, no locked instructions.
+ */
+
+#ifndef NODE_COUNTERS_H
+#define NODE_COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+enum NodeCounter : uint32_t {
+    MAC_TX_PKTS,
+    MAC_TX_BYTES,
+    MAC_RX_PKTS,
+    MAC_RX_BYTES,
+    IP_TX_PKTS,
+    IP_TX_BYTES,
+    IP_RX_PKTS,
+    IP_RX_BYTES,
+    IP_DROP_PKTS,
+    PHY_TX_BEGIN,
+    PHY_TX_END,
+    PHY_TX_DROP,
+    PHY_RX_BEGIN,
+    PHY_RX_END,
+    PHY_RX_DROP,
+    NODE_COUNTER_COUNT
+};
+
+// Short names, used as column/metric names when exporting
+static const char *const kNodeCounterNames[NODE_COUNTER_COUNT] = {
+    "mac_tx_pkts", "mac_tx_bytes", "mac_rx_pkts", "mac_rx_bytes",
+    "ip_tx_pkts",  "ip_tx_bytes",  "ip_rx_pkts",  "ip_rx_bytes", "ip_drop_pkts",
+    "phy_tx_begin", "phy_tx_end", "phy_tx_drop",
+    "phy_rx_begin", "phy_rx_end", "phy_rx_drop",
+};
+
+/**
+ * Consistent copy of one row
+ */
+struct NodeCounterSnapshot {
+    uint64_t value[NODE_COUNTER_COUNT] = {};
+
+    uint64_t Get(NodeCounter c) const { return value[c]; }
+};
+
+/**
+ * One row of the table. Aligned to a cache line so neighbouring nodes never
+ * share a line.
+ */
+struct alignas(64) NodeCounters {
+    NodeCounters() {
+        for (auto &v : value) {
+            v.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /** Add to one counter (simulator thread only) */
+    void Add(NodeCounter c, uint64_t n = 1) {
+        BeginWrite();
+        Bump(c, n);
+        EndWrite();
+    }
+
+    /** Count one packet of size bytes, atomically for readers */
+    void AddPacket(NodeCounter pkts, NodeCounter bytes, uint64_t size) {
+        BeginWrite();
+        Bump(pkts, 1);
+        Bump(bytes, size);
+        EndWrite();
+    }
+
+    /** Single counter, relaxed (exact on the simulator thread) */
+    uint64_t Get(NodeCounter c) const { return value[c].load(std::memory_order_relaxed); }
+
+    /** Consistent copy of the whole row, safe from any thread */
+    NodeCounterSnapshot Snapshot() const {
+        NodeCounterSnapshot snap;
+        uint32_t before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            for (uint32_t c = 0; c < NODE_COUNTER_COUNT; c++) {
+                snap.value[c] = value[c].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return snap;
+    }
+
+private:
+    void BeginWrite() {
+        seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void EndWrite() { seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    void Bump(NodeCounter c, uint64_t n) {
+        value[c].store(value[c].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint64_t> value[NODE_COUNTER_COUNT];
+};
+
+/**
+ * Flat table of NodeCounters indexed by node id. Size it once before the
+ * simulation starts; rows never move afterwards.
+ */
+class NodeCounterTable {
+public:
+    void Resize(uint32_t nodes) {
+        m_rows.reset(new NodeCounters[nodes]);
+        m_n = nodes;
+    }
+    uint32_t GetN() const { return m_n; }
+
+    NodeCounters &operator[](uint32_t nodeId) { return m_rows[nodeId]; }
+    const NodeCounters &operator[](uint32_t nodeId) const { return m_rows[nodeId]; }
+
+    uint64_t Total(NodeCounter c) const {
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < m_n; i++) {
+            sum += m_rows[i].Get(c);
+        }
+        return sum;
+    }
+
+private:
+    std::unique_ptr<NodeCounters[]> m_rows;
+    uint32_t m_n = 0;
+};
+
+#endif /* NODE_COUNTERS_H */
@@ -0,0 +1,163 @@
+/*
+ * ns-3 side of the merged pcapng capture (pcapng-writer.h).
+ *
+ * Replaces the per-device PcapHelper files (EnablePcapAll, EnablePcap):
+ * every attached device becomes one interface of a single capture, fed
+ * from the same trace sources the helpers use
+ *   - WifiNetDevice: Phy/MonitorSnifferRx and MonitorSnifferTx, 802.11 frames,
+ *   - CsmaNetDevice and other Ethernet devices (ShapedLinkNetDevice):
+ *     PromiscSniffer, Ethernet frames.
+ * The trace callbacks only copy the frame into the writer's ring, and
+ * only frames a TraceFilter (trace-filter.h) keeps when one is set.
+ */
+
+#ifndef PCAPNG_CAPTURE_H
+#define PCAPNG_CAPTURE_H
+
+#include "pcapng-writer.h"
+#include "trace-filter.h"
+
+#include "ns3/core-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Command line options shared by the scenarios
+ */
+struct PcapngOptions {
+    uint32_t snaplen = 65535;
+    double fileMb = 32;
+    double rotateSeconds = 0;
+    uint32_t files = 8;
+    uint32_t ringKb = 8192;
+
+    void AddValues(CommandLine &cmd) {
+        cmd.AddValue("pcapSnaplen", "Bytes captured per frame", snaplen);
+        cmd.AddValue("pcapFileMb", "Rotate the capture file after this many MB (0: never)", fileMb);
+        cmd.AddValue("pcapRotate", "Rotate the capture file after this many simulated seconds (0: never)",
+                     rotateSeconds);
+        cmd.AddValue("pcapFiles", "Capture files kept, oldest are deleted (0: keep all)", files);
+        cmd.AddValue("pcapRingKb", "In-memory capture ring in kB (power of two)", ringKb);
+    }
+
+    PcapngWriter::Config ToConfig(const std::string &prefix) const {
+        PcapngWriter::Config config;
+        config.prefix = prefix;
+        config.snaplen = snaplen;
+        config.maxFileBytes = static_cast<uint64_t>(fileMb * (1 << 20));
+        config.rotateSeconds = rotateSeconds;
+        config.maxFiles = files;
+        config.ringBytes = ringKb * 1024;
+        return config;
+    }
+};
+
+class PcapngCapture {
+public:
+    bool Start(const std::string &prefix, const PcapngOptions &options) {
+        m_prefix = prefix;
+        return m_writer.Start(options.ToConfig(prefix));
+    }
+
+    void Stop() { m_writer.Stop(); }
+
+    /** Only capture the frames filter keeps; filter must outlive the capture */
+    void SetFilter(const TraceFilter *filter) { m_filter = filter; }
+
+    /**
+     * Attach every WiFi, CSMA and other PromiscSniffer device of the
+     * container, named node<id>-<type><index>
+     */
+    void Attach(const NetDeviceContainer &devices) {
+        for (uint32_t i = 0; i < devices.GetN(); i++) {
+            Ptr<NetDevice> dev = devices.Get(i);
+            std::string name = "node" + std::to_string(dev->GetNode()->GetId());
+            if (Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice>(dev)) {
+                AttachWifi(wifi, name + "-wifi" + std::to_string(dev->GetIfIndex()));
+            } else if (Ptr<CsmaNetDevice> csma = DynamicCast<CsmaNetDevice>(dev)) {
+                AttachCsma(csma, name + "-csma" + std::to_string(dev->GetIfIndex()));
+            } else if (HasSniffer(dev)) {
+                AttachEthernet(dev, name + "-eth" + std::to_string(dev->GetIfIndex()));
+            }
+        }
+    }
+
+    void AttachWifi(Ptr<WifiNetDevice> dev, const std::string &name) {
+        uint32_t id = AddInterface(name, PCAPNG_LINKTYPE_IEEE802_11, dev, TRACE_WIFI);
+        Ptr<WifiPhy> phy = dev->GetPhy();
+        phy->TraceConnectWithoutContext("MonitorSnifferRx", MakeBoundCallback(&SniffWifiRx, this, id));
+        phy->TraceConnectWithoutContext("MonitorSnifferTx", MakeBoundCallback(&SniffWifiTx, this, id));
+    }
+
+    void AttachCsma(Ptr<CsmaNetDevice> dev, const std::string &name) { AttachEthernet(dev, name); }
+
+    /** Any device with an Ethernet PromiscSniffer trace source */
+    void AttachEthernet(Ptr<NetDevice> dev, const std::string &name) {
+        uint32_t id = AddInterface(name, PCAPNG_LINKTYPE_ETHERNET, dev, TRACE_ETHERNET);
+        dev->TraceConnectWithoutContext("PromiscSniffer", MakeBoundCallback(&Sniff, this, id));
+    }
+
+    void Print(std::ostream &os) const {
+        os << "PCAPNG: " << m_writer.GetPackets() << " frames, " << m_writer.GetBytesWritten() << " bytes in "
+           << m_writer.GetFilesOpened() << " file(s) " << m_prefix << "-*.pcapng";
+        if (m_writer.GetDropped() > 0) {
+            os << ", " << m_writer.GetDropped() << " dropped (ring full)";
+        }
+        os << "\n";
+    }
+
+private:
+    static bool HasSniffer(Ptr<NetDevice> dev) {
+        TypeId::TraceSourceInformation info;
+        return dev->GetInstanceTypeId().LookupTraceSourceByName("PromiscSniffer", &info) != nullptr;
+    }
+
+    struct Interface {
+        uint32_t node;
+        TraceLayer layer;
+    };
+
+    uint32_t AddInterface(const std::string &name, uint16_t linkType, Ptr<NetDevice> dev, TraceLayer layer) {
+        uint32_t id = m_writer.AddInterface(name, linkType);
+        if (m_interfaces.size() <= id) {
+            m_interfaces.resize(id + 1);
+        }
+        m_interfaces[id] = {dev->GetNode()->GetId(), layer};
+        return id;
+    }
+
+    static void Sniff(PcapngCapture *capture, uint32_t id, Ptr<const Packet> p) {
+        const Interface &i = capture->m_interfaces[id];
+        if (capture->m_filter && !capture->m_filter->Accept(i.node, p, i.layer)) {
+            return;
+        }
+        capture->m_writer.Write(id, Simulator::Now().GetNanoSeconds(), p->GetSize(),
+                                [&p](uint8_t *dst, uint32_t n) { p->CopyData(dst, n); });
+    }
+
+    static void SniffWifiRx(PcapngCapture *capture, uint32_t id, Ptr<const Packet> p, uint16_t channelFreqMhz,
+                            WifiTxVector txVector, MpduInfo aMpdu, SignalNoiseDbm signalNoise, uint16_t staId) {
+        Sniff(capture, id, p);
+    }
+
+    static void SniffWifiTx(PcapngCapture *capture, uint32_t id, Ptr<const Packet> p, uint16_t channelFreqMhz,
+                            WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId) {
+        Sniff(capture, id, p);
+    }
+
+    PcapngWriter m_writer;
+    std::string m_prefix;
+    const TraceFilter *m_filter = nullptr;
+    std::vector<Interface> m_interfaces;
+};
+
+} // namespace ns3
+
+#endif /* PCAPNG_CAPTURE_H */
@@ -0,0 +1,341 @@
+/*
+ * Merged pcapng capture written by a background thread.
+ *
+ * One writer serves all interfaces of a scenario: every traced device gets
+ * an Interface Description Block (link type, name, snaplen, ns timestamps)
+ * and its frames become Enhanced Packet Blocks in the same file.
+ *
+ * The simulator thread only copies (at most snaplen bytes of) each frame
+ * into an in-memory single-producer/single-consumer byte ring. A background
+ * thread drains the ring into the current file and rotates files by size
+ * and/or by capture time, keeping at most MaxFiles of them. Every file
+ * starts with the section header and all interface blocks, so each one
+ * opens on its own in Wireshark. If the ring is full the frame is dropped
+ * and counted; the event loop never waits for the disk.
+ *
+ * Files are named <prefix>-000.pcapng, <prefix>-001.pcapng, ...
+ */
+
+#ifndef PCAPNG_WRITER_H
+#define PCAPNG_WRITER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Link types (http://www.tcpdump.org/linktypes.html)
+static const uint16_t PCAPNG_LINKTYPE_ETHERNET = 1;
+static const uint16_t PCAPNG_LINKTYPE_IEEE802_11 = 105;
+
+class PcapngWriter {
+public:
+    struct Config {
+        std::string prefix = "/tmp/capture";
+        uint32_t snaplen = 65535;
+        uint64_t maxFileBytes = 32ull << 20; // 0: no size rotation
+        double rotateSeconds = 0;            // capture time per file, 0: no time rotation
+        uint32_t maxFiles = 8;               // oldest files are deleted, 0: keep all
+        uint32_t ringBytes = 8u << 20;       // power of two
+    };
+
+    ~PcapngWriter() { Stop(); }
+
+    /** Start the writer thread; interfaces may be added before or after */
+    bool Start(const Config &config) {
+        m_config = config;
+        if (m_config.ringBytes < 4096 || (m_config.ringBytes & (m_config.ringBytes - 1)) != 0) {
+            std::cerr << "pcapng: ring size must be a power of two >= 4096\n";
+            return false;
+        }
+        m_ring.reset(new uint8_t[m_config.ringBytes]);
+        if (!OpenNextFile(0)) {
+            return false;
+        }
+        m_running.store(true, std::memory_order_release);
+        m_thread = std::thread(&PcapngWriter::Run, this);
+        return true;
+    }
+
+    /** Drain the ring, close the file and stop the thread */
+    void Stop() {
+        if (!m_running.exchange(false)) {
+            return;
+        }
+        m_thread.join();
+        Drain();
+        CloseFile();
+    }
+
+    /**
+     * Register an interface (simulator thread, before or after Start). The
+     * returned id is the pcapng interface id to pass to Write().
+     */
+    uint32_t AddInterface(const std::string &name, uint16_t linkType) {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_pendingInterfaces.push_back(InterfaceBlock(name, linkType));
+        return m_nextInterface++;
+    }
+
+    /**
+     * Capture one frame (simulator thread). copy(dst, n) writes the first n
+     * bytes of the frame to dst; n is already clamped to the snaplen.
+     */
+    template <typename CopyFn>
+    void Write(uint32_t interface, uint64_t timeNs, uint32_t length, CopyFn copy) {
+        if (!m_ring) {
+            return;
+        }
+        uint32_t captured = std::min(length, m_config.snaplen);
+        uint32_t padded = (captured + 3) & ~3u;
+        uint32_t blockLen = 32 + padded;
+        uint8_t *p = Reserve(timeNs, blockLen);
+        if (!p) {
+            return;
+        }
+        uint32_t header[7] = {6, blockLen, interface, static_cast<uint32_t>(timeNs >> 32),
+                              static_cast<uint32_t>(timeNs), captured, length};
+        std::memcpy(p, header, sizeof(header));
+        copy(p + 28, captured);
+        std::memset(p + 28 + captured, 0, padded - captured);
+        std::memcpy(p + 28 + padded, &blockLen, 4);
+        Commit(blockLen);
+    }
+
+    uint64_t GetPackets() const { return m_packets.load(std::memory_order_relaxed); }
+    uint64_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t GetBytesWritten() const { return m_bytesWritten.load(std::memory_order_relaxed); }
+    uint32_t GetFilesOpened() const { return m_fileIndex; }
+
+private:
+    enum RecordKind : uint32_t { RECORD_PAD, RECORD_PACKET };
+
+    // Ring record header; the payload is a complete Enhanced Packet Block
+    struct Record {
+        uint32_t length; // header + payload, rounded up to 16
+        uint32_t kind;
+        uint64_t timeNs;
+    };
+
+    static uint32_t Align16(uint32_t n) { return (n + 15) & ~15u; }
+
+    static void PutOption(std::string &out, uint16_t code, const void *data, uint16_t len) {
+        out.append(reinterpret_cast<const char *>(&code), 2);
+        out.append(reinterpret_cast<const char *>(&len), 2);
+        if (len > 0) {
+            out.append(static_cast<const char *>(data), len);
+        }
+        out.append((4 - len % 4) % 4, '\0');
+    }
+
+    static void Finish(std::string &block) {
+        block.append(4, '\0');
+        uint32_t len = static_cast<uint32_t>(block.size());
+        std::memcpy(&block[4], &len, 4);
+        std::memcpy(&block[len - 4], &len, 4);
+    }
+
+    std::string InterfaceBlock(const std::string &name, uint16_t linkType) const {
+        std::string b(8, '\0');
+        uint32_t type = 1;
+        std::memcpy(&b[0], &type, 4);
+        uint16_t reserved = 0;
+        b.append(reinterpret_cast<const char *>(&linkType), 2);
+        b.append(reinterpret_cast<const char *>(&reserved), 2);
+        b.append(reinterpret_cast<const char *>(&m_config.snaplen), 4);
+        PutOption(b, 2, name.data(), static_cast<uint16_t>(name.size())); // if_name
+        uint8_t tsresol = 9;                                             // nanoseconds
+        PutOption(b, 9, &tsresol, 1);
+        PutOption(b, 0, nullptr, 0);
+        Finish(b);
+        return b;
+    }
+
+    static std::string SectionHeader() {
+        std::string b(8, '\0');
+        uint32_t type = 0x0A0D0D0A, magic = 0x1A2B3C4D;
+        uint16_t major = 1, minor = 0;
+        int64_t sectionLength = -1;
+        std::memcpy(&b[0], &type, 4);
+        b.append(reinterpret_cast<const char *>(&magic), 4);
+        b.append(reinterpret_cast<const char *>(&major), 2);
+        b.append(reinterpret_cast<const char *>(&minor), 2);
+        b.append(reinterpret_cast<const char *>(&sectionLength), 8);
+        const char app[] = "ns-3 scenarios";
+        PutOption(b, 4, app, sizeof(app) - 1); // shb_userappl
+        PutOption(b, 0, nullptr, 0);
+        Finish(b);
+        return b;
+    }
+
+    // Producer side
+
+    /** Space for a payload of len bytes, or nullptr if the ring is full */
+    uint8_t *Reserve(uint64_t timeNs, uint32_t len) {
+        const uint64_t size = m_config.ringBytes;
+        const uint32_t need = Align16(sizeof(Record) + len);
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        uint64_t contiguous = size - (head & (size - 1));
+        uint64_t total = need <= contiguous ? need : contiguous + need;
+        if (need > size / 2 || size - (head - m_tailCache) < total) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (need > size / 2 || size - (head - m_tailCache) < total) {
+                m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        if (need > contiguous) {
+            // Pad to the end of the buffer, the record starts at offset 0
+            Record pad{static_cast<uint32_t>(contiguous), RECORD_PAD, 0};
+            std::memcpy(&m_ring[head & (size - 1)], &pad, sizeof(pad));
+            head += contiguous;
+            m_head.store(head, std::memory_order_release);
+        }
+        Record r{need, RECORD_PACKET, timeNs};
+        std::memcpy(&m_ring[head & (size - 1)], &r, sizeof(r));
+        return &m_ring[(head & (size - 1)) + sizeof(Record)];
+    }
+
+    void Commit(uint32_t len) {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        m_head.store(head + Align16(sizeof(Record) + len), std::memory_order_release);
+    }
+
+    // Consumer side
+
+    void Run() {
+        while (m_running.load(std::memory_order_acquire)) {
+            if (!Drain()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+    /** Write everything queued; returns false if the ring was empty */
+    bool Drain() {
+        const uint64_t size = m_config.ringBytes;
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        // Interfaces were registered before any of their packets were queued
+        WritePendingInterfaces();
+        if (tail == head) {
+            return false;
+        }
+        while (tail != head) {
+            Record r;
+            std::memcpy(&r, &m_ring[tail & (size - 1)], sizeof(r));
+            const uint8_t *payload = &m_ring[(tail & (size - 1)) + sizeof(Record)];
+            if (r.kind == RECORD_PACKET) {
+                uint32_t blockLen;
+                std::memcpy(&blockLen, payload + 4, 4);
+                MaybeRotate(r.timeNs, blockLen);
+                WriteBlock(payload, blockLen);
+                m_packets.fetch_add(1, std::memory_order_relaxed);
+            }
+            tail += r.length;
+        }
+        m_tail.store(tail, std::memory_order_release);
+        return true;
+    }
+
+    void WritePendingInterfaces() {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        for (const std::string &block : m_pendingInterfaces) {
+            m_interfaces.push_back(block);
+            WriteBlock(block.data(), static_cast<uint32_t>(block.size()));
+        }
+        m_pendingInterfaces.clear();
+    }
+
+    void MaybeRotate(uint64_t timeNs, uint32_t blockLen) {
+        if (!m_fileHasPackets) {
+            m_fileStartNs = timeNs;
+            m_fileHasPackets = true;
+            return;
+        }
+        bool full = m_config.maxFileBytes > 0 && m_fileBytes + blockLen > m_config.maxFileBytes;
+        bool old = m_config.rotateSeconds > 0 && (timeNs - m_fileStartNs) >= m_config.rotateSeconds * 1e9;
+        if (full || old) {
+            CloseFile();
+            OpenNextFile(timeNs);
+            m_fileHasPackets = true;
+        }
+    }
+
+    bool OpenNextFile(uint64_t timeNs) {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "-%03u.pcapng", m_fileIndex++);
+        std::string path = m_config.prefix + suffix;
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file) {
+            std::cerr << "pcapng: cannot open " << path << "\n";
+            return false;
+        }
+        std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+        m_files.push_back(path);
+        while (m_config.maxFiles > 0 && m_files.size() > m_config.maxFiles) {
+            std::remove(m_files.front().c_str());
+            m_files.pop_front();
+        }
+        m_fileBytes = 0;
+        m_fileStartNs = timeNs;
+        m_fileHasPackets = false;
+
+        std::string shb = SectionHeader();
+        WriteBlock(shb.data(), static_cast<uint32_t>(shb.size()));
+        for (const std::string &idb : m_interfaces) {
+            WriteBlock(idb.data(), static_cast<uint32_t>(idb.size()));
+        }
+        return true;
+    }
+
+    void CloseFile() {
+        if (m_file) {
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    void WriteBlock(const void *data, uint32_t len) {
+        if (m_file) {
+            std::fwrite(data, 1, len, m_file);
+            m_fileBytes += len;
+            m_bytesWritten.fetch_add(len, std::memory_order_relaxed);
+        }
+    }
+
+    Config m_config;
+    std::unique_ptr<uint8_t[]> m_ring;
+    alignas(64) std::atomic<uint64_t> m_head{0};
+    uint64_t m_tailCache = 0;
+    uint32_t m_nextInterface = 0;
+    std::atomic<uint64_t> m_dropped{0};
+    alignas(64) std::atomic<uint64_t> m_tail{0};
+    std::atomic<uint64_t> m_packets{0};
+    std::atomic<uint64_t> m_bytesWritten{0};
+
+    std::mutex m_pendingMutex;
+    std::vector<std::string> m_pendingInterfaces;
+
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+    std::FILE *m_file = nullptr;
+    std::deque<std::string> m_files;
+    std::vector<std::string> m_interfaces;
+    uint32_t m_fileIndex = 0;
+    uint64_t m_fileBytes = 0;
+    uint64_t m_fileStartNs = 0;
+    bool m_fileHasPackets = false;
+};
+
+#endif /* PCAPNG_WRITER_H */
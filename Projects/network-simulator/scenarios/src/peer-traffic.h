@@ -0,0 +1,452 @@
+/*
+ * Synthetic peer traffic: the pynode workload, inside the simulator.
+ *
+ * Each container of tap-4pynode (pynode/main.py) listens on TCP port 5000
+ * and, every 2 s, connects to a random peer, sends one short message and
+ * closes the connection. PeerTrafficApplication does the same for one
+ * virtual peer: it listens on its own port and, every Interval, opens a new
+ * TCP connection to a peer drawn uniformly from all the others, sends
+ * MessageSize bytes once connected and closes. A node may host several
+ * virtual peers (one port each), so thousands of them fit in a run.
+ *
+ * Every message starts with a PeerMessageHeader carrying the simulated time
+ * its connection was opened. The receiving peer records the message latency
+ * (connect start to last byte received, route discovery and handshake
+ * included) once the whole message is in. Connections not established
+ * within ConnectTimeout are abandoned and counted as timeouts; those reset
+ * by the peer (or given up by TCP) as refused, like main.py's error classes.
+ */
+
+#ifndef PEER_TRAFFIC_H
+#define PEER_TRAFFIC_H
+
+#include "latency-histogram.h"
+#include "metrics-exporter.h"
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+static const uint32_t kPeerMessageMagic = 0x4d503454; // "T4PM"
+
+/** First bytes of every message; the rest is padding up to length */
+struct PeerMessageHeader {
+    uint32_t magic;
+    uint32_t length;
+    int64_t startNs;
+};
+
+static_assert(sizeof(PeerMessageHeader) == 16, "PeerMessageHeader layout");
+
+/**
+ * Counters and latency histograms of all the virtual peers of a run.
+ * Written on the simulator thread, read by the reports.
+ */
+class PeerTrafficStats {
+public:
+    /** Connections opened */
+    std::atomic<uint64_t> attempts{0};
+    /** Connections established, message sent */
+    std::atomic<uint64_t> connected{0};
+    /** Connections reset or given up by TCP before ConnectTimeout */
+    std::atomic<uint64_t> refused{0};
+    /** Connections not established within ConnectTimeout */
+    std::atomic<uint64_t> timeouts{0};
+    /** Messages received in full */
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> bytes{0};
+
+    /** Connect start to last byte received, ns */
+    LatencyHistogram latency;
+    /** Connect start to connection established, ns */
+    LatencyHistogram connect;
+
+    static void Bump(std::atomic<uint64_t> &a, uint64_t n = 1) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static uint64_t Load(const std::atomic<uint64_t> &a) { return a.load(std::memory_order_relaxed); }
+
+    /** Delivered messages per connection attempt */
+    double SuccessRate() const {
+        uint64_t n = Load(attempts);
+        return n ? static_cast<double>(Load(delivered)) / n : 0.0;
+    }
+
+    /** One-line summary, for the periodic and the final reports */
+    void PrintSummary(std::ostream &os) const {
+        if (Load(attempts) == 0) {
+            return;
+        }
+        LatencyHistogram::Snapshot s = latency.Read();
+        LatencyHistogram::Snapshot c = connect.Read();
+        os << "  Peer traffic: attempts=" << Load(attempts) << " connected=" << Load(connected)
+           << " refused=" << Load(refused) << " timeouts=" << Load(timeouts) << " delivered=" << Load(delivered)
+           << " (" << SuccessRate() * 100 << "%) latency p50=" << Ms(s.Percentile(0.5))
+           << "ms p99=" << Ms(s.Percentile(0.99)) << "ms max=" << Ms(s.max)
+           << "ms connect p50=" << Ms(c.Percentile(0.5)) << "ms\n";
+    }
+
+    /**
+     * Export t4_peer_{attempts,connected,refused,timeouts,delivered,bytes}
+     * and t4_peer_latency_ns{quantile}, t4_peer_connect_ns{quantile}
+     */
+    void AddCollector(MetricsExporter &metrics) const {
+        metrics.AddCollector([this](std::vector<MetricsExporter::Sample> &out) {
+            if (Load(attempts) == 0) {
+                return;
+            }
+            out.push_back({"t4_peer_attempts", {}, static_cast<double>(Load(attempts))});
+            out.push_back({"t4_peer_connected", {}, static_cast<double>(Load(connected))});
+            out.push_back({"t4_peer_refused", {}, static_cast<double>(Load(refused))});
+            out.push_back({"t4_peer_timeouts", {}, static_cast<double>(Load(timeouts))});
+            out.push_back({"t4_peer_delivered", {}, static_cast<double>(Load(delivered))});
+            out.push_back({"t4_peer_bytes", {}, static_cast<double>(Load(bytes))});
+            LatencyHistogram::Snapshot s = latency.Read();
+            LatencyHistogram::Snapshot c = connect.Read();
+            for (const char *q : {"0.5", "0.9", "0.99"}) {
+                out.push_back({"t4_peer_latency_ns", {{"quantile", q}},
+                               static_cast<double>(s.Percentile(std::atof(q)))});
+                out.push_back({"t4_peer_connect_ns", {{"quantile", q}},
+                               static_cast<double>(c.Percentile(std::atof(q)))});
+            }
+        });
+    }
+
+    static double Ms(uint64_t ns) { return ns / 1e6; }
+};
+
+/**
+ * Addresses of all the virtual peers of a run: peer i is on node
+ * i / perNode, port basePort + i % perNode
+ */
+struct PeerDirectory {
+    std::vector<Ipv4Address> nodes;
+    uint32_t perNode = 1;
+    uint16_t basePort = 5000;
+
+    uint32_t GetN() const { return static_cast<uint32_t>(nodes.size()) * perNode; }
+
+    InetSocketAddress Get(uint32_t peer) const {
+        return InetSocketAddress(nodes[peer / perNode], basePort + peer % perNode);
+    }
+};
+
+/**
+ * One virtual peer: a listening socket and a connection to a random peer
+ * every Interval
+ */
+class PeerTrafficApplication : public Application {
+public:
+    static TypeId GetTypeId() {
+        static TypeId tid =
+            TypeId("ns3::PeerTrafficApplication")
+                .SetParent<Application>()
+                .SetGroupName("Applications")
+                .AddConstructor<PeerTrafficApplication>()
+                .AddAttribute("Interval", "Seconds between two connections",
+                              StringValue("ns3::ConstantRandomVariable[Constant=2.0]"),
+                              MakePointerAccessor(&PeerTrafficApplication::m_interval),
+                              MakePointerChecker<RandomVariableStream>())
+                .AddAttribute("MessageSize", "Bytes sent per connection (at least the 16-byte header)",
+                              StringValue("ns3::ConstantRandomVariable[Constant=48]"),
+                              MakePointerAccessor(&PeerTrafficApplication::m_messageSize),
+                              MakePointerChecker<RandomVariableStream>())
+                .AddAttribute("ConnectTimeout", "Abandon connections not established by then",
+                              TimeValue(Seconds(5.0)),
+                              MakeTimeAccessor(&PeerTrafficApplication::m_timeout), MakeTimeChecker());
+        return tid;
+    }
+
+    PeerTrafficApplication() : m_choice(CreateObject<UniformRandomVariable>()) {}
+
+    /** Peer self of directory, reporting to stats (both outlive the application) */
+    void Setup(std::shared_ptr<const PeerDirectory> directory, uint32_t self, PeerTrafficStats *stats) {
+        m_directory = std::move(directory);
+        m_self = self;
+        m_stats = stats;
+    }
+
+    int64_t AssignStreams(int64_t stream) {
+        m_interval->SetStream(stream);
+        m_messageSize->SetStream(stream + 1);
+        m_choice->SetStream(stream + 2);
+        return 3;
+    }
+
+protected:
+    void DoDispose() override {
+        m_listener = nullptr;
+        m_outbound.clear();
+        m_inbound.clear();
+        Application::DoDispose();
+    }
+
+private:
+    struct Outbound {
+        Ptr<Socket> socket;
+        Time start;
+        EventId timeout;
+    };
+
+    struct Inbound {
+        Ptr<Socket> socket;
+        PeerMessageHeader header = {};
+        uint64_t received = 0;
+        bool done = false;
+    };
+
+    void StartApplication() override {
+        m_listener = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+        m_listener->Bind(m_directory->Get(m_self));
+        m_listener->Listen();
+        m_listener->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address &>(),
+                                      MakeCallback(&PeerTrafficApplication::HandleAccept, this));
+        // Containers do not start in step: first connection anywhere in the first interval
+        m_next = Simulator::Schedule(Seconds(m_choice->GetValue(0.0, m_interval->GetValue())),
+                                     &PeerTrafficApplication::Connect, this);
+    }
+
+    void StopApplication() override {
+        m_next.Cancel();
+        if (m_listener) {
+            m_listener->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address &>(),
+                                          MakeNullCallback<void, Ptr<Socket>, const Address &>());
+            m_listener->Close();
+        }
+        for (auto &entry : m_outbound) {
+            entry.second.timeout.Cancel();
+            Abandon(entry.second.socket);
+        }
+        m_outbound.clear();
+        for (auto &entry : m_inbound) {
+            Abandon(entry.second.socket);
+        }
+        m_inbound.clear();
+    }
+
+    /** Open a connection to a random other peer, then schedule the next one */
+    void Connect() {
+        uint32_t n = m_directory->GetN();
+        uint32_t peer = m_choice->GetInteger(0, n - 2);
+        peer += peer >= m_self ? 1 : 0;
+
+        Ptr<Socket> socket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+        socket->Bind();
+        socket->SetConnectCallback(MakeCallback(&PeerTrafficApplication::HandleConnected, this),
+                                   MakeCallback(&PeerTrafficApplication::HandleRefused, this));
+        Outbound &out = m_outbound[PeekPointer(socket)];
+        out.socket = socket;
+        out.start = Simulator::Now();
+        out.timeout = Simulator::Schedule(m_timeout, &PeerTrafficApplication::HandleTimeout, this,
+                                          PeekPointer(socket));
+        PeerTrafficStats::Bump(m_stats->attempts);
+        socket->Connect(m_directory->Get(peer));
+
+        m_next = Simulator::Schedule(Seconds(m_interval->GetValue()), &PeerTrafficApplication::Connect, this);
+    }
+
+    void HandleConnected(Ptr<Socket> socket) {
+        auto it = m_outbound.find(PeekPointer(socket));
+        if (it == m_outbound.end()) {
+            return;
+        }
+        Outbound out = it->second;
+        m_outbound.erase(it);
+        out.timeout.Cancel();
+        PeerTrafficStats::Bump(m_stats->connected);
+        m_stats->connect.Record((Simulator::Now() - out.start).GetNanoSeconds());
+
+        PeerMessageHeader header;
+        header.magic = kPeerMessageMagic;
+        header.length = std::max<uint32_t>(sizeof(header), m_messageSize->GetInteger());
+        header.startNs = out.start.GetNanoSeconds();
+        Ptr<Packet> packet = Create<Packet>(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+        packet->AddPaddingAtEnd(header.length - sizeof(header));
+        socket->Send(packet);
+        // TCP sends the FIN once the message has drained
+        socket->Close();
+    }
+
+    void HandleRefused(Ptr<Socket> socket) {
+        auto it = m_outbound.find(PeekPointer(socket));
+        if (it == m_outbound.end()) {
+            return;
+        }
+        it->second.timeout.Cancel();
+        m_outbound.erase(it);
+        PeerTrafficStats::Bump(m_stats->refused);
+    }
+
+    void HandleTimeout(Socket *key) {
+        auto it = m_outbound.find(key);
+        if (it == m_outbound.end()) {
+            return;
+        }
+        Abandon(it->second.socket);
+        m_outbound.erase(it);
+        PeerTrafficStats::Bump(m_stats->timeouts);
+    }
+
+    void HandleAccept(Ptr<Socket> socket, const Address &from) {
+        socket->SetRecvCallback(MakeCallback(&PeerTrafficApplication::HandleRead, this));
+        socket->SetCloseCallbacks(MakeCallback(&PeerTrafficApplication::HandlePeerClose, this),
+                                  MakeCallback(&PeerTrafficApplication::HandlePeerClose, this));
+        m_inbound[PeekPointer(socket)].socket = socket;
+    }
+
+    void HandleRead(Ptr<Socket> socket) {
+        auto it = m_inbound.find(PeekPointer(socket));
+        if (it == m_inbound.end()) {
+            return;
+        }
+        Inbound &in = it->second;
+        Ptr<Packet> packet;
+        while ((packet = socket->Recv()) && packet->GetSize() > 0) {
+            uint32_t size = packet->GetSize();
+            if (in.received < sizeof(in.header)) {
+                uint32_t n = std::min<uint32_t>(size, sizeof(in.header) - in.received);
+                packet->CopyData(reinterpret_cast<uint8_t *>(&in.header) + in.received, n);
+            }
+            in.received += size;
+        }
+        if (!in.done && in.received >= sizeof(in.header) && in.header.magic == kPeerMessageMagic &&
+            in.received >= in.header.length) {
+            in.done = true;
+            PeerTrafficStats::Bump(m_stats->delivered);
+            PeerTrafficStats::Bump(m_stats->bytes, in.header.length);
+            m_stats->latency.Record(Simulator::Now().GetNanoSeconds() - in.header.startNs);
+        }
+    }
+
+    /** The sender closed (or reset) its side: close ours too, as main.py does */
+    void HandlePeerClose(Ptr<Socket> socket) {
+        auto it = m_inbound.find(PeekPointer(socket));
+        if (it == m_inbound.end()) {
+            return;
+        }
+        Ptr<Socket> keep = it->second.socket;
+        m_inbound.erase(it);
+        Abandon(keep);
+    }
+
+    /** Close a socket without calling back into this application */
+    static void Abandon(Ptr<Socket> socket) {
+        socket->SetConnectCallback(MakeNullCallback<void, Ptr<Socket>>(), MakeNullCallback<void, Ptr<Socket>>());
+        socket->SetCloseCallbacks(MakeNullCallback<void, Ptr<Socket>>(), MakeNullCallback<void, Ptr<Socket>>());
+        socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        socket->Close();
+    }
+
+    Ptr<RandomVariableStream> m_interval;
+    Ptr<RandomVariableStream> m_messageSize;
+    Ptr<UniformRandomVariable> m_choice;
+    Time m_timeout;
+
+    std::shared_ptr<const PeerDirectory> m_directory;
+    uint32_t m_self = 0;
+    PeerTrafficStats *m_stats = nullptr;
+
+    Ptr<Socket> m_listener;
+    EventId m_next;
+    std::unordered_map<Socket *, Outbound> m_outbound;
+    std::unordered_map<Socket *, Inbound> m_inbound;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(PeerTrafficApplication);
+
+/**
+ * Command line options of the peer workload
+ */
+struct PeerTrafficOptions {
+    uint32_t perNode = 1;
+    uint16_t port = 5000;
+    double interval = 2.0;
+    std::string intervalDist = "constant";
+    uint32_t messageSize = 48;
+    uint32_t messageSizeMax = 0;
+    double timeout = 5.0;
+
+    void AddValues(CommandLine &cmd) {
+        cmd.AddValue("peersPerNode", "Virtual peers per node, each on its own port", perNode);
+        cmd.AddValue("peerPort", "Port of the first virtual peer of each node", port);
+        cmd.AddValue("peerInterval", "Mean seconds between two connections of a peer", interval);
+        cmd.AddValue("peerIntervalDist", "Interval distribution: constant or exponential", intervalDist);
+        cmd.AddValue("peerMessageSize", "Bytes per message (minimum 16)", messageSize);
+        cmd.AddValue("peerMessageSizeMax", "If larger than peerMessageSize, sizes are uniform in between",
+                     messageSizeMax);
+        cmd.AddValue("peerTimeout", "Seconds before an unanswered connection counts as a timeout", timeout);
+    }
+
+    std::string IntervalVariable() const {
+        std::ostringstream oss;
+        if (intervalDist == "exponential") {
+            oss << "ns3::ExponentialRandomVariable[Mean=" << interval << "|Bound=" << 10 * interval << "]";
+        } else {
+            oss << "ns3::ConstantRandomVariable[Constant=" << interval << "]";
+        }
+        return oss.str();
+    }
+
+    std::string MessageSizeVariable() const {
+        std::ostringstream oss;
+        if (messageSizeMax > messageSize) {
+            oss << "ns3::UniformRandomVariable[Min=" << messageSize << "|Max=" << messageSizeMax + 1 << "]";
+        } else {
+            oss << "ns3::ConstantRandomVariable[Constant=" << messageSize << "]";
+        }
+        return oss.str();
+    }
+};
+
+/**
+ * perNode virtual peers on every node of nodes (interface i of interfaces
+ * being node i's address), all reporting to stats. Peer i draws from RNG
+ * streams stream + 3i .. stream + 3i + 2, so other random variables in the
+ * scenario do not shift the workload
+ */
+inline ApplicationContainer InstallPeerTraffic(NodeContainer &nodes, Ipv4InterfaceContainer &interfaces,
+                                               const PeerTrafficOptions &options, PeerTrafficStats &stats,
+                                               Time start, Time stop, int64_t stream) {
+    auto directory = std::make_shared<PeerDirectory>();
+    for (uint32_t i = 0; i < nodes.GetN(); i++) {
+        directory->nodes.push_back(interfaces.GetAddress(i));
+    }
+    directory->perNode = std::max<uint32_t>(1, options.perNode);
+    directory->basePort = options.port;
+
+    ApplicationContainer apps;
+    if (directory->GetN() < 2) {
+        return apps;
+    }
+    for (uint32_t i = 0; i < directory->GetN(); i++) {
+        Ptr<PeerTrafficApplication> app = CreateObject<PeerTrafficApplication>();
+        app->SetAttribute("Interval", StringValue(options.IntervalVariable()));
+        app->SetAttribute("MessageSize", StringValue(options.MessageSizeVariable()));
+        app->SetAttribute("ConnectTimeout", TimeValue(Seconds(options.timeout)));
+        app->Setup(directory, i, &stats);
+        stream += app->AssignStreams(stream);
+        nodes.Get(i / directory->perNode)->AddApplication(app);
+        apps.Add(app);
+    }
+    apps.Start(start);
+    apps.Stop(stop);
+    return apps;
+}
+
+} // namespace ns3
+
+#endif /* PEER_TRAFFIC_H */
@@ -0,0 +1,315 @@
+/*
+ * Scheduling lag of the realtime simulator.
+ *
+ * RealtimeSimulatorImpl runs an event as soon as the wall clock reaches its
+ * timestamp, or late if the events before it took too long. It only reports
+ * how late when the lag exceeds HardLimit in HardLimit mode, and then it
+ * aborts. LagMonitoringScheduler wraps the real scheduler (MapScheduler by
+ * default) and measures every event as it is dequeued for execution:
+ *
+ *   lag = wall clock since Run() - event timestamp
+ *
+ * The lag goes into an HDR-style histogram. Events later than the
+ * simulator's HardLimit are counted as violations, whatever the
+ * synchronization mode.
+ *
+ * Lag is attributed by event type (the EventImpl class, i.e. the callback
+ * signature bound by MakeEvent). An event is blamed for the lag it adds:
+ * the next event's lag minus what it would have inherited anyway,
+ * max(0, previous lag - timestamp gap). This points at slow handlers
+ * rather than at whatever happened to run after them.
+ *
+ * Everything is written on the simulator thread, inside the simulator's
+ * critical section. The exporter thread reads it through RealtimeLagMonitor.
+ */
+
+#ifndef REALTIME_LAG_MONITOR_H
+#define REALTIME_LAG_MONITOR_H
+
+#include "latency-histogram.h"
+#include "metrics-exporter.h"
+
+#include "ns3/core-module.h"
+#include "ns3/event-impl.h"
+#include "ns3/realtime-simulator-impl.h"
+#include "ns3/scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Lag statistics, shared by the scheduler (writer) and the reports
+ */
+class RealtimeLagMonitor {
+public:
+    static constexpr uint32_t kMaxTypes = 64;
+
+    struct TypeStats {
+        std::string name;
+        std::atomic<uint64_t> events{0};
+        std::atomic<uint64_t> causedNs{0};
+        std::atomic<uint64_t> maxCausedNs{0};
+        std::atomic<uint64_t> maxLagNs{0};
+    };
+
+    static RealtimeLagMonitor &Get() {
+        static RealtimeLagMonitor monitor;
+        return monitor;
+    }
+
+    /**
+     * Install the monitoring scheduler. Only meaningful with
+     * RealtimeSimulatorImpl; returns false (and does nothing) otherwise.
+     */
+    bool Enable() {
+        m_realtime = DynamicCast<RealtimeSimulatorImpl>(Simulator::GetImplementation());
+        if (!m_realtime) {
+            return false;
+        }
+        TimeValue hardLimit;
+        m_realtime->GetAttribute("HardLimit", hardLimit);
+        m_hardLimitNs = hardLimit.Get().GetNanoSeconds();
+        ObjectFactory factory;
+        factory.SetTypeId("ns3::LagMonitoringScheduler");
+        Simulator::SetScheduler(factory);
+        m_enabled = true;
+        return true;
+    }
+
+    bool IsEnabled() const { return m_enabled; }
+
+    /** Wall clock of the realtime simulator, in ns since Run() */
+    int64_t RealtimeNs() const { return m_realtime->RealtimeNow().GetNanoSeconds(); }
+
+    /** Called by the scheduler for every event it hands out */
+    void Record(const EventImpl *event, int64_t timestampNs) {
+        int64_t lag = RealtimeNs() - timestampNs;
+        uint64_t late = lag > 0 ? static_cast<uint64_t>(lag) : 0;
+        m_lag.Record(late);
+        if (late > m_hardLimitNs) {
+            Bump(m_violations, 1);
+        }
+
+        // Blame the previous event for the lag it added
+        if (m_previous) {
+            int64_t inherited = std::max<int64_t>(0, m_previousLag - (timestampNs - m_previousTs));
+            if (lag > inherited) {
+                uint64_t caused = static_cast<uint64_t>(lag - inherited);
+                Bump(m_previous->causedNs, caused);
+                Max(m_previous->maxCausedNs, caused);
+            }
+        }
+
+        TypeStats *type = Lookup(event);
+        Bump(type->events, 1);
+        Max(type->maxLagNs, late);
+        m_previous = type;
+        m_previousLag = lag;
+        m_previousTs = timestampNs;
+    }
+
+    uint64_t GetViolations() const { return m_violations.load(std::memory_order_relaxed); }
+
+    /** One-line summary for the periodic report */
+    void PrintSummary(std::ostream &os) const {
+        if (!m_enabled) {
+            return;
+        }
+        LatencyHistogram::Snapshot s = m_lag.Read();
+        os << "  Realtime lag: events=" << s.count << " p50=" << Ms(s.Percentile(0.5))
+           << "ms p99=" << Ms(s.Percentile(0.99)) << "ms p99.9=" << Ms(s.Percentile(0.999))
+           << "ms max=" << Ms(s.max) << "ms HardLimit(" << Ms(m_hardLimitNs)
+           << "ms) violations=" << GetViolations() << "\n";
+    }
+
+    /** Final report: summary, then the event types that caused most lag */
+    void Print(std::ostream &os, uint32_t top = 8) const {
+        if (!m_enabled) {
+            return;
+        }
+        os << "Realtime scheduling lag:\n";
+        PrintSummary(os);
+        std::vector<const TypeStats *> types;
+        for (uint32_t i = 0; i < GetTypeCount(); i++) {
+            if (m_types[i].causedNs.load(std::memory_order_relaxed) > 0) {
+                types.push_back(&m_types[i]);
+            }
+        }
+        std::sort(types.begin(), types.end(), [](const TypeStats *a, const TypeStats *b) {
+            return a->causedNs.load(std::memory_order_relaxed) > b->causedNs.load(std::memory_order_relaxed);
+        });
+        if (types.size() > top) {
+            types.resize(top);
+        }
+        for (const TypeStats *t : types) {
+            os << "    caused " << std::setw(10) << Ms(t->causedNs.load(std::memory_order_relaxed))
+               << "ms (max " << Ms(t->maxCausedNs.load(std::memory_order_relaxed)) << "ms) over "
+               << t->events.load(std::memory_order_relaxed) << " events: " << t->name << "\n";
+        }
+    }
+
+    /**
+     * Export t4_rt_lag_ns{quantile}, t4_rt_lag_max_ns, t4_rt_hard_limit_violations
+     * and t4_rt_lag_caused_ns{event} through the metrics exporter
+     */
+    void AddCollector(MetricsExporter &metrics) const {
+        metrics.AddCollector([this](std::vector<MetricsExporter::Sample> &out) {
+            if (!m_enabled) {
+                return;
+            }
+            LatencyHistogram::Snapshot s = m_lag.Read();
+            for (const char *q : {"0.5", "0.9", "0.99", "0.999"}) {
+                out.push_back({"t4_rt_lag_ns", {{"quantile", q}},
+                               static_cast<double>(s.Percentile(std::atof(q)))});
+            }
+            out.push_back({"t4_rt_lag_max_ns", {}, static_cast<double>(s.max)});
+            out.push_back({"t4_rt_lag_events", {}, static_cast<double>(s.count)});
+            out.push_back({"t4_rt_hard_limit_violations", {}, static_cast<double>(GetViolations())});
+            for (uint32_t i = 0; i < GetTypeCount(); i++) {
+                out.push_back({"t4_rt_lag_caused_ns", {{"event", m_types[i].name}},
+                               static_cast<double>(m_types[i].causedNs.load(std::memory_order_relaxed))});
+            }
+        });
+    }
+
+private:
+    static void Bump(std::atomic<uint64_t> &a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void Max(std::atomic<uint64_t> &a, uint64_t v) {
+        if (v > a.load(std::memory_order_relaxed)) {
+            a.store(v, std::memory_order_relaxed);
+        }
+    }
+
+    static double Ms(uint64_t ns) { return ns / 1e6; }
+
+    uint32_t GetTypeCount() const { return m_typeCount.load(std::memory_order_acquire); }
+
+    TypeStats *Lookup(const EventImpl *event) {
+        const std::type_info &info = typeid(*event);
+        if (m_lastInfo == &info) {
+            return m_lastType;
+        }
+        auto it = m_index.find(std::type_index(info));
+        TypeStats *type;
+        if (it != m_index.end()) {
+            type = &m_types[it->second];
+        } else {
+            uint32_t n = m_typeCount.load(std::memory_order_relaxed);
+            // The last slot collects every type beyond the table
+            uint32_t slot = n < kMaxTypes ? n : kMaxTypes - 1;
+            if (n < kMaxTypes) {
+                m_types[slot].name = n < kMaxTypes - 1 ? TypeName(info) : "(other)";
+                m_typeCount.store(n + 1, std::memory_order_release);
+            }
+            m_index.emplace(std::type_index(info), slot);
+            type = &m_types[slot];
+        }
+        m_lastInfo = &info;
+        m_lastType = type;
+        return type;
+    }
+
+    /**
+     * Readable name for a MakeEvent type: "TapBridge::*(...)" for member
+     * functions, the demangled signature otherwise
+     */
+    static std::string TypeName(const std::type_info &info) {
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(info.name(), nullptr, nullptr, &status);
+        std::string name = status == 0 ? demangled : info.name();
+        std::free(demangled);
+
+        // MakeEvent<void (ns3::Class::*)(Args...), ...>::EventMemberImplN
+        std::string::size_type member = name.find("::*)(");
+        if (member != std::string::npos) {
+            std::string::size_type open = name.rfind('(', member);
+            std::string::size_type close = name.find(')', member + 4);
+            std::string cls = name.substr(open + 1, member - open - 1);
+            if (cls.compare(0, 5, "ns3::") == 0) {
+                cls.erase(0, 5);
+            }
+            return cls + "::*" + name.substr(member + 4, close - member - 3);
+        }
+        const std::string::size_type maxLength = 96;
+        return name.size() > maxLength ? name.substr(0, maxLength) + "..." : name;
+    }
+
+    Ptr<RealtimeSimulatorImpl> m_realtime;
+    bool m_enabled = false;
+    uint64_t m_hardLimitNs = UINT64_MAX;
+
+    LatencyHistogram m_lag;
+    std::atomic<uint64_t> m_violations{0};
+
+    TypeStats m_types[kMaxTypes];
+    std::atomic<uint32_t> m_typeCount{0};
+    std::unordered_map<std::type_index, uint32_t> m_index;
+    const std::type_info *m_lastInfo = nullptr;
+    TypeStats *m_lastType = nullptr;
+
+    TypeStats *m_previous = nullptr;
+    int64_t m_previousLag = 0;
+    int64_t m_previousTs = 0;
+};
+
+/**
+ * Scheduler that forwards to the real one and reports every dequeued event
+ * to RealtimeLagMonitor. Installed by RealtimeLagMonitor::Enable().
+ */
+class LagMonitoringScheduler : public Scheduler {
+public:
+    static TypeId GetTypeId() {
+        static TypeId tid = TypeId("ns3::LagMonitoringScheduler")
+                                .SetParent<Scheduler>()
+                                .SetGroupName("Core")
+                                .AddConstructor<LagMonitoringScheduler>()
+                                .AddAttribute("Scheduler", "Type of the wrapped scheduler",
+                                              TypeIdValue(MapScheduler::GetTypeId()),
+                                              MakeTypeIdAccessor(&LagMonitoringScheduler::m_innerType),
+                                              MakeTypeIdChecker());
+        return tid;
+    }
+
+    void Insert(const Event &ev) override { m_inner->Insert(ev); }
+    bool IsEmpty() const override { return m_inner->IsEmpty(); }
+    Event PeekNext() const override { return m_inner->PeekNext(); }
+    void Remove(const Event &ev) override { m_inner->Remove(ev); }
+
+    Event RemoveNext() override {
+        Event ev = m_inner->RemoveNext();
+        // The realtime simulator dequeues an event right before running it
+        RealtimeLagMonitor::Get().Record(ev.impl, TimeStep(ev.key.m_ts).GetNanoSeconds());
+        return ev;
+    }
+
+protected:
+    void NotifyConstructionCompleted() override {
+        ObjectFactory factory;
+        factory.SetTypeId(m_innerType);
+        m_inner = factory.Create<Scheduler>();
+        Scheduler::NotifyConstructionCompleted();
+    }
+
+private:
+    TypeId m_innerType;
+    Ptr<Scheduler> m_inner;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LagMonitoringScheduler);
+
+} // namespace ns3
+
+#endif /* REALTIME_LAG_MONITOR_H */
@@ -0,0 +1,88 @@
+/*
+ * Run statistics: executed events, events/sec, memory footprint and heap
+ * allocations (alloc-counter.h, -1 unless built with T4_COUNT_ALLOCS).
+ *
+ * Start() right before Simulator::Run(), Print() right after it. The output
+ * lines are stable so scripts/bench-*.sh can grep them.
+ */
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include "alloc-counter.h"
+
+#include "ns3/simulator.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+
+class RunStats {
+public:
+    void Start() {
+        m_wallStart = std::chrono::steady_clock::now();
+        m_eventsStart = ns3::Simulator::GetEventCount();
+        m_allocationsStart = HeapAllocations();
+    }
+
+    void Stop() {
+        m_wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wallStart).count();
+        m_events = ns3::Simulator::GetEventCount() - m_eventsStart;
+        m_simSeconds = ns3::Simulator::Now().GetSeconds();
+        m_allocations = m_allocationsStart < 0 ? -1 : HeapAllocations() - m_allocationsStart;
+    }
+
+    uint64_t GetEvents() const { return m_events; }
+    /** Heap allocations during the run (setup excluded), -1 without T4_COUNT_ALLOCS */
+    int64_t GetAllocations() const { return m_allocations; }
+    double GetSimSeconds() const { return m_simSeconds; }
+    double GetWallSeconds() const { return m_wallSeconds; }
+    double GetEventsPerSecond() const { return m_wallSeconds > 0 ? m_events / m_wallSeconds : 0.0; }
+    double GetSimPerWall() const { return m_wallSeconds > 0 ? m_simSeconds / m_wallSeconds : 0.0; }
+
+    /** Peak resident set size of this process in kB */
+    static uint64_t PeakRssKb() {
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        return static_cast<uint64_t>(ru.ru_maxrss);
+    }
+
+    /** Current resident set size of this process in kB */
+    static uint64_t CurrentRssKb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmRSS:") == 0) {
+                return std::stoull(line.substr(6));
+            }
+        }
+        return 0;
+    }
+
+    void Print(std::ostream &os = std::cout) const {
+        os << "\n=== RUN STATISTICS ===\n";
+        os << "Events: " << m_events << " (" << static_cast<uint64_t>(GetEventsPerSecond()) << " events/s)\n";
+        os << "Wall time: " << m_wallSeconds << " s (sim/wall=" << GetSimPerWall() << ")\n";
+        os << "RSS: current=" << CurrentRssKb() << " kB peak=" << PeakRssKb() << " kB\n";
+        if (m_allocations < 0) {
+            os << "Allocations: -1 (not counted, see alloc-counter.h)\n";
+        } else {
+            os << "Allocations: " << m_allocations << " ("
+               << (m_events ? static_cast<double>(m_allocations) / m_events : 0.0) << " per event)\n";
+        }
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_wallStart;
+    uint64_t m_eventsStart = 0;
+    uint64_t m_events = 0;
+    int64_t m_allocationsStart = 0;
+    int64_t m_allocations = 0;
+    double m_wallSeconds = 0.0;
+    double m_simSeconds = 0.0;
+};
+
+#endif /* RUN_STATS_H */
@@ -0,0 +1,586 @@
+/*
+ * Shaped link: a cheap point-to-multipoint channel for container traffic
+ *
+ * CsmaChannel models carrier sense and collisions and costs several events
+ * per frame (transmit start, complete, propagation, receive on every
+ * device). Scenarios that only need "these containers, at this rate and
+ * delay" can use ShapedLinkChannel instead:
+ *   - every ShapedLinkNetDevice shapes its egress with a token bucket kept
+ *     in virtual time (DataRate, Burst): a frame's departure is computed
+ *     when it is sent and a frame that would wait longer than QueueBytes
+ *     at DataRate is dropped, so shaping costs no event at all,
+ *   - the channel adds Delay, uniform +-Jitter, Loss, and with probability
+ *     Reorder an extra ReorderDelay, then puts the frame into a timing
+ *     wheel of Resolution-wide slots; the wheel spans at most twice
+ *     Delay + Jitter + ReorderDelay, frames further out (long egress
+ *     queues) wait in a sorted overflow until the wheel reaches them,
+ *   - one event per busy slot delivers up to BatchSize frames, in order.
+ * Like a learning switch, the channel remembers which device sent each
+ * source MAC and delivers unicast frames only there; broadcast, multicast
+ * and unknown destinations go to every other device. Devices support
+ * SendFrom and promiscuous receive, so TapBridge can use them in both
+ * UseLocal and UseBridge mode, and provide MacTx, MacRx, MacTxDrop and
+ * PromiscSniffer (Ethernet frames) like CsmaNetDevice.
+ */
+
+#ifndef SHAPED_LINK_H
+#define SHAPED_LINK_H
+
+#include "metrics-exporter.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class ShapedLinkChannel;
+
+class ShapedLinkNetDevice : public NetDevice {
+public:
+    static TypeId GetTypeId();
+
+    /** Counters, written on the simulator thread and read by the metrics exporter */
+    struct Stats {
+        std::atomic<uint64_t> txFrames{0};
+        std::atomic<uint64_t> txBytes{0};
+        std::atomic<uint64_t> rxFrames{0};
+        std::atomic<uint64_t> rxBytes{0};
+        std::atomic<uint64_t> queueDrops{0};
+        std::atomic<uint64_t> lost{0};
+    };
+
+    void Attach(Ptr<ShapedLinkChannel> channel);
+
+    const Stats &GetStats() const { return m_stats; }
+
+    static uint64_t Load(const std::atomic<uint64_t> &a) { return a.load(std::memory_order_relaxed); }
+
+    // NetDevice
+
+    void SetIfIndex(const uint32_t index) override { m_ifIndex = index; }
+    uint32_t GetIfIndex() const override { return m_ifIndex; }
+    Ptr<Channel> GetChannel() const override;
+    void SetAddress(Address address) override { m_address = Mac48Address::ConvertFrom(address); }
+    Address GetAddress() const override { return m_address; }
+    bool SetMtu(const uint16_t mtu) override {
+        m_mtu = mtu;
+        return true;
+    }
+    uint16_t GetMtu() const override { return m_mtu; }
+    bool IsLinkUp() const override { return m_channel != nullptr; }
+    void AddLinkChangeCallback(Callback<void> callback) override {}
+    bool IsBroadcast() const override { return true; }
+    Address GetBroadcast() const override { return Mac48Address::GetBroadcast(); }
+    bool IsMulticast() const override { return true; }
+    Address GetMulticast(Ipv4Address group) const override { return Mac48Address::GetMulticast(group); }
+    Address GetMulticast(Ipv6Address group) const override { return Mac48Address::GetMulticast(group); }
+    bool IsBridge() const override { return false; }
+    bool IsPointToPoint() const override { return false; }
+    bool Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber) override {
+        return SendFrom(packet, m_address, dest, protocolNumber);
+    }
+    bool SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest, uint16_t protocolNumber) override;
+    Ptr<Node> GetNode() const override { return m_node; }
+    void SetNode(Ptr<Node> node) override { m_node = node; }
+    bool NeedsArp() const override { return true; }
+    void SetReceiveCallback(ReceiveCallback cb) override { m_rxCallback = cb; }
+    void SetPromiscReceiveCallback(PromiscReceiveCallback cb) override { m_promiscRxCallback = cb; }
+    bool SupportsSendFrom() const override { return true; }
+
+    /** Channel side: hand a frame to the node */
+    void Receive(Ptr<Packet> packet, uint16_t protocol, Mac48Address src, Mac48Address dst);
+
+protected:
+    void DoDispose() override {
+        m_channel = nullptr;
+        m_node = nullptr;
+        m_rxCallback.Nullify();
+        m_promiscRxCallback.Nullify();
+        NetDevice::DoDispose();
+    }
+
+private:
+    // Destination, source and type; no preamble, FCS or gap
+    static const uint32_t kEthernetHeader = 14;
+
+    static void Bump(std::atomic<uint64_t> &a, uint64_t n = 1) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void Sniff(Ptr<const Packet> packet, uint16_t protocol, Mac48Address src, Mac48Address dst) {
+        if (m_snifferTrace.IsEmpty()) {
+            return;
+        }
+        Ptr<Packet> frame = packet->Copy();
+        EthernetHeader header(false);
+        header.SetSource(src);
+        header.SetDestination(dst);
+        header.SetLengthType(protocol);
+        frame->AddHeader(header);
+        m_snifferTrace(frame);
+    }
+
+    DataRate m_rate;
+    uint32_t m_burst = 0;
+    uint32_t m_queueBytes = 0;
+
+    Ptr<ShapedLinkChannel> m_channel;
+    uint32_t m_port = 0;
+    Ptr<Node> m_node;
+    uint32_t m_ifIndex = 0;
+    Mac48Address m_address;
+    uint16_t m_mtu = 1500;
+    ReceiveCallback m_rxCallback;
+    PromiscReceiveCallback m_promiscRxCallback;
+
+    // Virtual finish time of the last frame accepted for transmission
+    int64_t m_nextFree = 0;
+    Stats m_stats;
+
+    TracedCallback<Ptr<const Packet>> m_macTxTrace;
+    TracedCallback<Ptr<const Packet>> m_macTxDropTrace;
+    TracedCallback<Ptr<const Packet>> m_macRxTrace;
+    TracedCallback<Ptr<const Packet>> m_snifferTrace;
+};
+
+class ShapedLinkChannel : public Channel {
+public:
+    static TypeId GetTypeId() {
+        static TypeId tid =
+            TypeId("ns3::ShapedLinkChannel")
+                .SetParent<Channel>()
+                .SetGroupName("Network")
+                .AddConstructor<ShapedLinkChannel>()
+                .AddAttribute("Delay", "Propagation delay", TimeValue(NanoSeconds(6560)),
+                              MakeTimeAccessor(&ShapedLinkChannel::m_delay), MakeTimeChecker())
+                .AddAttribute("Jitter", "Uniform extra delay in [-Jitter, Jitter], never below 0",
+                              TimeValue(Seconds(0)), MakeTimeAccessor(&ShapedLinkChannel::m_jitter),
+                              MakeTimeChecker())
+                .AddAttribute("Loss", "Probability that a frame is lost", DoubleValue(0),
+                              MakeDoubleAccessor(&ShapedLinkChannel::m_loss), MakeDoubleChecker<double>(0, 1))
+                .AddAttribute("Reorder", "Probability that a frame is held back by ReorderDelay", DoubleValue(0),
+                              MakeDoubleAccessor(&ShapedLinkChannel::m_reorder), MakeDoubleChecker<double>(0, 1))
+                .AddAttribute("ReorderDelay", "Extra delay of reordered frames", TimeValue(MilliSeconds(1)),
+                              MakeTimeAccessor(&ShapedLinkChannel::m_reorderDelay), MakeTimeChecker())
+                .AddAttribute("Resolution", "Width of a timing wheel slot; arrivals are rounded up to it",
+                              TimeValue(MicroSeconds(10)), MakeTimeAccessor(&ShapedLinkChannel::m_resolution),
+                              MakeTimeChecker(NanoSeconds(1)))
+                .AddAttribute("BatchSize", "Most frames delivered per event", UintegerValue(256),
+                              MakeUintegerAccessor(&ShapedLinkChannel::m_batchSize),
+                              MakeUintegerChecker<uint32_t>(1));
+        return tid;
+    }
+
+    ShapedLinkChannel() {
+        m_random = CreateObject<UniformRandomVariable>();
+        m_slots.resize(1024);
+        m_mask = m_slots.size() - 1;
+    }
+
+    /** Assign the stream of the loss, jitter and reorder draws; returns streams used */
+    int64_t AssignStreams(int64_t stream) {
+        m_random->SetStream(stream);
+        return 1;
+    }
+
+    /** Device side */
+    uint32_t Add(Ptr<ShapedLinkNetDevice> device) {
+        m_devices.push_back(device);
+        Learn(Mac48Address::ConvertFrom(device->GetAddress()), m_devices.size() - 1);
+        return m_devices.size() - 1;
+    }
+
+    /**
+     * Device side: frame leaves device from at departNs. False if it is
+     * lost on the way
+     */
+    bool Transmit(uint32_t from, Ptr<Packet> packet, uint16_t protocol, Mac48Address src, Mac48Address dst,
+                  int64_t departNs) {
+        Learn(src, from);
+        if (m_loss > 0 && m_random->GetValue() < m_loss) {
+            return false;
+        }
+        int64_t arrival = departNs + m_delay.GetNanoSeconds();
+        if (!m_jitter.IsZero()) {
+            int64_t j = m_jitter.GetNanoSeconds();
+            arrival = std::max(departNs, arrival + static_cast<int64_t>(m_random->GetValue(-j, j)));
+        }
+        if (m_reorder > 0 && m_random->GetValue() < m_reorder) {
+            arrival += m_reorderDelay.GetNanoSeconds();
+        }
+        Insert({packet, protocol, src, dst, from}, arrival);
+        return true;
+    }
+
+    uint64_t GetEvents() const { return m_events.load(std::memory_order_relaxed); }
+    uint64_t GetDelivered() const { return m_delivered.load(std::memory_order_relaxed); }
+
+    /** Final statistics, one line per device */
+    void Print(std::ostream &os) const {
+        os << "Shaped link: " << GetDelivered() << " frames delivered in " << GetEvents() << " events\n";
+        for (const Ptr<ShapedLinkNetDevice> &dev : m_devices) {
+            const ShapedLinkNetDevice::Stats &s = dev->GetStats();
+            os << "  node " << dev->GetNode()->GetId() << ": tx=" << ShapedLinkNetDevice::Load(s.txFrames)
+               << " pkts/" << ShapedLinkNetDevice::Load(s.txBytes)
+               << " bytes rx=" << ShapedLinkNetDevice::Load(s.rxFrames) << " pkts/"
+               << ShapedLinkNetDevice::Load(s.rxBytes)
+               << " bytes queue_drops=" << ShapedLinkNetDevice::Load(s.queueDrops)
+               << " lost=" << ShapedLinkNetDevice::Load(s.lost) << "\n";
+        }
+    }
+
+    /**
+     * Export t4_link_frames{node,dir}, t4_link_bytes{node,dir},
+     * t4_link_drops{node,reason} and t4_link_events
+     */
+    void AddCollector(MetricsExporter &metrics) const {
+        metrics.AddCollector([this](std::vector<MetricsExporter::Sample> &out) {
+            for (const Ptr<ShapedLinkNetDevice> &dev : m_devices) {
+                const ShapedLinkNetDevice::Stats &s = dev->GetStats();
+                std::string node = std::to_string(dev->GetNode()->GetId());
+                out.push_back({"t4_link_frames", {{"node", node}, {"dir", "tx"}},
+                               static_cast<double>(ShapedLinkNetDevice::Load(s.txFrames))});
+                out.push_back({"t4_link_frames", {{"node", node}, {"dir", "rx"}},
+                               static_cast<double>(ShapedLinkNetDevice::Load(s.rxFrames))});
+                out.push_back({"t4_link_bytes", {{"node", node}, {"dir", "tx"}},
+                               static_cast<double>(ShapedLinkNetDevice::Load(s.txBytes))});
+                out.push_back({"t4_link_bytes", {{"node", node}, {"dir", "rx"}},
+                               static_cast<double>(ShapedLinkNetDevice::Load(s.rxBytes))});
+                out.push_back({"t4_link_drops", {{"node", node}, {"reason", "queue"}},
+                               static_cast<double>(ShapedLinkNetDevice::Load(s.queueDrops))});
+                out.push_back({"t4_link_drops", {{"node", node}, {"reason", "loss"}},
+                               static_cast<double>(ShapedLinkNetDevice::Load(s.lost))});
+            }
+            out.push_back({"t4_link_events", {}, static_cast<double>(GetEvents())});
+        });
+    }
+
+    // Channel
+
+    std::size_t GetNDevices() const override { return m_devices.size(); }
+    Ptr<NetDevice> GetDevice(std::size_t i) const override { return m_devices[i]; }
+
+protected:
+    void DoDispose() override {
+        m_tick.Cancel();
+        m_devices.clear();
+        m_slots.clear();
+        m_far.clear();
+        Channel::DoDispose();
+    }
+
+private:
+    struct Frame {
+        Ptr<Packet> packet;
+        uint16_t protocol;
+        Mac48Address src;
+        Mac48Address dst;
+        uint32_t from;
+    };
+
+    static uint64_t Key(Mac48Address mac) {
+        uint8_t b[6];
+        mac.CopyTo(b);
+        uint64_t key = 0;
+        for (uint8_t byte : b) {
+            key = key << 8 | byte;
+        }
+        return key;
+    }
+
+    void Learn(Mac48Address src, uint32_t device) {
+        if (!src.IsGroup()) {
+            m_owner[Key(src)] = device;
+        }
+    }
+
+    /**
+     * Put frame into the slot of arrivalNs, growing the wheel up to
+     * MaxSlots() if it is too far out, and into m_far beyond that
+     */
+    void Insert(Frame frame, int64_t arrivalNs) {
+        int64_t res = m_resolution.GetNanoSeconds();
+        if (m_pending == 0) {
+            // Idle wheel: start at the present instead of spanning the idle gap
+            m_cursor = std::max(m_cursor, Simulator::Now().GetNanoSeconds() / res);
+        }
+        int64_t slot = std::max((arrivalNs + res - 1) / res, m_cursor);
+        while (slot - m_cursor >= static_cast<int64_t>(m_slots.size()) && m_slots.size() < MaxSlots()) {
+            Grow();
+        }
+        PullFar();
+        if (slot - m_cursor < static_cast<int64_t>(m_slots.size())) {
+            m_slots[slot & m_mask].push_back(frame);
+        } else {
+            m_far.emplace(slot, frame);
+        }
+        m_pending++;
+        if (!m_tick.IsRunning() || slot < m_tickSlot) {
+            ScheduleTick(slot);
+        }
+    }
+
+    /**
+     * Wheel size that holds every frame the channel itself delays. With
+     * frames pending, the cursor trails the present by at most one such
+     * span, hence twice
+     */
+    size_t MaxSlots() const {
+        int64_t span = m_delay.GetNanoSeconds() + m_jitter.GetNanoSeconds() + m_reorderDelay.GetNanoSeconds();
+        size_t slots = 2 * static_cast<size_t>(span / m_resolution.GetNanoSeconds() + 1);
+        size_t size = 1024;
+        while (size < slots) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    /** Move the frames of m_far that the wheel now reaches into their slots */
+    void PullFar() {
+        while (!m_far.empty() && m_far.begin()->first - m_cursor < static_cast<int64_t>(m_slots.size())) {
+            m_slots[m_far.begin()->first & m_mask].push_back(m_far.begin()->second);
+            m_far.erase(m_far.begin());
+        }
+    }
+
+    void Grow() {
+        std::vector<std::vector<Frame>> old(m_slots.size() * 2);
+        old.swap(m_slots);
+        m_mask = m_slots.size() - 1;
+        // Old slot i holds the frames of the one absolute slot in [cursor, cursor + old size) that maps to it
+        int64_t oldSize = static_cast<int64_t>(old.size());
+        for (int64_t s = m_cursor; s < m_cursor + oldSize; s++) {
+            std::vector<Frame> &frames = old[s & (oldSize - 1)];
+            if (!frames.empty()) {
+                m_slots[s & m_mask].swap(frames);
+            }
+        }
+    }
+
+    void ScheduleTick(int64_t slot) {
+        m_tick.Cancel();
+        m_tickSlot = slot;
+        Time at = NanoSeconds(slot * m_resolution.GetNanoSeconds());
+        Time now = Simulator::Now();
+        m_tick = Simulator::Schedule(at > now ? at - now : Seconds(0), &ShapedLinkChannel::Tick, this);
+    }
+
+    /** Deliver up to BatchSize frames of the current slot, then schedule the next busy slot */
+    void Tick() {
+        m_events.store(m_events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_cursor = m_tickSlot;
+        PullFar();
+        uint32_t n = 0;
+        // Receivers may send (ARP replies): frames without delay are appended
+        // to this slot, and the wheel may grow, so look the slot up each time
+        while (m_slotPos < m_slots[m_cursor & m_mask].size() && n < m_batchSize) {
+            Frame frame = m_slots[m_cursor & m_mask][m_slotPos++];
+            Deliver(frame);
+            n++;
+        }
+        std::vector<Frame> &slot = m_slots[m_cursor & m_mask];
+        m_pending -= n;
+        m_delivered.store(m_delivered.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        if (m_slotPos < slot.size()) {
+            ScheduleTick(m_cursor);
+            return;
+        }
+        slot.clear();
+        m_slotPos = 0;
+        m_cursor++;
+        if (m_pending == 0) {
+            return;
+        }
+        PullFar();
+        int64_t next = m_cursor;
+        int64_t end = m_cursor + static_cast<int64_t>(m_slots.size());
+        while (next < end && m_slots[next & m_mask].empty()) {
+            next++;
+        }
+        ScheduleTick(next < end ? next : m_far.begin()->first);
+    }
+
+    void Deliver(const Frame &frame) {
+        if (!frame.dst.IsGroup()) {
+            auto it = m_owner.find(Key(frame.dst));
+            if (it != m_owner.end()) {
+                if (it->second != frame.from) {
+                    m_devices[it->second]->Receive(frame.packet, frame.protocol, frame.src, frame.dst);
+                }
+                return;
+            }
+        }
+        for (uint32_t i = 0; i < m_devices.size(); i++) {
+            if (i != frame.from) {
+                m_devices[i]->Receive(frame.packet->Copy(), frame.protocol, frame.src, frame.dst);
+            }
+        }
+    }
+
+    Time m_delay;
+    Time m_jitter;
+    double m_loss = 0;
+    double m_reorder = 0;
+    Time m_reorderDelay;
+    Time m_resolution;
+    uint32_t m_batchSize = 256;
+    Ptr<UniformRandomVariable> m_random;
+
+    std::vector<Ptr<ShapedLinkNetDevice>> m_devices;
+    std::unordered_map<uint64_t, uint32_t> m_owner;
+
+    // Timing wheel: slot s (absolute, s * Resolution) lives at m_slots[s & m_mask]
+    std::vector<std::vector<Frame>> m_slots;
+    uint64_t m_mask = 0;
+    int64_t m_cursor = 0;
+    // Frames beyond the wheel's reach, by slot (insertion order within a slot)
+    std::multimap<int64_t, Frame> m_far;
+    size_t m_slotPos = 0;
+    uint64_t m_pending = 0;
+    EventId m_tick;
+    int64_t m_tickSlot = 0;
+
+    std::atomic<uint64_t> m_events{0};
+    std::atomic<uint64_t> m_delivered{0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ShapedLinkChannel);
+
+NS_OBJECT_ENSURE_REGISTERED(ShapedLinkNetDevice);
+
+inline TypeId ShapedLinkNetDevice::GetTypeId() {
+    static TypeId tid =
+        TypeId("ns3::ShapedLinkNetDevice")
+            .SetParent<NetDevice>()
+            .SetGroupName("Network")
+            .AddConstructor<ShapedLinkNetDevice>()
+            .AddAttribute("DataRate", "Egress rate of the token bucket", DataRateValue(DataRate("1Gbps")),
+                          MakeDataRateAccessor(&ShapedLinkNetDevice::m_rate), MakeDataRateChecker())
+            .AddAttribute("Burst", "Bytes sent at once before DataRate applies", UintegerValue(64 * 1024),
+                          MakeUintegerAccessor(&ShapedLinkNetDevice::m_burst), MakeUintegerChecker<uint32_t>())
+            .AddAttribute("QueueBytes", "Bytes waiting for the token bucket before frames are dropped",
+                          UintegerValue(512 * 1024), MakeUintegerAccessor(&ShapedLinkNetDevice::m_queueBytes),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("Mtu", "Largest payload", UintegerValue(1500),
+                          MakeUintegerAccessor(&ShapedLinkNetDevice::m_mtu), MakeUintegerChecker<uint16_t>())
+            .AddAttribute("Address", "MAC address of the device", Mac48AddressValue(Mac48Address("ff:ff:ff:ff:ff:ff")),
+                          MakeMac48AddressAccessor(&ShapedLinkNetDevice::m_address), MakeMac48AddressChecker())
+            .AddTraceSource("MacTx", "A frame is accepted for transmission",
+                            MakeTraceSourceAccessor(&ShapedLinkNetDevice::m_macTxTrace),
+                            "ns3::Packet::TracedCallback")
+            .AddTraceSource("MacTxDrop", "A frame is dropped because the queue is full",
+                            MakeTraceSourceAccessor(&ShapedLinkNetDevice::m_macTxDropTrace),
+                            "ns3::Packet::TracedCallback")
+            .AddTraceSource("MacRx", "A frame is received by this device",
+                            MakeTraceSourceAccessor(&ShapedLinkNetDevice::m_macRxTrace),
+                            "ns3::Packet::TracedCallback")
+            .AddTraceSource("PromiscSniffer", "Ethernet frames sent and received, for packet capture",
+                            MakeTraceSourceAccessor(&ShapedLinkNetDevice::m_snifferTrace),
+                            "ns3::Packet::TracedCallback");
+    return tid;
+}
+
+inline void ShapedLinkNetDevice::Attach(Ptr<ShapedLinkChannel> channel) {
+    m_channel = channel;
+    m_port = channel->Add(this);
+}
+
+inline Ptr<Channel> ShapedLinkNetDevice::GetChannel() const { return m_channel; }
+
+inline bool ShapedLinkNetDevice::SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest,
+                                          uint16_t protocolNumber) {
+    if (!m_channel || packet->GetSize() > m_mtu) {
+        return false;
+    }
+    Mac48Address src = Mac48Address::ConvertFrom(source);
+    Mac48Address dst = Mac48Address::ConvertFrom(dest);
+    uint32_t bytes = packet->GetSize() + kEthernetHeader;
+
+    // Token bucket in virtual time: credit for up to Burst bytes accrues while idle
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    int64_t start = std::max(m_nextFree, now - m_rate.CalculateBytesTxTime(m_burst).GetNanoSeconds());
+    int64_t depart = start + m_rate.CalculateBytesTxTime(bytes).GetNanoSeconds();
+    if (depart - now > m_rate.CalculateBytesTxTime(m_queueBytes).GetNanoSeconds()) {
+        Bump(m_stats.queueDrops);
+        m_macTxDropTrace(packet);
+        return false;
+    }
+    m_nextFree = depart;
+
+    m_macTxTrace(packet);
+    Sniff(packet, protocolNumber, src, dst);
+    Bump(m_stats.txFrames);
+    Bump(m_stats.txBytes, bytes);
+    if (!m_channel->Transmit(m_port, packet, protocolNumber, src, dst, std::max(depart, now))) {
+        Bump(m_stats.lost);
+    }
+    return true;
+}
+
+inline void ShapedLinkNetDevice::Receive(Ptr<Packet> packet, uint16_t protocol, Mac48Address src,
+                                         Mac48Address dst) {
+    PacketType type = dst == m_address       ? PACKET_HOST
+                      : dst.IsBroadcast()    ? PACKET_BROADCAST
+                      : dst.IsGroup()        ? PACKET_MULTICAST
+                                             : PACKET_OTHERHOST;
+    Bump(m_stats.rxFrames);
+    Bump(m_stats.rxBytes, packet->GetSize() + kEthernetHeader);
+    m_macRxTrace(packet);
+    Sniff(packet, protocol, src, dst);
+    if (!m_promiscRxCallback.IsNull()) {
+        m_promiscRxCallback(this, packet, protocol, src, dst, type);
+    }
+    if (type != PACKET_OTHERHOST) {
+        m_rxCallback(this, packet, protocol, src);
+    }
+}
+
+/**
+ * Creates one ShapedLinkChannel and a ShapedLinkNetDevice on each node,
+ * like CsmaHelper
+ */
+class ShapedLinkHelper {
+public:
+    ShapedLinkHelper() {
+        m_channelFactory.SetTypeId("ns3::ShapedLinkChannel");
+        m_deviceFactory.SetTypeId("ns3::ShapedLinkNetDevice");
+    }
+
+    void SetChannelAttribute(const std::string &name, const AttributeValue &value) {
+        m_channelFactory.Set(name, value);
+    }
+
+    void SetDeviceAttribute(const std::string &name, const AttributeValue &value) {
+        m_deviceFactory.Set(name, value);
+    }
+
+    NetDeviceContainer Install(const NodeContainer &nodes) {
+        Ptr<ShapedLinkChannel> channel = m_channelFactory.Create<ShapedLinkChannel>();
+        NetDeviceContainer devices;
+        for (uint32_t i = 0; i < nodes.GetN(); i++) {
+            Ptr<ShapedLinkNetDevice> device = m_deviceFactory.Create<ShapedLinkNetDevice>();
+            device->SetAddress(Mac48Address::Allocate());
+            nodes.Get(i)->AddDevice(device);
+            device->Attach(channel);
+            devices.Add(device);
+        }
+        return devices;
+    }
+
+private:
+    ObjectFactory m_channelFactory;
+    ObjectFactory m_deviceFactory;
+};
+
+} // namespace ns3
+
+#endif /* SHAPED_LINK_H */
@@ -0,0 +1,449 @@
+/*
+ * Frame path benchmark: shared-memory bridge vs TAP bridge
+ *
+ * Measures the two ways a frame can travel between a container and the
+ * simulator process, without the simulator itself:
+ *
+ *   shm  shm-shim side (child)  <-> region rings <-> ShmBridge side (parent),
+ *        with the same spin-then-doorbell waits as shm-bridge.h
+ *   tap  container eth0 (child, AF_PACKET on a veth) <-> veth peer <->
+ *        Linux bridge <-> TAP device <-> TapBridge side (parent, one
+ *        read()/write() per frame), as tap-4node-setup.sh wires it
+ *
+ * Two tests per path:
+ *   stream  the child sends --frames frames as fast as it can; the parent
+ *           counts what arrives. Reports delivered pps and losses.
+ *   ping    the parent sends one frame, the child echoes it back; repeated
+ *           --pings times. Reports the round-trip time percentiles.
+ *
+ * The tap path creates t4b-br, t4b-tap and the t4b-veth0/1 pair for the
+ * run and needs root.
+ *
+ * Usage: shm-bench [--path=shm|tap|both] [--frames=1000000] [--size=128]
+ *                  [--pings=20000] [--spinUs=50]
+ */
+
+#include "latency-histogram.h"
+#include "shm-ring.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/if_packet.h>
+#include <linux/if_tun.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Options {
+    std::string path = "both";
+    uint64_t frames = 1000000;
+    uint32_t size = 128;
+    uint64_t pings = 20000;
+    uint64_t spinUs = 50;
+};
+
+// Local experimental EtherType, ignored by the host stack
+static const uint16_t kEtherType = 0x88B5;
+static const uint8_t kChildMac[6] = {0x02, 0x54, 0x34, 0x00, 0x00, 0x01};
+static const uint8_t kParentMac[6] = {0x02, 0x54, 0x34, 0x00, 0x00, 0x02};
+
+static bool ParseArgs(int argc, char *argv[], Options &o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string::size_type eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            return false;
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (name == "path") {
+            o.path = value;
+        } else if (name == "frames") {
+            o.frames = std::stoull(value);
+        } else if (name == "size") {
+            o.size = std::stoul(value);
+        } else if (name == "pings") {
+            o.pings = std::stoull(value);
+        } else if (name == "spinUs") {
+            o.spinUs = std::stoull(value);
+        } else {
+            return false;
+        }
+    }
+    return (o.path == "shm" || o.path == "tap" || o.path == "both") && o.size >= 60 && o.size <= 1514;
+}
+
+/** Ethernet frame of size bytes from src to dst, sequence number after the header */
+static void Frame(uint8_t *frame, uint32_t size, const uint8_t *dst, const uint8_t *src, uint64_t seq) {
+    std::memset(frame, 0, size);
+    std::memcpy(frame, dst, 6);
+    std::memcpy(frame + 6, src, 6);
+    frame[12] = kEtherType >> 8;
+    frame[13] = kEtherType & 0xff;
+    std::memcpy(frame + 14, &seq, sizeof(seq));
+}
+
+static bool IsBenchFrame(const uint8_t *frame, ssize_t length) {
+    return length >= 22 && frame[12] == (kEtherType >> 8) && frame[13] == (kEtherType & 0xff);
+}
+
+struct Result {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t bytes = 0;
+    double seconds = 0;
+    LatencyHistogram rtt;
+};
+
+static void PrintStream(const char *path, const Result &r) {
+    std::printf("%-4s stream: %10.0f pps  %8.1f Mbit/s  received %llu of %llu (%.2f%% lost)\n", path,
+                r.seconds > 0 ? r.received / r.seconds : 0.0,
+                r.seconds > 0 ? r.bytes * 8 / r.seconds / 1e6 : 0.0, static_cast<unsigned long long>(r.received),
+                static_cast<unsigned long long>(r.sent), r.sent ? 100.0 * (r.sent - r.received) / r.sent : 0.0);
+}
+
+static void PrintPing(const char *path, const Result &r) {
+    LatencyHistogram::Snapshot s = r.rtt.Read();
+    std::printf("%-4s ping:   rtt p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus (%llu pings, %llu lost)\n", path,
+                s.Percentile(0.5) / 1e3, s.Percentile(0.99) / 1e3, s.Percentile(0.999) / 1e3, s.max / 1e3,
+                static_cast<unsigned long long>(s.count), static_cast<unsigned long long>(r.sent - r.received));
+}
+
+/** Child's count of frames it managed to send, through a pipe */
+static uint64_t ReadCount(int fd) {
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+    }
+    close(fd);
+    return count;
+}
+
+// Shared memory
+
+static bool ShmStream(const Options &o, Result &r) {
+    const std::string path = "/dev/shm/t4-shm-bench";
+    ShmRegion region;
+    if (!region.Create(path)) {
+        std::cerr << path << ": " << region.GetError() << "\n";
+        return false;
+    }
+    int pipeFd[2];
+    if (pipe(pipeFd) != 0) {
+        return false;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        // Shim side: what shm-shim does with each frame read from its TAP
+        ShmRegion shared;
+        shared.Attach(path);
+        ShmRing ring = shared.Ring(SHM_TO_SIM);
+        uint8_t frame[1514];
+        uint64_t sent = 0;
+        for (uint64_t i = 0; i < o.frames; i++) {
+            // A full ring pushes back, as the shim's blocking TAP read() would
+            Frame(frame, o.size, kParentMac, kChildMac, i);
+            while (!ring.Push(frame, o.size)) {
+                ring.Notify();
+                sched_yield();
+            }
+            ring.Notify();
+            sent++;
+        }
+        (void)!write(pipeFd[1], &sent, sizeof(sent));
+        _exit(0);
+    }
+    close(pipeFd[1]);
+
+    // Simulator side: drain batches, copying each frame out as the TAP
+    // side's read() does, so both paths pay for one copy per frame
+    ShmRing ring = region.Ring(SHM_TO_SIM);
+    uint8_t copy[2048];
+    uint64_t start = 0, last = 0;
+    bool done = false;
+    while (!done) {
+        if (!ring.Wait(o.spinUs * 1000, 200)) {
+            done = waitpid(child, nullptr, WNOHANG) == child;
+            continue;
+        }
+        ring.Drain(
+            [&](const uint8_t *frame, uint32_t length) {
+                std::memcpy(copy, frame, length);
+                if (IsBenchFrame(copy, length)) {
+                    r.received++;
+                    r.bytes += length;
+                }
+            },
+            64);
+        last = ShmRing::NowNs();
+        start = start ? start : last;
+        if (r.received >= o.frames) {
+            waitpid(child, nullptr, 0);
+            done = true;
+        }
+    }
+    r.sent = ReadCount(pipeFd[0]);
+    r.seconds = (last - start) / 1e9;
+    unlink(path.c_str());
+    return true;
+}
+
+static bool ShmPing(const Options &o, Result &r) {
+    const std::string path = "/dev/shm/t4-shm-bench";
+    ShmRegion region;
+    if (!region.Create(path)) {
+        std::cerr << path << ": " << region.GetError() << "\n";
+        return false;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        // Shim side reflector; a frame of length 0 ends it
+        ShmRegion shared;
+        shared.Attach(path);
+        ShmRing in = shared.Ring(SHM_TO_HOST);
+        ShmRing out = shared.Ring(SHM_TO_SIM);
+        bool stop = false;
+        while (!stop) {
+            if (!in.Wait(o.spinUs * 1000, 1000)) {
+                continue;
+            }
+            in.Drain(
+                [&](const uint8_t *frame, uint32_t length) {
+                    stop = stop || length == 0;
+                    if (length) {
+                        out.Push(frame, length);
+                    }
+                },
+                64);
+            out.Notify();
+        }
+        _exit(0);
+    }
+
+    ShmRing out = region.Ring(SHM_TO_HOST);
+    ShmRing in = region.Ring(SHM_TO_SIM);
+    uint8_t frame[1514];
+    uint8_t copy[2048];
+    for (uint64_t i = 0; i < o.pings; i++) {
+        Frame(frame, o.size, kChildMac, kParentMac, i);
+        uint64_t t0 = ShmRing::NowNs();
+        out.Push(frame, o.size);
+        out.Notify();
+        r.sent++;
+        if (in.Wait(o.spinUs * 1000, 1000)) {
+            in.Drain([&](const uint8_t *echo, uint32_t length) { std::memcpy(copy, echo, length); }, 64);
+            r.rtt.Record(ShmRing::NowNs() - t0);
+            r.received++;
+        }
+    }
+    out.Push(frame, 0);
+    out.Notify();
+    waitpid(child, nullptr, 0);
+    unlink(path.c_str());
+    return true;
+}
+
+// TAP
+
+static bool Run(const std::string &command) { return std::system((command + " >/dev/null 2>&1").c_str()) == 0; }
+
+static void TapTeardown() {
+    Run("ip link delete t4b-veth0");
+    Run("ip link delete t4b-tap");
+    Run("ip link delete t4b-br");
+}
+
+/** The TAP device opened as TapBridge does, bridged to a veth like a container's */
+static int TapSetup() {
+    TapTeardown();
+    int fd = open("/dev/net/tun", O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        std::perror("/dev/net/tun");
+        return -1;
+    }
+    ifreq ifr = {};
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    std::strncpy(ifr.ifr_name, "t4b-tap", IFNAMSIZ - 1);
+    if (ioctl(fd, TUNSETIFF, &ifr) != 0) {
+        std::perror("TUNSETIFF");
+        close(fd);
+        return -1;
+    }
+    bool ok = Run("ip link add t4b-br type bridge") && Run("ip link add t4b-veth0 type veth peer name t4b-veth1");
+    for (const char *dev : {"t4b-br", "t4b-tap", "t4b-veth0", "t4b-veth1"}) {
+        std::string ipv6 = std::string("/proc/sys/net/ipv6/conf/") + dev + "/disable_ipv6";
+        Run(std::string("echo 1 > ") + ipv6);
+    }
+    ok = ok && Run("ip link set t4b-tap master t4b-br promisc on up") &&
+         Run("ip link set t4b-veth1 master t4b-br up") && Run("ip link set t4b-veth0 up") &&
+         Run("ip link set t4b-br up");
+    if (!ok) {
+        std::cerr << "Cannot set up the TAP path (root needed)\n";
+        close(fd);
+        TapTeardown();
+        return -1;
+    }
+    return fd;
+}
+
+/** The container's end: raw socket on t4b-veth0 for the bench EtherType */
+static int ContainerSocket() {
+    int fd = socket(AF_PACKET, SOCK_RAW, htons(kEtherType));
+    sockaddr_ll addr = {};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(kEtherType);
+    addr.sll_ifindex = if_nametoindex("t4b-veth0");
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        std::perror("AF_PACKET");
+        return -1;
+    }
+    return fd;
+}
+
+/** Read the next bench frame from fd, waiting at most timeoutMs; false on timeout */
+static bool ReadBench(int fd, uint8_t *frame, size_t size, int timeoutMs) {
+    pollfd p = {fd, POLLIN, 0};
+    while (poll(&p, 1, timeoutMs) > 0) {
+        sockaddr_ll from = {};
+        socklen_t fromLength = sizeof(from);
+        ssize_t n = recvfrom(fd, frame, size, 0, reinterpret_cast<sockaddr *>(&from), &fromLength);
+        if (n < 0 && errno == ENOTSOCK) {
+            n = read(fd, frame, size);
+        } else if (from.sll_pkttype == PACKET_OUTGOING) {
+            continue;
+        }
+        if (IsBenchFrame(frame, n)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool TapStream(const Options &o, Result &r) {
+    int tap = TapSetup();
+    if (tap < 0) {
+        return false;
+    }
+    int pipeFd[2];
+    if (pipe(pipeFd) != 0) {
+        return false;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        int sock = ContainerSocket();
+        uint8_t frame[1514];
+        uint64_t sent = 0;
+        for (uint64_t i = 0; sock >= 0 && i < o.frames; i++) {
+            Frame(frame, o.size, kParentMac, kChildMac, i);
+            if (send(sock, frame, o.size, 0) == static_cast<ssize_t>(o.size)) {
+                sent++;
+            }
+        }
+        (void)!write(pipeFd[1], &sent, sizeof(sent));
+        _exit(0);
+    }
+    close(pipeFd[1]);
+
+    // TapBridge side: one read() per frame
+    uint8_t frame[2048];
+    uint64_t start = 0, last = 0;
+    while (r.received < o.frames && ReadBench(tap, frame, sizeof(frame), 200)) {
+        r.received++;
+        r.bytes += o.size;
+        last = ShmRing::NowNs();
+        start = start ? start : last;
+    }
+    waitpid(child, nullptr, 0);
+    r.sent = ReadCount(pipeFd[0]);
+    r.seconds = (last - start) / 1e9;
+    close(tap);
+    TapTeardown();
+    return true;
+}
+
+static bool TapPing(const Options &o, Result &r) {
+    int tap = TapSetup();
+    if (tap < 0) {
+        return false;
+    }
+    int ready[2];
+    if (pipe(ready) != 0) {
+        return false;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        // Container side reflector; a frame with sequence ~0 ends it
+        int sock = ContainerSocket();
+        char ok = sock >= 0;
+        (void)!write(ready[1], &ok, 1);
+        uint8_t frame[2048];
+        while (sock >= 0 && ReadBench(sock, frame, sizeof(frame), 2000)) {
+            uint64_t seq;
+            std::memcpy(&seq, frame + 14, sizeof(seq));
+            if (seq == ~0ull) {
+                break;
+            }
+            std::memcpy(frame, kParentMac, 6);
+            std::memcpy(frame + 6, kChildMac, 6);
+            (void)!send(sock, frame, o.size, 0);
+        }
+        _exit(0);
+    }
+    char ok = 0;
+    (void)!read(ready[0], &ok, 1);
+
+    uint8_t frame[2048];
+    uint8_t echo[2048];
+    for (uint64_t i = 0; ok && i < o.pings; i++) {
+        Frame(frame, o.size, kChildMac, kParentMac, i);
+        uint64_t t0 = ShmRing::NowNs();
+        (void)!write(tap, frame, o.size);
+        r.sent++;
+        if (ReadBench(tap, echo, sizeof(echo), 1000)) {
+            r.rtt.Record(ShmRing::NowNs() - t0);
+            r.received++;
+        }
+    }
+    Frame(frame, o.size, kChildMac, kParentMac, ~0ull);
+    (void)!write(tap, frame, o.size);
+    waitpid(child, nullptr, 0);
+    close(tap);
+    TapTeardown();
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    Options o;
+    if (!ParseArgs(argc, argv, o)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--path=shm|tap|both] [--frames=N] [--size=60..1514] [--pings=N] [--spinUs=50]\n";
+        return 2;
+    }
+    std::printf("%llu frames of %u bytes, %llu pings, spin %llu us\n", static_cast<unsigned long long>(o.frames),
+                o.size, static_cast<unsigned long long>(o.pings), static_cast<unsigned long long>(o.spinUs));
+    bool ok = true;
+    if (o.path != "tap") {
+        Result stream, ping;
+        ok = ShmStream(o, stream) && ShmPing(o, ping) && ok;
+        PrintStream("shm", stream);
+        PrintPing("shm", ping);
+    }
+    if (o.path != "shm") {
+        Result stream, ping;
+        ok = TapStream(o, stream) && TapPing(o, ping) && ok;
+        PrintStream("tap", stream);
+        PrintPing("tap", ping);
+    }
+    return ok ? 0 : 1;
+}
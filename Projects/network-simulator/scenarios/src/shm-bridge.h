@@ -0,0 +1,269 @@
+/*
+ * Shared-memory alternative to TapBridge (UseLocal mode)
+ *
+ * TapBridge moves every frame through the container's veth, a Linux
+ * bridge and a TAP device, then read() into a buffer and one simulator
+ * event per frame. ShmBridge exchanges Ethernet frames with shm-shim in
+ * the container through a region of shm-ring.h instead:
+ *
+ *   container stack <-> shim TAP <-> shm-shim <-> rings <-> ShmBridge <-> WifiNetDevice
+ *
+ * From the container: a helper thread sleeps on the to-sim doorbell and,
+ * when frames arrive, schedules one event on the node; that event copies
+ * up to BatchSize frames straight from their slots into Packets and sends
+ * them on the bridged device. The thread only waits again once the batch
+ * is drained, so the ring is only ever consumed on the simulator thread.
+ * To the container: frames the bridged device receives are written into
+ * the next to-host slot; the shim is only woken if it went to sleep.
+ *
+ * Like UseLocal, the bridged device keeps its MAC and sends with Send();
+ * the container's MAC is learned from its first frame and frames for the
+ * device are rewritten to it.
+ */
+
+#ifndef SHM_BRIDGE_H
+#define SHM_BRIDGE_H
+
+#include "shm-ring.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ns3 {
+
+class ShmBridge : public NetDevice {
+public:
+    static TypeId GetTypeId() {
+        static TypeId tid =
+            TypeId("ns3::ShmBridge")
+                .SetParent<NetDevice>()
+                .SetGroupName("TapBridge")
+                .AddConstructor<ShmBridge>()
+                .AddAttribute("Path", "Region file shared with shm-shim", StringValue(""),
+                              MakeStringAccessor(&ShmBridge::m_path), MakeStringChecker())
+                .AddAttribute("Slots", "Frames per ring (power of two)", UintegerValue(ShmRegion::kDefaultSlots),
+                              MakeUintegerAccessor(&ShmBridge::m_slots), MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("BatchSize", "Most frames from the container handled per event", UintegerValue(64),
+                              MakeUintegerAccessor(&ShmBridge::m_batchSize), MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("SpinTime", "Busy-poll the ring this long before sleeping on the doorbell",
+                              TimeValue(MicroSeconds(50)), MakeTimeAccessor(&ShmBridge::m_spin),
+                              MakeTimeChecker());
+        return tid;
+    }
+
+    ~ShmBridge() override { Stop(); }
+
+    /** Take over device: its frames go to the container, the container's are sent on it */
+    void SetBridgedNetDevice(Ptr<NetDevice> device) {
+        m_device = device;
+        m_node->RegisterProtocolHandler(MakeCallback(&ShmBridge::ReceiveFromBridgedDevice, this), 0, device,
+                                        true);
+        // As TapBridge: the node's own stack no longer sees the bridged device
+        device->SetReceiveCallback(MakeCallback(&ShmBridge::DiscardFromBridgedDevice, this));
+    }
+
+    Ptr<NetDevice> GetBridgedNetDevice() const { return m_device; }
+
+    /** Frames from / to the container, and frames lost because the to-host ring was full */
+    void Print(std::ostream &os) const {
+        os << "  node " << m_node->GetId() << " (" << m_path << "): in=" << m_framesIn << " out=" << m_framesOut
+           << " full=" << m_dropsFull << " events=" << m_events << " doorbells=" << m_toHost.GetRings() << "\n";
+    }
+
+    uint64_t GetFramesIn() const { return m_framesIn; }
+    uint64_t GetFramesOut() const { return m_framesOut; }
+
+    // NetDevice: the bridge itself carries no traffic of the node
+
+    void SetIfIndex(const uint32_t index) override { m_ifIndex = index; }
+    uint32_t GetIfIndex() const override { return m_ifIndex; }
+    Ptr<Channel> GetChannel() const override { return nullptr; }
+    void SetAddress(Address address) override { m_address = Mac48Address::ConvertFrom(address); }
+    Address GetAddress() const override { return m_address; }
+    bool SetMtu(const uint16_t mtu) override {
+        m_mtu = mtu;
+        return true;
+    }
+    uint16_t GetMtu() const override { return m_mtu; }
+    bool IsLinkUp() const override { return true; }
+    void AddLinkChangeCallback(Callback<void> callback) override {}
+    bool IsBroadcast() const override { return true; }
+    Address GetBroadcast() const override { return Mac48Address::GetBroadcast(); }
+    bool IsMulticast() const override { return true; }
+    Address GetMulticast(Ipv4Address group) const override { return Mac48Address::GetMulticast(group); }
+    Address GetMulticast(Ipv6Address group) const override { return Mac48Address::GetMulticast(group); }
+    bool IsBridge() const override { return true; }
+    bool IsPointToPoint() const override { return false; }
+    bool Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber) override { return false; }
+    bool SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest,
+                  uint16_t protocolNumber) override {
+        return false;
+    }
+    Ptr<Node> GetNode() const override { return m_node; }
+    void SetNode(Ptr<Node> node) override { m_node = node; }
+    bool NeedsArp() const override { return true; }
+    void SetReceiveCallback(ReceiveCallback cb) override {}
+    void SetPromiscReceiveCallback(PromiscReceiveCallback cb) override {}
+    bool SupportsSendFrom() const override { return false; }
+
+protected:
+    void DoInitialize() override {
+        if (!m_region.Create(m_path, m_slots)) {
+            NS_FATAL_ERROR("ShmBridge: " << m_path << ": " << m_region.GetError());
+        }
+        m_toSim = m_region.Ring(SHM_TO_SIM);
+        m_toHost = m_region.Ring(SHM_TO_HOST);
+        m_stop = false;
+        m_thread = std::thread(&ShmBridge::WaitLoop, this);
+        NetDevice::DoInitialize();
+    }
+
+    void DoDispose() override {
+        Stop();
+        m_device = nullptr;
+        m_node = nullptr;
+        NetDevice::DoDispose();
+    }
+
+private:
+    static const uint32_t kEthernetHeader = 14;
+
+    void Stop() {
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_drained.notify_one();
+            m_toSim.Wake();
+            m_thread.join();
+        }
+    }
+
+    /** Helper thread: one event per burst from the container */
+    void WaitLoop() {
+        uint64_t spinNs = m_spin.GetNanoSeconds();
+        uint32_t context = m_node->GetId();
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            if (!m_toSim.Wait(spinNs, 100)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_scheduled = true;
+            Simulator::ScheduleWithContext(context, Seconds(0), &ShmBridge::DrainToSim, this);
+            m_drained.wait(lock, [this] { return !m_scheduled || m_stop.load(std::memory_order_relaxed); });
+        }
+    }
+
+    /** Simulator thread: send a batch of container frames on the bridged device */
+    void DrainToSim() {
+        m_events++;
+        m_toSim.Drain(
+            [this](const uint8_t *frame, uint32_t length) {
+                if (length < kEthernetHeader) {
+                    return;
+                }
+                Mac48Address dst, src;
+                dst.CopyFrom(frame);
+                src.CopyFrom(frame + 6);
+                uint16_t protocol = static_cast<uint16_t>(frame[12] << 8 | frame[13]);
+                if (protocol < 0x600) {
+                    return; // 802.3 length field: not Ethernet II, TapBridge drops these too
+                }
+                if (!m_learned) {
+                    m_containerMac = src;
+                    m_learned = true;
+                }
+                Ptr<Packet> packet = Create<Packet>(frame + kEthernetHeader, length - kEthernetHeader);
+                m_framesIn++;
+                m_device->Send(packet, dst, protocol);
+            },
+            m_batchSize);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_scheduled = false;
+        }
+        m_drained.notify_one();
+    }
+
+    bool ReceiveFromBridgedDevice(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                  const Address &src, const Address &dst, PacketType packetType) {
+        if (packetType == PACKET_OTHERHOST || !m_learned) {
+            return true;
+        }
+        uint32_t size = packet->GetSize();
+        uint8_t *slot = size + kEthernetHeader <= m_toHost.GetMtu() ? m_toHost.Reserve() : nullptr;
+        if (!slot) {
+            m_dropsFull++;
+            return true;
+        }
+        Mac48Address to = packetType == PACKET_HOST ? m_containerMac : Mac48Address::ConvertFrom(dst);
+        to.CopyTo(slot);
+        Mac48Address::ConvertFrom(src).CopyTo(slot + 6);
+        slot[12] = static_cast<uint8_t>(protocol >> 8);
+        slot[13] = static_cast<uint8_t>(protocol);
+        packet->CopyData(slot + kEthernetHeader, size);
+        m_toHost.Commit(size + kEthernetHeader);
+        m_toHost.Notify();
+        m_framesOut++;
+        return true;
+    }
+
+    bool DiscardFromBridgedDevice(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                  const Address &src) {
+        return true;
+    }
+
+    std::string m_path;
+    uint32_t m_slots = ShmRegion::kDefaultSlots;
+    uint32_t m_batchSize = 64;
+    Time m_spin;
+
+    Ptr<NetDevice> m_device;
+    Ptr<Node> m_node;
+    uint32_t m_ifIndex = 0;
+    Mac48Address m_address;
+    uint16_t m_mtu = 1500;
+
+    ShmRegion m_region;
+    ShmRing m_toSim;
+    ShmRing m_toHost;
+    bool m_learned = false;
+    Mac48Address m_containerMac;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_drained;
+    bool m_scheduled = false;
+    std::atomic<bool> m_stop{false};
+
+    uint64_t m_framesIn = 0;
+    uint64_t m_framesOut = 0;
+    uint64_t m_dropsFull = 0;
+    uint64_t m_events = 0;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ShmBridge);
+
+/**
+ * Bridge device to the container through region path, as
+ * TapBridgeHelper::Install(node, device) does with a TAP device
+ */
+inline Ptr<ShmBridge> InstallShmBridge(Ptr<Node> node, Ptr<NetDevice> device, const std::string &path) {
+    Ptr<ShmBridge> bridge = CreateObject<ShmBridge>();
+    bridge->SetAttribute("Path", StringValue(path));
+    node->AddDevice(bridge);
+    bridge->SetBridgedNetDevice(device);
+    return bridge;
+}
+
+} // namespace ns3
+
+#endif /* SHM_BRIDGE_H */
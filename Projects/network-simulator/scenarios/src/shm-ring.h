@@ -0,0 +1,363 @@
+/*
+ * Shared-memory frame rings between the simulator and a container
+ *
+ * One region per bridged node, a file in a tmpfs directory mapped by both
+ * sides (ShmBridge in the simulator, shm-shim in the container). It holds
+ * two single-producer single-consumer rings of fixed-size slots:
+ *
+ *   header (64) | ring control to-sim | ring control to-host |
+ *   to-sim slots | to-host slots
+ *
+ * A slot is a u32 frame length followed by the Ethernet frame. Producers
+ * write the frame straight into the slot, then publish it by advancing
+ * head; consumers read it in place and advance tail. Nothing is locked and
+ * no system call is made while the consumer is busy.
+ *
+ * Doorbells are futexes in the shared control block. A consumer that finds
+ * its ring empty spins for a while, then sets `sleeping` and waits on the
+ * doorbell. A producer only rings (increments the doorbell and calls
+ * FUTEX_WAKE) when it sees `sleeping` set, so a burst costs at most one
+ * wake-up, however many frames it carries.
+ *
+ * The simulator creates (or re-initializes) the region and bumps its epoch
+ * on every run; a shim attached to an older epoch resynchronizes its ring
+ * positions.
+ */
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char kShmRegionMagic[8] = {'T', '4', 'S', 'H', 'M', 'B', 'R', '1'};
+
+enum ShmDirection : uint32_t {
+    SHM_TO_SIM = 0,
+    SHM_TO_HOST = 1,
+};
+
+struct ShmRegionHeader {
+    char magic[8];
+    uint32_t slots;
+    uint32_t slotBytes;
+    std::atomic<uint32_t> epoch;
+    uint32_t reserved[11];
+};
+
+/** Positions and doorbell of one ring, producer and consumer fields on separate lines */
+struct ShmRingControl {
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    alignas(64) std::atomic<uint32_t> doorbell;
+    std::atomic<uint32_t> sleeping;
+    std::atomic<uint64_t> rings;
+};
+
+static_assert(sizeof(ShmRegionHeader) == 64, "ShmRegionHeader layout");
+static_assert(sizeof(ShmRingControl) == 192, "ShmRingControl layout");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared atomics must be lock free");
+
+/**
+ * One direction of a region, as seen by one process. Only one thread may
+ * produce and only one may consume.
+ */
+class ShmRing {
+public:
+    ShmRing() = default;
+
+    ShmRing(ShmRingControl *control, uint8_t *slots, uint32_t count, uint32_t slotBytes)
+        : m_control(control), m_slots(slots), m_mask(count - 1), m_slotBytes(slotBytes) {
+        Resync();
+    }
+
+    /** Largest frame a slot holds */
+    uint32_t GetMtu() const { return m_slotBytes - sizeof(uint32_t); }
+
+    /** Pick up the shared positions again (after the other side re-initialized the region) */
+    void Resync() {
+        m_head = m_control->head.load(std::memory_order_acquire);
+        m_tail = m_control->tail.load(std::memory_order_acquire);
+    }
+
+    // Producer
+
+    /** Slot for the next frame, or nullptr if the ring is full */
+    uint8_t *Reserve() {
+        if (m_head - m_tail > m_mask) {
+            m_tail = m_control->tail.load(std::memory_order_acquire);
+            if (m_head - m_tail > m_mask) {
+                return nullptr;
+            }
+        }
+        return Slot(m_head) + sizeof(uint32_t);
+    }
+
+    /** Publish the frame written into the reserved slot */
+    void Commit(uint32_t length) {
+        std::memcpy(Slot(m_head), &length, sizeof(length));
+        m_control->head.store(++m_head, std::memory_order_release);
+    }
+
+    bool Push(const void *frame, uint32_t length) {
+        uint8_t *slot = length <= GetMtu() ? Reserve() : nullptr;
+        if (!slot) {
+            return false;
+        }
+        std::memcpy(slot, frame, length);
+        Commit(length);
+        return true;
+    }
+
+    /** Ring the doorbell if the consumer went to sleep; call after a batch of Commit() */
+    void Notify() {
+        // Pairs with the fence in Wait(): either we see it asleep or it sees our head
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_control->sleeping.load(std::memory_order_relaxed)) {
+            Wake();
+        }
+    }
+
+    /** Unconditional wake-up, e.g. to stop a consumer thread */
+    void Wake() {
+        m_control->doorbell.fetch_add(1, std::memory_order_release);
+        m_control->rings.fetch_add(1, std::memory_order_relaxed);
+        syscall(SYS_futex, &m_control->doorbell, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+
+    // Consumer
+
+    /** Next frame in place, or nullptr if the ring is empty */
+    const uint8_t *Front(uint32_t &length) {
+        if (m_tail == m_head) {
+            m_head = m_control->head.load(std::memory_order_acquire);
+            if (m_tail == m_head) {
+                return nullptr;
+            }
+        }
+        const uint8_t *slot = Slot(m_tail);
+        std::memcpy(&length, slot, sizeof(length));
+        length = length <= GetMtu() ? length : GetMtu();
+        return slot + sizeof(uint32_t);
+    }
+
+    void Pop() { m_control->tail.store(++m_tail, std::memory_order_release); }
+
+    /** Hand up to max frames to fn(const uint8_t *, uint32_t); returns how many */
+    template <typename F>
+    uint32_t Drain(F fn, uint32_t max) {
+        uint32_t n = 0;
+        uint32_t length;
+        const uint8_t *frame;
+        while (n < max && (frame = Front(length))) {
+            fn(frame, length);
+            m_tail++;
+            n++;
+        }
+        if (n) {
+            m_control->tail.store(m_tail, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /**
+     * Wait until the ring has a frame: spin for spinNs, then sleep on the
+     * doorbell for at most timeoutMs. False on timeout or Wake() without data.
+     */
+    bool Wait(uint64_t spinNs, int timeoutMs) {
+        uint32_t length;
+        if (Front(length)) {
+            return true;
+        }
+        uint64_t deadline = NowNs() + spinNs;
+        while (spinNs && NowNs() < deadline) {
+            if (Front(length)) {
+                return true;
+            }
+            CpuRelax();
+        }
+        uint32_t bell = m_control->doorbell.load(std::memory_order_acquire);
+        m_control->sleeping.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!Front(length)) {
+            timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+            syscall(SYS_futex, &m_control->doorbell, FUTEX_WAIT, bell, timeoutMs >= 0 ? &timeout : nullptr,
+                    nullptr, 0);
+        }
+        m_control->sleeping.store(0, std::memory_order_relaxed);
+        return Front(length) != nullptr;
+    }
+
+    /** Doorbells rung so far (producer wake-ups that made a system call) */
+    uint64_t GetRings() const { return m_control->rings.load(std::memory_order_relaxed); }
+
+    /** Frames waiting */
+    uint32_t GetDepth() const {
+        return m_control->head.load(std::memory_order_relaxed) - m_control->tail.load(std::memory_order_relaxed);
+    }
+
+    static uint64_t NowNs() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+    }
+
+private:
+    static void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    uint8_t *Slot(uint32_t index) const { return m_slots + static_cast<size_t>(index & m_mask) * m_slotBytes; }
+
+    ShmRingControl *m_control = nullptr;
+    uint8_t *m_slots = nullptr;
+    uint32_t m_mask = 0;
+    uint32_t m_slotBytes = 0;
+    uint32_t m_head = 0;
+    uint32_t m_tail = 0;
+};
+
+/**
+ * Mapping of a region file
+ */
+class ShmRegion {
+public:
+    static const uint32_t kDefaultSlots = 1024;
+    static const uint32_t kDefaultSlotBytes = 2048;
+
+    ShmRegion() = default;
+    ShmRegion(const ShmRegion &) = delete;
+    ShmRegion &operator=(const ShmRegion &) = delete;
+
+    ~ShmRegion() {
+        if (m_base) {
+            munmap(m_base, m_size);
+        }
+    }
+
+    /** Simulator side: create path (or reuse it) with empty rings and a new epoch */
+    bool Create(const std::string &path, uint32_t slots = kDefaultSlots, uint32_t slotBytes = kDefaultSlotBytes) {
+        if (slots == 0 || (slots & (slots - 1)) != 0 || slotBytes < 64 || slotBytes % 64 != 0) {
+            m_error = "slots must be a power of two and slotBytes a multiple of 64";
+            return false;
+        }
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        if (fd < 0) {
+            m_error = std::string("cannot open: ") + std::strerror(errno);
+            return false;
+        }
+        size_t size = Size(slots, slotBytes);
+        struct stat st;
+        uint32_t epoch = 0;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == size) {
+            // Same geometry: keep the inode so an attached shim sees the new epoch
+            if (!Map(fd, size)) {
+                close(fd);
+                return false;
+            }
+            if (std::memcmp(Header()->magic, kShmRegionMagic, sizeof(kShmRegionMagic)) == 0) {
+                epoch = Header()->epoch.load(std::memory_order_relaxed);
+            }
+        } else if (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0 || !Map(fd, size)) {
+            m_error = m_error.empty() ? std::string("cannot size: ") + std::strerror(errno) : m_error;
+            close(fd);
+            return false;
+        }
+        close(fd);
+
+        ShmRegionHeader *header = Header();
+        header->slots = slots;
+        header->slotBytes = slotBytes;
+        for (uint32_t d = SHM_TO_SIM; d <= SHM_TO_HOST; d++) {
+            ShmRingControl *control = Control(d);
+            control->head.store(0, std::memory_order_relaxed);
+            control->tail.store(0, std::memory_order_relaxed);
+            control->sleeping.store(0, std::memory_order_relaxed);
+            control->rings.store(0, std::memory_order_relaxed);
+        }
+        std::memcpy(header->magic, kShmRegionMagic, sizeof(kShmRegionMagic));
+        header->epoch.store(epoch + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Container side: map a region created by the simulator */
+    bool Attach(const std::string &path) {
+        int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            m_error = std::string("cannot open: ") + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ShmRegionHeader) + 2 * sizeof(ShmRingControl))) {
+            m_error = "too short";
+            close(fd);
+            return false;
+        }
+        bool mapped = Map(fd, static_cast<size_t>(st.st_size));
+        close(fd);
+        if (!mapped) {
+            return false;
+        }
+        const ShmRegionHeader *header = Header();
+        if (std::memcmp(header->magic, kShmRegionMagic, sizeof(kShmRegionMagic)) != 0 ||
+            Size(header->slots, header->slotBytes) != m_size) {
+            m_error = "not a shared-memory bridge region";
+            return false;
+        }
+        return true;
+    }
+
+    ShmRing Ring(ShmDirection direction) {
+        ShmRegionHeader *header = Header();
+        uint8_t *slots = static_cast<uint8_t *>(m_base) + sizeof(ShmRegionHeader) + 2 * sizeof(ShmRingControl) +
+                         static_cast<size_t>(direction) * header->slots * header->slotBytes;
+        return ShmRing(Control(direction), slots, header->slots, header->slotBytes);
+    }
+
+    uint32_t GetEpoch() const { return Header()->epoch.load(std::memory_order_acquire); }
+    const std::string &GetError() const { return m_error; }
+
+    static size_t Size(uint32_t slots, uint32_t slotBytes) {
+        return sizeof(ShmRegionHeader) + 2 * sizeof(ShmRingControl) + 2 * static_cast<size_t>(slots) * slotBytes;
+    }
+
+private:
+    bool Map(int fd, size_t size) {
+        void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            m_error = std::string("mmap: ") + std::strerror(errno);
+            return false;
+        }
+        m_base = base;
+        m_size = size;
+        return true;
+    }
+
+    ShmRegionHeader *Header() const { return static_cast<ShmRegionHeader *>(m_base); }
+
+    ShmRingControl *Control(uint32_t direction) const {
+        return reinterpret_cast<ShmRingControl *>(static_cast<uint8_t *>(m_base) + sizeof(ShmRegionHeader)) +
+               direction;
+    }
+
+    void *m_base = nullptr;
+    size_t m_size = 0;
+    std::string m_error;
+};
+
+#endif /* SHM_RING_H */
@@ -0,0 +1,192 @@
+/*
+ * Container side of the shared-memory bridge (shm-bridge.h)
+ *
+ * Creates a TAP device in the container (by default eth0, with the MAC and
+ * address tap-4node-setup.sh gives the veth) and moves frames between it
+ * and the region the simulator created:
+ *   TAP -> to-sim ring   read() straight into the next slot
+ *   to-host ring -> TAP  write() straight from the slot
+ * The ring-to-TAP thread spins on the ring for --spinUs before sleeping on
+ * its doorbell. If the simulator restarts, the region gets a new epoch and
+ * the shim picks up the new ring positions.
+ *
+ * The shim waits for the region file, so it may start before the
+ * simulation. Needs CAP_NET_ADMIN and /dev/net/tun in the container.
+ *
+ * Usage: shm-shim --region=/dev/shm/t4/node-0 [--dev=eth0]
+ *                 [--mac=12:34:88:5D:61:B0] [--ip=10.0.0.1/24] [--spinUs=50]
+ */
+
+#include "shm-ring.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/if_tun.h>
+#include <net/if.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+struct Options {
+    std::string region;
+    std::string dev = "eth0";
+    std::string mac;
+    std::string ip;
+    uint64_t spinUs = 50;
+};
+
+static std::atomic<bool> g_stop{false};
+
+static void OnSignal(int) { g_stop = true; }
+
+static bool ParseArgs(int argc, char *argv[], Options &o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string::size_type eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            return false;
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (name == "region") {
+            o.region = value;
+        } else if (name == "dev") {
+            o.dev = value;
+        } else if (name == "mac") {
+            o.mac = value;
+        } else if (name == "ip") {
+            o.ip = value;
+        } else if (name == "spinUs") {
+            o.spinUs = std::stoull(value);
+        } else {
+            return false;
+        }
+    }
+    return !o.region.empty();
+}
+
+static int OpenTap(const std::string &name) {
+    int fd = open("/dev/net/tun", O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        std::perror("/dev/net/tun");
+        return -1;
+    }
+    ifreq ifr = {};
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    std::strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
+    if (ioctl(fd, TUNSETIFF, &ifr) != 0) {
+        std::perror(("TUNSETIFF " + name).c_str());
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** One-time interface setup, with the container's iproute2 */
+static bool Configure(const Options &o) {
+    std::string dev = " dev " + o.dev;
+    if (!o.mac.empty() && std::system(("ip link set" + dev + " address " + o.mac).c_str()) != 0) {
+        return false;
+    }
+    if (std::system(("ip link set" + dev + " up").c_str()) != 0) {
+        return false;
+    }
+    return o.ip.empty() || std::system(("ip addr replace " + o.ip + dev).c_str()) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    Options o;
+    if (!ParseArgs(argc, argv, o)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " --region=<file> [--dev=eth0] [--mac=xx:xx:xx:xx:xx:xx] [--ip=a.b.c.d/n] [--spinUs=50]\n";
+        return 2;
+    }
+    // No SA_RESTART: a signal must interrupt the blocking read()
+    struct sigaction action = {};
+    action.sa_handler = OnSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    int tap = OpenTap(o.dev);
+    if (tap < 0 || !Configure(o)) {
+        return 1;
+    }
+
+    ShmRegion region;
+    while (!region.Attach(o.region)) {
+        if (g_stop) {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    std::cout << o.dev << " <-> " << o.region << " (epoch " << region.GetEpoch() << ")\n";
+
+    std::atomic<uint64_t> in{0}, out{0}, full{0};
+    std::atomic<uint32_t> epoch{region.GetEpoch()};
+
+    // Ring to TAP, on its own thread; signals go to the main thread
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    std::thread toTap([&] {
+        ShmRing ring = region.Ring(SHM_TO_HOST);
+        uint32_t seen = epoch;
+        while (!g_stop) {
+            if (region.GetEpoch() != seen) {
+                seen = region.GetEpoch();
+                ring.Resync();
+            }
+            if (!ring.Wait(o.spinUs * 1000, 100)) {
+                continue;
+            }
+            out += ring.Drain([&](const uint8_t *frame, uint32_t length) { (void)!write(tap, frame, length); },
+                              256);
+        }
+    });
+
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    // TAP to ring, on the main thread: one read() per frame, into its slot
+    ShmRing ring = region.Ring(SHM_TO_SIM);
+    uint32_t seen = epoch;
+    uint8_t scratch[65536];
+    while (!g_stop) {
+        uint8_t *slot = ring.Reserve();
+        ssize_t n = read(tap, slot ? slot : scratch, slot ? ring.GetMtu() : sizeof(scratch));
+        if (n <= 0) {
+            if (n < 0 && errno != EINTR) {
+                std::perror("read");
+                break;
+            }
+            continue;
+        }
+        if (region.GetEpoch() != seen) {
+            seen = region.GetEpoch();
+            ring.Resync();
+            continue;
+        }
+        if (!slot) {
+            full++;
+            continue;
+        }
+        ring.Commit(static_cast<uint32_t>(n));
+        ring.Notify();
+        in++;
+    }
+    g_stop = true;
+    toTap.join();
+    std::cout << o.dev << ": " << in << " frames to the simulator, " << out << " from it, " << full
+              << " dropped (ring full)\n";
+    return 0;
+}
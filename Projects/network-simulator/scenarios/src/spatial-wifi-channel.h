@@ -0,0 +1,342 @@
+/*
+ * Spatially indexed YANS WiFi channel.
+ *
+ * The stock YansWifiChannel::Send() walks every PHY on the channel and
+ * schedules a Receive event for each of them, even for receivers that the
+ * RangePropagationLossModel puts at -1000 dBm. That makes every frame
+ * O(N) events and the channel O(N^2) overall.
+ *
+ * SpatialYansWifiChannel keeps the PHYs in a uniform grid of MaxRange-sized
+ * cells and only visits receivers in the neighbouring cells. Mobile nodes
+ * are re-binned on CourseChange and, for nodes moving in a straight line,
+ * at least every RebinInterval; the search radius is widened by the largest
+ * distance any node can have drifted since, so no receiver within MaxRange
+ * is ever missed. Candidates are visited in the same order as the stock
+ * channel and go through the same delay/loss/Receive path, so the results
+ * are meant to be identical as long as the loss model is deterministic and
+ * 0 W beyond MaxRange (RangePropagationLossModel).
+ * scripts/check-spatial-channel.sh compares the MANET's counters against
+ * the stock channel with the same RNG run.
+ *
+ * YansWifiChannel::Send is not virtual, so the transmitting side is a
+ * SpatialYansWifiPhy (created by SpatialYansWifiPhyHelper) whose StartTx
+ * calls into this channel. On a plain YansWifiChannel it behaves exactly
+ * like YansWifiPhy.
+ */
+
+#ifndef SPATIAL_WIFI_CHANNEL_H
+#define SPATIAL_WIFI_CHANNEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/wifi-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class SpatialYansWifiChannel : public YansWifiChannel {
+public:
+    static TypeId GetTypeId() {
+        static TypeId tid =
+            TypeId("ns3::SpatialYansWifiChannel")
+                .SetParent<YansWifiChannel>()
+                .SetGroupName("Wifi")
+                .AddConstructor<SpatialYansWifiChannel>()
+                .AddAttribute("MaxRange",
+                              "Distance (m) beyond which no receiver can hear a frame. "
+                              "Must not be smaller than the range of the loss model.",
+                              DoubleValue(100.0),
+                              MakeDoubleAccessor(&SpatialYansWifiChannel::m_maxRange),
+                              MakeDoubleChecker<double>(1.0))
+                .AddAttribute("RebinInterval",
+                              "Maximum age of the grid position of a moving node",
+                              TimeValue(MilliSeconds(100)),
+                              MakeTimeAccessor(&SpatialYansWifiChannel::m_rebinInterval),
+                              MakeTimeChecker());
+        return tid;
+    }
+
+    // Shadow the base setters: the models are private in YansWifiChannel
+    void SetPropagationLossModel(const Ptr<PropagationLossModel> loss) {
+        m_loss = loss;
+        YansWifiChannel::SetPropagationLossModel(loss);
+    }
+
+    void SetPropagationDelayModel(const Ptr<PropagationDelayModel> delay) {
+        m_delay = delay;
+        YansWifiChannel::SetPropagationDelayModel(delay);
+    }
+
+    /**
+     * Same contract as YansWifiChannel::Send, but only visits receivers in
+     * the cells around the sender
+     */
+    void Send(Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double txPowerDbm) {
+        if (m_entries.size() != GetNDevices()) {
+            BuildIndex();
+        }
+        Time now = Simulator::Now();
+        if (m_maxSpeed > 0.0 && now - m_lastRebin >= m_rebinInterval) {
+            RebinMoving();
+        }
+
+        auto it = m_phyIndex.find(PeekPointer(sender));
+        NS_ASSERT_MSG(it != m_phyIndex.end(), "Sender is not attached to this channel");
+        const Entry &src = m_entries[it->second];
+        Ptr<MobilityModel> senderMobility = src.mobility;
+
+        // Widen the search by the distance sender and receiver may have
+        // moved since they were binned
+        double drift = m_maxSpeed * (now - m_lastRebin).GetSeconds();
+        int32_t rings = static_cast<int32_t>(std::ceil((m_maxRange + 2.0 * drift) / m_maxRange));
+
+        m_candidates.clear();
+        if ((2 * rings + 1) * (2 * rings + 1) >= static_cast<int32_t>(m_cells.size())) {
+            for (uint32_t i = 0; i < m_entries.size(); i++) {
+                m_candidates.push_back(i);
+            }
+        } else {
+            for (int32_t dx = -rings; dx <= rings; dx++) {
+                for (int32_t dy = -rings; dy <= rings; dy++) {
+                    auto cell = m_cells.find(CellKey(src.cellX + dx, src.cellY + dy));
+                    if (cell != m_cells.end()) {
+                        m_candidates.insert(m_candidates.end(), cell->second.begin(), cell->second.end());
+                    }
+                }
+            }
+            // Keep the stock channel's scheduling order
+            std::sort(m_candidates.begin(), m_candidates.end());
+        }
+
+        m_sends++;
+        m_fullFanout += m_entries.size() - 1;
+
+        for (uint32_t index : m_candidates) {
+            const Entry &dst = m_entries[index];
+            if (dst.phy == sender) {
+                continue;
+            }
+            // For now don't account for inter channel interference nor channel bonding
+            if (dst.phy->GetChannelWidth() < sender->GetChannelWidth()) {
+                continue;
+            }
+            m_visited++;
+            Time delay = m_delay->GetDelay(senderMobility, dst.mobility);
+            double rxPowerDbm = m_loss->CalcRxPower(txPowerDbm, senderMobility, dst.mobility);
+            Ptr<WifiPpdu> copy = ppdu->Copy();
+            Simulator::ScheduleWithContext(dst.node, delay, &SpatialYansWifiChannel::Receive,
+                                           dst.phy, copy, rxPowerDbm);
+        }
+    }
+
+    /** Number of frames sent through the channel */
+    uint64_t GetSends() const { return m_sends; }
+    /** Receivers actually visited */
+    uint64_t GetVisited() const { return m_visited; }
+    /** Receivers the stock channel would have visited */
+    uint64_t GetFullFanout() const { return m_fullFanout; }
+
+protected:
+    void DoDispose() override {
+        m_entries.clear();
+        m_cells.clear();
+        m_phyIndex.clear();
+        m_loss = nullptr;
+        m_delay = nullptr;
+        YansWifiChannel::DoDispose();
+    }
+
+private:
+    struct Entry {
+        Ptr<YansWifiPhy> phy;
+        Ptr<MobilityModel> mobility;
+        uint32_t node;
+        int32_t cellX;
+        int32_t cellY;
+        double speed;
+        bool binned;
+    };
+
+    static int64_t CellKey(int32_t x, int32_t y) {
+        return (static_cast<int64_t>(x) << 32) ^ static_cast<uint32_t>(y);
+    }
+
+    /** Identical to the (private) YansWifiChannel::Receive */
+    static void Receive(Ptr<YansWifiPhy> phy, Ptr<const WifiPpdu> ppdu, double rxPowerDbm) {
+        // Do no further processing if signal is too weak
+        // Current implementation assumes constant RX power over the PPDU duration
+        // Compare received TX power per MHz to normalized RX sensitivity
+        uint16_t txWidth = ppdu->GetTransmissionChannelWidth();
+        if ((rxPowerDbm + phy->GetRxGain()) < phy->GetRxSensitivity() + RatioToDb(txWidth / 20.0)) {
+            return;
+        }
+        RxPowerWattPerChannelBand rxPowerW;
+        rxPowerW.insert({std::make_pair(0, 0), (DbmToW(rxPowerDbm + phy->GetRxGain()))}); // dummy band for YANS
+        phy->StartReceivePreamble(ppdu, rxPowerW, ppdu->GetTxDuration());
+    }
+
+    static void NotifyCourseChange(SpatialYansWifiChannel *channel, uint32_t index,
+                                   Ptr<const MobilityModel> model) {
+        channel->Rebin(index);
+    }
+
+    void BuildIndex() {
+        for (uint32_t i = 0; i < m_entries.size(); i++) {
+            m_entries[i].mobility->TraceDisconnectWithoutContext(
+                "CourseChange", MakeBoundCallback(&SpatialYansWifiChannel::NotifyCourseChange, this, i));
+        }
+        m_entries.clear();
+        m_cells.clear();
+        m_phyIndex.clear();
+        m_maxSpeed = 0.0;
+        m_lastRebin = Simulator::Now();
+
+        for (uint32_t i = 0; i < GetNDevices(); i++) {
+            Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice>(GetDevice(i));
+            NS_ABORT_MSG_UNLESS(dev, "SpatialYansWifiChannel requires WifiNetDevices");
+            Entry e;
+            e.phy = DynamicCast<YansWifiPhy>(dev->GetPhy());
+            e.mobility = e.phy->GetMobility()->GetObject<MobilityModel>();
+            e.node = dev->GetNode()->GetId();
+            e.binned = false;
+            m_phyIndex[PeekPointer(e.phy)] = i;
+            m_entries.push_back(e);
+            e.mobility->TraceConnectWithoutContext(
+                "CourseChange", MakeBoundCallback(&SpatialYansWifiChannel::NotifyCourseChange, this, i));
+            Rebin(i);
+        }
+    }
+
+    void Rebin(uint32_t index) {
+        Entry &e = m_entries[index];
+        Vector pos = e.mobility->GetPosition();
+        int32_t x = static_cast<int32_t>(std::floor(pos.x / m_maxRange));
+        int32_t y = static_cast<int32_t>(std::floor(pos.y / m_maxRange));
+        e.speed = e.mobility->GetVelocity().GetLength();
+        m_maxSpeed = std::max(m_maxSpeed, e.speed);
+        if (e.binned && x == e.cellX && y == e.cellY) {
+            return;
+        }
+        if (e.binned) {
+            std::vector<uint32_t> &old = m_cells[CellKey(e.cellX, e.cellY)];
+            old.erase(std::find(old.begin(), old.end(), index));
+            if (old.empty()) {
+                m_cells.erase(CellKey(e.cellX, e.cellY));
+            }
+        }
+        e.cellX = x;
+        e.cellY = y;
+        e.binned = true;
+        m_cells[CellKey(x, y)].push_back(index);
+    }
+
+    void RebinMoving() {
+        double maxSpeed = 0.0;
+        for (uint32_t i = 0; i < m_entries.size(); i++) {
+            if (m_entries[i].speed > 0.0) {
+                Rebin(i);
+            }
+            maxSpeed = std::max(maxSpeed, m_entries[i].speed);
+        }
+        m_maxSpeed = maxSpeed;
+        m_lastRebin = Simulator::Now();
+    }
+
+    double m_maxRange = 100.0;
+    Time m_rebinInterval = MilliSeconds(100);
+    Ptr<PropagationLossModel> m_loss;
+    Ptr<PropagationDelayModel> m_delay;
+
+    std::vector<Entry> m_entries;
+    std::unordered_map<int64_t, std::vector<uint32_t>> m_cells;
+    std::unordered_map<const YansWifiPhy *, uint32_t> m_phyIndex;
+    std::vector<uint32_t> m_candidates;
+    double m_maxSpeed = 0.0;  // upper bound on node speed since m_lastRebin
+    Time m_lastRebin;
+
+    uint64_t m_sends = 0;
+    uint64_t m_visited = 0;
+    uint64_t m_fullFanout = 0;
+};
+
+/**
+ * YansWifiPhy that transmits through SpatialYansWifiChannel::Send when it is
+ * attached to one
+ */
+class SpatialYansWifiPhy : public YansWifiPhy {
+public:
+    static TypeId GetTypeId() {
+        static TypeId tid = TypeId("ns3::SpatialYansWifiPhy")
+                                .SetParent<YansWifiPhy>()
+                                .SetGroupName("Wifi")
+                                .AddConstructor<SpatialYansWifiPhy>();
+        return tid;
+    }
+
+    void StartTx(Ptr<const WifiPpdu> ppdu) override {
+        Ptr<SpatialYansWifiChannel> channel = DynamicCast<SpatialYansWifiChannel>(GetChannel());
+        if (!channel) {
+            YansWifiPhy::StartTx(ppdu);
+            return;
+        }
+        channel->Send(this, ppdu, GetTxPowerForTransmission(ppdu) + GetTxGain());
+    }
+};
+
+/**
+ * YansWifiPhyHelper that installs SpatialYansWifiPhy instances
+ */
+class SpatialYansWifiPhyHelper : public YansWifiPhyHelper {
+public:
+    SpatialYansWifiPhyHelper() { m_phy.SetTypeId("ns3::SpatialYansWifiPhy"); }
+};
+
+/**
+ * Channel with constant-speed delay and a hard range cutoff, either the
+ * stock YansWifiChannel or the spatially indexed one
+ */
+inline Ptr<YansWifiChannel> CreateRangeWifiChannel(double maxRange, bool spatial) {
+    if (!spatial) {
+        YansWifiChannelHelper wifiChannel;
+        wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
+        wifiChannel.AddPropagationLoss("ns3::RangePropagationLossModel", "MaxRange", DoubleValue(maxRange));
+        return wifiChannel.Create();
+    }
+    Ptr<SpatialYansWifiChannel> channel =
+        CreateObjectWithAttributes<SpatialYansWifiChannel>("MaxRange", DoubleValue(maxRange));
+    channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+    channel->SetPropagationLossModel(
+        CreateObjectWithAttributes<RangePropagationLossModel>("MaxRange", DoubleValue(maxRange)));
+    return channel;
+}
+
+/**
+ * Print how much of the full PHY fan-out the spatial channel skipped
+ */
+inline void PrintSpatialChannelStats(Ptr<YansWifiChannel> channel, std::ostream &os = std::cout) {
+    Ptr<SpatialYansWifiChannel> spatial = DynamicCast<SpatialYansWifiChannel>(channel);
+    if (!spatial) {
+        return;
+    }
+    uint64_t full = spatial->GetFullFanout();
+    os << "Channel (spatial): " << spatial->GetSends() << " frames, visited " << spatial->GetVisited()
+       << " of " << full << " receivers";
+    if (full > 0) {
+        os << " (" << 100.0 * spatial->GetVisited() / full << "%)";
+    }
+    os << "\n";
+}
+
+NS_OBJECT_ENSURE_REGISTERED(SpatialYansWifiChannel);
+NS_OBJECT_ENSURE_REGISTERED(SpatialYansWifiPhy);
+
+} // namespace ns3
+
+#endif /* SPATIAL_WIFI_CHANNEL_H */
@@ -0,0 +1,7 @@
+/*
+ * tap-csma-line with the heap allocation counter of alloc-counter.h, for
+ * Benchmarks/bench.py. Takes the same arguments.
+ */
+
+#define T4_COUNT_ALLOCS
+#include "tap-csma-line.cc"
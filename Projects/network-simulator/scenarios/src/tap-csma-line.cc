@@ -1,6 +1,14 @@
 /*
  * TAP-CSMA Line Topology - 4 Nodes
  * Node0 -- Node1 -- Node2 -- Node3 (all on shared CSMA channel)
+ *
+ * --bridge=mq reads the (multi_queue) TAP devices with MqTapBridge
+ * (mq-tap-bridge.h) instead of TapBridge. --link=shaped replaces the CSMA
+ * channel with the token bucket and delay line of shaped-link.h, for
+ * bandwidth tests; loss, jitter and reordering are its channel attributes
+ * (--ns3::ShapedLinkChannel::Loss=0.01, ...). --tap=false runs headless
+ * for benchmarking: default simulator, no TAP, and the nodes get an IPv4
+ * stack and synthetic UDP echo traffic instead (echo-traffic.h).
  */
 
 #include "ns3/core-module.h"
@@ -8,90 +16,204 @@
 #include "ns3/network-module.h"
 #include "ns3/tap-bridge-module.h"
 #include "ns3/internet-module.h"
+#include "echo-traffic.h"
+#include "metrics-exporter.h"
+#include "mq-tap-bridge.h"
+#include "node-counters.h"
+#include "pcapng-capture.h"
+#include "realtime-lag-monitor.h"
+#include "run-stats.h"
+#include "shaped-link.h"
 #include <iostream>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TapCsmaLineTopology");
 
-static uint64_t g_bytes[4] = {0}, g_packets[4] = {0};
+static NodeCounterTable g_counters;
 
-static void RxCallback(uint32_t idx, Ptr<const Packet> p) {
-    g_bytes[idx] += p->GetSize();
-    g_packets[idx]++;
+// Synthetic (headless) echo traffic: requests sent, replies received
+static EchoTrafficStats g_echo;
+
+static void RxCallback(uint32_t nodeId, Ptr<const Packet> p) {
+    g_counters[nodeId].AddPacket(MAC_RX_PKTS, MAC_RX_BYTES, p->GetSize());
 }
-static void Rx0(Ptr<const Packet> p) { RxCallback(0, p); }
-static void Rx1(Ptr<const Packet> p) { RxCallback(1, p); }
-static void Rx2(Ptr<const Packet> p) { RxCallback(2, p); }
-static void Rx3(Ptr<const Packet> p) { RxCallback(3, p); }
 
-static void PrintStats() {
-    std::cout << "\n[" << Simulator::Now().GetSeconds() << "s] ";
+// Runs on the metrics exporter thread; reads seqlock snapshots only
+static void PrintStats(std::ostream &os, double elapsed) {
+    os << "\n[" << elapsed << "s] ";
     uint64_t total = 0;
-    for (int i = 0; i < 4; i++) {
-        std::cout << "N" << i << ":" << g_packets[i] << "p ";
-        total += g_packets[i];
+    for (uint32_t i = 0; i < g_counters.GetN(); i++) {
+        uint64_t pkts = g_counters[i].Snapshot().Get(MAC_RX_PKTS);
+        os << "N" << i << ":" << pkts << "p ";
+        total += pkts;
     }
-    std::cout << "Total:" << total << "\n";
-    Simulator::Schedule(Seconds(10.0), &PrintStats);
+    os << "Total:" << total << "\n";
 }
 
 int main(int argc, char* argv[]) {
     bool verbose = false;
     std::string dataRate = "100Mbps";
     double time = 600.0;
+    double metricsInterval = 10.0;
+    std::string metricsSocket;
+    std::string metricsFormat = "prometheus";
+    bool pcap = true;
+    PcapngOptions pcapOptions;
+    bool lagMonitor = true;
+    std::string bridge = "tap";
+    uint32_t tapQueues = 4;
+    std::string link = "csma";
+    std::string delay = "6560ns";
+    bool tap = true;
+    double echoInterval = 1.0;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("verbose", "Enable logging", verbose);
-    cmd.AddValue("dataRate", "CSMA data rate", dataRate);
+    cmd.AddValue("link", "Channel: csma (CsmaHelper) or shaped (token bucket and delay line)", link);
+    cmd.AddValue("dataRate", "Channel data rate (per device with --link=shaped)", dataRate);
+    cmd.AddValue("delay", "Channel delay", delay);
     cmd.AddValue("time", "Simulation time", time);
+    cmd.AddValue("metricsInterval", "Seconds between statistics reports (0 disables)", metricsInterval);
+    cmd.AddValue("metricsSocket", "Unix socket serving metric snapshots (empty disables)", metricsSocket);
+    cmd.AddValue("metricsFormat", "Metrics socket format: text, json, prometheus", metricsFormat);
+    cmd.AddValue("pcap", "Write the merged pcapng capture /tmp/csma-line-*.pcapng", pcap);
+    pcapOptions.AddValues(cmd);
+    cmd.AddValue("lagMonitor", "Measure realtime scheduling lag per event", lagMonitor);
+    cmd.AddValue("tap", "Bridge to TAP devices in realtime; false runs headless with synthetic traffic", tap);
+    cmd.AddValue("echoInterval", "Seconds between the echo requests of each node (headless)", echoInterval);
+    cmd.AddValue("bridge", "Container bridge: tap (TapBridge) or mq (multi-queue TAP ingress)", bridge);
+    cmd.AddValue("tapQueues", "TAP queues read in parallel with --bridge=mq", tapQueues);
     cmd.Parse(argc, argv);
 
+    if (bridge != "tap" && bridge != "mq") {
+        NS_FATAL_ERROR("--bridge must be tap or mq");
+    }
+    if (link != "csma" && link != "shaped") {
+        NS_FATAL_ERROR("--link must be csma or shaped");
+    }
+    Config::SetDefault("ns3::MqTapBridge::Queues", UintegerValue(tapQueues));
+
     if (verbose) {
         LogComponentEnable("TapCsmaLineTopology", LOG_LEVEL_INFO);
         LogComponentEnable("TapBridge", LOG_LEVEL_INFO);
     }
 
-    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    if (tap) {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    }
     GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
 
-    std::cout << "TAP-CSMA 4-Node Line Topology\n";
+    // Measure how far the realtime event loop falls behind the wall clock
+    if (tap && lagMonitor) {
+        RealtimeLagMonitor::Get().Enable();
+    }
+
+    std::cout << "TAP-CSMA 4-Node Line Topology" << (link == "shaped" ? " (shaped link)" : "")
+              << (tap ? "" : " (headless)") << "\n";
 
     NodeContainer nodes;
     nodes.Create(4);
 
-    CsmaHelper csma;
-    csma.SetChannelAttribute("DataRate", StringValue(dataRate));
-    csma.SetChannelAttribute("Delay", TimeValue(NanoSeconds(6560)));
-    NetDeviceContainer devices = csma.Install(nodes);
+    NetDeviceContainer devices;
+    Ptr<ShapedLinkChannel> shaped;
+    if (link == "shaped") {
+        ShapedLinkHelper shapedLink;
+        shapedLink.SetDeviceAttribute("DataRate", StringValue(dataRate));
+        shapedLink.SetChannelAttribute("Delay", StringValue(delay));
+        devices = shapedLink.Install(nodes);
+        shaped = DynamicCast<ShapedLinkChannel>(devices.Get(0)->GetChannel());
+    } else {
+        CsmaHelper csma;
+        csma.SetChannelAttribute("DataRate", StringValue(dataRate));
+        csma.SetChannelAttribute("Delay", StringValue(delay));
+        devices = csma.Install(nodes);
+    }
 
-    // PCAP tracing
-    for (uint32_t i = 0; i < 4; i++) {
-        std::ostringstream oss;
-        oss << "/tmp/node" << i;
-        csma.EnablePcap(oss.str(), devices.Get(i), true);
+    // PCAP tracing: one pcapng file, one interface per node
+    PcapngCapture capture;
+    if (pcap) {
+        if (!capture.Start("/tmp/csma-line", pcapOptions)) {
+            NS_FATAL_ERROR("Cannot start the pcapng capture");
+        }
+        capture.Attach(devices);
     }
 
     // Traffic monitoring
-    devices.Get(0)->TraceConnectWithoutContext("MacRx", MakeCallback(&Rx0));
-    devices.Get(1)->TraceConnectWithoutContext("MacRx", MakeCallback(&Rx1));
-    devices.Get(2)->TraceConnectWithoutContext("MacRx", MakeCallback(&Rx2));
-    devices.Get(3)->TraceConnectWithoutContext("MacRx", MakeCallback(&Rx3));
-
-    // TAP bridges
-    TapBridgeHelper tapBridge;
-    tapBridge.SetAttribute("Mode", StringValue("UseBridge"));
-    const char* taps[] = {"tap-0", "tap-1", "tap-2", "tap-3"};
-    for (uint32_t i = 0; i < 4; i++) {
-        tapBridge.SetAttribute("DeviceName", StringValue(taps[i]));
-        tapBridge.Install(nodes.Get(i), devices.Get(i));
-        std::cout << "Node " << i << " -> " << taps[i] << "\n";
-    }
-
-    Simulator::Schedule(Seconds(10.0), &PrintStats);
+    g_counters.Resize(nodes.GetN());
+    for (uint32_t i = 0; i < devices.GetN(); i++) {
+        devices.Get(i)->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&RxCallback, i));
+    }
+
+    // TAP bridges; headless, the nodes themselves are the endpoints
+    std::vector<Ptr<MqTapBridge>> mqBridges;
+    if (tap) {
+        TapBridgeHelper tapBridge;
+        tapBridge.SetAttribute("Mode", StringValue("UseBridge"));
+        const char* taps[] = {"tap-0", "tap-1", "tap-2", "tap-3"};
+        for (uint32_t i = 0; i < 4; i++) {
+            if (bridge == "mq") {
+                mqBridges.push_back(InstallMqTapBridge(nodes.Get(i), devices.Get(i), taps[i], "UseBridge"));
+                std::cout << "Node " << i << " -> " << taps[i] << " (multi-queue)\n";
+                continue;
+            }
+            tapBridge.SetAttribute("DeviceName", StringValue(taps[i]));
+            tapBridge.Install(nodes.Get(i), devices.Get(i));
+            std::cout << "Node " << i << " -> " << taps[i] << "\n";
+        }
+    } else {
+        InternetStackHelper internet;
+        internet.Install(nodes);
+        Ipv4AddressHelper ipv4;
+        ipv4.SetBase("10.1.1.0", "255.255.255.0");
+        Ipv4InterfaceContainer interfaces = ipv4.Assign(devices);
+        InstallEchoTraffic(nodes, interfaces, Seconds(echoInterval), 64, Seconds(time), g_echo);
+    }
+
+    MetricsExporter metrics;
+    metrics.AddNodeCounterTable(&g_counters);
+    metrics.SetTextReport([&mqBridges](std::ostream &os, double elapsed) {
+        PrintStats(os, elapsed);
+        RealtimeLagMonitor::Get().PrintSummary(os);
+        for (const Ptr<MqTapBridge> &mq : mqBridges) {
+            mq->PrintSummary(os);
+        }
+    });
+    RealtimeLagMonitor::Get().AddCollector(metrics);
+    for (const Ptr<MqTapBridge> &mq : mqBridges) {
+        mq->AddCollector(metrics);
+    }
+    if (shaped) {
+        shaped->AddCollector(metrics);
+    }
+    metrics.Start(metricsInterval, metricsSocket, MetricsExporter::ParseFormat(metricsFormat));
+
+    RunStats runStats;
     Simulator::Stop(Seconds(time));
+    runStats.Start();
     Simulator::Run();
-    PrintStats();
+    runStats.Stop();
+    metrics.Stop();
+    capture.Stop();
+    PrintStats(std::cout, time);
+    RealtimeLagMonitor::Get().Print(std::cout);
+    if (shaped) {
+        shaped->Print(std::cout);
+    }
+    if (!mqBridges.empty()) {
+        std::cout << "Multi-queue TAP bridges:\n";
+        for (const Ptr<MqTapBridge> &mq : mqBridges) {
+            mq->Print(std::cout);
+        }
+    }
+    if (pcap) {
+        capture.Print(std::cout);
+    }
+    if (!tap) {
+        std::cout << "Echo: " << g_echo.tx << " requests, " << g_echo.rx << " replies (pdr=" << g_echo.DeliveryRatio()
+                  << ")\n";
+    }
+    runStats.Print();
     Simulator::Destroy();
     return 0;
 }
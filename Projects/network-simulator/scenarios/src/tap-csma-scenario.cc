@@ -61,6 +61,11 @@
 #include "ns3/csma-module.h"
 #include "ns3/network-module.h"
 #include "ns3/tap-bridge-module.h"
+#include "metrics-exporter.h"
+#include "node-counters.h"
+#include "pcapng-capture.h"
+#include "realtime-lag-monitor.h"
+#include "shaped-link.h"
 
 #include <fstream>
 #include <iostream>
@@ -69,45 +74,31 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TapCsmaVirtualMachineExample");
 
-// Global counters for traffic statistics
-static uint64_t g_totalBytesLeft = 0;
-static uint64_t g_totalBytesRight = 0;
-static uint64_t g_totalPacketsLeft = 0;
-static uint64_t g_totalPacketsRight = 0;
+// Traffic statistics, row 0 = left node, row 1 = right node
+static NodeCounterTable g_counters;
 
-// Callback for packet reception on left node
+// Callback for packet reception, bound to the node index
 static void
-RxCallbackLeft(Ptr<const Packet> packet)
+RxCallback(uint32_t idx, Ptr<const Packet> packet)
 {
-    g_totalBytesLeft += packet->GetSize();
-    g_totalPacketsLeft++;
-    NS_LOG_INFO("LEFT  RX: " << packet->GetSize() << " bytes (Total: "
-                << g_totalPacketsLeft << " pkts, " << g_totalBytesLeft << " bytes)");
+    NodeCounters& c = g_counters[idx];
+    c.AddPacket(MAC_RX_PKTS, MAC_RX_BYTES, packet->GetSize());
+    NS_LOG_INFO((idx == 0 ? "LEFT " : "RIGHT") << " RX: " << packet->GetSize() << " bytes (Total: "
+                << c.Get(MAC_RX_PKTS) << " pkts, " << c.Get(MAC_RX_BYTES) << " bytes)");
 }
 
-// Callback for packet reception on right node
+// Periodic statistics printout, called on the metrics exporter thread
 static void
-RxCallbackRight(Ptr<const Packet> packet)
+PrintStats(std::ostream& os, double elapsed)
 {
-    g_totalBytesRight += packet->GetSize();
-    g_totalPacketsRight++;
-    NS_LOG_INFO("RIGHT RX: " << packet->GetSize() << " bytes (Total: "
-                << g_totalPacketsRight << " pkts, " << g_totalBytesRight << " bytes)");
-}
-
-// Periodic statistics printout
-static void
-PrintStats()
-{
-    std::cout << "\n========== Traffic Statistics at " << Simulator::Now().GetSeconds() << "s ==========\n";
-    std::cout << "LEFT  Node: " << g_totalPacketsLeft << " packets, " << g_totalBytesLeft << " bytes\n";
-    std::cout << "RIGHT Node: " << g_totalPacketsRight << " packets, " << g_totalBytesRight << " bytes\n";
-    std::cout << "TOTAL:      " << (g_totalPacketsLeft + g_totalPacketsRight) << " packets, "
-              << (g_totalBytesLeft + g_totalBytesRight) << " bytes\n";
-    std::cout << "==========================================================\n\n";
-
-    // Schedule next stats printout in 10 seconds
-    Simulator::Schedule(Seconds(10.0), &PrintStats);
+    NodeCounterSnapshot left = g_counters[0].Snapshot();
+    NodeCounterSnapshot right = g_counters[1].Snapshot();
+    os << "\n========== Traffic Statistics at " << elapsed << "s ==========\n";
+    os << "LEFT  Node: " << left.Get(MAC_RX_PKTS) << " packets, " << left.Get(MAC_RX_BYTES) << " bytes\n";
+    os << "RIGHT Node: " << right.Get(MAC_RX_PKTS) << " packets, " << right.Get(MAC_RX_BYTES) << " bytes\n";
+    os << "TOTAL:      " << (left.Get(MAC_RX_PKTS) + right.Get(MAC_RX_PKTS)) << " packets, "
+       << (left.Get(MAC_RX_BYTES) + right.Get(MAC_RX_BYTES)) << " bytes\n";
+    os << "==========================================================\n\n";
 }
 
 int
@@ -115,11 +106,36 @@ main(int argc, char* argv[])
 {
     // Enable logging for this component
     bool verbose = false;
+    double metricsInterval = 10.0;
+    std::string metricsSocket;
+    std::string metricsFormat = "prometheus";
+    bool pcap = true;
+    bool ascii = false;
+    PcapngOptions pcapOptions;
+    bool lagMonitor = true;
+    std::string link = "csma";
+    std::string dataRate = "100Mbps";
+    std::string delay = "6560ns";
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("verbose", "Enable verbose logging", verbose);
+    cmd.AddValue("metricsInterval", "Seconds between statistics reports (0 disables)", metricsInterval);
+    cmd.AddValue("metricsSocket", "Unix socket serving metric snapshots (empty disables)", metricsSocket);
+    cmd.AddValue("metricsFormat", "Metrics socket format: text, json, prometheus", metricsFormat);
+    cmd.AddValue("pcap", "Write the merged pcapng capture /tmp/tap-csma-*.pcapng", pcap);
+    cmd.AddValue("ascii", "Also write the ASCII trace /tmp/tap-csma-trace.tr", ascii);
+    pcapOptions.AddValues(cmd);
+    cmd.AddValue("lagMonitor", "Measure realtime scheduling lag per event", lagMonitor);
+    cmd.AddValue("link", "Channel: csma (CsmaHelper) or shaped (token bucket and delay line)", link);
+    cmd.AddValue("dataRate", "Channel data rate (per device with --link=shaped)", dataRate);
+    cmd.AddValue("delay", "Channel delay", delay);
     cmd.Parse(argc, argv);
 
+    if (link != "csma" && link != "shaped")
+    {
+        NS_FATAL_ERROR("--link must be csma or shaped");
+    }
+
     if (verbose)
     {
         LogComponentEnable("TapCsmaVirtualMachineExample", LOG_LEVEL_INFO);
@@ -140,6 +156,15 @@ main(int argc, char* argv[])
     GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
     GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
 
+    //
+    // Measure how far the realtime event loop falls behind the wall clock,
+    // per event, and which event types cause it
+    //
+    if (lagMonitor)
+    {
+        RealtimeLagMonitor::Get().Enable();
+    }
+
     //
     // Create two ghost nodes.  The first will represent the virtual machine host
     // on the left side of the network; and the second will represent the VM on
@@ -151,35 +176,69 @@ main(int argc, char* argv[])
     //
     // Use a CsmaHelper to get a CSMA channel created, and the needed net
     // devices installed on both of the nodes.  The data rate and delay for the
-    // channel can be set through the command-line parser.  For example,
+    // channel are set with --dataRate and --delay.  For example,
     //
-    // ./ns3 run "tap-csma-virtual-machine --ns3::CsmaChannel::DataRate=10000000"
+    // ./ns3 run "tap-csma-scenario --dataRate=10Mbps"
+    //
+    // --link=shaped uses the lighter ShapedLinkHelper (shaped-link.h) with
+    // the same rate (per device) and delay, e.g.
+    //
+    // ./ns3 run "tap-csma-scenario --link=shaped --dataRate=1Gbps"
+    //
+    // The helpers set these attributes explicitly, so they override
+    // --ns3::CsmaChannel::DataRate and the like.
     //
     CsmaHelper csma;
-    // Set reasonable defaults for the CSMA channel
-    csma.SetChannelAttribute("DataRate", StringValue("100Mbps"));
-    csma.SetChannelAttribute("Delay", TimeValue(NanoSeconds(6560)));
+    csma.SetChannelAttribute("DataRate", StringValue(dataRate));
+    csma.SetChannelAttribute("Delay", StringValue(delay));
 
-    NetDeviceContainer devices = csma.Install(nodes);
+    NetDeviceContainer devices;
+    Ptr<ShapedLinkChannel> shaped;
+    if (link == "shaped")
+    {
+        ShapedLinkHelper shapedLink;
+        shapedLink.SetDeviceAttribute("DataRate", StringValue(dataRate));
+        shapedLink.SetChannelAttribute("Delay", StringValue(delay));
+        devices = shapedLink.Install(nodes);
+        shaped = DynamicCast<ShapedLinkChannel>(devices.Get(0)->GetChannel());
+    }
+    else
+    {
+        devices = csma.Install(nodes);
+    }
 
     //
-    // Enable PCAP tracing on the CSMA devices
-    // Files will be created in /tmp/tap-csma-left-0.pcap and /tmp/tap-csma-right-0.pcap
+    // Capture both CSMA devices into one pcapng file (/tmp/tap-csma-000.pcapng),
+    // with an interface per side. Frames are copied into a ring that a
+    // background thread writes out, rotating files by size.
     //
-    csma.EnablePcap("/tmp/tap-csma-left", devices.Get(0), true);
-    csma.EnablePcap("/tmp/tap-csma-right", devices.Get(1), true);
+    PcapngCapture capture;
+    if (pcap)
+    {
+        if (!capture.Start("/tmp/tap-csma", pcapOptions))
+        {
+            NS_FATAL_ERROR("Cannot start the pcapng capture");
+        }
+        capture.AttachEthernet(devices.Get(0), "left");
+        capture.AttachEthernet(devices.Get(1), "right");
+    }
 
     //
-    // Enable ASCII tracing for text-based analysis
+    // ASCII tracing for text-based analysis is synchronous and unbounded, so
+    // it is only enabled on request (--ascii, CSMA only)
     //
-    AsciiTraceHelper ascii;
-    csma.EnableAsciiAll(ascii.CreateFileStream("/tmp/tap-csma-trace.tr"));
+    if (ascii && !shaped)
+    {
+        AsciiTraceHelper asciiHelper;
+        csma.EnableAsciiAll(asciiHelper.CreateFileStream("/tmp/tap-csma-trace.tr"));
+    }
 
     //
     // Connect trace callbacks to monitor traffic
     //
-    devices.Get(0)->TraceConnectWithoutContext("MacRx", MakeCallback(&RxCallbackLeft));
-    devices.Get(1)->TraceConnectWithoutContext("MacRx", MakeCallback(&RxCallbackRight));
+    g_counters.Resize(nodes.GetN());
+    devices.Get(0)->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&RxCallback, 0));
+    devices.Get(1)->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&RxCallback, 1));
 
     //
     // Use the TapBridgeHelper to connect to the pre-configured tap devices for
@@ -200,24 +259,50 @@ main(int argc, char* argv[])
     tapBridge.SetAttribute("DeviceName", StringValue("tap-right"));
     tapBridge.Install(nodes.Get(1), devices.Get(1));
 
-    Simulator::Schedule(Seconds(10.0), &PrintStats);
+    //
+    // Periodic statistics come from a separate exporter thread so that
+    // formatting output never delays the realtime event loop.
+    //
+    MetricsExporter metrics;
+    metrics.AddNodeCounterTable(&g_counters);
+    metrics.SetTextReport([](std::ostream& os, double elapsed) {
+        PrintStats(os, elapsed);
+        RealtimeLagMonitor::Get().PrintSummary(os);
+    });
+    RealtimeLagMonitor::Get().AddCollector(metrics);
+    if (shaped)
+    {
+        shaped->AddCollector(metrics);
+    }
+    metrics.Start(metricsInterval, metricsSocket, MetricsExporter::ParseFormat(metricsFormat));
 
     Simulator::Stop(Seconds(600.));
     Simulator::Run();
+    metrics.Stop();
+    capture.Stop();
 
     // Print final statistics
     std::cout << "\n╔═══════════════════════════════════════════════════════════════╗\n";
     std::cout << "║                    FINAL TRAFFIC SUMMARY                      ║\n";
     std::cout << "╠═══════════════════════════════════════════════════════════════╣\n";
-    std::cout << "║  LEFT  Node: " << g_totalPacketsLeft << " packets, " << g_totalBytesLeft << " bytes\n";
-    std::cout << "║  RIGHT Node: " << g_totalPacketsRight << " packets, " << g_totalBytesRight << " bytes\n";
-    std::cout << "║  TOTAL:      " << (g_totalPacketsLeft + g_totalPacketsRight) << " packets, "
-              << (g_totalBytesLeft + g_totalBytesRight) << " bytes\n";
+    const NodeCounters& left = g_counters[0];
+    const NodeCounters& right = g_counters[1];
+    std::cout << "║  LEFT  Node: " << left.Get(MAC_RX_PKTS) << " packets, " << left.Get(MAC_RX_BYTES) << " bytes\n";
+    std::cout << "║  RIGHT Node: " << right.Get(MAC_RX_PKTS) << " packets, " << right.Get(MAC_RX_BYTES) << " bytes\n";
+    std::cout << "║  TOTAL:      " << (left.Get(MAC_RX_PKTS) + right.Get(MAC_RX_PKTS)) << " packets, "
+              << (left.Get(MAC_RX_BYTES) + right.Get(MAC_RX_BYTES)) << " bytes\n";
     std::cout << "╚═══════════════════════════════════════════════════════════════╝\n";
-    std::cout << "\nPCAP files saved to:\n";
-    std::cout << "  - /tmp/tap-csma-left-0.pcap\n";
-    std::cout << "  - /tmp/tap-csma-right-0.pcap\n";
-    std::cout << "Open with: wireshark /tmp/tap-csma-left-0.pcap\n\n";
+    RealtimeLagMonitor::Get().Print(std::cout);
+    if (shaped)
+    {
+        shaped->Print(std::cout);
+    }
+    if (pcap)
+    {
+        std::cout << "\n";
+        capture.Print(std::cout);
+        std::cout << "Open with: wireshark /tmp/tap-csma-000.pcapng\n\n";
+    }
 
     Simulator::Destroy();
 }
@@ -0,0 +1,624 @@
+/*
+ * Host network provisioner for the TAP scenarios, over rtnetlink
+ *
+ * Does what scripts/tap-4node-setup.sh and tap-4node-teardown.sh do, for
+ * any number of nodes, without running ip/ifconfig once per step:
+ *   br-<i>        bridge, up
+ *   tap-<i>       persistent TAP device, promiscuous, up, in br-<i>
+ *   veth-int-<i>  in br-<i>, up; its peer is created directly inside the
+ *                 netns of container node-<i> as eth0, with MAC
+ *                 12:34:88:5D:61:B0 + i, up, and address 10.0.0.(i + 1)
+ *                 (/24, or /16 beyond 253 nodes, as manet-aodv-static)
+ *
+ * Links are created, enslaved and brought up by batches of RTM_NEWLINK
+ * messages sent in one sendmsg() and acknowledged together, and put in one
+ * interface group that `down` deletes with a single RTM_DELLINK. TAP devices
+ * cannot be created over rtnetlink, they get the two /dev/net/tun ioctls
+ * `ip tuntap add` uses. Container PIDs come from one `docker inspect` for
+ * all the nodes; addresses are set through a netlink socket opened in
+ * each container's netns.
+ *
+ * The node count is the number of node-<i> containers in the scenario
+ * file, or --nodes. Nodes whose container is not running get their bridge
+ * and TAP device only.
+ *
+ * Usage (as root, from Projects/network-simulator):
+ *   tap-provision up scenarios/tap-4node-scenario.yaml [--nodes=N] [--compose=false] [--multiQueue=true]
+ *   tap-provision down scenarios/tap-4node-scenario.yaml [--nodes=N] [--compose=false]
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <linux/if_link.h>
+#include <linux/if_tun.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/veth.h>
+#include <net/if.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Options {
+    std::string command;
+    std::string scenario;
+    uint32_t nodes = 0;
+    bool compose = true;
+    bool multiQueue = false;
+};
+
+static void Usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " up|down <scenario.yaml> [options]\n"
+              << "  --nodes=N        nodes to provision (default: node-<i> containers in the scenario)\n"
+              << "  --compose=false  do not run docker compose up/down\n"
+              << "  --multiQueue=true  create multi_queue TAP devices (for --bridge=mq)\n";
+}
+
+static bool ParseArgs(int argc, char *argv[], Options &o) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string::size_type eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0) {
+            positional.push_back(arg);
+            continue;
+        }
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (name == "nodes") {
+            o.nodes = std::stoul(value);
+        } else if (name == "compose") {
+            o.compose = value != "false" && value != "0";
+        } else if (name == "multiQueue") {
+            o.multiQueue = value != "false" && value != "0";
+        } else {
+            return false;
+        }
+    }
+    if (positional.size() != 2 || (positional[0] != "up" && positional[0] != "down")) {
+        return false;
+    }
+    o.command = positional[0];
+    o.scenario = positional[1];
+    return true;
+}
+
+/** One more than the highest N of the "container_name: node-N" lines */
+static uint32_t CountNodes(const std::string &path) {
+    std::ifstream in(path);
+    std::regex re("^\\s*container_name:\\s*[\"']?node-([0-9]+)");
+    std::string line;
+    uint32_t nodes = 0;
+    std::smatch m;
+    while (std::getline(in, line)) {
+        if (std::regex_search(line, m, re)) {
+            nodes = std::max<uint32_t>(nodes, std::stoul(m[1]) + 1);
+        }
+    }
+    return nodes;
+}
+
+// Interface group of every host link created here, deleted as one
+static const uint32_t kLinkGroup = 0x7434;
+
+static std::string Name(const char *prefix, uint32_t i) { return prefix + std::to_string(i); }
+
+/**
+ * Batched rtnetlink requests: messages are queued in one buffer, sent with
+ * a single sendmsg() and their acks collected in a single pass. Errors are
+ * reported with the label given to their message, unless listed as
+ * expected for it.
+ */
+class Rtnl {
+public:
+    ~Rtnl() {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    /** Socket in the calling thread's current netns */
+    bool Open() {
+        m_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (m_fd < 0) {
+            std::perror("netlink socket");
+            return false;
+        }
+        int size = 4 << 20;
+        if (setsockopt(m_fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) != 0) {
+            setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        }
+        int one = 1;
+        // Acks without a copy of the request
+        setsockopt(m_fd, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one));
+        sockaddr_nl local = {};
+        local.nl_family = AF_NETLINK;
+        if (bind(m_fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0) {
+            std::perror("netlink bind");
+            return false;
+        }
+        return true;
+    }
+
+    /** Start a message with its fixed header (ifinfomsg, ifaddrmsg, ...) */
+    template <typename T>
+    void Begin(uint16_t type, uint16_t flags, const T &fixed, const std::string &label, int expected = 0) {
+        // Keep each sendmsg() well below the socket's send buffer
+        if (m_buffer.size() > kBatchBytes) {
+            Flush();
+        }
+        m_start = m_buffer.size();
+        nlmsghdr header = {};
+        header.nlmsg_type = type;
+        header.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+        header.nlmsg_seq = ++m_seq;
+        Append(&header, sizeof(header));
+        Append(&fixed, sizeof(fixed));
+        m_pending[m_seq] = {label, expected};
+        m_queued++;
+    }
+
+    void Attr(uint16_t type, const void *data, size_t size) {
+        nlattr attr;
+        attr.nla_len = static_cast<uint16_t>(NLA_HDRLEN + size);
+        attr.nla_type = type;
+        Append(&attr, sizeof(attr));
+        Append(data, size);
+    }
+
+    void Attr(uint16_t type, const std::string &s) { Attr(type, s.c_str(), s.size() + 1); }
+    void Attr(uint16_t type, uint32_t v) { Attr(type, &v, sizeof(v)); }
+
+    /** Nested attribute: Nest() ... EndNest(offset) */
+    size_t Nest(uint16_t type) {
+        size_t offset = m_buffer.size();
+        Attr(type, nullptr, 0);
+        return offset;
+    }
+
+    void EndNest(size_t offset) {
+        reinterpret_cast<nlattr *>(&m_buffer[offset])->nla_len = static_cast<uint16_t>(m_buffer.size() - offset);
+    }
+
+    /** Raw bytes inside a nest (the ifinfomsg of a veth peer) */
+    void Raw(const void *data, size_t size) { Append(data, size); }
+
+    void End() { reinterpret_cast<nlmsghdr *>(&m_buffer[m_start])->nlmsg_len = m_buffer.size() - m_start; }
+
+    /** Send everything queued and wait for all the acks; false if any failed */
+    bool Flush() {
+        if (m_buffer.empty()) {
+            return m_failures == 0;
+        }
+        sockaddr_nl kernel = {};
+        kernel.nl_family = AF_NETLINK;
+        if (sendto(m_fd, m_buffer.data(), m_buffer.size(), 0, reinterpret_cast<sockaddr *>(&kernel),
+                   sizeof(kernel)) < 0) {
+            std::perror("netlink send");
+            m_failures += m_pending.size();
+            m_pending.clear();
+        }
+        m_buffer.clear();
+        m_messages += m_queued;
+        m_queued = 0;
+        m_batches++;
+        while (!m_pending.empty()) {
+            ssize_t n = recv(m_fd, m_receive, sizeof(m_receive), 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::perror("netlink recv");
+                m_failures += m_pending.size();
+                m_pending.clear();
+                break;
+            }
+            for (nlmsghdr *h = reinterpret_cast<nlmsghdr *>(m_receive); NLMSG_OK(h, n); h = NLMSG_NEXT(h, n)) {
+                if (h->nlmsg_type != NLMSG_ERROR) {
+                    continue;
+                }
+                auto it = m_pending.find(h->nlmsg_seq);
+                if (it == m_pending.end()) {
+                    continue;
+                }
+                int error = -static_cast<nlmsgerr *>(NLMSG_DATA(h))->error;
+                if (error != 0 && error != it->second.expected) {
+                    std::cerr << "tap-provision: " << it->second.label << ": " << std::strerror(error) << "\n";
+                    m_failures++;
+                }
+                m_pending.erase(it);
+            }
+        }
+        return m_failures == 0;
+    }
+
+    /** Interface indexes by name (RTM_GETLINK dump) */
+    std::map<std::string, int> Links() {
+        std::map<std::string, int> links;
+        struct {
+            nlmsghdr header;
+            ifinfomsg info;
+        } request = {};
+        request.header.nlmsg_len = sizeof(request);
+        request.header.nlmsg_type = RTM_GETLINK;
+        request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+        request.header.nlmsg_seq = ++m_seq;
+        request.info.ifi_family = AF_UNSPEC;
+        if (send(m_fd, &request, sizeof(request), 0) < 0) {
+            std::perror("netlink dump");
+            return links;
+        }
+        for (;;) {
+            ssize_t n = recv(m_fd, m_receive, sizeof(m_receive), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return links;
+            }
+            for (nlmsghdr *h = reinterpret_cast<nlmsghdr *>(m_receive); NLMSG_OK(h, n); h = NLMSG_NEXT(h, n)) {
+                if (h->nlmsg_type == NLMSG_DONE || h->nlmsg_type == NLMSG_ERROR) {
+                    return links;
+                }
+                if (h->nlmsg_type != RTM_NEWLINK) {
+                    continue;
+                }
+                ifinfomsg *info = static_cast<ifinfomsg *>(NLMSG_DATA(h));
+                int length = IFLA_PAYLOAD(h);
+                for (rtattr *a = IFLA_RTA(info); RTA_OK(a, length); a = RTA_NEXT(a, length)) {
+                    if (a->rta_type == IFLA_IFNAME) {
+                        links[static_cast<const char *>(RTA_DATA(a))] = info->ifi_index;
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t GetMessages() const { return m_messages; }
+    uint32_t GetBatches() const { return m_batches; }
+
+private:
+    static const size_t kBatchBytes = 32 * 1024;
+
+    struct Pending {
+        std::string label;
+        int expected;
+    };
+
+    void Append(const void *data, size_t size) {
+        const char *p = static_cast<const char *>(data);
+        m_buffer.insert(m_buffer.end(), p, p + size);
+        m_buffer.resize(NLMSG_ALIGN(m_buffer.size()));
+    }
+
+    int m_fd = -1;
+    uint32_t m_seq = 0;
+    std::vector<char> m_buffer;
+    size_t m_start = 0;
+    std::map<uint32_t, Pending> m_pending;
+    uint32_t m_failures = 0;
+    uint32_t m_messages = 0;
+    uint32_t m_queued = 0;
+    uint32_t m_batches = 0;
+    alignas(nlmsghdr) char m_receive[64 * 1024];
+};
+
+/** Wall time of each step, printed at the end */
+class Timer {
+public:
+    Timer() : m_start(std::chrono::steady_clock::now()), m_last(m_start) {}
+
+    void Step(const std::string &name) {
+        auto now = std::chrono::steady_clock::now();
+        m_steps.push_back({name, Ms(now - m_last)});
+        m_last = now;
+    }
+
+    void Print(std::ostream &os) const {
+        for (const auto &step : m_steps) {
+            os << "  " << step.first << ": " << step.second << " ms\n";
+        }
+        os << "  total: " << Ms(m_last - m_start) << " ms\n";
+    }
+
+private:
+    static double Ms(std::chrono::steady_clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    std::chrono::steady_clock::time_point m_start, m_last;
+    std::vector<std::pair<std::string, double>> m_steps;
+};
+
+/** Persistent TAP device, as `ip tuntap add <name> mode tap [multi_queue]` */
+static bool CreateTap(const std::string &name, bool multiQueue) {
+    int fd = open("/dev/net/tun", O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        std::perror("/dev/net/tun");
+        return false;
+    }
+    ifreq ifr = {};
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI | (multiQueue ? IFF_MULTI_QUEUE : 0);
+    std::strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
+    bool ok = ioctl(fd, TUNSETIFF, &ifr) == 0 && ioctl(fd, TUNSETPERSIST, 1) == 0;
+    if (!ok) {
+        std::cerr << "tap-provision: " << name << ": " << std::strerror(errno) << "\n";
+    }
+    close(fd);
+    return ok;
+}
+
+/** PIDs of the running node-<i> containers (0: not running), from one docker inspect */
+static std::vector<pid_t> ContainerPids(uint32_t nodes) {
+    std::vector<pid_t> pids(nodes, 0);
+    std::string command = "docker inspect --format '{{.Name}} {{.State.Pid}}'";
+    for (uint32_t i = 0; i < nodes; i++) {
+        command += " " + Name("node-", i);
+    }
+    command += " 2>/dev/null";
+    FILE *p = popen(command.c_str(), "r");
+    if (!p) {
+        return pids;
+    }
+    char name[256];
+    long pid;
+    while (std::fscanf(p, " /node-%255s %ld", name, &pid) == 2) {
+        uint32_t i = std::strtoul(name, nullptr, 10);
+        if (i < nodes) {
+            pids[i] = static_cast<pid_t>(pid);
+        }
+    }
+    pclose(p);
+    return pids;
+}
+
+/** eth0 MAC of node i: 12:34:88:5D:61:B0 + i */
+static void NodeMac(uint32_t i, uint8_t mac[6]) {
+    uint32_t low = 0x61B0 + i;
+    const uint8_t prefix[] = {0x12, 0x34, 0x88, 0x5D};
+    std::memcpy(mac, prefix, sizeof(prefix));
+    mac[4] = static_cast<uint8_t>(low >> 8);
+    mac[5] = static_cast<uint8_t>(low);
+}
+
+/** Same as scripts/tap-4node-setup.sh, which only writes what exists */
+static void DisableBridgeNetfilter() {
+    glob_t g;
+    if (glob("/proc/sys/net/bridge/bridge-nf-*", 0, nullptr, &g) != 0) {
+        return;
+    }
+    for (size_t i = 0; i < g.gl_pathc; i++) {
+        std::ofstream(g.gl_pathv[i]) << "0\n";
+    }
+    globfree(&g);
+}
+
+static ifinfomsg LinkInfo(int index = 0, uint32_t flags = 0) {
+    ifinfomsg info = {};
+    info.ifi_family = AF_UNSPEC;
+    info.ifi_index = index;
+    info.ifi_flags = flags;
+    info.ifi_change = flags;
+    return info;
+}
+
+static int Up(const Options &o, uint32_t nodes) {
+    Timer timer;
+    Rtnl rtnl;
+    if (!rtnl.Open()) {
+        return 1;
+    }
+
+    // Bridges and TAP devices that do not exist yet
+    std::map<std::string, int> links = rtnl.Links();
+    bool ok = true;
+    for (uint32_t i = 0; i < nodes; i++) {
+        if (!links.count(Name("br-", i))) {
+            rtnl.Begin(RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL, LinkInfo(), Name("create br-", i));
+            rtnl.Attr(IFLA_IFNAME, Name("br-", i));
+            size_t linkinfo = rtnl.Nest(IFLA_LINKINFO);
+            rtnl.Attr(IFLA_INFO_KIND, std::string("bridge"));
+            rtnl.EndNest(linkinfo);
+            rtnl.End();
+        }
+    }
+    ok = rtnl.Flush() && ok;
+    for (uint32_t i = 0; i < nodes; i++) {
+        if (!links.count(Name("tap-", i))) {
+            ok = CreateTap(Name("tap-", i), o.multiQueue) && ok;
+        }
+    }
+    timer.Step("bridges and TAP devices");
+
+    // TAP devices into their bridge, promiscuous and up; bridges up
+    links = rtnl.Links();
+    for (uint32_t i = 0; i < nodes; i++) {
+        int bridge = links[Name("br-", i)];
+        rtnl.Begin(RTM_NEWLINK, 0, LinkInfo(links[Name("tap-", i)], IFF_UP | IFF_PROMISC), Name("set tap-", i));
+        rtnl.Attr(IFLA_MASTER, static_cast<uint32_t>(bridge));
+        rtnl.Attr(IFLA_GROUP, kLinkGroup);
+        rtnl.End();
+        rtnl.Begin(RTM_NEWLINK, 0, LinkInfo(bridge, IFF_UP), Name("set br-", i));
+        rtnl.Attr(IFLA_GROUP, kLinkGroup);
+        rtnl.End();
+    }
+    ok = rtnl.Flush() && ok;
+    DisableBridgeNetfilter();
+    timer.Step("enslave and bring up");
+
+    if (o.compose) {
+        std::string command = "docker compose -f '" + o.scenario + "' up -d";
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << "Failed to start containers\n";
+            return 1;
+        }
+        timer.Step("docker compose up");
+    }
+    std::vector<pid_t> pids = ContainerPids(nodes);
+    timer.Step("docker inspect");
+
+    // veth pairs: the inner end is created in the container's netns as eth0
+    uint32_t veths = 0;
+    for (uint32_t i = 0; i < nodes; i++) {
+        rtnl.Begin(RTM_DELLINK, 0, LinkInfo(), Name("delete veth-int-", i), ENODEV);
+        rtnl.Attr(IFLA_IFNAME, Name("veth-int-", i));
+        rtnl.End();
+    }
+    rtnl.Flush();
+    for (uint32_t i = 0; i < nodes; i++) {
+        if (pids[i] <= 0) {
+            std::cout << "Warning: node-" << i << " not running, skipping\n";
+            continue;
+        }
+        uint8_t mac[6];
+        NodeMac(i, mac);
+        rtnl.Begin(RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL, LinkInfo(0, IFF_UP), Name("create veth-int-", i));
+        rtnl.Attr(IFLA_IFNAME, Name("veth-int-", i));
+        rtnl.Attr(IFLA_MASTER, static_cast<uint32_t>(links[Name("br-", i)]));
+        rtnl.Attr(IFLA_GROUP, kLinkGroup);
+        size_t linkinfo = rtnl.Nest(IFLA_LINKINFO);
+        rtnl.Attr(IFLA_INFO_KIND, std::string("veth"));
+        size_t data = rtnl.Nest(IFLA_INFO_DATA);
+        size_t peer = rtnl.Nest(VETH_INFO_PEER);
+        // Brought up later, from its netns: the peer cannot be opened before veth-int exists
+        ifinfomsg peerInfo = LinkInfo();
+        rtnl.Raw(&peerInfo, sizeof(peerInfo));
+        rtnl.Attr(IFLA_IFNAME, std::string("eth0"));
+        rtnl.Attr(IFLA_ADDRESS, mac, sizeof(mac));
+        rtnl.Attr(IFLA_NET_NS_PID, static_cast<uint32_t>(pids[i]));
+        rtnl.EndNest(peer);
+        rtnl.EndNest(data);
+        rtnl.EndNest(linkinfo);
+        rtnl.End();
+        veths++;
+    }
+    ok = rtnl.Flush() && ok;
+    timer.Step("veth pairs");
+
+    // Addresses, through a netlink socket in each container's netns
+    int self = open("/proc/self/ns/net", O_RDONLY | O_CLOEXEC);
+    uint8_t prefix = nodes < 254 ? 24 : 16;
+    uint32_t messages = rtnl.GetMessages(), batches = rtnl.GetBatches();
+    for (uint32_t i = 0; i < nodes; i++) {
+        if (pids[i] <= 0) {
+            continue;
+        }
+        int ns = open(("/proc/" + std::to_string(pids[i]) + "/ns/net").c_str(), O_RDONLY | O_CLOEXEC);
+        if (ns < 0 || setns(ns, CLONE_NEWNET) != 0) {
+            std::cerr << "tap-provision: netns of node-" << i << ": " << std::strerror(errno) << "\n";
+            ok = false;
+            if (ns >= 0) {
+                close(ns);
+            }
+            continue;
+        }
+        Rtnl inner;
+        bool opened = inner.Open();
+        int eth0 = if_nametoindex("eth0");
+        setns(self, CLONE_NEWNET);
+        close(ns);
+        if (!opened || eth0 == 0) {
+            ok = false;
+            continue;
+        }
+        uint32_t address = htonl((10u << 24) + i + 1);
+        ifaddrmsg info = {};
+        info.ifa_family = AF_INET;
+        info.ifa_prefixlen = prefix;
+        info.ifa_scope = RT_SCOPE_UNIVERSE;
+        info.ifa_index = eth0;
+        inner.Begin(RTM_NEWLINK, 0, LinkInfo(eth0, IFF_UP), Name("set eth0 of node-", i));
+        inner.End();
+        inner.Begin(RTM_NEWADDR, NLM_F_CREATE | NLM_F_REPLACE, info, Name("address of node-", i));
+        inner.Attr(IFA_LOCAL, &address, sizeof(address));
+        inner.Attr(IFA_ADDRESS, &address, sizeof(address));
+        inner.End();
+        ok = inner.Flush() && ok;
+        messages += inner.GetMessages();
+        batches += inner.GetBatches();
+        char text[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &address, text, sizeof(text));
+        if (i < 16) {
+            std::cout << "node-" << i << ": " << text << "\n";
+        }
+    }
+    close(self);
+    timer.Step("addresses");
+
+    std::cout << "Provisioned " << nodes << " nodes (" << veths << " containers attached): " << messages
+              << " netlink messages in " << batches << " batches\n";
+    timer.Print(std::cout);
+    return ok ? 0 : 1;
+}
+
+static int Down(const Options &o, uint32_t nodes) {
+    Timer timer;
+    if (o.compose) {
+        std::string command = "docker compose -f '" + o.scenario + "' down 2>/dev/null";
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << "docker compose down failed, removing the links anyway\n";
+        }
+        timer.Step("docker compose down");
+    }
+
+    // Deleting veth-int-<i> also deletes its peer, if its container still exists.
+    // The whole group goes in one request (one RCU grace period instead of
+    // one per link); links left by the shell scripts are then deleted by name.
+    Rtnl rtnl;
+    if (!rtnl.Open()) {
+        return 1;
+    }
+    rtnl.Begin(RTM_DELLINK, 0, LinkInfo(), "delete group", ENODEV);
+    rtnl.Attr(IFLA_GROUP, kLinkGroup);
+    rtnl.End();
+    rtnl.Flush();
+    for (const char *prefix : {"veth-int-", "tap-", "br-"}) {
+        for (uint32_t i = 0; i < nodes; i++) {
+            rtnl.Begin(RTM_DELLINK, 0, LinkInfo(), "delete " + Name(prefix, i), ENODEV);
+            rtnl.Attr(IFLA_IFNAME, Name(prefix, i));
+            rtnl.End();
+        }
+    }
+    bool ok = rtnl.Flush();
+    timer.Step("delete links");
+
+    std::cout << "Removed " << nodes << " nodes: " << rtnl.GetMessages() << " netlink messages in "
+              << rtnl.GetBatches() << " batches\n";
+    timer.Print(std::cout);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    Options o;
+    if (!ParseArgs(argc, argv, o)) {
+        Usage(argv[0]);
+        return 2;
+    }
+    uint32_t nodes = o.nodes ? o.nodes : CountNodes(o.scenario);
+    if (nodes == 0) {
+        std::cerr << o.scenario << ": no node-<i> containers (use --nodes)\n";
+        return 1;
+    }
+    std::cout << (o.command == "up" ? "Setting up: " : "Tearing down: ") << o.scenario << " (" << nodes
+              << " nodes)\n";
+    return o.command == "up" ? Up(o, nodes) : Down(o, nodes);
+}
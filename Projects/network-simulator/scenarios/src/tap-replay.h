@@ -0,0 +1,320 @@
+/*
+ * Record and replay of TAP ingress.
+ *
+ * TapBridge has no trace sources, so the scenarios put a TapPortDevice
+ * between each TapBridge and the WiFi device it bridges:
+ *
+ *   tap-N <-> TapBridge <-> TapPortDevice <-> WifiNetDevice
+ *
+ * The port forwards everything unchanged and fires TapIngress for every
+ * frame the bridge sends into the simulation (with the same arguments the
+ * bridge passes to Send/SendFrom) and TapEgress for every frame it offers
+ * back to the bridge. The bridge's receive callback goes to the real
+ * device, so the node's own stack stays disconnected from it, as without
+ * the port; otherwise the node would answer the hosts' traffic while it is
+ * being recorded.
+ *
+ * TapIngressRecorder writes TapIngress to a file; TapIngressReplay reads it
+ * back and calls Send/SendFrom on the same node's device at the same
+ * simulated time. Replay needs no TAP devices, no root and no realtime
+ * simulator, so a recorded run re-executes as fast as the default simulator
+ * goes, with identical results every time. It is open loop: the hosts'
+ * traffic is replayed as recorded, it does not react to the simulation.
+ *
+ * File: "T4TAPREC" | u32 node count | u32 reserved, then one record per
+ * frame (little endian):
+ *   u64 time (ns) | u32 node | u16 protocol | u8 flags | u8 reserved |
+ *   dst MAC (6) | src MAC (6) | u32 length | payload
+ * flags bit 0 means SendFrom (src is meaningful), otherwise Send.
+ */
+
+#ifndef TAP_REPLAY_H
+#define TAP_REPLAY_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+static const char kTapRecordMagic[8] = {'T', '4', 'T', 'A', 'P', 'R', 'E', 'C'};
+
+enum TapRecordFlags : uint8_t {
+    TAP_RECORD_SEND_FROM = 1,
+};
+
+/** Fixed part of a record, followed by length payload bytes */
+struct TapRecord {
+    uint64_t timeNs;
+    uint32_t node;
+    uint16_t protocol;
+    uint8_t flags;
+    uint8_t reserved;
+    uint8_t dst[6];
+    uint8_t src[6];
+    uint32_t length;
+};
+
+static_assert(sizeof(TapRecord) == 32, "TapRecord layout");
+
+/**
+ * Transparent proxy for the device bridged by a TapBridge
+ */
+class TapPortDevice : public NetDevice {
+public:
+    /** Bridge frame, destination, source (SendFrom only), protocol */
+    typedef void (*FrameCallback)(Ptr<const Packet> packet, const Address &dst, const Address &src,
+                                  uint16_t protocol);
+
+    static TypeId GetTypeId() {
+        static TypeId tid =
+            TypeId("ns3::TapPortDevice")
+                .SetParent<NetDevice>()
+                .SetGroupName("TapBridge")
+                .AddConstructor<TapPortDevice>()
+                .AddTraceSource("TapIngress", "A frame read from the TAP device enters the simulation",
+                                MakeTraceSourceAccessor(&TapPortDevice::m_ingressTrace),
+                                "ns3::TapPortDevice::FrameCallback")
+                .AddTraceSource("TapEgress", "A frame is offered to the TapBridge for the TAP device",
+                                MakeTraceSourceAccessor(&TapPortDevice::m_egressTrace),
+                                "ns3::TapPortDevice::FrameCallback");
+        return tid;
+    }
+
+    /** Wrap device and add the port to the device's node; bridge the port instead of device */
+    static Ptr<TapPortDevice> Install(Ptr<NetDevice> device) {
+        Ptr<TapPortDevice> port = CreateObject<TapPortDevice>();
+        port->m_device = device;
+        device->GetNode()->AddDevice(port);
+        return port;
+    }
+
+    Ptr<NetDevice> GetDevice() const { return m_device; }
+
+    void SetIfIndex(const uint32_t index) override { m_ifIndex = index; }
+    uint32_t GetIfIndex() const override { return m_ifIndex; }
+    Ptr<Channel> GetChannel() const override { return m_device->GetChannel(); }
+    void SetAddress(Address address) override { m_device->SetAddress(address); }
+    Address GetAddress() const override { return m_device->GetAddress(); }
+    bool SetMtu(const uint16_t mtu) override { return m_device->SetMtu(mtu); }
+    uint16_t GetMtu() const override { return m_device->GetMtu(); }
+    bool IsLinkUp() const override { return m_device->IsLinkUp(); }
+    void AddLinkChangeCallback(Callback<void> callback) override { m_device->AddLinkChangeCallback(callback); }
+    bool IsBroadcast() const override { return m_device->IsBroadcast(); }
+    Address GetBroadcast() const override { return m_device->GetBroadcast(); }
+    bool IsMulticast() const override { return m_device->IsMulticast(); }
+    Address GetMulticast(Ipv4Address group) const override { return m_device->GetMulticast(group); }
+    Address GetMulticast(Ipv6Address group) const override { return m_device->GetMulticast(group); }
+    bool IsBridge() const override { return m_device->IsBridge(); }
+    bool IsPointToPoint() const override { return m_device->IsPointToPoint(); }
+    Ptr<Node> GetNode() const override { return m_node; }
+    void SetNode(Ptr<Node> node) override { m_node = node; }
+    bool NeedsArp() const override { return m_device->NeedsArp(); }
+    bool SupportsSendFrom() const override { return m_device->SupportsSendFrom(); }
+
+    bool Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber) override {
+        m_ingressTrace(packet, dest, Address(), protocolNumber);
+        return m_device->Send(packet, dest, protocolNumber);
+    }
+
+    bool SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest,
+                  uint16_t protocolNumber) override {
+        m_ingressTrace(packet, dest, source, protocolNumber);
+        return m_device->SendFrom(packet, source, dest, protocolNumber);
+    }
+
+    /** The bridge disconnects the node's stack from the real device, not just from the port */
+    void SetReceiveCallback(ReceiveCallback cb) override { m_device->SetReceiveCallback(cb); }
+
+    /**
+     * TapBridge listens promiscuously on the device it bridges; forward what
+     * the real device receives under the port's name
+     */
+    void SetPromiscReceiveCallback(PromiscReceiveCallback cb) override {
+        if (m_promiscRxCallback.IsNull()) {
+            m_node->RegisterProtocolHandler(MakeCallback(&TapPortDevice::ReceiveFromDevice, this), 0,
+                                            m_device, true);
+        }
+        m_promiscRxCallback = cb;
+    }
+
+protected:
+    void DoDispose() override {
+        m_device = nullptr;
+        m_node = nullptr;
+        m_promiscRxCallback.Nullify();
+        NetDevice::DoDispose();
+    }
+
+private:
+    void ReceiveFromDevice(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                           const Address &src, const Address &dst, PacketType packetType) {
+        m_egressTrace(packet, dst, src, protocol);
+        m_promiscRxCallback(this, packet, protocol, src, dst, packetType);
+    }
+
+    Ptr<NetDevice> m_device;
+    Ptr<Node> m_node;
+    uint32_t m_ifIndex = 0;
+    PromiscReceiveCallback m_promiscRxCallback;
+    TracedCallback<Ptr<const Packet>, const Address &, const Address &, uint16_t> m_ingressTrace;
+    TracedCallback<Ptr<const Packet>, const Address &, const Address &, uint16_t> m_egressTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TapPortDevice);
+
+/**
+ * Writes the TapIngress of every attached port to a record file
+ */
+class TapIngressRecorder {
+public:
+    ~TapIngressRecorder() { Close(); }
+
+    bool Open(const std::string &path, uint32_t nodeCount) {
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file) {
+            return false;
+        }
+        std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+        uint32_t header[2] = {nodeCount, 0};
+        std::fwrite(kTapRecordMagic, 1, sizeof(kTapRecordMagic), m_file);
+        std::fwrite(header, 1, sizeof(header), m_file);
+        return true;
+    }
+
+    void Attach(Ptr<TapPortDevice> port) {
+        port->TraceConnectWithoutContext(
+            "TapIngress", MakeBoundCallback(&TapIngressRecorder::Ingress, this, port->GetNode()->GetId()));
+    }
+
+    void Close() {
+        if (m_file) {
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    uint64_t GetFrames() const { return m_frames; }
+
+private:
+    static void Ingress(TapIngressRecorder *recorder, uint32_t node, Ptr<const Packet> packet, const Address &dst,
+                        const Address &src, uint16_t protocol) {
+        if (!recorder->m_file) {
+            return;
+        }
+        TapRecord r = {};
+        r.timeNs = Simulator::Now().GetNanoSeconds();
+        r.node = node;
+        r.protocol = protocol;
+        r.flags = src.IsInvalid() ? 0 : TAP_RECORD_SEND_FROM;
+        Mac48Address::ConvertFrom(dst).CopyTo(r.dst);
+        if (r.flags & TAP_RECORD_SEND_FROM) {
+            Mac48Address::ConvertFrom(src).CopyTo(r.src);
+        }
+        r.length = packet->GetSize();
+        recorder->m_buffer.resize(r.length);
+        packet->CopyData(recorder->m_buffer.data(), r.length);
+        std::fwrite(&r, 1, sizeof(r), recorder->m_file);
+        std::fwrite(recorder->m_buffer.data(), 1, r.length, recorder->m_file);
+        recorder->m_frames++;
+    }
+
+    std::FILE *m_file = nullptr;
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_frames = 0;
+};
+
+/**
+ * Re-injects a record file into the devices of a (non-realtime) simulation.
+ * Records are read one at a time, each scheduled when the previous one runs.
+ */
+class TapIngressReplay {
+public:
+    ~TapIngressReplay() {
+        if (m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    /**
+     * Open the file and schedule its first frame. devices holds the device
+     * that was bridged on each node (first device per node id wins).
+     */
+    bool Start(const std::string &path, const NetDeviceContainer &devices) {
+        m_file = std::fopen(path.c_str(), "rb");
+        char magic[sizeof(kTapRecordMagic)];
+        uint32_t header[2];
+        if (!m_file || std::fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) ||
+            std::memcmp(magic, kTapRecordMagic, sizeof(magic)) != 0 ||
+            std::fread(header, 1, sizeof(header), m_file) != sizeof(header)) {
+            return false;
+        }
+        m_recordedNodes = header[0];
+        for (uint32_t i = 0; i < devices.GetN(); i++) {
+            uint32_t id = devices.Get(i)->GetNode()->GetId();
+            if (id >= m_devices.size()) {
+                m_devices.resize(id + 1);
+            }
+            if (!m_devices[id]) {
+                m_devices[id] = devices.Get(i);
+            }
+        }
+        ScheduleNext();
+        return true;
+    }
+
+    /** Node count of the recorded scenario, to check it matches the replay */
+    uint32_t GetRecordedNodes() const { return m_recordedNodes; }
+    uint64_t GetFrames() const { return m_frames; }
+    uint64_t GetSkipped() const { return m_skipped; }
+
+private:
+    void ScheduleNext() {
+        if (std::fread(&m_next, 1, sizeof(m_next), m_file) != sizeof(m_next)) {
+            return;
+        }
+        m_payload.resize(m_next.length);
+        if (m_next.length > 0 && std::fread(m_payload.data(), 1, m_next.length, m_file) != m_next.length) {
+            return;
+        }
+        Time at = NanoSeconds(static_cast<int64_t>(m_next.timeNs));
+        Time delay = at > Simulator::Now() ? at - Simulator::Now() : Time(0);
+        Simulator::ScheduleWithContext(m_next.node, delay, &TapIngressReplay::Inject, this);
+    }
+
+    void Inject() {
+        Ptr<NetDevice> device = m_next.node < m_devices.size() ? m_devices[m_next.node] : nullptr;
+        if (device) {
+            Ptr<Packet> packet = Create<Packet>(m_payload.data(), m_next.length);
+            Mac48Address dst;
+            dst.CopyFrom(m_next.dst);
+            if (m_next.flags & TAP_RECORD_SEND_FROM) {
+                Mac48Address src;
+                src.CopyFrom(m_next.src);
+                device->SendFrom(packet, src, dst, m_next.protocol);
+            } else {
+                device->Send(packet, dst, m_next.protocol);
+            }
+            m_frames++;
+        } else {
+            m_skipped++;
+        }
+        ScheduleNext();
+    }
+
+    std::FILE *m_file = nullptr;
+    std::vector<Ptr<NetDevice>> m_devices;
+    uint32_t m_recordedNodes = 0;
+    TapRecord m_next;
+    std::vector<uint8_t> m_payload;
+    uint64_t m_frames = 0;
+    uint64_t m_skipped = 0;
+};
+
+} // namespace ns3
+
+#endif /* TAP_REPLAY_H */
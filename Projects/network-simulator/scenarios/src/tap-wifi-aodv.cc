@@ -1,6 +1,14 @@
 /*
  * TAP-WIFI-AODV MANET - 4 Mobile Nodes
  * Wireless ad-hoc network with AODV routing and RandomWaypoint mobility
+ *
+ * --tapRecord=<file> records the frames read from tap-0..tap-3;
+ * --tapReplay=<file> replays them without TAP devices under the default
+ * simulator (see tap-replay.h). --flowLatency reports latency and loss per
+ * container flow at exit (flow-latency.h). --trace=<spec> samples and
+ * filters the MAC counters and the capture (trace-filter.h).
+ * --tap=false runs headless for benchmarking: default simulator, no TAP,
+ * synthetic UDP echo traffic between the nodes (echo-traffic.h).
  */
 
 #include "ns3/core-module.h"
@@ -10,6 +18,15 @@
 #include "ns3/mobility-module.h"
 #include "ns3/aodv-module.h"
 #include "ns3/tap-bridge-module.h"
+#include "echo-traffic.h"
+#include "flow-latency.h"
+#include "pcapng-capture.h"
+#include "realtime-lag-monitor.h"
+#include "run-stats.h"
+#include "spatial-wifi-channel.h"
+#include "tap-replay.h"
+#include "trace-filter.h"
+#include "trajectory-mobility.h"
 #include <iostream>
 
 using namespace ns3;
@@ -17,8 +34,15 @@ using namespace ns3;
 NS_LOG_COMPONENT_DEFINE("TapWifiAodvManet");
 
 static uint64_t g_bytes[4] = {0}, g_packets[4] = {0};
+static TraceFilter g_trace;
+
+// Synthetic (headless) echo traffic: requests sent, replies received
+static EchoTrafficStats g_echo;
 
 static void RxCallback(uint32_t idx, Ptr<const Packet> p) {
+    if (!g_trace.Accept(idx, p, TRACE_LLC)) {
+        return;
+    }
     g_bytes[idx] += p->GetSize();
     g_packets[idx]++;
 }
@@ -40,6 +64,16 @@ static void PrintPositions(NodeContainer& nodes) {
 int main(int argc, char* argv[]) {
     bool verbose = false;
     double time = 300.0, speed = 2.0, pause = 5.0, txPower = 20.0;
+    bool spatialChannel = true;
+    bool pcap = true;
+    PcapngOptions pcapOptions;
+    bool lagMonitor = true;
+    bool tap = true;
+    double echoInterval = 1.0;
+    std::string tapRecord, tapReplay;
+    std::string trajectory;
+    bool flowLatency = true;
+    std::string traceSpec;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("verbose", "Enable logging", verbose);
@@ -47,17 +81,44 @@ int main(int argc, char* argv[]) {
     cmd.AddValue("speed", "Max node speed (m/s)", speed);
     cmd.AddValue("pause", "Pause at waypoints (s)", pause);
     cmd.AddValue("txPower", "TX power (dBm)", txPower);
+    cmd.AddValue("spatialChannel", "Use the spatially indexed WiFi channel (false: stock YansWifiChannel)", spatialChannel);
+    cmd.AddValue("pcap", "Write the merged pcapng capture /tmp/aodv-*.pcapng", pcap);
+    pcapOptions.AddValues(cmd);
+    cmd.AddValue("lagMonitor", "Measure realtime scheduling lag per event", lagMonitor);
+    cmd.AddValue("trajectory", "Precomputed trajectory file from trajectory-gen (replaces RandomWaypoint)", trajectory);
+    cmd.AddValue("tap", "Bridge to TAP devices in realtime; false runs headless with synthetic traffic", tap);
+    cmd.AddValue("echoInterval", "Seconds between the echo requests of each node (headless)", echoInterval);
+    cmd.AddValue("tapRecord", "Record the frames read from the TAP devices to this file", tapRecord);
+    cmd.AddValue("tapReplay", "Replay a --tapRecord file without TAP devices, faster than realtime", tapReplay);
+    cmd.AddValue("flowLatency", "Per-flow latency and loss of the container traffic (TAP ingress to egress)",
+                 flowLatency);
+    cmd.AddValue("trace", "Packets seen by the MAC counters and the capture (see trace-filter.h)", traceSpec);
     cmd.Parse(argc, argv);
+    if (!tapReplay.empty()) {
+        tap = false;
+    }
+    std::string traceError;
+    if (!g_trace.Parse(traceSpec, traceError)) {
+        NS_FATAL_ERROR("--trace: " << traceError);
+    }
 
     if (verbose) {
         LogComponentEnable("TapWifiAodvManet", LOG_LEVEL_INFO);
         LogComponentEnable("AodvRoutingProtocol", LOG_LEVEL_DEBUG);
     }
 
-    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    if (tap) {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    }
     GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
 
-    std::cout << "TAP-WIFI-AODV MANET (4 Mobile Nodes)\n";
+    // Measure how far the realtime event loop falls behind the wall clock
+    if (tap && lagMonitor) {
+        RealtimeLagMonitor::Get().Enable();
+    }
+
+    std::cout << "TAP-WIFI-AODV MANET (4 Mobile Nodes)"
+              << (tap ? "" : tapReplay.empty() ? " (headless)" : ", replay of " + tapReplay) << "\n";
 
     NodeContainer nodes;
     nodes.Create(4);
@@ -66,31 +127,36 @@ int main(int argc, char* argv[]) {
     WifiHelper wifi;
     wifi.SetStandard(WIFI_STANDARD_80211a);
 
-    YansWifiPhyHelper wifiPhy;
+    SpatialYansWifiPhyHelper wifiPhy;
     wifiPhy.Set("TxPowerStart", DoubleValue(txPower));
     wifiPhy.Set("TxPowerEnd", DoubleValue(txPower));
 
-    YansWifiChannelHelper wifiChannel;
-    wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-    wifiChannel.AddPropagationLoss("ns3::RangePropagationLossModel", "MaxRange", DoubleValue(100.0));
-    wifiPhy.SetChannel(wifiChannel.Create());
+    Ptr<YansWifiChannel> channel = CreateRangeWifiChannel(100.0, spatialChannel);
+    wifiPhy.SetChannel(channel);
 
     WifiMacHelper wifiMac;
     wifiMac.SetType("ns3::AdhocWifiMac");
     NetDeviceContainer devices = wifi.Install(wifiPhy, wifiMac, nodes);
 
-    // Mobility
-    MobilityHelper mobility;
-    mobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
-        "X", StringValue("ns3::UniformRandomVariable[Min=0|Max=100]"),
-        "Y", StringValue("ns3::UniformRandomVariable[Min=0|Max=100]"));
-
-    std::ostringstream ss, ps;
-    ss << "ns3::UniformRandomVariable[Min=0|Max=" << speed << "]";
-    ps << "ns3::ConstantRandomVariable[Constant=" << pause << "]";
-    mobility.SetMobilityModel("ns3::RandomWaypointMobilityModel",
-        "Speed", StringValue(ss.str()), "Pause", StringValue(ps.str()));
-    mobility.Install(nodes);
+    // Mobility: RandomWaypoint, or tracks precomputed by trajectory-gen
+    if (trajectory.empty()) {
+        MobilityHelper mobility;
+        mobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
+            "X", StringValue("ns3::UniformRandomVariable[Min=0|Max=100]"),
+            "Y", StringValue("ns3::UniformRandomVariable[Min=0|Max=100]"));
+
+        std::ostringstream ss, ps;
+        ss << "ns3::UniformRandomVariable[Min=0|Max=" << speed << "]";
+        ps << "ns3::ConstantRandomVariable[Constant=" << pause << "]";
+        mobility.SetMobilityModel("ns3::RandomWaypointMobilityModel",
+            "Speed", StringValue(ss.str()), "Pause", StringValue(ps.str()));
+        mobility.Install(nodes);
+    } else {
+        std::string error;
+        if (!InstallTrajectories(nodes, trajectory, error)) {
+            NS_FATAL_ERROR(error);
+        }
+    }
 
     // AODV routing
     AodvHelper aodv;
@@ -106,24 +172,82 @@ int main(int argc, char* argv[]) {
         std::cout << "Node " << i << ": " << interfaces.GetAddress(i) << "\n";
 
     // Tracing
-    wifiPhy.EnablePcapAll("/tmp/aodv");
+    PcapngCapture capture;
+    if (pcap) {
+        if (!capture.Start("/tmp/aodv", pcapOptions)) {
+            NS_FATAL_ERROR("Cannot start the pcapng capture");
+        }
+        capture.SetFilter(&g_trace);
+        capture.Attach(devices);
+    }
     devices.Get(0)->TraceConnectWithoutContext("MacRx", MakeCallback(&Rx0));
     devices.Get(1)->TraceConnectWithoutContext("MacRx", MakeCallback(&Rx1));
     devices.Get(2)->TraceConnectWithoutContext("MacRx", MakeCallback(&Rx2));
     devices.Get(3)->TraceConnectWithoutContext("MacRx", MakeCallback(&Rx3));
 
-    // TAP bridges
-    TapBridgeHelper tapBridge;
-    tapBridge.SetAttribute("Mode", StringValue("UseLocal"));
-    const char* taps[] = {"tap-0", "tap-1", "tap-2", "tap-3"};
-    for (uint32_t i = 0; i < 4; i++) {
-        tapBridge.SetAttribute("DeviceName", StringValue(taps[i]));
-        tapBridge.Install(nodes.Get(i), devices.Get(i));
+    // TAP bridges, through a recording and timestamping port if asked to
+    TapIngressRecorder recorder;
+    TapIngressReplay replay;
+    FlowLatencyMonitor flows;
+    if (tap) {
+        if (!tapRecord.empty() && !recorder.Open(tapRecord, nodes.GetN())) {
+            NS_FATAL_ERROR("Cannot open TAP record file " << tapRecord);
+        }
+        TapBridgeHelper tapBridge;
+        tapBridge.SetAttribute("Mode", StringValue("UseLocal"));
+        const char* taps[] = {"tap-0", "tap-1", "tap-2", "tap-3"};
+        for (uint32_t i = 0; i < 4; i++) {
+            Ptr<NetDevice> bridged = devices.Get(i);
+            if (!tapRecord.empty() || flowLatency) {
+                Ptr<TapPortDevice> port = TapPortDevice::Install(bridged);
+                if (!tapRecord.empty()) {
+                    recorder.Attach(port);
+                }
+                if (flowLatency) {
+                    flows.Attach(port);
+                }
+                bridged = port;
+            }
+            tapBridge.SetAttribute("DeviceName", StringValue(taps[i]));
+            tapBridge.Install(nodes.Get(i), bridged);
+        }
+    } else if (!tapReplay.empty()) {
+        if (!replay.Start(tapReplay, devices)) {
+            NS_FATAL_ERROR("Cannot read TAP record file " << tapReplay);
+        }
+    } else {
+        InstallEchoTraffic(nodes, interfaces, Seconds(echoInterval), 64, Seconds(time), g_echo);
     }
 
     Simulator::Schedule(Seconds(1.0), &PrintPositions, nodes);
+    RunStats runStats;
     Simulator::Stop(Seconds(time));
+    runStats.Start();
     Simulator::Run();
+    runStats.Stop();
+    capture.Stop();
+    recorder.Close();
+    std::cout << "\nMAC RX:";
+    for (uint32_t i = 0; i < 4; i++) {
+        std::cout << " N" << i << "=" << g_packets[i] << "pkts/" << g_bytes[i] << "B";
+    }
+    std::cout << "\n";
+    PrintSpatialChannelStats(channel);
+    RealtimeLagMonitor::Get().Print(std::cout);
+    if (pcap) {
+        capture.Print(std::cout);
+    }
+    flows.Print(std::cout);
+    if (tap && !tapRecord.empty()) {
+        std::cout << "TAP record: " << recorder.GetFrames() << " frames in " << tapRecord << "\n";
+    }
+    if (!tapReplay.empty()) {
+        std::cout << "TAP replay: " << replay.GetFrames() << " frames injected\n";
+    } else if (!tap) {
+        std::cout << "Echo: " << g_echo.tx << " requests, " << g_echo.rx << " replies (pdr=" << g_echo.DeliveryRatio()
+                  << ")\n";
+    }
+    runStats.Print();
     Simulator::Destroy();
     return 0;
 }
@@ -0,0 +1,426 @@
+/*
+ * Sampled and filtered tracing
+ *
+ * One filter in front of every per-packet trace sink (node counters and
+ * event log, pcapng capture, binary animation), configured by a single
+ * --trace spec of ';'-separated clauses, all of which must match:
+ *
+ *   sample=N            1 in N packets, chosen by a hash of the packet uid,
+ *                       so a packet is kept (or not) at every node and layer
+ *   nodes=0-3,7         only these node ids
+ *   flows=F[,F...]      only IPv4 packets of these flows; F is a protocol
+ *                       (tcp, udp, icmp, a number or *), a flow
+ *                       [proto/]src[:port]>dst[:port] with * for any part
+ *                       and a.b.c.d/len prefixes, e.g. udp/10.0.0.1>*:5000
+ *   window=10-20,40-   simulated seconds [start, end), open-ended without end
+ *
+ * e.g. --trace="sample=10;nodes=0-3;window=30-60". An empty spec keeps
+ * everything and costs one branch per trace call. Headers are only looked
+ * at when flows= is set: sinks pass the layer their packet starts at
+ * (IPv4, LLC/SNAP, 802.11 or Ethernet) and frames without an IPv4 packet
+ * do not match any flow.
+ */
+
+#ifndef TRACE_FILTER_H
+#define TRACE_FILTER_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/** Where the bytes handed to the filter start */
+enum TraceLayer {
+    TRACE_IPV4,     // IPv4 header (Ipv4L3Protocol Tx/Rx)
+    TRACE_LLC,      // LLC/SNAP header (WifiMac MacTx/MacRx)
+    TRACE_WIFI,     // 802.11 MAC header (WifiPhy traces and sniffers)
+    TRACE_ETHERNET, // Ethernet header (CSMA sniffers)
+};
+
+class TraceFilter {
+public:
+    /** IPv4 5-tuple as seen by the filter; ports are 0 when unknown */
+    struct Flow {
+        uint32_t src = 0;
+        uint32_t dst = 0;
+        uint16_t srcPort = 0;
+        uint16_t dstPort = 0;
+        uint8_t protocol = 0;
+    };
+
+    /** Replace the filter with spec; false (filter unchanged) and error on a bad spec */
+    bool Parse(const std::string &spec, std::string &error) {
+        TraceFilter f;
+        f.m_spec = spec;
+        for (const std::string &clause : Split(spec, ';')) {
+            if (clause.empty()) {
+                continue;
+            }
+            size_t eq = clause.find('=');
+            std::string key = clause.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : clause.substr(eq + 1);
+            bool ok;
+            if (key == "sample") {
+                char *end;
+                f.m_sample = std::strtoul(value.c_str(), &end, 10);
+                ok = !value.empty() && *end == '\0' && f.m_sample > 0;
+            } else if (key == "nodes") {
+                ok = f.ParseNodes(value);
+            } else if (key == "flows") {
+                ok = f.ParseFlows(value);
+            } else if (key == "window") {
+                ok = f.ParseWindows(value);
+            } else {
+                error = "unknown trace clause '" + key + "' (sample, nodes, flows, window)";
+                return false;
+            }
+            if (!ok) {
+                error = "bad trace clause '" + clause + "'";
+                return false;
+            }
+        }
+        f.m_active = f.m_sample > 1 || !f.m_nodes.empty() || !f.m_flows.empty() || !f.m_windows.empty();
+        *this = f;
+        return true;
+    }
+
+    /** Whether anything is filtered at all */
+    bool IsActive() const { return m_active; }
+
+    /** Whether Accept looks at the packet's headers */
+    bool HasFlows() const { return !m_flows.empty(); }
+
+    /** First and last simulated second of the windows (0 and -1 without windows) */
+    double GetStart() const { return m_windows.empty() ? 0 : m_windows.front().start / 1e9; }
+    double GetStop() const {
+        if (m_windows.empty()) {
+            return -1;
+        }
+        // Sorted by start only; a window that starts later can end sooner
+        int64_t stop = 0;
+        for (const Window &w : m_windows) {
+            stop = std::max(stop, w.end);
+        }
+        return stop / 1e9;
+    }
+
+    /** Keep packet p, which starts at layer, at node now? */
+    bool Accept(uint32_t node, Ptr<const Packet> p, TraceLayer layer) const {
+        if (!m_active) {
+            return true;
+        }
+        if (!AcceptCheap(node, p->GetUid(), Simulator::Now().GetNanoSeconds())) {
+            return false;
+        }
+        if (m_flows.empty()) {
+            return true;
+        }
+        uint8_t b[kMaxHeaders];
+        Flow flow;
+        return ParseFlow(b, p->CopyData(b, sizeof(b)), layer, flow) && MatchFlow(flow);
+    }
+
+    /** Keep the IP payload p with header (e.g. Ipv4L3Protocol Drop)? */
+    bool Accept(uint32_t node, Ptr<const Packet> p, const Ipv4Header &header) const {
+        if (!m_active) {
+            return true;
+        }
+        if (!AcceptCheap(node, p->GetUid(), Simulator::Now().GetNanoSeconds())) {
+            return false;
+        }
+        if (m_flows.empty()) {
+            return true;
+        }
+        Flow flow;
+        flow.src = header.GetSource().Get();
+        flow.dst = header.GetDestination().Get();
+        flow.protocol = header.GetProtocol();
+        uint8_t b[4];
+        if ((flow.protocol == 6 || flow.protocol == 17) && header.GetFragmentOffset() == 0 &&
+            p->CopyData(b, 4) == 4) {
+            flow.srcPort = static_cast<uint16_t>(b[0] << 8 | b[1]);
+            flow.dstPort = static_cast<uint16_t>(b[2] << 8 | b[3]);
+        }
+        return MatchFlow(flow);
+    }
+
+    /** Find the IPv4 5-tuple in the first length bytes of a frame starting at layer */
+    static bool ParseFlow(const uint8_t *b, uint32_t length, TraceLayer layer, Flow &flow) {
+        uint32_t offset = 0;
+        if (layer == TRACE_WIFI) {
+            // Data frames only: 24 byte header, +6 with four addresses, +2 for QoS
+            if (length < 24 || ((b[0] >> 2) & 3) != 2) {
+                return false;
+            }
+            offset = 24 + ((b[1] & 3) == 3 ? 6 : 0) + ((b[0] & 0x80) ? 2 : 0);
+        }
+        if (layer == TRACE_WIFI || layer == TRACE_LLC) {
+            if (length < offset + 8 || b[offset] != 0xaa || b[offset + 1] != 0xaa || b[offset + 6] != 0x08 ||
+                b[offset + 7] != 0x00) {
+                return false;
+            }
+            offset += 8;
+        } else if (layer == TRACE_ETHERNET) {
+            if (length < 14 || b[12] != 0x08 || b[13] != 0x00) {
+                return false;
+            }
+            offset = 14;
+        }
+        const uint8_t *ip = b + offset;
+        if (length < offset + 20 || (ip[0] >> 4) != 4) {
+            return false;
+        }
+        flow.protocol = ip[9];
+        flow.src = static_cast<uint32_t>(ip[12]) << 24 | ip[13] << 16 | ip[14] << 8 | ip[15];
+        flow.dst = static_cast<uint32_t>(ip[16]) << 24 | ip[17] << 16 | ip[18] << 8 | ip[19];
+        flow.srcPort = flow.dstPort = 0;
+        uint32_t ihl = (ip[0] & 0x0f) * 4u;
+        bool first = ((ip[6] & 0x1f) | ip[7]) == 0;
+        if (first && (flow.protocol == 6 || flow.protocol == 17) && length >= offset + ihl + 4) {
+            flow.srcPort = static_cast<uint16_t>(ip[ihl] << 8 | ip[ihl + 1]);
+            flow.dstPort = static_cast<uint16_t>(ip[ihl + 2] << 8 | ip[ihl + 3]);
+        }
+        return true;
+    }
+
+    /** One line describing what is kept */
+    void Print(std::ostream &os) const {
+        if (!m_active) {
+            os << "Tracing: every packet\n";
+            return;
+        }
+        os << "Tracing: " << m_spec;
+        if (m_sample > 1) {
+            os << " (1 in " << m_sample << " packets, counters are not scaled)";
+        }
+        os << "\n";
+    }
+
+private:
+    // 802.11 header with four addresses and QoS, LLC/SNAP, IPv4 with options, ports
+    static const uint32_t kMaxHeaders = 32 + 8 + 60 + 4;
+
+    struct FlowMatch {
+        uint8_t protocol = 0; // 0: any
+        uint32_t src = 0, srcMask = 0;
+        uint32_t dst = 0, dstMask = 0;
+        uint16_t srcPort = 0, dstPort = 0; // 0: any
+    };
+
+    struct Window {
+        int64_t start;
+        int64_t end;
+    };
+
+    bool AcceptCheap(uint32_t node, uint64_t uid, int64_t nowNs) const {
+        if (!m_windows.empty()) {
+            bool inside = false;
+            for (const Window &w : m_windows) {
+                if (nowNs >= w.start && nowNs < w.end) {
+                    inside = true;
+                    break;
+                }
+            }
+            if (!inside) {
+                return false;
+            }
+        }
+        if (!m_nodes.empty() && (node >= m_nodes.size() || !m_nodes[node])) {
+            return false;
+        }
+        return m_sample <= 1 || Mix(uid) % m_sample == 0;
+    }
+
+    bool MatchFlow(const Flow &flow) const {
+        for (const FlowMatch &m : m_flows) {
+            if ((m.protocol == 0 || m.protocol == flow.protocol) && (flow.src & m.srcMask) == m.src &&
+                (flow.dst & m.dstMask) == m.dst && (m.srcPort == 0 || m.srcPort == flow.srcPort) &&
+                (m.dstPort == 0 || m.dstPort == flow.dstPort)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** splitmix64 finalizer: uids are sequential, the sample should not be */
+    static uint64_t Mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static std::vector<std::string> Split(const std::string &s, char sep) {
+        std::vector<std::string> parts;
+        std::string part;
+        std::istringstream in(s);
+        while (std::getline(in, part, sep)) {
+            size_t b = part.find_first_not_of(" \t");
+            size_t e = part.find_last_not_of(" \t");
+            parts.push_back(b == std::string::npos ? "" : part.substr(b, e - b + 1));
+        }
+        return parts;
+    }
+
+    static bool ParseUint(const std::string &s, uint64_t max, uint64_t &value) {
+        char *end;
+        value = std::strtoull(s.c_str(), &end, 10);
+        return !s.empty() && *end == '\0' && value <= max && s[0] != '-';
+    }
+
+    bool ParseNodes(const std::string &value) {
+        for (const std::string &range : Split(value, ',')) {
+            size_t dash = range.find('-');
+            uint64_t first, last;
+            if (!ParseUint(range.substr(0, dash), 1u << 20, first)) {
+                return false;
+            }
+            last = first;
+            if (dash != std::string::npos && (!ParseUint(range.substr(dash + 1), 1u << 20, last) || last < first)) {
+                return false;
+            }
+            if (m_nodes.size() <= last) {
+                m_nodes.resize(last + 1, false);
+            }
+            for (uint64_t n = first; n <= last; n++) {
+                m_nodes[n] = true;
+            }
+        }
+        return !m_nodes.empty();
+    }
+
+    static bool ParseProtocol(const std::string &s, uint8_t &protocol) {
+        uint64_t n;
+        if (s == "*") {
+            protocol = 0;
+        } else if (s == "tcp") {
+            protocol = 6;
+        } else if (s == "udp") {
+            protocol = 17;
+        } else if (s == "icmp") {
+            protocol = 1;
+        } else if (ParseUint(s, 255, n)) {
+            protocol = static_cast<uint8_t>(n);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /** "a.b.c.d[/len][:port]" or "*[:port]" */
+    static bool ParseEndpoint(const std::string &s, uint32_t &addr, uint32_t &mask, uint16_t &port) {
+        size_t colon = s.find(':');
+        std::string host = s.substr(0, colon);
+        port = 0;
+        uint64_t n;
+        if (colon != std::string::npos) {
+            std::string p = s.substr(colon + 1);
+            if (p != "*") {
+                if (!ParseUint(p, 65535, n)) {
+                    return false;
+                }
+                port = static_cast<uint16_t>(n);
+            }
+        }
+        if (host == "*") {
+            addr = mask = 0;
+            return true;
+        }
+        uint64_t len = 32;
+        size_t slash = host.find('/');
+        if (slash != std::string::npos && !ParseUint(host.substr(slash + 1), 32, len)) {
+            return false;
+        }
+        std::vector<std::string> octets = Split(host.substr(0, slash), '.');
+        if (octets.size() != 4) {
+            return false;
+        }
+        addr = 0;
+        for (const std::string &o : octets) {
+            if (!ParseUint(o, 255, n)) {
+                return false;
+            }
+            addr = addr << 8 | static_cast<uint32_t>(n);
+        }
+        mask = len == 0 ? 0 : ~0u << (32 - len);
+        addr &= mask;
+        return true;
+    }
+
+    bool ParseFlows(const std::string &value) {
+        for (const std::string &f : Split(value, ',')) {
+            FlowMatch m;
+            size_t slash = f.find('/');
+            size_t arrow = f.find('>');
+            std::string endpoints = f;
+            if (arrow == std::string::npos) {
+                // Protocol only
+                if (!ParseProtocol(f, m.protocol)) {
+                    return false;
+                }
+                m_flows.push_back(m);
+                continue;
+            }
+            // A '/' before the first '.' separates the protocol, later ones are prefix lengths
+            size_t dot = f.find('.');
+            if (slash != std::string::npos && (dot == std::string::npos || slash < dot) && slash < arrow) {
+                if (!ParseProtocol(f.substr(0, slash), m.protocol)) {
+                    return false;
+                }
+                endpoints = f.substr(slash + 1);
+                arrow = endpoints.find('>');
+            }
+            if (!ParseEndpoint(endpoints.substr(0, arrow), m.src, m.srcMask, m.srcPort) ||
+                !ParseEndpoint(endpoints.substr(arrow + 1), m.dst, m.dstMask, m.dstPort)) {
+                return false;
+            }
+            m_flows.push_back(m);
+        }
+        return !m_flows.empty();
+    }
+
+    bool ParseWindows(const std::string &value) {
+        for (const std::string &range : Split(value, ',')) {
+            size_t dash = range.find('-');
+            if (dash == std::string::npos) {
+                return false;
+            }
+            char *end;
+            std::string a = range.substr(0, dash);
+            std::string b = range.substr(dash + 1);
+            double start = std::strtod(a.c_str(), &end);
+            if (a.empty() || *end != '\0') {
+                return false;
+            }
+            double stop = b.empty() ? 1e9 : std::strtod(b.c_str(), &end);
+            if (*end != '\0' || start < 0 || stop <= start) {
+                return false;
+            }
+            m_windows.push_back({static_cast<int64_t>(start * 1e9), static_cast<int64_t>(stop * 1e9)});
+        }
+        std::sort(m_windows.begin(), m_windows.end(),
+                  [](const Window &x, const Window &y) { return x.start < y.start; });
+        return !m_windows.empty();
+    }
+
+    std::string m_spec;
+    bool m_active = false;
+    uint64_t m_sample = 1;
+    std::vector<bool> m_nodes;
+    std::vector<FlowMatch> m_flows;
+    std::vector<Window> m_windows;
+};
+
+} // namespace ns3
+
+#endif /* TRACE_FILTER_H */
@@ -0,0 +1,135 @@
+/*
+ * Precomputed node trajectories: file format shared by the generator
+ * (trajectory-gen.cc) and the mobility model (trajectory-mobility.h).
+ *
+ * Each node moves along piecewise-linear segments: from time t0 it is at
+ * (x, y) + (vx, vy) * (t - t0), until the t0 of its next segment. The last
+ * segment of a node never ends. All values are native (little endian):
+ *
+ *   header   "T4TRAJ01" | u32 nodes | u32 reserved | f64 duration | u64 segments
+ *   index    u64 first segment of node i, for i = 0..nodes (nodes + 1 entries)
+ *   segments TrajectorySegment[segments], grouped by node, sorted by t0
+ *
+ * The file is used in place through mmap, so every run (and every process
+ * of a sweep) shares the same page-cache copy.
+ */
+
+#ifndef TRAJECTORY_FORMAT_H
+#define TRAJECTORY_FORMAT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char kTrajectoryMagic[8] = {'T', '4', 'T', 'R', 'A', 'J', '0', '1'};
+
+struct TrajectoryHeader {
+    char magic[8];
+    uint32_t nodes;
+    uint32_t reserved;
+    double duration;
+    uint64_t segments;
+};
+
+struct TrajectorySegment {
+    double t0;
+    float x, y;
+    float vx, vy;
+};
+
+static_assert(sizeof(TrajectoryHeader) == 32, "TrajectoryHeader layout");
+static_assert(sizeof(TrajectorySegment) == 24, "TrajectorySegment layout");
+
+/**
+ * Read-only mapping of a trajectory file
+ */
+class TrajectoryFile {
+public:
+    TrajectoryFile() = default;
+    TrajectoryFile(const TrajectoryFile &) = delete;
+    TrajectoryFile &operator=(const TrajectoryFile &) = delete;
+
+    ~TrajectoryFile() {
+        if (m_base) {
+            munmap(m_base, m_size);
+        }
+    }
+
+    /** Map and validate path; false (with GetError()) if it is not a usable trajectory file */
+    bool Open(const std::string &path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            m_error = std::string("cannot open: ") + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(TrajectoryHeader))) {
+            close(fd);
+            m_error = "too short";
+            return false;
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        void *base = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            m_error = std::string("mmap: ") + std::strerror(errno);
+            return false;
+        }
+        m_base = base;
+
+        m_header = static_cast<const TrajectoryHeader *>(m_base);
+        if (std::memcmp(m_header->magic, kTrajectoryMagic, sizeof(kTrajectoryMagic)) != 0) {
+            m_error = "not a trajectory file";
+            return false;
+        }
+        uint64_t expected = sizeof(TrajectoryHeader) + (uint64_t(m_header->nodes) + 1) * sizeof(uint64_t) +
+                            m_header->segments * sizeof(TrajectorySegment);
+        if (expected != m_size) {
+            m_error = "truncated";
+            return false;
+        }
+        m_index = reinterpret_cast<const uint64_t *>(m_header + 1);
+        m_segments = reinterpret_cast<const TrajectorySegment *>(m_index + m_header->nodes + 1);
+        for (uint32_t i = 0; i < m_header->nodes; i++) {
+            if (m_index[i] >= m_index[i + 1] || m_index[i + 1] > m_header->segments) {
+                m_error = "bad index for node " + std::to_string(i);
+                return false;
+            }
+        }
+        madvise(m_base, m_size, MADV_WILLNEED);
+        return true;
+    }
+
+    const std::string &GetError() const { return m_error; }
+    uint32_t GetNodes() const { return m_header->nodes; }
+    double GetDuration() const { return m_header->duration; }
+    uint64_t GetSegmentCount() const { return m_header->segments; }
+
+    /** Segments of one node, sorted by t0 */
+    const TrajectorySegment *Segments(uint32_t node) const { return m_segments + m_index[node]; }
+    uint64_t SegmentCount(uint32_t node) const { return m_index[node + 1] - m_index[node]; }
+
+    /** Segment active at time t: the last one with t0 <= t (the first one before it starts) */
+    static uint64_t Find(const TrajectorySegment *segments, uint64_t count, double t) {
+        const TrajectorySegment *it = std::upper_bound(
+            segments, segments + count, t, [](double time, const TrajectorySegment &s) { return time < s.t0; });
+        return it == segments ? 0 : static_cast<uint64_t>(it - segments - 1);
+    }
+
+private:
+    void *m_base = nullptr;
+    size_t m_size = 0;
+    const TrajectoryHeader *m_header = nullptr;
+    const uint64_t *m_index = nullptr;
+    const TrajectorySegment *m_segments = nullptr;
+    std::string m_error;
+};
+
+#endif /* TRAJECTORY_FORMAT_H */
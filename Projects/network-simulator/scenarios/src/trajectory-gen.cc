@@ -0,0 +1,243 @@
+/*
+ * Generate a trajectory file (trajectory-format.h) for --trajectory
+ *
+ * Produces the same kinds of movement as SetupMobility() in
+ * manet-aodv-static.cc, on the same initial layout (the original 2x2
+ * positions for 4 nodes, a grid with --spacing otherwise) and area:
+ *   random-waypoint  destination uniform in the area, speed uniform in
+ *                    [minSpeed, speed], then --pause seconds still
+ *   random-walk      direction uniform, speed uniform in [1, speed], a new
+ *                    draw every --walkDistance metres, reflected at the
+ *                    area bounds
+ *   static           one segment per node
+ *
+ * The tracks are computed once, here, with their own RNG (--seed); every
+ * run that maps the file then moves identically, whatever its --RngRun.
+ *
+ * Usage: trajectory-gen --nodes=64 --model=random-waypoint --speed=5
+ *                       --pause=2 --time=300 --out=tracks.traj
+ */
+
+#include "trajectory-format.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Options {
+    uint32_t nodes = 4;
+    std::string model = "random-waypoint";
+    double speed = 5.0;
+    double minSpeed = 0.1;
+    double pause = 2.0;
+    double time = 60.0;
+    double spacing = 40.0;
+    double walkDistance = 1.0;
+    uint64_t seed = 1;
+    std::string out = "manet.traj";
+};
+
+static bool ParseArg(const std::string &arg, Options &o) {
+    std::string::size_type eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+        return false;
+    }
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    try {
+        if (name == "nodes") {
+            o.nodes = std::stoul(value);
+        } else if (name == "model") {
+            o.model = value;
+        } else if (name == "speed") {
+            o.speed = std::stod(value);
+        } else if (name == "minSpeed") {
+            o.minSpeed = std::stod(value);
+        } else if (name == "pause") {
+            o.pause = std::stod(value);
+        } else if (name == "time") {
+            o.time = std::stod(value);
+        } else if (name == "spacing") {
+            o.spacing = std::stod(value);
+        } else if (name == "walkDistance") {
+            o.walkDistance = std::stod(value);
+        } else if (name == "seed") {
+            o.seed = std::stoull(value);
+        } else if (name == "out") {
+            o.out = value;
+        } else {
+            return false;
+        }
+    } catch (const std::logic_error &) {
+        // std::invalid_argument or std::out_of_range from the number parsers
+        std::cerr << "Bad value for --" << name << ": " << value << "\n";
+        return false;
+    }
+    return true;
+}
+
+static bool ParseArgs(int argc, char *argv[], Options &o) {
+    for (int i = 1; i < argc; i++) {
+        if (!ParseArg(argv[i], o)) {
+            return false;
+        }
+    }
+    return o.nodes > 0 && o.time > 0 && o.speed > 0 && o.walkDistance > 0 &&
+           (o.model == "static" || o.model == "random-waypoint" || o.model == "random-walk");
+}
+
+class Generator {
+public:
+    explicit Generator(const Options &o) : m_o(o), m_rng(o.seed) {
+        uint32_t gridWidth = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(o.nodes))));
+        m_side = std::max(100.0, o.spacing * gridWidth);
+        m_gridWidth = gridWidth;
+    }
+
+    /** Tracks of all nodes, appended to segments; index[i] is where node i starts */
+    void Run(std::vector<TrajectorySegment> &segments, std::vector<uint64_t> &index) {
+        for (uint32_t i = 0; i < m_o.nodes; i++) {
+            index.push_back(segments.size());
+            double x, y;
+            InitialPosition(i, x, y);
+            if (m_o.model == "random-waypoint") {
+                Waypoint(x, y, segments);
+            } else if (m_o.model == "random-walk") {
+                Walk(x, y, segments);
+            } else {
+                Add(segments, 0.0, x, y, 0.0, 0.0);
+            }
+        }
+        index.push_back(segments.size());
+    }
+
+private:
+    /** Same layout as SetupMobility() */
+    void InitialPosition(uint32_t i, double &x, double &y) const {
+        if (m_o.nodes == 4) {
+            static const double kPositions[4][2] = {{0, 0}, {50, 0}, {0, 50}, {60, 60}};
+            x = kPositions[i][0];
+            y = kPositions[i][1];
+        } else {
+            x = m_o.spacing * (i % m_gridWidth);
+            y = m_o.spacing * (i / m_gridWidth);
+        }
+    }
+
+    double Uniform(double min, double max) { return std::uniform_real_distribution<double>(min, max)(m_rng); }
+
+    static void Add(std::vector<TrajectorySegment> &segments, double t, double x, double y, double vx, double vy) {
+        segments.push_back({t, static_cast<float>(x), static_cast<float>(y), static_cast<float>(vx),
+                            static_cast<float>(vy)});
+    }
+
+    void Waypoint(double x, double y, std::vector<TrajectorySegment> &segments) {
+        double t = 0.0;
+        while (t < m_o.time) {
+            double dx = Uniform(0, m_side) - x;
+            double dy = Uniform(0, m_side) - y;
+            double speed = Uniform(std::min(m_o.minSpeed, m_o.speed), m_o.speed);
+            double distance = std::sqrt(dx * dx + dy * dy);
+            double travel = distance / speed;
+            if (travel > 0) {
+                Add(segments, t, x, y, dx / travel, dy / travel);
+            }
+            t += travel;
+            x += dx;
+            y += dy;
+            if (m_o.pause > 0 || t >= m_o.time) {
+                Add(segments, t, x, y, 0.0, 0.0);
+            }
+            t += m_o.pause;
+        }
+    }
+
+    void Walk(double x, double y, std::vector<TrajectorySegment> &segments) {
+        double t = 0.0;
+        while (t < m_o.time) {
+            double angle = Uniform(0, 2 * M_PI);
+            double speed = Uniform(std::min(1.0, m_o.speed), m_o.speed);
+            double vx = speed * std::cos(angle);
+            double vy = speed * std::sin(angle);
+            double left = m_o.walkDistance / speed;
+            // Split the step at every wall it reaches, reflecting the velocity
+            while (left > 1e-12) {
+                double hit = left;
+                hit = std::min(hit, TimeToWall(x, vx));
+                hit = std::min(hit, TimeToWall(y, vy));
+                Add(segments, t, x, y, vx, vy);
+                x = std::min(std::max(x + vx * hit, 0.0), m_side);
+                y = std::min(std::max(y + vy * hit, 0.0), m_side);
+                t += hit;
+                left -= hit;
+                if (left > 1e-12) {
+                    if ((x <= 0.0 && vx < 0) || (x >= m_side && vx > 0)) {
+                        vx = -vx;
+                    }
+                    if ((y <= 0.0 && vy < 0) || (y >= m_side && vy > 0)) {
+                        vy = -vy;
+                    }
+                }
+            }
+        }
+        Add(segments, t, x, y, 0.0, 0.0);
+    }
+
+    double TimeToWall(double p, double v) const {
+        if (v > 0) {
+            return (m_side - p) / v;
+        }
+        if (v < 0) {
+            return -p / v;
+        }
+        return INFINITY;
+    }
+
+    const Options &m_o;
+    std::mt19937_64 m_rng;
+    double m_side;
+    uint32_t m_gridWidth;
+};
+
+int main(int argc, char *argv[]) {
+    Options o;
+    if (!ParseArgs(argc, argv, o)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--nodes=N] [--model=random-waypoint|random-walk|static] [--speed=m/s]"
+                     " [--minSpeed=m/s] [--pause=s] [--time=s] [--spacing=m] [--walkDistance=m]"
+                     " [--seed=N] [--out=file]\n";
+        return 2;
+    }
+
+    std::vector<TrajectorySegment> segments;
+    std::vector<uint64_t> index;
+    Generator(o).Run(segments, index);
+
+    TrajectoryHeader header = {};
+    std::memcpy(header.magic, kTrajectoryMagic, sizeof(kTrajectoryMagic));
+    header.nodes = o.nodes;
+    header.duration = o.time;
+    header.segments = segments.size();
+
+    std::FILE *f = std::fopen(o.out.c_str(), "wb");
+    if (!f) {
+        std::perror(o.out.c_str());
+        return 1;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+              std::fwrite(index.data(), sizeof(uint64_t), index.size(), f) == index.size() &&
+              std::fwrite(segments.data(), sizeof(TrajectorySegment), segments.size(), f) == segments.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) {
+        std::perror(o.out.c_str());
+        return 1;
+    }
+    std::cout << o.out << ": " << o.nodes << " nodes, " << segments.size() << " segments, "
+              << sizeof(header) + index.size() * sizeof(uint64_t) + segments.size() * sizeof(TrajectorySegment)
+              << " bytes (" << o.model << ", " << o.time << " s)\n";
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Mobility from a precomputed trajectory file (trajectory-format.h,
+ * written by trajectory-gen.cc).
+ *
+ * MappedTrajectoryMobilityModel answers GetPosition/GetVelocity from the
+ * node's segments in the memory-mapped file: the segment active now is
+ * found by binary search (or, in the common case, is the one found last
+ * time), so no waypoints are drawn and no random variables are consumed.
+ *
+ * CourseChange still fires at each segment start. SpatialYansWifiChannel
+ * re-bins nodes on it and AnimationInterface logs positions from it, so
+ * turning it off (NotifyCourseChanges=false) is only safe without them.
+ */
+
+#ifndef TRAJECTORY_MOBILITY_H
+#define TRAJECTORY_MOBILITY_H
+
+#include "trajectory-format.h"
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+
+#include <memory>
+#include <string>
+
+namespace ns3 {
+
+class MappedTrajectoryMobilityModel : public MobilityModel {
+public:
+    static TypeId GetTypeId() {
+        static TypeId tid =
+            TypeId("ns3::MappedTrajectoryMobilityModel")
+                .SetParent<MobilityModel>()
+                .SetGroupName("Mobility")
+                .AddConstructor<MappedTrajectoryMobilityModel>()
+                .AddAttribute("NotifyCourseChanges", "Fire CourseChange at the start of every segment",
+                              BooleanValue(true),
+                              MakeBooleanAccessor(&MappedTrajectoryMobilityModel::m_notify),
+                              MakeBooleanChecker());
+        return tid;
+    }
+
+    /** Follow track of node in file (shared by all the nodes of a run) */
+    void SetTrajectory(std::shared_ptr<const TrajectoryFile> file, uint32_t node) {
+        m_file = std::move(file);
+        m_segments = m_file->Segments(node);
+        m_count = m_file->SegmentCount(node);
+        m_current = 0;
+    }
+
+protected:
+    void DoInitialize() override {
+        ScheduleCourseChange();
+        MobilityModel::DoInitialize();
+    }
+
+    void DoDispose() override {
+        m_event.Cancel();
+        m_file.reset();
+        MobilityModel::DoDispose();
+    }
+
+private:
+    /** Segment active at Now(): the cached one, its successor, or a binary search */
+    const TrajectorySegment &Current() const {
+        double t = Simulator::Now().GetSeconds();
+        if (!InSegment(m_current, t)) {
+            m_current = InSegment(m_current + 1, t) ? m_current + 1 : TrajectoryFile::Find(m_segments, m_count, t);
+        }
+        return m_segments[m_current];
+    }
+
+    bool InSegment(uint64_t i, double t) const {
+        return i < m_count && (i == 0 || m_segments[i].t0 <= t) && (i + 1 == m_count || t < m_segments[i + 1].t0);
+    }
+
+    Vector DoGetPosition() const override {
+        const TrajectorySegment &s = Current();
+        double dt = std::max(0.0, Simulator::Now().GetSeconds() - s.t0);
+        return Vector(s.x + s.vx * dt, s.y + s.vy * dt, 0.0) + m_offset;
+    }
+
+    Vector DoGetVelocity() const override {
+        const TrajectorySegment &s = Current();
+        return Vector(s.vx, s.vy, 0.0);
+    }
+
+    /** The track is fixed; a position set explicitly shifts it from now on */
+    void DoSetPosition(const Vector &position) override {
+        m_offset = Vector();
+        m_offset = position - DoGetPosition();
+        NotifyCourseChange();
+    }
+
+    void ScheduleCourseChange() {
+        if (!m_notify) {
+            return;
+        }
+        // Compare as Time: Seconds(t0) is where the previous notification ran
+        Time now = Simulator::Now();
+        uint64_t next = TrajectoryFile::Find(m_segments, m_count, now.GetSeconds()) + 1;
+        while (next < m_count && Seconds(m_segments[next].t0) <= now) {
+            next++;
+        }
+        if (next < m_count) {
+            m_event = Simulator::Schedule(Seconds(m_segments[next].t0) - now,
+                                          &MappedTrajectoryMobilityModel::CourseChanged, this);
+        }
+    }
+
+    void CourseChanged() {
+        NotifyCourseChange();
+        ScheduleCourseChange();
+    }
+
+    std::shared_ptr<const TrajectoryFile> m_file;
+    const TrajectorySegment *m_segments = nullptr;
+    uint64_t m_count = 0;
+    mutable uint64_t m_current = 0;
+    Vector m_offset;
+    bool m_notify = true;
+    EventId m_event;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(MappedTrajectoryMobilityModel);
+
+/**
+ * Map path once and give node i of nodes the track of node i in the file.
+ * Fails if the file cannot be used or has fewer tracks than nodes.
+ */
+inline bool InstallTrajectories(NodeContainer &nodes, const std::string &path, std::string &error) {
+    auto file = std::make_shared<TrajectoryFile>();
+    if (!file->Open(path)) {
+        error = path + ": " + file->GetError();
+        return false;
+    }
+    if (file->GetNodes() < nodes.GetN()) {
+        error = path + ": " + std::to_string(file->GetNodes()) + " tracks for " + std::to_string(nodes.GetN()) +
+                " nodes";
+        return false;
+    }
+    for (uint32_t i = 0; i < nodes.GetN(); i++) {
+        Ptr<MappedTrajectoryMobilityModel> model = CreateObject<MappedTrajectoryMobilityModel>();
+        model->SetTrajectory(file, i);
+        nodes.Get(i)->AggregateObject(model);
+    }
+    return true;
+}
+
+} // namespace ns3
+
+#endif /* TRAJECTORY_MOBILITY_H */
@@ -0,0 +1,31 @@
+#!/bin/env bash
+# Node-count benchmark for manet-aodv-static.cc
+# Runs the MANET headless (no TAP, default simulator, synthetic UDP echo
+# traffic) at several node counts and reports events/sec and RSS.
+#
+# Usage: ./scripts/bench-manet-nodes.sh [sim-time] [node counts...]
+#   ./scripts/bench-manet-nodes.sh            # 60s at N=4 32 128 256
+#   ./scripts/bench-manet-nodes.sh 30 4 64
+
+TIME=${1:-60}
+shift
+NODES=${@:-4 32 128 256}
+CONTAINER=${NS3_CONTAINER:-ns-3}
+
+docker exec "$CONTAINER" ./ns3 build scratch/manet-aodv-static >/dev/null || { echo "Build failed"; exit 1; }
+
+printf "%8s %12s %14s %10s %12s\n" "nodes" "events" "events/s" "sim/wall" "peakRSS(kB)"
+for n in $NODES; do
+    out=$(docker exec "$CONTAINER" ./ns3 run --no-build \
+        "scratch/manet-aodv-static --tap=false --anim=false --pcap=false --nodes=$n --time=$TIME" 2>&1)
+    if [ $? -ne 0 ]; then
+        echo "N=$n failed:"
+        echo "$out" | tail -5
+        continue
+    fi
+    events=$(echo "$out" | sed -n 's/^Events: \([0-9]*\) (\([0-9]*\) events\/s)/\1/p')
+    rate=$(echo "$out" | sed -n 's/^Events: \([0-9]*\) (\([0-9]*\) events\/s)/\2/p')
+    ratio=$(echo "$out" | sed -n 's/^Wall time: .*(sim\/wall=\(.*\))/\1/p')
+    rss=$(echo "$out" | sed -n 's/^RSS: .*peak=\([0-9]*\) kB/\1/p')
+    printf "%8s %12s %14s %10s %12s\n" "$n" "$events" "$rate" "$ratio" "$rss"
+done
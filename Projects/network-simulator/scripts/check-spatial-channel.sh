@@ -0,0 +1,42 @@
+#!/bin/env bash
+# Compares SpatialYansWifiChannel against the stock YansWifiChannel
+# Runs manet-aodv-static headless twice per case, with --spatialChannel=true
+# and =false and the same RNG run, and compares the RESULT lines. Only the
+# counters are compared; events, wall time and RSS are expected to differ.
+#
+# Usage: ./scripts/check-spatial-channel.sh [sim-time] [node counts...]
+#   ./scripts/check-spatial-channel.sh            # 60s at N=4 32 128
+#   ./scripts/check-spatial-channel.sh 30 16
+
+TIME=${1:-60}
+shift
+NODES=${@:-4 32 128}
+CONTAINER=${NS3_CONTAINER:-ns-3}
+
+docker exec "$CONTAINER" ./ns3 build scratch/manet-aodv-static >/dev/null || { echo "Build failed"; exit 1; }
+
+result() {
+    docker exec "$CONTAINER" ./ns3 run --no-build \
+        "scratch/manet-aodv-static --tap=false --anim=false --pcap=false --metricsInterval=0 --eventLog= $1" 2>&1 \
+        | sed -n 's/^RESULT //p' | sed 's/ events=.*//'
+}
+
+failed=0
+for n in $NODES; do
+    for mobility in static random-waypoint random-walk; do
+        for run in 1 2; do
+            args="--nodes=$n --time=$TIME --mobility=$mobility --speed=5 --RngRun=$run"
+            spatial=$(result "$args --spatialChannel=true")
+            stock=$(result "$args --spatialChannel=false")
+            if [ -z "$spatial" ] || [ "$spatial" != "$stock" ]; then
+                echo "DIFFERENT $args"
+                echo "  spatial: $spatial"
+                echo "  stock:   $stock"
+                failed=1
+            else
+                echo "same      $args"
+            fi
+        done
+    done
+done
+exit $failed
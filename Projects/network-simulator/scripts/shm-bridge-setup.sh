@@ -0,0 +1,37 @@
+#!/bin/env bash
+# Shared-memory bridge setup for 4-node NS-3 scenarios
+# Usage: sudo ./scripts/shm-bridge-setup.sh [scenario-yaml] [spinUs]
+#
+# No host TAP devices, bridges or veths: the containers share /dev/shm/t4
+# with the simulator and each one runs shm-shim, which creates its eth0.
+# Then run the simulation with --bridge=shm.
+
+SCENARIO_FILE="${1:-scenarios/tap-4node-shm-scenario.yaml}"
+SPIN_US="${2:-50}"
+SHM_DIR=/dev/shm/t4
+
+echo "Setting up: $SCENARIO_FILE"
+sudo mkdir -p $SHM_DIR
+sudo chmod 1777 $SHM_DIR
+
+docker compose -f "$SCENARIO_FILE" up -d || { echo "Failed to start containers"; exit 1; }
+sleep 2
+
+# One static shim for all containers, built with the simulator's toolchain
+docker exec ns-3 g++ -std=c++17 -O2 -static -pthread -o $SHM_DIR/shm-shim scratch/shm-shim.cc \
+    || { echo "Failed to build shm-shim"; exit 1; }
+
+declare -a macs=("12:34:88:5D:61:B0" "12:34:88:5D:61:B1" "12:34:88:5D:61:B2" "12:34:88:5D:61:B3")
+
+for i in 0 1 2 3; do
+    if [ "$(docker inspect --format '{{ .State.Running }}' node-$i 2>/dev/null)" != "true" ]; then
+        echo "Warning: node-$i not running, skipping"
+        continue
+    fi
+    # The shim waits for the simulator to create its region
+    docker exec -d node-$i sh -c "$SHM_DIR/shm-shim --region=$SHM_DIR/node-$i --mac=${macs[$i]} \
+        --ip=10.0.0.$((i+1))/24 --spinUs=$SPIN_US > $SHM_DIR/shim-$i.log 2>&1"
+    echo "node-$i: 10.0.0.$((i+1)) via $SHM_DIR/node-$i"
+done
+
+echo "Done. Run: docker exec ns-3 ./ns3 run \"scratch/manet-aodv-static --bridge=shm --shmSpinUs=$SPIN_US\""
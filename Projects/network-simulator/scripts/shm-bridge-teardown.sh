@@ -0,0 +1,10 @@
+#!/bin/env bash
+# Shared-memory bridge teardown for 4-node NS-3 scenarios
+
+echo "Tearing down..."
+for i in 0 1 2 3; do
+    docker exec node-$i sh -c 'kill $(pidof shm-shim)' 2>/dev/null || true
+done
+docker compose -f scenarios/tap-4node-shm-scenario.yaml down 2>/dev/null || true
+sudo rm -rf /dev/shm/t4
+echo "Done."
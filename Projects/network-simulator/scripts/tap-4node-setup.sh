@@ -1,6 +1,7 @@
 #!/bin/env bash
 # TAP Device Setup for 4-Node NS-3 Scenarios
 # Usage: sudo ./scripts/tap-4node-setup.sh [scenario-yaml]
+# TAP_MULTI_QUEUE=1 creates multi_queue TAP devices, for --bridge=mq
 
 select_scenario() {
     mapfile -t scenarios < <(find scenarios -name "*.yaml" -o -name "*.yml" 2>/dev/null | sort)
@@ -49,7 +50,7 @@ echo "Setting up: $SCENARIO_FILE"
 # Create bridges and TAP devices
 for i in 0 1 2 3; do
     ip link show br-$i &>/dev/null || sudo ip link add name br-$i type bridge
-    ip link show tap-$i &>/dev/null || sudo ip tuntap add tap-$i mode tap
+    ip link show tap-$i &>/dev/null || sudo ip tuntap add tap-$i mode tap ${TAP_MULTI_QUEUE:+multi_queue}
     sudo ifconfig tap-$i 0.0.0.0 promisc up
     sudo ip link set tap-$i master br-$i
     sudo ip link set br-$i up
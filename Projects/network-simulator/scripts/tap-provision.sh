@@ -0,0 +1,18 @@
+#!/bin/env bash
+# Fast TAP/bridge/veth setup and teardown for N-node scenarios (rtnetlink)
+# Builds scenarios/src/tap-provision.cc into a fresh private directory on
+# every run; a binary kept in a shared place like /tmp could be replaced by
+# anyone before it runs as root.
+#
+# Usage: sudo ./scripts/tap-provision.sh up|down <scenario-yaml> [--nodes=N] [--compose=false]
+#   sudo ./scripts/tap-provision.sh up scenarios/tap-4node-scenario.yaml
+#   sudo ./scripts/tap-provision.sh down scenarios/tap-4node-scenario.yaml
+
+SRC=scenarios/src/tap-provision.cc
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+BIN=$DIR/tap-provision
+
+g++ -std=c++17 -O2 -o "$BIN" "$SRC" || { echo "Build of $SRC failed"; exit 1; }
+
+"$BIN" "$@"
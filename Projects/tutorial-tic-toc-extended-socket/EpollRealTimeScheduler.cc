@@ -0,0 +1,222 @@
+#include "EpollRealTimeScheduler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+Register_Class(EpollRealTimeScheduler);
+
+namespace {
+
+// Längstes Warten am Stück: danach fragt der Scheduler die Oberfläche,
+// ob der Benutzer die Simulation anhalten will
+const int kIdleMs = 100;
+
+int64_t monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace
+
+void EpollRealTimeScheduler::WakeupStats::add(int64_t ns)
+{
+    if (ns < 0)
+        ns = 0;
+    count++;
+    sumNs += ns;
+    if (ns > maxNs)
+        maxNs = ns;
+    int bucket = ns ? 64 - __builtin_clzll((uint64_t)ns) : 0;
+    buckets[bucket < 63 ? bucket : 63]++;
+}
+
+int64_t EpollRealTimeScheduler::WakeupStats::percentileNs(double q) const
+{
+    if (count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < 64; b++) {
+        seen += buckets[b];
+        if (seen >= rank)
+            return b ? std::min<int64_t>((int64_t)1 << (b < 63 ? b : 62), maxNs) : 0;
+    }
+    return maxNs;
+}
+
+EpollRealTimeScheduler::~EpollRealTimeScheduler()
+{
+    if (timerFd >= 0)
+        close(timerFd);
+    if (epollFd >= 0)
+        close(epollFd);
+}
+
+std::string EpollRealTimeScheduler::str() const
+{
+    return "epoll realtime scheduler, " + std::to_string(listeners.size()) + " fds";
+}
+
+void EpollRealTimeScheduler::ensureEpoll()
+{
+    if (epollFd >= 0)
+        return;
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epollFd < 0 || timerFd < 0)
+        throw cRuntimeError("EpollRealTimeScheduler: epoll/timerfd: %s", strerror(errno));
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = timerFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &ev);
+}
+
+void EpollRealTimeScheduler::addFd(int fd, IListener *listener)
+{
+    // Module registrieren sich in initialize(), also vor startRun()
+    ensureEpoll();
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        throw cRuntimeError("EpollRealTimeScheduler: fd %d: %s", fd, strerror(errno));
+    listeners[fd] = listener;
+}
+
+void EpollRealTimeScheduler::removeFd(int fd)
+{
+    if (listeners.erase(fd) && epollFd >= 0)
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EpollRealTimeScheduler::startRun()
+{
+    ensureEpoll();
+    armedNs = -1;
+    timerLateness = WakeupStats();
+    fdDispatch = WakeupStats();
+    idleWakeups = 0;
+    baseNs = monotonicNs();
+}
+
+void EpollRealTimeScheduler::endRun()
+{
+    printStats(std::cout);
+}
+
+void EpollRealTimeScheduler::executionResumed()
+{
+    // Nach einer Pause dort weitermachen, wo die Simulationszeit steht
+    baseNs = monotonicNs() - sim->getSimTime().inUnit(SIMTIME_NS);
+}
+
+simtime_t EpollRealTimeScheduler::toSimTime(int64_t wallNs) const
+{
+    simtime_t t = SimTime(wallNs - baseNs, SIMTIME_NS);
+    return t < sim->getSimTime() ? sim->getSimTime() : t;
+}
+
+void EpollRealTimeScheduler::armTimer(int64_t deadlineNs)
+{
+    if (deadlineNs == armedNs)
+        return;
+    itimerspec spec{};
+    if (deadlineNs >= 0) {
+        spec.it_value.tv_sec = deadlineNs / 1000000000;
+        spec.it_value.tv_nsec = deadlineNs % 1000000000;
+    }
+    // it_value 0 schaltet den Timer ab (kein Ereignis in der FES)
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    armedNs = deadlineNs;
+}
+
+bool EpollRealTimeScheduler::wait(int64_t deadlineNs)
+{
+    armTimer(deadlineNs);
+
+    epoll_event events[32];
+    int n = epoll_wait(epollFd, events, 32, kIdleMs);
+    int64_t wokeNs = monotonicNs();
+    if (n < 0 && errno != EINTR)
+        throw cRuntimeError("EpollRealTimeScheduler: epoll_wait: %s", strerror(errno));
+
+    bool timer = false, fds = false;
+    for (int k = 0; k < n; k++) {
+        int fd = events[k].data.fd;
+        if (fd == timerFd) {
+            uint64_t expirations;
+            if (read(timerFd, &expirations, sizeof(expirations)) > 0)
+                timer = true;
+            continue;
+        }
+        auto it = listeners.find(fd);
+        if (it == listeners.end())
+            continue;   // während dieses Durchlaufs abgemeldet
+        // Alle Deskriptoren dieses Aufwachens bekommen dieselbe Ankunftszeit
+        it->second->notify(fd, toSimTime(wokeNs));
+        fds = true;
+    }
+
+    if (timer)
+        timerLateness.add(wokeNs - deadlineNs);
+    if (fds)
+        fdDispatch.add(monotonicNs() - wokeNs);
+    if (n <= 0) {
+        idleWakeups++;
+        if (getEnvir()->idle())
+            return false;
+    }
+    return true;
+}
+
+cEvent *EpollRealTimeScheduler::guessNextEvent()
+{
+    return sim->getFES()->peekFirst();
+}
+
+cEvent *EpollRealTimeScheduler::takeNextEvent()
+{
+    for (;;) {
+        cEvent *event = sim->getFES()->peekFirst();
+        int64_t deadlineNs = -1;
+        if (event != nullptr) {
+            deadlineNs = baseNs + event->getArrivalTime().inUnit(SIMTIME_NS);
+            if (monotonicNs() >= deadlineNs)
+                return sim->getFES()->removeFirst();
+        }
+        else {
+            bool expecting = false;
+            for (const auto& entry : listeners)
+                expecting = expecting || entry.second->expectsInput();
+            if (!expecting)
+                throw cTerminationException(E_ENDEDOK);
+        }
+        // Bis zur Frist oder bis ein Deskriptor etwas bringt; Listener können
+        // dabei ein früheres Ereignis einplanen, daher danach neu nachsehen
+        if (!wait(deadlineNs))
+            return nullptr;
+    }
+}
+
+void EpollRealTimeScheduler::putBackEvent(cEvent *event)
+{
+    sim->getFES()->putBackFirst(event);
+}
+
+void EpollRealTimeScheduler::printStats(std::ostream& os) const
+{
+    os << "EpollRealTimeScheduler: " << timerLateness.count << " Frist-Wecker (Verspätung Mittel "
+       << timerLateness.meanNs() / 1e3 << "us, p99 <= " << timerLateness.percentileNs(0.99) / 1e3
+       << "us, max " << timerLateness.maxNs / 1e3 << "us), "
+       << fdDispatch.count << " fd-Wecker (Dauer Mittel " << fdDispatch.meanNs() / 1e3
+       << "us, p99 <= " << fdDispatch.percentileNs(0.99) / 1e3 << "us, max "
+       << fdDispatch.maxNs / 1e3 << "us), " << idleWakeups << " Leerlauf\n";
+}
@@ -0,0 +1,99 @@
+#ifndef EPOLLREALTIMESCHEDULER_H_
+#define EPOLLREALTIMESCHEDULER_H_
+
+#include <omnetpp.h>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+using namespace omnetpp;
+
+/**
+ * Echtzeit-Scheduler, der auf die Wanduhr UND auf registrierte Deskriptoren
+ * (Sockets, eventfds, TAP-Geräte) in einem einzigen epoll_wait wartet.
+ *
+ * Die Frist des nächsten Ereignisses steckt in einem timerfd (absolut,
+ * CLOCK_MONOTONIC, ns-genau) im selben epoll-Set wie die Deskriptoren.
+ * Wird ein Deskriptor lesbar, ruft der Scheduler den zugehörigen Listener
+ * im Simulationsthread auf und übergibt ihm die Simulationszeit, die der
+ * Ankunft entspricht; der Listener plant damit sein Ereignis ein. Kein
+ * Polling-Timer, kein zweiter Thread, der in die Simulation greift.
+ *
+ * Einsatz in der omnetpp.ini:
+ *   scheduler-class = "EpollRealTimeScheduler"
+ */
+class EpollRealTimeScheduler : public cScheduler
+{
+  public:
+    class IListener
+    {
+      public:
+        virtual ~IListener() {}
+        /**
+         * fd ist lesbar. arrival ist die Simulationszeit des Eintreffens
+         * (nie früher als simTime()). true, wenn ein Ereignis eingeplant wurde
+         */
+        virtual bool notify(int fd, simtime_t arrival) = 0;
+        /**
+         * Ist die FES leer, läuft die Simulation nur weiter, solange noch
+         * ein Listener Eingaben erwartet
+         */
+        virtual bool expectsInput() const { return true; }
+    };
+
+    /** Einfache log2-Verteilung für Aufwachzeiten in Nanosekunden */
+    struct WakeupStats
+    {
+        uint64_t count = 0;
+        int64_t sumNs = 0;
+        int64_t maxNs = 0;
+        uint64_t buckets[64] = {};
+
+        void add(int64_t ns);
+        double meanNs() const { return count ? (double)sumNs / count : 0; }
+        /** Obere Schranke des Buckets, in dem das q-Quantil liegt */
+        int64_t percentileNs(double q) const;
+    };
+
+    EpollRealTimeScheduler() {}
+    virtual ~EpollRealTimeScheduler();
+
+    virtual std::string str() const override;
+
+    /** fd für epoll registrieren; listener muss bis removeFd() leben */
+    void addFd(int fd, IListener *listener);
+    void removeFd(int fd);
+
+    /** Wecker durch die Frist: Verspätung gegenüber der Sollzeit */
+    const WakeupStats& getTimerLateness() const { return timerLateness; }
+    /** Wecker durch Deskriptoren: Dauer von epoll-Rückkehr bis Listener fertig */
+    const WakeupStats& getFdDispatch() const { return fdDispatch; }
+    uint64_t getIdleWakeups() const { return idleWakeups; }
+    void printStats(std::ostream& os) const;
+
+    virtual void startRun() override;
+    virtual void endRun() override;
+    virtual void executionResumed() override;
+    virtual cEvent *guessNextEvent() override;
+    virtual cEvent *takeNextEvent() override;
+    virtual void putBackEvent(cEvent *event) override;
+
+  protected:
+    void ensureEpoll();
+    void armTimer(int64_t deadlineNs);
+    /** Ein epoll_wait; false, wenn die Simulation gestoppt werden soll */
+    bool wait(int64_t deadlineNs);
+    simtime_t toSimTime(int64_t wallNs) const;
+
+    int epollFd = -1;
+    int timerFd = -1;
+    int64_t armedNs = -1;       // aktuell im timerfd stehende Frist
+    int64_t baseNs = 0;         // Wanduhrzeit von Simulationszeit 0
+    std::unordered_map<int, IListener *> listeners;
+
+    WakeupStats timerLateness;
+    WakeupStats fdDispatch;
+    uint64_t idleWakeups = 0;   // nur für Benutzereingaben aufgewacht
+};
+
+#endif /* EPOLLREALTIMESCHEDULER_H_ */
@@ -0,0 +1,363 @@
+#include "GatewayIo.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const int64_t kMinBackoffNs = 10000000;     // 10 ms
+const int64_t kMaxBackoffNs = 1000000000;   // 1 s
+const uint64_t kWakeTag = 0;                // epoll-Daten des wakeFd
+
+void signal(int fd)
+{
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+void consume(int fd)
+{
+    uint64_t value;
+    while (read(fd, &value, sizeof(value)) < 0 && errno == EINTR) {
+    }
+}
+
+}  // namespace
+
+int64_t GatewayIo::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool GatewayIo::start(const Options& opts, std::string& error)
+{
+    sockaddr_in addr{};
+    if (opts.connections < 1 || opts.maxOutstanding < 1) {
+        error = "connections und maxOutstanding müssen > 0 sein";
+        return false;
+    }
+    if (inet_pton(AF_INET, opts.host.c_str(), &addr.sin_addr) <= 0) {
+        error = "ungültige IP-Adresse " + opts.host;
+        return false;
+    }
+    stop();
+    options = opts;
+    // Die Antwort-Queue fasst jede offene Anfrage: push() kann nie scheitern
+    requests.reset(options.maxOutstanding);
+    replies.reset(options.maxOutstanding);
+    connections.assign(options.connections, Connection());
+    pending.clear();
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    replyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0 || replyFd < 0) {
+        error = std::string("epoll/eventfd: ") + strerror(errno);
+        stop();
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = kWakeTag;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    for (size_t i = 0; i < connections.size(); i++)
+        connect(i);
+    running.store(true);
+    thread = std::thread(&GatewayIo::run, this);
+    return true;
+}
+
+void GatewayIo::stop()
+{
+    if (thread.joinable()) {
+        running.store(false);
+        signal(wakeFd);
+        thread.join();
+    }
+    for (auto& c : connections)
+        if (c.fd >= 0)
+            ::close(c.fd);
+    connections.clear();
+    for (int *fd : {&epollFd, &wakeFd, &replyFd}) {
+        if (*fd >= 0)
+            ::close(*fd);
+        *fd = -1;
+    }
+    outstanding.store(0);
+}
+
+bool GatewayIo::submit(uint64_t id, const std::string& payload)
+{
+    if (!running.load(std::memory_order_relaxed)
+            || outstanding.load(std::memory_order_relaxed) >= options.maxOutstanding)
+        return false;
+    Request request;
+    request.id = id;
+    request.payload = payload;
+    request.submitNs = nowNs();
+    // Zeilenrahmung: eingebettete Zeilenumbrüche würden den Server verwirren
+    for (char& ch : request.payload)
+        if (ch == '\n' || ch == '\r')
+            ch = ' ';
+    outstanding.fetch_add(1, std::memory_order_relaxed);
+    requests.push(std::move(request));
+    signal(wakeFd);
+    return true;
+}
+
+void GatewayIo::clearReplyFd()
+{
+    consume(replyFd);
+}
+
+void GatewayIo::connect(size_t index)
+{
+    Connection& c = connections[index];
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+        close(index, std::string("socket: ") + strerror(errno));
+        return;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options.port);
+    inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+    if (::connect(c.fd, (sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        close(index, std::string("connect: ") + strerror(errno));
+        return;
+    }
+    // Verbindungsaufbau ist fertig, sobald der Socket schreibbar wird
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u64 = index + 1;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, c.fd, &ev);
+    c.pollOut = true;
+}
+
+void GatewayIo::close(size_t index, const std::string& reason)
+{
+    Connection& c = connections[index];
+    if (c.fd >= 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+    }
+    c.fd = -1;
+    c.connected = false;
+    c.out.clear();
+    c.outPos = 0;
+    c.in.clear();
+    // Was schon unterwegs war, ist verloren: nicht still neu senden
+    for (Request& request : c.inflight)
+        complete(request, false, std::string(reason));
+    c.inflight.clear();
+
+    c.backoffNs = c.backoffNs ? std::min(2 * c.backoffNs, kMaxBackoffNs) : kMinBackoffNs;
+    c.retryAtNs = nowNs() + c.backoffNs;
+
+    // Ohne jede Verbindung würden wartende Anfragen unbegrenzt liegen bleiben
+    bool any = false;
+    for (const Connection& other : connections)
+        any = any || other.connected;
+    if (!any)
+        failPending("Server nicht erreichbar (" + reason + ")");
+}
+
+void GatewayIo::assign(Request&& request)
+{
+    // Verbindung mit den wenigsten offenen Anfragen, bei Gleichstand reihum
+    size_t best = SIZE_MAX;
+    for (size_t k = 0; k < connections.size(); k++) {
+        size_t i = (nextConnection + k) % connections.size();
+        if (connections[i].connected
+                && (best == SIZE_MAX || connections[i].inflight.size() < connections[best].inflight.size()))
+            best = i;
+    }
+    if (best == SIZE_MAX) {
+        pending.push_back(std::move(request));
+        return;
+    }
+    nextConnection = (best + 1) % connections.size();
+
+    Connection& c = connections[best];
+    c.out.append(request.payload);
+    c.out.push_back('\n');
+    c.inflight.push_back(std::move(request));
+    sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GatewayIo::flush(size_t index)
+{
+    Connection& c = connections[index];
+    while (c.outPos < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            close(index, std::string("send: ") + strerror(errno));
+            return;
+        }
+        c.outPos += n;
+    }
+    if (c.outPos == c.out.size()) {
+        c.out.clear();
+        c.outPos = 0;
+    }
+    updateEvents(index);
+}
+
+void GatewayIo::receive(size_t index)
+{
+    Connection& c = connections[index];
+    char buffer[16384];
+    bool eof = false;
+    for (;;) {
+        ssize_t n = recv(c.fd, buffer, sizeof(buffer), 0);
+        if (n == 0) {
+            eof = true;
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            close(index, std::string("recv: ") + strerror(errno));
+            return;
+        }
+        c.in.append(buffer, n);
+        if ((size_t)n < sizeof(buffer))
+            break;
+    }
+
+    size_t start = 0, end;
+    while ((end = c.in.find('\n', start)) != std::string::npos) {
+        if (c.inflight.empty()) {
+            close(index, "Antwort ohne Anfrage");
+            return;
+        }
+        size_t len = end - start;
+        if (len > 0 && c.in[end - 1] == '\r')
+            len--;
+        complete(c.inflight.front(), true, c.in.substr(start, len));
+        c.inflight.pop_front();
+        start = end + 1;
+    }
+    c.in.erase(0, start);
+    // Erst die vollständigen Zeilen zustellen, dann das Schließen melden
+    if (eof)
+        close(index, "Verbindung vom Server geschlossen");
+}
+
+void GatewayIo::updateEvents(size_t index)
+{
+    // EPOLLOUT nur, solange Daten im Socketpuffer keinen Platz fanden
+    Connection& c = connections[index];
+    bool wantOut = !c.out.empty();
+    if (wantOut == c.pollOut)
+        return;
+    epoll_event ev{};
+    ev.events = EPOLLIN | (wantOut ? (uint32_t)EPOLLOUT : 0);
+    ev.data.u64 = index + 1;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.pollOut = wantOut;
+}
+
+void GatewayIo::complete(Request& request, bool ok, std::string&& payload)
+{
+    Reply reply;
+    reply.id = request.id;
+    reply.ok = ok;
+    reply.payload = std::move(payload);
+    reply.rttNs = nowNs() - request.submitNs;
+    (ok ? received : failed).fetch_add(1, std::memory_order_relaxed);
+    replies.push(std::move(reply));
+    signal(replyFd);
+}
+
+void GatewayIo::failPending(const std::string& reason)
+{
+    for (Request& request : pending)
+        complete(request, false, std::string(reason));
+    pending.clear();
+}
+
+void GatewayIo::run()
+{
+    epoll_event events[64];
+    while (running.load()) {
+        // Nur warten, bis die nächste fällige Neuverbindung ansteht
+        int64_t now = nowNs();
+        int timeoutMs = -1;
+        for (const Connection& c : connections) {
+            if (c.fd >= 0)
+                continue;
+            int64_t ms = std::max<int64_t>(0, (c.retryAtNs - now + 999999) / 1000000);
+            if (timeoutMs < 0 || ms < timeoutMs)
+                timeoutMs = (int)ms;
+        }
+
+        int n = epoll_wait(epollFd, events, 64, timeoutMs);
+        if (n < 0 && errno != EINTR)
+            break;
+
+        for (int k = 0; k < n; k++) {
+            if (events[k].data.u64 == kWakeTag) {
+                consume(wakeFd);
+                Request request;
+                while (requests.pop(request))
+                    assign(std::move(request));
+                continue;
+            }
+            size_t i = events[k].data.u64 - 1;
+            Connection& c = connections[i];
+            if (c.fd < 0)
+                continue;
+            if (!c.connected && (events[k].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err) {
+                    close(i, std::string("connect: ") + strerror(err));
+                    continue;
+                }
+                c.connected = true;
+                c.backoffNs = 0;
+                connects.fetch_add(1, std::memory_order_relaxed);
+                // Wartende Anfragen auf alle verbundenen Verbindungen verteilen
+                std::deque<Request> waiting;
+                waiting.swap(pending);
+                for (Request& request : waiting)
+                    assign(std::move(request));
+            }
+            if (events[k].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                receive(i);
+        }
+
+        // Gesammelt senden: ein send() pro Verbindung und Schleifendurchlauf
+        for (size_t i = 0; i < connections.size(); i++)
+            if (connections[i].connected)
+                flush(i);
+
+        now = nowNs();
+        for (size_t i = 0; i < connections.size(); i++)
+            if (connections[i].fd < 0 && connections[i].retryAtNs <= now)
+                connect(i);
+    }
+}
@@ -0,0 +1,193 @@
+//
+// GatewayIo: Socket-I/O des SocketGateway ohne OMNeT++-Abhängigkeiten.
+//
+// Ein einzelner I/O-Thread hält einen Pool dauerhafter TCP-Verbindungen
+// zum Echo-Server (socket_client.py) und bedient alle über ein epoll:
+//   - Simulation -> Thread: Anfragen über eine lock-freie SPSC-Queue,
+//     geweckt über ein eventfd,
+//   - Thread -> Simulation: Antworten über eine zweite SPSC-Queue; das
+//     eventfd getReplyFd() wird lesbar, sobald Antworten warten.
+// Nachrichten sind zeilenweise ('\n') gerahmt und werden pro Verbindung
+// gepipelined; der Server antwortet pro Verbindung in Reihenfolge, deshalb
+// reicht je Verbindung eine FIFO der offenen Anfragen. Bricht eine
+// Verbindung ab, werden ihre offenen Anfragen als fehlgeschlagen gemeldet
+// und die Verbindung mit Backoff neu aufgebaut.
+//
+
+#ifndef GATEWAYIO_H_
+#define GATEWAYIO_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Begrenzte Single-Producer/Single-Consumer-Queue
+ */
+template <typename T>
+class SpscQueue
+{
+  public:
+    explicit SpscQueue(size_t capacity = 1024) { reset(capacity); }
+
+    /** Nur aufrufen, solange kein Thread die Queue benutzt */
+    void reset(size_t capacity)
+    {
+        size_t n = 1;
+        while (n < capacity)
+            n <<= 1;
+        slots.assign(n, T());
+        mask = n - 1;
+        head.store(0);
+        tail.store(0);
+    }
+
+    bool push(T&& value)
+    {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask)
+            return false;
+        slots[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        value = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+  private:
+    std::vector<T> slots;
+    uint64_t mask = 0;
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+};
+
+class GatewayIo
+{
+  public:
+    struct Options
+    {
+        std::string host = "127.0.0.1";
+        int port = 65432;
+        int connections = 4;        // Größe des Verbindungspools
+        size_t maxOutstanding = 4096;  // offene Anfragen insgesamt
+    };
+
+    struct Request
+    {
+        uint64_t id = 0;
+        std::string payload;
+        int64_t submitNs = 0;
+    };
+
+    struct Reply
+    {
+        uint64_t id = 0;
+        bool ok = false;
+        std::string payload;        // Antwort des Servers oder Fehlertext
+        int64_t rttNs = 0;          // von submit() bis zur Antwort
+    };
+
+    GatewayIo() = default;
+    ~GatewayIo() { stop(); }
+    GatewayIo(const GatewayIo&) = delete;
+    GatewayIo& operator=(const GatewayIo&) = delete;
+
+    /** Startet den I/O-Thread; false und error, wenn das nicht geht */
+    bool start(const Options& options, std::string& error);
+
+    /** Beendet den I/O-Thread und schließt alle Verbindungen */
+    void stop();
+
+    /**
+     * Simulations-Thread: Anfrage einreihen. false, wenn schon
+     * maxOutstanding Anfragen offen sind
+     */
+    bool submit(uint64_t id, const std::string& payload);
+
+    /** Simulations-Thread: alle wartenden Antworten an fn(Reply&) übergeben */
+    template <typename F>
+    size_t drain(F fn)
+    {
+        // eventfd zuerst zurücksetzen: was danach eintrifft, meldet sich neu
+        clearReplyFd();
+        size_t n = 0;
+        Reply reply;
+        while (replies.pop(reply)) {
+            fn(reply);
+            n++;
+        }
+        outstanding.fetch_sub(n, std::memory_order_relaxed);
+        return n;
+    }
+
+    /** eventfd, lesbar solange Antworten abzuholen sind (für epoll/poll) */
+    int getReplyFd() const { return replyFd; }
+
+    size_t getOutstanding() const { return outstanding.load(std::memory_order_relaxed); }
+    uint64_t getSent() const { return sent.load(std::memory_order_relaxed); }
+    uint64_t getReceived() const { return received.load(std::memory_order_relaxed); }
+    uint64_t getFailed() const { return failed.load(std::memory_order_relaxed); }
+    uint64_t getConnects() const { return connects.load(std::memory_order_relaxed); }
+
+    static int64_t nowNs();
+
+  private:
+    struct Connection
+    {
+        int fd = -1;
+        bool connected = false;
+        bool pollOut = false;       // EPOLLOUT im epoll-Set
+        std::string out;            // noch nicht gesendete Bytes
+        size_t outPos = 0;
+        std::string in;             // unvollständige Antwortzeile
+        std::deque<Request> inflight;
+        int64_t retryAtNs = 0;      // nächster Verbindungsversuch
+        int64_t backoffNs = 0;
+    };
+
+    void clearReplyFd();
+    void run();
+    void connect(size_t index);
+    void close(size_t index, const std::string& reason);
+    void assign(Request&& request);
+    void flush(size_t index);
+    void receive(size_t index);
+    void updateEvents(size_t index);
+    void complete(Request& request, bool ok, std::string&& payload);
+    void failPending(const std::string& reason);
+
+    Options options;
+    std::vector<Connection> connections;
+    std::deque<Request> pending;    // warten auf eine Verbindung
+    size_t nextConnection = 0;
+
+    SpscQueue<Request> requests;
+    SpscQueue<Reply> replies;
+    int epollFd = -1;
+    int wakeFd = -1;                // Simulation -> I/O-Thread
+    int replyFd = -1;               // I/O-Thread -> Simulation
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    std::atomic<size_t> outstanding{0};
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> connects{0};
+};
+
+#endif /* GATEWAYIO_H_ */
@@ -0,0 +1,148 @@
+#include "SocketGateway.h"
+#include <algorithm>
+#include "SocketReply_m.h"      // aus der .msg generiert
+
+Define_Module(SocketGateway);
+
+SocketGateway::~SocketGateway()
+{
+    if (scheduler != nullptr)
+        scheduler->removeFd(io.getReplyFd());
+    io.stop();
+    cancelAndDelete(pollTimer);
+}
+
+void SocketGateway::initialize()
+{
+    GatewayIo::Options options;
+    options.host = par("host").stdstringValue();
+    options.port = par("port");
+    options.connections = par("connections");
+    options.maxOutstanding = par("maxOutstanding").intValue();
+    pollInterval = par("pollInterval").doubleValue();
+
+    std::string error;
+    if (!io.start(options, error))
+        throw cRuntimeError("SocketGateway: %s", error.c_str());
+
+    scheduler = dynamic_cast<EpollRealTimeScheduler *>(getSimulation()->getScheduler());
+    if (scheduler != nullptr)
+        scheduler->addFd(io.getReplyFd(), this);
+    pollTimer = new cMessage("poll");
+    rttStats.setName("rtt");
+    rttVector.setName("rtt");
+    rttVector.setUnit("s");
+}
+
+uint64_t SocketGateway::request(cModule *origin, const char *payload)
+{
+    Enter_Method("request()");
+
+    uint64_t id = nextRequestId;
+    if (!io.submit(id, payload)) {
+        rejected++;
+        return 0;
+    }
+    nextRequestId++;
+    if (requests++ == 0)
+        firstRequestNs = GatewayIo::nowNs();
+    origins[id] = origin->getId();
+
+    // Nur pollen, solange etwas offen ist
+    if (scheduler == nullptr && !pollTimer->isScheduled())
+        scheduleAfter(pollInterval, pollTimer);
+    return id;
+}
+
+void SocketGateway::handleMessage(cMessage *msg)
+{
+    ASSERT(msg == pollTimer);
+    deliverReplies(SIMTIME_ZERO);
+    if (io.getOutstanding() > 0)
+        scheduleAfter(pollInterval, pollTimer);
+}
+
+bool SocketGateway::notify(int fd, simtime_t arrival)
+{
+    Enter_Method_Silent();
+    return deliverReplies(arrival - simTime()) > 0;
+}
+
+void SocketGateway::account(const GatewayIo::Reply& r)
+{
+    lastReplyNs = GatewayIo::nowNs();
+    double rtt = r.rttNs / 1e9;
+    if (r.ok) {
+        replies++;
+        rtts.push_back(rtt);
+        rttStats.collect(rtt);
+        rttVector.record(rtt);
+    }
+    else {
+        errors++;
+    }
+}
+
+size_t SocketGateway::deliverReplies(simtime_t delay)
+{
+    return io.drain([this, delay](GatewayIo::Reply& r) {
+        account(r);
+
+        auto it = origins.find(r.id);
+        if (it == origins.end())
+            return;
+        cModule *origin = getSimulation()->getModule(it->second);
+        origins.erase(it);
+        if (origin == nullptr)
+            return;     // Modul inzwischen gelöscht
+
+        auto *reply = new SocketReply(r.ok ? "reply" : "replyError");
+        reply->setRequestId(r.id);
+        reply->setOk(r.ok);
+        reply->setPayload(r.payload.c_str());
+        reply->setRtt(r.rttNs / 1e9);
+        sendDirect(reply, delay, SIMTIME_ZERO, origin, "replyIn");
+    });
+}
+
+void SocketGateway::finish()
+{
+    // Späte Antworten nur noch zählen: nach dem Ende wird nichts mehr zugestellt
+    io.drain([this](GatewayIo::Reply& r) { account(r); });
+
+    double seconds = (lastReplyNs - firstRequestNs) / 1e9;
+    double p50 = 0, p99 = 0;
+    if (!rtts.empty()) {
+        std::sort(rtts.begin(), rtts.end());
+        p50 = rtts[(rtts.size() - 1) / 2];
+        p99 = rtts[(size_t)((rtts.size() - 1) * 0.99)];
+    }
+
+    EV << "SocketGateway: " << requests << " Anfragen, " << replies << " Antworten, "
+       << errors << " Fehler, " << rejected << " abgewiesen, "
+       << io.getConnects() << " Verbindungsaufbauten\n";
+    if (seconds > 0)
+        EV << "  " << replies / seconds << " msgs/s, RTT p50=" << p50 * 1e3
+           << "ms p99=" << p99 * 1e3 << "ms\n";
+
+    recordScalar("requests", requests);
+    recordScalar("replies", replies);
+    recordScalar("errors", errors);
+    recordScalar("rejected", rejected);
+    recordScalar("connects", (double)io.getConnects());
+    recordScalar("msgsPerSec", seconds > 0 ? replies / seconds : 0);
+    recordScalar("rttP50", p50, "s");
+    recordScalar("rttP99", p99, "s");
+    rttStats.record();
+
+    if (scheduler != nullptr) {
+        const auto& timer = scheduler->getTimerLateness();
+        const auto& fds = scheduler->getFdDispatch();
+        recordScalar("schedulerTimerWakeups", timer.count);
+        recordScalar("schedulerTimerLatenessMean", timer.meanNs() / 1e9, "s");
+        recordScalar("schedulerTimerLatenessP99", timer.percentileNs(0.99) / 1e9, "s");
+        recordScalar("schedulerFdWakeups", fds.count);
+        recordScalar("schedulerFdDispatchMean", fds.meanNs() / 1e9, "s");
+        recordScalar("schedulerFdDispatchP99", fds.percentileNs(0.99) / 1e9, "s");
+    }
+}
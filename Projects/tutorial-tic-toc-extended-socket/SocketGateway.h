@@ -0,0 +1,68 @@
+#ifndef SOCKETGATEWAY_H_
+#define SOCKETGATEWAY_H_
+
+#include <omnetpp.h>
+#include <unordered_map>
+#include <vector>
+#include "EpollRealTimeScheduler.h"
+#include "GatewayIo.h"
+
+using namespace omnetpp;
+
+/**
+ * Gemeinsamer Zugang aller Module zum externen Echo-Server.
+ *
+ * Statt pro Nachricht einen Thread und eine TCP-Verbindung aufzumachen,
+ * reichen die Module ihre Anfragen mit request() ein; GatewayIo schickt
+ * sie über einen Pool dauerhafter Verbindungen. Antworten kommen als
+ * SocketReply per sendDirect an das Gate "replyIn" des anfragenden Moduls
+ * zurück, also im Simulationsthread und als ganz normales Ereignis.
+ *
+ * Mit dem EpollRealTimeScheduler meldet das Gateway das eventfd der
+ * Antworten beim Scheduler an und wird geweckt, sobald eine Antwort da
+ * ist; die SocketReply trägt dann die Ankunftszeit. Mit jedem anderen
+ * Scheduler holt ein Timer die Antworten im Takt pollInterval ab.
+ */
+class SocketGateway : public cSimpleModule, public EpollRealTimeScheduler::IListener
+{
+  public:
+    virtual ~SocketGateway();
+
+    /**
+     * Anfrage für origin einreihen. Gibt die requestId der späteren
+     * SocketReply zurück, 0 wenn schon zu viele Anfragen offen sind
+     */
+    uint64_t request(cModule *origin, const char *payload);
+
+    virtual bool notify(int fd, simtime_t arrival) override;
+    virtual bool expectsInput() const override { return io.getOutstanding() > 0; }
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+  private:
+    void account(const GatewayIo::Reply& reply);
+    size_t deliverReplies(simtime_t delay);
+
+    GatewayIo io;
+    EpollRealTimeScheduler *scheduler = nullptr;   // nullptr: Polling
+    cMessage *pollTimer = nullptr;
+    simtime_t pollInterval;
+    uint64_t nextRequestId = 1;
+    std::unordered_map<uint64_t, int> origins;  // requestId -> Modul-ID
+
+    // Statistik
+    long requests = 0;
+    long replies = 0;
+    long errors = 0;
+    long rejected = 0;
+    int64_t firstRequestNs = 0;
+    int64_t lastReplyNs = 0;
+    std::vector<double> rtts;   // Sekunden, für p50/p99 in finish()
+    cStdDev rttStats;
+    cOutVector rttVector;
+};
+
+#endif /* SOCKETGATEWAY_H_ */
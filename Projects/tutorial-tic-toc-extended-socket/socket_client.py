@@ -7,19 +7,22 @@ import socketserver
 from contextlib import suppress
 
 
-class EchoRequestHandler(socketserver.BaseRequestHandler):
-    """Handles a single client connection and sends back an echo message."""
+class EchoRequestHandler(socketserver.StreamRequestHandler):
+    """Answers every newline-terminated line on a persistent connection.
 
-    def handle(self) -> None:
-        data = self.request.recv(1024)
-        if not data:
-            return
+    The SocketGateway keeps its connections open and pipelines requests,
+    one per line; replies go back in order, one line each. A client that
+    sends a single message without a newline and half-closes still gets
+    its echo.
+    """
 
-        message = data.decode("utf-8", errors="replace").strip()
-        logging.info("received '%s' from %s:%s", message, *self.client_address)
+    def handle(self) -> None:
+        for line in self.rfile:
+            message = line.decode("utf-8", errors="replace").strip()
+            logging.debug("received '%s' from %s:%s", message, *self.client_address)
 
-        response = f"Echo vom Python-Server: {message}".encode("utf-8")
-        self.request.sendall(response)
+            response = f"Echo vom Python-Server: {message}\n".encode("utf-8")
+            self.wfile.write(response)
 
 
 class ThreadedTCPServer(socketserver.ThreadingMixIn, socketserver.TCPServer):
@@ -2,104 +2,83 @@
 #include <cstring>
 #include <string> // statt <string.h> in C++
 #include "AppPacket_m.h"        // aus der .msg generiert
+#include "SocketReply_m.h"
+#include "SocketGateway.h"
 #include <cstdlib>
 #include <ctime>
-#include <iostream>
-#include <unistd.h>
-#include <arpa/inet.h>
-#include <thread>
-
-bool connectAndEcho(const std::string& server_ip, int server_port, const std::string& message)
-{
-    // 1️⃣ Socket erstellen (IPv4, TCP)
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        perror("socket");
-        return false;
-    }
-
-    // 2️⃣ Server-Adresse vorbereiten
-    sockaddr_in server_addr{};
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(server_port);
-    if (inet_pton(AF_INET, server_ip.c_str(), &server_addr.sin_addr) <= 0) {
-        std::cerr << "Ungültige IP-Adresse\n";
-        close(sock);
-        return false;
-    }
-
-    // 3️⃣ Verbindung herstellen
-    if (connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        perror("connect");
-        close(sock);
-        return false;
-    }
-
-    std::cout << "✅ Verbunden mit " << server_ip << ":" << server_port << "\n";
-
-    // 4️⃣ Nachricht senden
-    ssize_t sent = send(sock, message.c_str(), message.size(), 0);
-    if (sent < 0) {
-        perror("send");
-        close(sock);
-        return false;
-    }
-
-    // 5️⃣ Antwort empfangen
-    char buffer[1024] = {0};
-    ssize_t n = recv(sock, buffer, sizeof(buffer) - 1, 0);
-    if (n < 0) {
-        perror("recv");
-        close(sock);
-        return false;
-    }
-
-    buffer[n] = '\0';
-    std::cout << "💬 Antwort vom Server: " << buffer << "\n";
-
-    // 6️⃣ Verbindung schließen
-    close(sock);
-    return true;
-}
 
 using namespace omnetpp;
 
 class Txc1 : public cSimpleModule
 {
+  public:
+    virtual ~Txc1();
+
   protected:
     int address;                // eigene Adresse aus NED-Parameter
+    SocketGateway *gateway = nullptr;   // Echo über den gemeinsamen Verbindungspool
+    cMessage *sendTimer = nullptr;      // nur tic: nächstes Paket verschicken
+    int remaining = 0;
 
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
+    void sendPacket();
+    void handleReply(SocketReply *reply);
 };
 
 Define_Module(Txc1);
 
+Txc1::~Txc1()
+{
+    cancelAndDelete(sendTimer);
+}
+
 void Txc1::initialize()
 {
-    // random destination
     srand(time(nullptr));
-    int rDest = rand() % 11 + 1;
-
 
     address = par("address");   // 0 für tic, 1 für toc
+    gateway = check_and_cast<SocketGateway *>(getModuleByPath(par("gatewayModule")));
 
     if (strcmp(getName(), "tic") == 0) {
-        auto *pkt = new AppPacket("hello");
-        pkt->setSrc(address);
-        pkt->setDest(rDest);
-        pkt->setPayload("Das ist die Nachricht, die versendet wird");
+        remaining = par("messages");
+        sendTimer = new cMessage("send");
+        if (remaining > 0)
+            sendPacket();
+    }
+}
 
-        // Länge korrekt setzen:
-        size_t bytes = std::strlen(pkt->getPayload());
-        pkt->setByteLength(bytes);              // oder: pkt->setBitLength(8*bytes);
+void Txc1::sendPacket()
+{
+    // random destination
+    int rDest = rand() % 11 + 1;
 
-        send(pkt, "out");
-    }
+    auto *pkt = new AppPacket("hello");
+    pkt->setSrc(address);
+    pkt->setDest(rDest);
+    pkt->setPayload("Das ist die Nachricht, die versendet wird");
+
+    // Länge korrekt setzen:
+    size_t bytes = std::strlen(pkt->getPayload());
+    pkt->setByteLength(bytes);              // oder: pkt->setBitLength(8*bytes);
+
+    send(pkt, "out");
+
+    if (--remaining > 0)
+        scheduleAfter(par("sendInterval").doubleValue(), sendTimer);
 }
 
 void Txc1::handleMessage(cMessage *msg)
 {
+    if (msg == sendTimer) {
+        sendPacket();
+        return;
+    }
+    if (msg->arrivedOn("replyIn")) {
+        handleReply(check_and_cast<SocketReply *>(msg));
+        return;
+    }
+
     auto *pkt = check_and_cast<AppPacket*>(msg);
 
     if (pkt->getDest() == address) {
@@ -107,11 +86,9 @@ void Txc1::handleMessage(cMessage *msg)
            << " dest=" << pkt->getDest()
            << " hops=" << pkt->getHopCount()
            << " payload=\"" << pkt->getPayload() << "\"\n";
-        // Echo in eigenem Thread starten
-        std::thread t([](){
-            connectAndEcho("127.0.0.1", 65432, "Hallo vom C++-Client!");
-        });
-        t.detach();
+        // Echo über das Gateway: kein eigener Thread, keine neue Verbindung
+        if (gateway->request(this, pkt->getPayload()) == 0)
+            EV_WARN << "Echo abgewiesen: zu viele offene Anfragen\n";
 
         delete pkt;
     } else {
@@ -121,11 +98,12 @@ void Txc1::handleMessage(cMessage *msg)
     }
 }
 
-
-
-
-
-
-
-
-
+void Txc1::handleReply(SocketReply *reply)
+{
+    if (reply->getOk())
+        EV << "💬 Antwort vom Server: " << reply->getPayload()
+           << " (RTT " << reply->getRtt() * 1e3 << "ms)\n";
+    else
+        EV_WARN << "Echo fehlgeschlagen: " << reply->getPayload() << "\n";
+    delete reply;
+}
@@ -0,0 +1,58 @@
+#include "AllocCounter.h"
+
+#ifdef TICTOC_COUNT_ALLOCS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Ersetzt den globalen operator new für den ganzen Prozess, also zählen
+// auch die Allokationen des OMNeT++-Kerns (FES, Gates, Protokoll) mit
+static std::atomic<int64_t> g_allocations{0};
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int64_t allocationCount()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+int64_t allocationCount()
+{
+    return -1;
+}
+
+#endif
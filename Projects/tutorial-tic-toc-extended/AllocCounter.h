@@ -0,0 +1,12 @@
+#ifndef ALLOCCOUNTER_H_
+#define ALLOCCOUNTER_H_
+
+#include <cstdint>
+
+/**
+ * Anzahl der Heap-Allokationen (operator new) seit Programmstart.
+ * Nur mit -DTICTOC_COUNT_ALLOCS übersetzt, sonst immer -1
+ */
+int64_t allocationCount();
+
+#endif /* ALLOCCOUNTER_H_ */
@@ -0,0 +1,104 @@
+#include "AppPacketPool.h"
+#include <iostream>
+#include <sys/resource.h>
+#include "AllocCounter.h"
+
+Define_Module(AppPacketPool);
+
+AppPacketPool::~AppPacketPool()
+{
+    for (AppPacket *pkt : freeList)
+        delete pkt;
+}
+
+void AppPacketPool::initialize()
+{
+    enabled = par("enabled");
+    maxSize = par("maxSize").intValue();
+    freeList.reserve(std::min<size_t>(maxSize, 65536));
+
+    startWall = std::chrono::steady_clock::now();
+    startAllocations = allocationCount();
+}
+
+AppPacket *AppPacketPool::acquire(const char *name)
+{
+    Enter_Method_Silent();
+
+    AppPacket *pkt;
+    if (!freeList.empty()) {
+        pkt = freeList.back();
+        freeList.pop_back();
+        pkt->setName(name);
+        reused++;
+    }
+    else {
+        pkt = new AppPacket(name);
+        created++;
+    }
+    drop(pkt);
+    return pkt;
+}
+
+void AppPacketPool::release(AppPacket *pkt)
+{
+    Enter_Method_Silent();
+    take(pkt);
+
+    delivered++;
+    hops += pkt->getHopCount() + 1;
+
+    if (!enabled || freeList.size() >= maxSize) {
+        delete pkt;
+        return;
+    }
+    // Zustand zurücksetzen; die Nutzdaten nicht länger festhalten
+    pkt->setSrc(0);
+    pkt->setDest(0);
+    pkt->setHopCount(0);
+    pkt->setPayload(PayloadRef());
+    pkt->setByteLength(0);
+    freeList.push_back(pkt);
+}
+
+void AppPacketPool::finish()
+{
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - startWall).count();
+    eventnumber_t events = getSimulation()->getEventNumber();
+    double eventsPerSec = wall > 0 ? events / wall : 0;
+    double simsecPerSec = wall > 0 ? simTime().dbl() / wall : 0;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peakRss = usage.ru_maxrss;     // kB
+
+    int64_t allocations = allocationCount();
+    if (allocations >= 0)
+        allocations -= startAllocations;
+    double allocationsPerHop = -1;
+    if (allocations >= 0 && hops > 0)
+        allocationsPerHop = double(allocations) / hops;
+
+    recordScalar("created", created);
+    recordScalar("reused", reused);
+    recordScalar("delivered", delivered);
+    recordScalar("hops", hops);
+    recordScalar("events", events);
+    recordScalar("wallTime", wall, "s");
+    recordScalar("eventsPerSec", eventsPerSec);
+    recordScalar("simsecPerSec", simsecPerSec);
+    recordScalar("peakRss", peakRss, "kB");
+    if (allocations >= 0)
+        recordScalar("allocations", allocations);
+    if (allocationsPerHop >= 0)
+        recordScalar("allocationsPerHop", allocationsPerHop);
+
+    // Eine Zeile auch im Express-Modus, für bench.sh
+    std::cout << "BENCH N=" << getParentModule()->par("N").intValue()
+              << " pool=" << (enabled ? "on" : "off")
+              << " events=" << events << " wall=" << wall
+              << " events/s=" << (long)eventsPerSec << " simsec/s=" << simsecPerSec
+              << " hops=" << hops << " created=" << created << " reused=" << reused
+              << " rss_kb=" << peakRss << " allocs=" << allocations
+              << " allocs/hop=" << allocationsPerHop << std::endl;
+}
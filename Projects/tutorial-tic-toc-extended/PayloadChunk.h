@@ -0,0 +1,91 @@
+#ifndef PAYLOADCHUNK_H_
+#define PAYLOADCHUNK_H_
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <string>
+#include <utility>
+
+/**
+ * Unveränderliche Nutzdaten mit Referenzzähler, nach dem Vorbild der
+ * Chunks in INET: einmal erzeugt, werden die Bytes nie mehr geändert und
+ * nur noch geteilt. Kopieren eines PayloadRef (etwa durch dup() eines
+ * AppPacket bei Fan-out) zählt nur hoch, statt Text zu kopieren.
+ *
+ * Der Zähler ist nicht atomar: eine Simulation läuft in einem Thread, und
+ * bei parsim hat jede Partition ihren eigenen Prozess.
+ */
+class PayloadChunk
+{
+  public:
+    size_t size() const { return length; }
+    const char *data() const { return bytes; }
+
+  private:
+    friend class PayloadRef;
+
+    // Kopf und Bytes liegen in einer einzigen Allokation; über operator new,
+    // damit sie in allocs/hop mitzählt (AllocCounter.cc)
+    static PayloadChunk *create(const char *data, size_t len)
+    {
+        void *mem = ::operator new(sizeof(PayloadChunk) + len + 1);
+        auto *chunk = new (mem) PayloadChunk();
+        chunk->length = len;
+        std::memcpy(chunk->bytes, data, len);
+        chunk->bytes[len] = '\0';
+        return chunk;
+    }
+
+    void ref() { refs++; }
+    void unref()
+    {
+        if (--refs == 0) {
+            this->~PayloadChunk();
+            ::operator delete(this);
+        }
+    }
+
+    size_t refs = 1;
+    size_t length = 0;
+    char bytes[1];
+};
+
+/**
+ * Geteilter Verweis auf einen PayloadChunk; leer entspricht ""
+ */
+class PayloadRef
+{
+  public:
+    PayloadRef() {}
+    explicit PayloadRef(const char *text) : PayloadRef(text, std::strlen(text)) {}
+    explicit PayloadRef(const std::string& text) : PayloadRef(text.data(), text.size()) {}
+    PayloadRef(const char *data, size_t len) : chunk(PayloadChunk::create(data, len)) {}
+
+    PayloadRef(const PayloadRef& other) : chunk(other.chunk) { if (chunk) chunk->ref(); }
+    PayloadRef(PayloadRef&& other) noexcept : chunk(other.chunk) { other.chunk = nullptr; }
+    ~PayloadRef() { if (chunk) chunk->unref(); }
+
+    PayloadRef& operator=(PayloadRef other) noexcept
+    {
+        std::swap(chunk, other.chunk);
+        return *this;
+    }
+
+    size_t size() const { return chunk ? chunk->size() : 0; }
+    const char *c_str() const { return chunk ? chunk->data() : ""; }
+    std::string str() const { return std::string(c_str(), size()); }
+    /** Anzahl der Verweise auf dieselben Bytes (0 bei leer) */
+    size_t useCount() const { return chunk ? chunk->refs : 0; }
+
+  private:
+    PayloadChunk *chunk = nullptr;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const PayloadRef& payload)
+{
+    return os.write(payload.c_str(), payload.size());
+}
+
+#endif /* PAYLOADCHUNK_H_ */
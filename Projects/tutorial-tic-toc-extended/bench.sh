@@ -0,0 +1,17 @@
+#!/bin/sh
+#
+# Benchmark der Middleman-Kette: Ereignisse/s und Allokationen pro Hop für
+# N = 10, 1000, 100000, jeweils mit Pool + geteilten Nutzdaten und ohne.
+#
+# Übersetzt das Projekt mit Allokationszähler (-DTICTOC_COUNT_ALLOCS) und
+# führt alle Läufe der Config "Bench" aus omnetpp.ini nacheinander aus.
+#
+set -e
+cd "$(dirname "$0")"
+
+opp_makemake -f -o tictoc -DTICTOC_COUNT_ALLOCS
+make MODE=release
+
+for run in $(./tictoc -u Cmdenv -c Bench -q runnumbers); do
+    ./tictoc -u Cmdenv -c Bench -r "$run" | grep '^BENCH'
+done
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Speedup von TictocExtended mit parsim gegenüber der Partitionsanzahl.
+#
+#   ./parsim-bench.sh [N] [Partitionen...]      (Standard: 10000  1 2 4 8)
+#
+# Für jede Partitionsanzahl P wird die Kette tic, middleman[0..N-1], toc in
+# P zusammenhängende Blöcke geschnitten (parsim.ini), dann laufen P Prozesse
+# der Config "Parsim" gleichzeitig und tauschen sich über benannte Pipes in
+# comm/ aus. P=1 ist der sequentielle Lauf ohne parsim. Gemessen wird die
+# Wanduhrzeit, bis alle Prozesse fertig sind.
+#
+set -e
+cd "$(dirname "$0")"
+
+N=${1:-10000}
+[ $# -gt 0 ] && shift
+PARTITIONS=${*:-1 2 4 8}
+BIN=./tictoc
+
+if [ ! -x "$BIN" ]; then
+    opp_makemake -f -o tictoc
+    make MODE=release
+fi
+mkdir -p comm
+
+now() { date +%s.%N; }
+
+base=""
+for P in $PARTITIONS; do
+    {
+        echo "include omnetpp.ini"
+        echo
+        echo "[Config ParsimP$P]"
+        echo "extends = Parsim"
+        echo "*.tic.partition-id = 0"
+        echo "*.toc.partition-id = $((P - 1))"
+        k=0
+        while [ $k -lt "$P" ]; do
+            echo "*.middleman[$((k * N / P))..$(((k + 1) * N / P - 1))].partition-id = $k"
+            k=$((k + 1))
+        done
+    } > parsim.ini
+
+    start=$(now)
+    if [ "$P" -eq 1 ]; then
+        $BIN -u Cmdenv -f parsim.ini -c ParsimP1 --parallel-simulation=false \
+            "--*.N=$N" "--*.tic.dest=$((N + 1))" > parsim-0.log 2>&1
+    else
+        pids=""
+        k=0
+        while [ $k -lt "$P" ]; do
+            $BIN -u Cmdenv -f parsim.ini -c "ParsimP$P" "-p$k,$P" \
+                "--*.N=$N" "--*.tic.dest=$((N + 1))" > "parsim-$k.log" 2>&1 &
+            pids="$pids $!"
+            k=$((k + 1))
+        done
+        for pid in $pids; do
+            wait "$pid" || { echo "P=$P: Prozess fehlgeschlagen, siehe parsim-*.log" >&2; exit 1; }
+        done
+    fi
+    wall=$(echo "$start $(now)" | awk '{ printf "%.3f", $2 - $1 }')
+    [ -z "$base" ] && base=$wall
+    echo "N=$N P=$P wall=${wall}s speedup=$(echo "$base $wall" | awk '{ printf "%.2f", $1 / $2 }')"
+done
@@ -1,6 +1,7 @@
 #include <omnetpp.h>
 #include <cstring>              // statt <string.h> in C++
 #include "AppPacket_m.h"        // aus der .msg generiert
+#include "AppPacketPool.h"
 #include <cstdlib>
 #include <ctime>
 
@@ -8,40 +9,87 @@ using namespace omnetpp;
 
 class Txc1 : public cSimpleModule
 {
+  public:
+    virtual ~Txc1();
+
   protected:
     int address;                // eigene Adresse aus NED-Parameter
+    AppPacketPool *pool = nullptr;      // nullptr: new/delete wie bisher
+    cMessage *sendTimer = nullptr;      // nur tic: nächstes Paket verschicken
+    int remaining = 0;
+    PayloadRef payload;         // einmal erzeugt, von allen Paketen geteilt
+    bool sharedPayload = true;
+    int fixedDest = -1;
 
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
+    void sendPacket();
 };
 
 Define_Module(Txc1);
 
+Txc1::~Txc1()
+{
+    cancelAndDelete(sendTimer);
+}
+
 void Txc1::initialize()
 {
-    // random destination
     srand(time(nullptr));
-    int rDest = rand() % 11 + 1;
-
 
     address = par("address");   // 0 für tic, 1 für toc
+    const char *poolPath = par("poolModule");
+    if (*poolPath)
+        pool = check_and_cast<AppPacketPool *>(getModuleByPath(poolPath));
 
     if (strcmp(getName(), "tic") == 0) {
-        auto *pkt = new AppPacket("hello");
-        pkt->setSrc(address);
-        pkt->setDest(rDest);
-        pkt->setPayload("Das ist die Nachricht, die versendet wird");
+        payload = PayloadRef("Das ist die Nachricht, die versendet wird");
+        sharedPayload = par("sharedPayload");
+        fixedDest = par("dest");
+        remaining = par("messages");
+        sendTimer = new cMessage("send");
+        if (remaining > 0)
+            sendPacket();
+    }
+}
 
-        // Länge korrekt setzen:
-        size_t bytes = std::strlen(pkt->getPayload());
-        pkt->setByteLength(bytes);              // oder: pkt->setBitLength(8*bytes);
+void Txc1::sendPacket()
+{
+    // random destination, außer das Ziel ist fest vorgegeben
+    int rDest = fixedDest;
+    if (rDest < 0)
+        rDest = rand() % (getParentModule()->par("N").intValue() + 1) + 1;
 
-        send(pkt, "out");
+    AppPacket *pkt;
+    if (pool != nullptr) {
+        pkt = pool->acquire("hello");
+        take(pkt);
+    }
+    else {
+        pkt = new AppPacket("hello");
     }
+    pkt->setSrc(address);
+    pkt->setDest(rDest);
+    // Geteilt statt kopiert; sharedPayload=false erzeugt die Bytes pro Paket neu
+    pkt->setPayload(sharedPayload ? payload : PayloadRef(payload.c_str()));
+
+    // Länge korrekt setzen:
+    size_t bytes = pkt->getPayload().size();
+    pkt->setByteLength(bytes);              // oder: pkt->setBitLength(8*bytes);
+
+    send(pkt, "out");
+
+    if (--remaining > 0)
+        scheduleAfter(par("sendInterval").doubleValue(), sendTimer);
 }
 
 void Txc1::handleMessage(cMessage *msg)
 {
+    if (msg == sendTimer) {
+        sendPacket();
+        return;
+    }
+
     auto *pkt = check_and_cast<AppPacket*>(msg);
 
     if (pkt->getDest() == address) {
@@ -49,9 +97,13 @@ void Txc1::handleMessage(cMessage *msg)
            << " dest=" << pkt->getDest()
            << " hops=" << pkt->getHopCount()
            << " payload=\"" << pkt->getPayload() << "\"\n";
-        delete pkt;
+        if (pool != nullptr)
+            pool->release(pkt);
+        else
+            delete pkt;
     } else {
-        // Weiterleiten (Beispiel: simple forward)
+        // Weiterleiten (Beispiel: simple forward); send() übergibt nur den
+        // Besitz, kopiert wird dabei nichts
         pkt->setHopCount(pkt->getHopCount() + 1);
         send(pkt, "out");
     }